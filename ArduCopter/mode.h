@@ -1366,6 +1366,11 @@ private:
 
     void log_data() const;
     float waveform(float time);
+#if HAL_WITH_DSP
+    int8_t freqresp_axis() const;
+    void freqresp_run();
+    void freqresp_report();
+#endif
 
     enum class AxisType {
         NONE = 0,           // none
@@ -1391,6 +1396,9 @@ private:
     AP_Float time_fade_in;      // Time to reach maximum amplitude of chirp
     AP_Float time_record;       // Time taken to complete the chirp waveform
     AP_Float time_fade_out;     // Time to reach zero amplitude after chirp finishes
+#if HAL_WITH_DSP
+    AP_Int8 estimate;           // Estimate the frequency response and propose rate gains
+#endif
 
     bool att_bf_feedforward;    // Setting of attitude_control->get_bf_feedforward
     float waveform_time;        // Time reference for waveform
@@ -1398,6 +1406,10 @@ private:
     float waveform_freq_rads;   // Instantaneous waveform frequency
     float time_const_freq;      // Time at constant frequency before chirp starts
     int8_t log_subsample;       // Subsample multiple for logging.
+#if HAL_WITH_DSP
+    AC_AutoTune_FreqResp *freqresp; // Frequency response estimate of the excited axis
+    bool freqresp_pending;      // Sweep finished, gains to be proposed once the estimate catches up
+#endif
 
     // System ID states
     enum class SystemIDModeState {
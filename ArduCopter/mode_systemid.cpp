@@ -61,6 +61,15 @@ const AP_Param::GroupInfo ModeSystemId::var_info[] = {
     // @User: Standard
     AP_GROUPINFO("_T_FADE_OUT", 7, ModeSystemId, time_fade_out, 2),
 
+#if HAL_WITH_DSP
+    // @Param: _ESTIMATE
+    // @DisplayName: System identification onboard estimate
+    // @Description: Estimate the frequency response of the excited roll, pitch or yaw rate loop during the sweep and propose rate PID gains from it once the sweep finishes. The gains are reported to the GCS and logged, not applied
+    // @Values: 0:Disabled, 1:Enabled
+    // @User: Advanced
+    AP_GROUPINFO("_ESTIMATE", 8, ModeSystemId, estimate, 0),
+#endif
+
     AP_GROUPEND
 };
 
@@ -70,6 +79,10 @@ ModeSystemId::ModeSystemId(void) : Mode()
 }
 
 #define SYSTEM_ID_DELAY     1.0f      // time in seconds waited after system id mode change for frequency sweep injection
+#define SYSTEM_ID_PHASE_MARGIN  45.0f // phase margin in degrees of the proposed rate loop
+#define SYSTEM_ID_D_LEAD        30.0f // phase lead in degrees from the proposed roll and pitch D
+#define SYSTEM_ID_PI_RATIO      1.0f  // proposed roll and pitch I as a multiple of P
+#define SYSTEM_ID_YAW_PI_RATIO  0.1f  // proposed yaw I as a multiple of P
 
 // systemId_init - initialise systemId controller
 bool ModeSystemId::init(bool ignore_checks)
@@ -95,6 +108,20 @@ bool ModeSystemId::init(bool ignore_checks)
     systemid_state = SystemIDModeState::SYSTEMID_STATE_TESTING;
     log_subsample = 0;
 
+#if HAL_WITH_DSP
+    freqresp_pending = false;
+    if (estimate && freqresp_axis() >= 0) {
+        if (freqresp == nullptr) {
+            freqresp = new AC_AutoTune_FreqResp();
+        }
+        if (freqresp == nullptr ||
+            !freqresp->init(copter.scheduler.get_loop_rate_hz(), frequency_start, frequency_stop) ||
+            !freqresp->start_thread()) {
+            gcs().send_text(MAV_SEVERITY_WARNING, "SystemID: estimate unavailable");
+        }
+    }
+#endif
+
     gcs().send_text(MAV_SEVERITY_INFO, "SystemID Starting: axis=%d", (unsigned)axis);
 
     copter.Log_Write_SysID_Setup(axis, waveform_magnitude, frequency_start, frequency_stop, time_fade_in, time_const_freq, time_record, time_fade_out);
@@ -193,6 +220,9 @@ void ModeSystemId::run()
             if (waveform_time > SYSTEM_ID_DELAY + time_fade_in + time_const_freq + time_record + time_fade_out) {
                 systemid_state = SystemIDModeState::SYSTEMID_STATE_STOPPED;
                 gcs().send_text(MAV_SEVERITY_INFO, "SystemID Finished");
+#if HAL_WITH_DSP
+                freqresp_pending = true;
+#endif
                 break;
             }
 
@@ -257,6 +287,10 @@ void ModeSystemId::run()
         attitude_control->set_throttle_out(pilot_throttle_scaled, true, g.throttle_filt);
     }
 
+#if HAL_WITH_DSP
+    freqresp_run();
+#endif
+
     if (log_subsample <= 0) {
         log_data();
         if (copter.should_log(MASK_LOG_ATTITUDE_FAST) && copter.should_log(MASK_LOG_ATTITUDE_MED)) {
@@ -291,6 +325,131 @@ void ModeSystemId::log_data() const
     copter.Log_Write_Attitude();
 }
 
+#if HAL_WITH_DSP
+// rate axis whose frequency response is estimated, -1 if none
+int8_t ModeSystemId::freqresp_axis() const
+{
+    switch ((AxisType)axis.get()) {
+        case AxisType::INPUT_ROLL:
+        case AxisType::RECOVER_ROLL:
+        case AxisType::RATE_ROLL:
+        case AxisType::MIX_ROLL:
+            return 0;
+        case AxisType::INPUT_PITCH:
+        case AxisType::RECOVER_PITCH:
+        case AxisType::RATE_PITCH:
+        case AxisType::MIX_PITCH:
+            return 1;
+        case AxisType::INPUT_YAW:
+        case AxisType::RECOVER_YAW:
+        case AxisType::RATE_YAW:
+        case AxisType::MIX_YAW:
+            return 2;
+        case AxisType::NONE:
+        case AxisType::MIX_THROTTLE:
+            break;
+    }
+    return -1;
+}
+
+// feed the estimate during the sweep and report it once analysed
+void ModeSystemId::freqresp_run()
+{
+    const int8_t freq_axis = freqresp_axis();
+    if (freqresp == nullptr || !estimate || freq_axis < 0) {
+        return;
+    }
+
+    if (systemid_state == SystemIDModeState::SYSTEMID_STATE_TESTING) {
+        // the whole rate controller output, including the sweep when it is injected at the mixer
+        float actuator;
+        switch (freq_axis) {
+            case 0:
+                actuator = motors->get_roll() + motors->get_roll_ff();
+                break;
+            case 1:
+                actuator = motors->get_pitch() + motors->get_pitch_ff();
+                break;
+            case 2:
+                actuator = motors->get_yaw() + motors->get_yaw_ff();
+                break;
+            default:
+                return;
+        }
+        freqresp->push_sample(waveform_sample, actuator, ahrs.get_gyro()[freq_axis]);
+        return;
+    }
+
+    // the analysis thread is still working through the end of the sweep
+    if (!freqresp_pending || freqresp->busy()) {
+        return;
+    }
+    freqresp_pending = false;
+    freqresp_report();
+}
+
+// propose rate gains from the estimate, and log them with the response they came from
+void ModeSystemId::freqresp_report()
+{
+    const uint8_t freq_axis = freqresp_axis();
+    const bool yaw = freq_axis == 2;
+    AC_AutoTune_FreqResp::Result result;
+    if (!freqresp->propose_gains(result, SYSTEM_ID_PHASE_MARGIN, yaw ? 0 : SYSTEM_ID_D_LEAD, yaw ? SYSTEM_ID_YAW_PI_RATIO : SYSTEM_ID_PI_RATIO)) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "SystemID: response not coherent enough to propose gains");
+        return;
+    }
+
+    gcs().send_text(MAV_SEVERITY_INFO, "SystemID: K=%.1f T=%.1fms Fc=%.1fHz", (double)result.plant_gain, (double)(result.delay_s * 1000), (double)result.crossover_hz);
+    gcs().send_text(MAV_SEVERITY_INFO, "SystemID: proposed P=%.4f I=%.4f D=%.5f", (double)result.kP, (double)result.kI, (double)result.kD);
+
+    const uint64_t now_us = AP_HAL::micros64();
+
+// @LoggerMessage: SIDG
+// @Description: System ID onboard estimate and proposed rate gains
+// @Field: TimeUS: Time since system startup
+// @Field: Ax: Rate axis estimated, 0:roll, 1:pitch, 2:yaw
+// @Field: K: Fitted plant gain, body rate per second per unit of actuator output
+// @Field: T: Fitted plant delay
+// @Field: Fc: Crossover frequency of the proposed rate loop
+// @Field: P: Proposed rate P gain
+// @Field: I: Proposed rate I gain
+// @Field: D: Proposed rate D gain
+    AP::logger().Write("SIDG", "TimeUS,Ax,K,T,Fc,P,I,D", "s--sz---", "F-------", "QBffffff",
+                       now_us,
+                       freq_axis,
+                       (double)result.plant_gain,
+                       (double)result.delay_s,
+                       (double)result.crossover_hz,
+                       (double)result.kP,
+                       (double)result.kI,
+                       (double)result.kD);
+
+    AC_AutoTune_FreqResp::Response *response = new AC_AutoTune_FreqResp::Response[AC_AUTOTUNE_FREQRESP_WINDOW_MAX / 2];
+    if (response == nullptr) {
+        return;
+    }
+    const uint16_t n = freqresp->get_response(response, AC_AUTOTUNE_FREQRESP_WINDOW_MAX / 2, AC_AUTOTUNE_FREQRESP_MIN_COHERENCE);
+    for (uint16_t i = 0; i < n; i++) {
+// @LoggerMessage: SIDF
+// @Description: System ID onboard estimate of the frequency response, one message per coherent frequency
+// @Field: TimeUS: Time since system startup
+// @Field: Ax: Rate axis estimated, 0:roll, 1:pitch, 2:yaw
+// @Field: F: Frequency
+// @Field: G: Gain from actuator output to body rate
+// @Field: Ph: Phase from actuator output to body rate
+// @Field: Coh: Coherence of the body rate with the sweep
+        AP::logger().Write("SIDF", "TimeUS,Ax,F,G,Ph,Coh", "s-z-d-", "F-----", "QBffff",
+                           now_us,
+                           freq_axis,
+                           (double)response[i].freq_hz,
+                           (double)response[i].gain,
+                           (double)response[i].phase_deg,
+                           (double)response[i].coherence);
+    }
+    delete[] response;
+}
+#endif // HAL_WITH_DSP
+
 // init_test - initialises the test
 float ModeSystemId::waveform(float time)
 {
@@ -6,8 +6,20 @@ check that replay produced identical results
 
 from __future__ import print_function
 
-def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose=False):
-    '''check replay log for matching output'''
+def values_match(v1, v2, tolerance):
+    '''check two logged values for a match. With a non-zero tolerance
+    floating point values may differ by that fraction of their
+    magnitude, or by that absolute amount when near zero'''
+    if v1 == v2:
+        return True
+    if tolerance <= 0 or not isinstance(v1, float) or not isinstance(v2, float):
+        return False
+    return abs(v1 - v2) <= tolerance * max(abs(v1), abs(v2), 1.0)
+
+def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose=False, tolerance=0.0):
+    '''check replay log for matching output. A non-zero tolerance
+    allows for changes which alter floating point rounding but not the
+    estimate, see values_match()'''
     from pymavlink import mavutil
     progress("Processing log %s" % logfile)
     failure = 0
@@ -58,7 +70,7 @@ def check_log(logfile, progress=print, ekf2_only=False, ekf3_only=False, verbose
                 continue
             v1 = getattr(m,f)
             v2 = getattr(mb,f)
-            if v1 != v2:
+            if not values_match(v1, v2, tolerance):
                 mismatch = True
                 errors += 1
                 progress("Mismatch in field %s.%s: %s %s" % (mtype, f, str(v1), str(v2)))
@@ -82,13 +94,14 @@ if __name__ == '__main__':
     parser.add_argument("--ekf2-only", action='store_true', help="only check EKF2")
     parser.add_argument("--ekf3-only", action='store_true', help="only check EKF3")
     parser.add_argument("--verbose", action='store_true', help="verbose output")
+    parser.add_argument("--tolerance", type=float, default=0.0, help="relative tolerance for floating point fields, zero for an exact match")
     parser.add_argument("logs", metavar="LOG", nargs="+")
 
     args = parser.parse_args()
 
     failed = False
     for filename in args.logs:
-        if not check_log(filename, print, args.ekf2_only, args.ekf3_only, args.verbose):
+        if not check_log(filename, print, args.ekf2_only, args.ekf3_only, args.verbose, args.tolerance):
             failed = True
 
     if failed:
@@ -18,8 +18,9 @@ from pymavlink import DFReader
 import check_replay
 
 class CheckReplayBranch(object):
-    def __init__(self, master='remotes/origin/master'):
+    def __init__(self, master='remotes/origin/master', tolerance=0.0):
         self.master = master
+        self.tolerance = tolerance
 
     def find_topdir(self):
         here = os.getcwd()
@@ -164,7 +165,7 @@ class CheckReplayBranch(object):
             self.progress("Running check_replay.py on Replay output log: %s" % new_log)
 
             # run check_replay across Replay log
-            if check_replay.check_log(new_log, verbose=True):
+            if check_replay.check_log(new_log, verbose=True, tolerance=self.tolerance):
                 self.progress("check_replay.py of (%s): OK" % new_log)
             else:
                 self.progress("check_replay.py of (%s): FAILED" % new_log)
@@ -181,10 +182,11 @@ if __name__ == '__main__':
     from argparse import ArgumentParser
     parser = ArgumentParser(description=__doc__)
     parser.add_argument("--master", default='remotes/origin/master', help="branch to consider master branch")
+    parser.add_argument("--tolerance", type=float, default=0.0, help="relative tolerance for floating point fields, for changes which alter rounding but not the estimate")
 
     args = parser.parse_args()
 
-    s = CheckReplayBranch(master=args.master)
+    s = CheckReplayBranch(master=args.master, tolerance=args.tolerance)
     if not s.run():
         sys.exit(1)
 
@@ -7,7 +7,9 @@ Andrew Tridgell
 May 2017
 '''
 
-import os, sys, tempfile, gzip
+import os, sys, tempfile, zlib
+
+ROMFS_WINDOW_BITS = 12
 
 def write_encode(out, s):
     out.write(s.encode())
@@ -47,10 +49,13 @@ def embed_file(out, f, idx, embedded_name, uncompressed):
             contents += nul
         compressed.write(contents)
     else:
-        # compress it
+        # compress it as gzip with a limited window so that AP_ROMFS
+        # can stream the file with a small inflate window. The window
+        # bits must match AP_ROMFS_STREAM_WINDOW_BITS in AP_ROMFS.h
+        c = zlib.compressobj(9, zlib.DEFLATED, 16 + ROMFS_WINDOW_BITS)
         f = open(compressed.name, "wb")
-        with gzip.GzipFile(fileobj=f, mode='wb', filename='', compresslevel=9, mtime=0) as g:
-            g.write(contents)
+        f.write(c.compress(contents))
+        f.write(c.flush())
         f.close()
 
     compressed.seek(0)
@@ -9,13 +9,16 @@ AP_FLAKE8_CLEAN
 from __future__ import print_function
 import copy
 import math
+import mmap
 import os
 import shutil
+import struct
 import time
 import numpy
 
 from pymavlink import mavutil
 from pymavlink import mavextra
+from pymavlink import quaternion
 from pymavlink import rotmat
 
 from pysim import util
@@ -5428,6 +5431,58 @@ class AutoTestCopter(AutoTest):
         self.fly_proximity_avoidance_test_alt_no_avoid()
         self.fly_proximity_avoidance_test_corners()
 
+    def fly_oa_database_stress(self):
+        '''fill the object database from a 10k point/s simulated lidar'''
+        self.context_push()
+        ex = None
+        try:
+            self.load_fence("copter-avoidance-fence.txt")
+            self.set_parameters({
+                "FENCE_ENABLE": 1,
+                "PRX_TYPE": 10,
+                "OA_TYPE": 1,
+                "OA_DB_SIZE": 1000,
+                "OA_DB_QUEUE_SIZE": 200,
+                "OA_DB_OUTPUT": 3,
+                "SIM_PRX_SCAN": 10000,
+            })
+            self.reboot_sitl()
+
+            objects = set()
+            queue_full = []
+
+            def my_message_hook(mav, m):
+                if m.get_type() == 'ADSB_VEHICLE' and m.callsign.startswith("OA_DB"):
+                    objects.add(m.ICAO_address)
+                if m.get_type() == 'STATUSTEXT' and "DB queue full" in m.text:
+                    queue_full.append(m.text)
+
+            self.install_message_hook_context(my_message_hook)
+            self.set_message_rate_hz(mavutil.mavlink.MAVLINK_MSG_ID_ADSB_VEHICLE, 50)
+            self.takeoff(10, mode="LOITER")
+
+            # turn on the spot so the walls are scanned from every angle
+            self.set_rc(4, 1600)
+            self.delay_sim_time(20)
+            self.set_rc(4, 1500)
+
+            self.progress("%u objects in database" % len(objects))
+            if len(queue_full):
+                raise NotAchievedException("Database queue overflowed")
+            if len(objects) < 20:
+                raise NotAchievedException("Only %u objects in database" % len(objects))
+
+            self.do_RTL()
+        except Exception as e:
+            self.print_exception_caught(e)
+            ex = e
+        self.context_pop()
+        self.clear_fence()
+        self.disarm_vehicle(force=True)
+        self.reboot_sitl()
+        if ex is not None:
+            raise ex
+
     def fly_fence_avoidance_test(self):
         self.context_push()
         ex = None
@@ -6605,6 +6660,103 @@ class AutoTestCopter(AutoTest):
         self.takeoff(10)
         self.do_RTL()
 
+    def read_state_export(self, path):
+        '''return header and newest record of the shared memory state
+        export, as dictionaries'''
+        header_fmt = struct.Struct("<IHHHHIQ")
+        record_fmt = struct.Struct("<IIQ4f3f3f3f3f3f3iI16HI")
+        header_fields = ["magic", "version", "record_size", "ring_length",
+                         "loop_rate_hz", "reserved", "count"]
+        with open(path, "rb") as f:
+            m = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        header = dict(zip(header_fields, header_fmt.unpack_from(m, 0)))
+        if header["magic"] != 0x45535041:
+            raise NotAchievedException("Bad magic 0x%x" % header["magic"])
+        if header["version"] != 1 or header["record_size"] != record_fmt.size:
+            raise NotAchievedException("Unexpected layout %s" % str(header))
+        for attempt in range(10):
+            count = header_fmt.unpack_from(m, 0)[6]
+            if count == 0:
+                raise NotAchievedException("No records published")
+            ofs = 64 + ((count-1) % header["ring_length"]) * record_fmt.size
+            seq = struct.unpack_from("<I", m, ofs)[0]
+            values = record_fmt.unpack_from(m, ofs)
+            if seq == values[0] == (2*(count-1)+2) & 0xffffffff and seq == struct.unpack_from("<I", m, ofs)[0]:
+                break
+        else:
+            raise NotAchievedException("Could not get a consistent record")
+        header["count"] = count
+        record = {
+            "time_us": values[2],
+            "quat": values[3:7],
+            "gyro": values[7:10],
+            "pos_ned": values[16:19],
+            "vel_ned": values[19:22],
+            "lat": values[22],
+            "lng": values[23],
+            "alt_cm": values[24],
+            "flags": values[25],
+            "servo_pwm": values[26:42],
+        }
+        m.close()
+        return (header, record)
+
+    def test_state_export(self):
+        '''check the shared memory state export against MAVLink'''
+        path = "/dev/shm/ardupilot_state.%u" % self.sysid_thismav()
+        self.set_parameter("SHM_ENABLE", 1)
+        self.reboot_sitl()
+        self.wait_ready_to_arm()
+
+        (header, record) = self.read_state_export(path)
+        loop_rate = self.get_parameter("SCHED_LOOP_RATE")
+        if header["loop_rate_hz"] != loop_rate:
+            raise NotAchievedException("loop rate %u != %u" % (header["loop_rate_hz"], loop_rate))
+
+        # one record per main loop
+        self.delay_sim_time(5)
+        (header2, record2) = self.read_state_export(path)
+        elapsed = record2["time_us"] - record["time_us"]
+        records = header2["count"] - header["count"]
+        rate = records * 1.0e6 / elapsed
+        self.progress("%u records in %.1fs of vehicle time (%.0fHz)" % (records, elapsed*1.0e-6, rate))
+        if abs(rate - loop_rate) > 0.1 * loop_rate:
+            raise NotAchievedException("Publish rate %.0fHz not loop rate %uHz" % (rate, loop_rate))
+
+        self.takeoff(10, mode="LOITER")
+        self.set_rc(4, 1600)
+        self.delay_sim_time(2)
+        m = self.assert_receive_message('ATTITUDE', timeout=2)
+        p = self.assert_receive_message('GLOBAL_POSITION_INT', timeout=2)
+        s = self.assert_receive_message('SERVO_OUTPUT_RAW', timeout=2)
+        (header, record) = self.read_state_export(path)
+        self.set_rc(4, 1500)
+
+        q = quaternion.Quaternion(list(record["quat"]))
+        (roll, pitch, yaw) = q.euler
+        self.progress("shm: roll=%.1f pitch=%.1f yaw=%.1f mavlink: roll=%.1f pitch=%.1f yaw=%.1f" %
+                      (math.degrees(roll), math.degrees(pitch), math.degrees(yaw),
+                       math.degrees(m.roll), math.degrees(m.pitch), math.degrees(m.yaw)))
+        if (abs(math.degrees(roll - m.roll)) > 5 or
+                abs(math.degrees(pitch - m.pitch)) > 5 or
+                abs(mavextra.angle_diff(math.degrees(yaw), math.degrees(m.yaw))) > 10):
+            raise NotAchievedException("Attitude mismatch")
+
+        if not record["flags"] & (1 << 0) or not record["flags"] & (1 << 4):
+            raise NotAchievedException("Expected position valid and armed, flags=0x%x" % record["flags"])
+        if abs(record["lat"] - p.lat) > 100 or abs(record["lng"] - p.lon) > 100:
+            raise NotAchievedException("Position mismatch")
+        if abs(-record["pos_ned"][2] - p.relative_alt * 0.001) > 2:
+            raise NotAchievedException("Altitude mismatch %.1f %.1f" %
+                                       (-record["pos_ned"][2], p.relative_alt * 0.001))
+        for i in range(4):
+            pwm = getattr(s, "servo%u_raw" % (i+1))
+            if abs(record["servo_pwm"][i] - pwm) > 200:
+                raise NotAchievedException("Motor %u output %u != %u" %
+                                           (i+1, record["servo_pwm"][i], pwm))
+
+        self.do_RTL()
+
     def fly_each_frame(self):
         vinfo = vehicleinfo.VehicleInfo()
         copter_vinfo_options = vinfo.options[self.vehicleinfo_key()]
@@ -6775,6 +6927,107 @@ class AutoTestCopter(AutoTest):
     def get_touchdownexpected_durations_from_current_onboard_log(self, ignore_multi=False):
         return self.get_ground_effect_duration_from_current_onboard_log(12, ignore_multi=ignore_multi)
 
+    def StreamSchedulerRateLimited(self):
+        '''check streamed messages are thinned by priority on a link
+        that can't carry everything asked for'''
+        high = ['ATTITUDE']
+        low = ['AHRS2', 'RAW_IMU', 'SCALED_PRESSURE', 'VIBRATION', 'SIMSTATE', 'EKF_STATUS_REPORT']
+        rate = 50
+        self.context_push()
+        ex = None
+        try:
+            # the console runs at 115200, which is more than the
+            # defaults need but less than all of these at 50Hz
+            self.set_parameter("SIM_BAUDLIMIT_EN", 1)
+            for name in high + low:
+                self.set_message_rate_hz(name, rate)
+            self.delay_sim_time(5)
+
+            attitude_rate = self.get_message_rate('ATTITUDE', 10)
+            if attitude_rate < rate * 0.8:
+                raise NotAchievedException("High priority ATTITUDE slowed to %.1fHz (want >= %.1f)" %
+                                           (attitude_rate, rate * 0.8))
+            for name in low:
+                low_rate = self.get_message_rate(name, 10)
+                if low_rate >= attitude_rate:
+                    raise NotAchievedException("Low priority %s at %.1fHz not slowed more than ATTITUDE at %.1fHz" %
+                                               (name, low_rate, attitude_rate))
+
+            contents = self.ftp_read_files("@SYS/streams.txt", [0])[0]
+            self.progress("streams.txt:\n%s" % contents.decode('ascii'))
+            if contents.find(b"CHAN0 limit=") == -1:
+                raise NotAchievedException("No stream state for channel 0")
+        except Exception as e:
+            self.print_exception_caught(e)
+            ex = e
+        self.context_pop()
+        for name in high + low:
+            self.set_message_rate_hz(name, 0)
+        if ex is not None:
+            raise ex
+
+    def SystemIdEstimate(self):
+        '''sweep the roll rate loop in SystemId mode and check the gains
+        proposed by the onboard estimate are sensible'''
+        self.context_push()
+        ex = None
+        try:
+            # SID_AXIS enables the rest of the SID parameters
+            self.set_parameter("SID_AXIS", 7)  # rate roll
+            self.set_parameters({
+                "SID_MAGNITUDE": 20,
+                "SID_F_START_HZ": 1,
+                "SID_F_STOP_HZ": 40,
+                "SID_T_FADE_IN": 5,
+                "SID_T_REC": 30,
+                "SID_T_FADE_OUT": 2,
+                "SID_ESTIMATE": 1,
+                "LOG_DISARMED": 0,
+            })
+            self.reboot_sitl()
+
+            self.takeoff(20, mode='ALT_HOLD')
+            self.set_rc(3, 1500)
+            self.change_mode('SYSTEMID')
+            self.wait_statustext("SystemID Finished", timeout=60)
+            self.wait_statustext(r"SystemID: proposed P=([0-9.]+) I=([0-9.]+) D=([0-9.]+)", timeout=10, regex=True)
+            proposed_p = float(self.re_match.group(1))
+            proposed_i = float(self.re_match.group(2))
+            proposed_d = float(self.re_match.group(3))
+            self.change_mode('LAND')
+            self.wait_disarmed()
+
+            # the SITL quad flies well on its defaults, so the proposal
+            # should be within a factor of a few of them
+            for (name, proposed) in [("ATC_RAT_RLL_P", proposed_p),
+                                     ("ATC_RAT_RLL_I", proposed_i),
+                                     ("ATC_RAT_RLL_D", proposed_d)]:
+                current = self.get_parameter(name)
+                self.progress("%s: current=%f proposed=%f" % (name, current, proposed))
+                if proposed < current / 4 or proposed > current * 4:
+                    raise NotAchievedException("Proposed %s=%f not near %f" % (name, proposed, current))
+
+            # the proposal is logged with the fit it came from
+            dfreader = self.dfreader_for_current_onboard_log()
+            m = dfreader.recv_match(type="SIDG")
+            if m is None:
+                raise NotAchievedException("No SIDG message logged")
+            self.progress("SIDG: %s" % str(m))
+            if m.Ax != 0:
+                raise NotAchievedException("Estimated axis %u, not roll" % m.Ax)
+            if abs(m.P - proposed_p) > 0.0001:
+                raise NotAchievedException("Logged P=%f but proposed %f" % (m.P, proposed_p))
+            if m.K <= 0 or m.T <= 0 or m.T > 0.1 or m.Fc <= 0:
+                raise NotAchievedException("Fit K=%f T=%f Fc=%f not sensible" % (m.K, m.T, m.Fc))
+        except Exception as e:
+            self.print_exception_caught(e)
+            ex = e
+            self.disarm_vehicle(force=True)
+        self.context_pop()
+        self.reboot_sitl()
+        if ex is not None:
+            raise ex
+
     def GroundEffectCompensation_takeOffExpected(self):
         self.change_mode('ALT_HOLD')
         self.set_parameter("LOG_FILE_DSRMROT", 1)
@@ -7275,6 +7528,14 @@ class AutoTestCopter(AutoTest):
                  "Test Replay",
                  self.test_replay),
 
+            Test("StateExport",
+                 "Test shared memory state export",
+                 self.test_state_export),
+
+            Test("OADatabaseStress",
+                 "Fill object avoidance database from dense lidar",
+                 self.fly_oa_database_stress),
+
             Test("GroundEffectCompensation_touchDownExpected",
                  "Test EKF's handling of touchdown-expected",
                  self.GroundEffectCompensation_touchDownExpected),
@@ -7286,6 +7547,14 @@ class AutoTestCopter(AutoTest):
             Test("LogUpload",
                  "Log upload",
                  self.log_upload),
+
+            Test("StreamSchedulerRateLimited",
+                 "Streams thinned by priority on a rate limited link",
+                 self.StreamSchedulerRateLimited),
+
+            Test("SystemIdEstimate",
+                 "Check gains proposed by the SystemId onboard estimate",
+                 self.SystemIdEstimate),
         ])
         return ret
 
@@ -7308,6 +7577,7 @@ class AutoTestCopter(AutoTest):
             "Parachute": "See https://github.com/ArduPilot/ardupilot/issues/4702",
             "HorizontalAvoidFence": "See https://github.com/ArduPilot/ardupilot/issues/11525",
             "AltEstimation": "See https://github.com/ArduPilot/ardupilot/issues/15191",
+            "StreamSchedulerRateLimited": "Needs a build with GCS_STREAM_SCHEDULER_ENABLED",
         }
 
 
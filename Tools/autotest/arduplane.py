@@ -1934,6 +1934,44 @@ class AutoTestPlane(AutoTest):
         if ex is not None:
             raise ex
 
+    def test_adsb_stress(self):
+        '''fill the ADSB vehicle list from a large simulated traffic set'''
+        self.context_push()
+        ex = None
+        try:
+            self.set_parameters({
+                "ADSB_TYPE": 1,
+                "ADSB_LIST_MAX": 100,
+                "AVD_ENABLE": 1,
+                "SIM_ADSB_COUNT": 500,
+                "SIM_ADSB_RADIUS": 20000,
+            })
+            self.reboot_sitl()
+            self.wait_ready_to_arm()
+
+            self.progress("Collecting ADSB_VEHICLE messages")
+            seen = set()
+            tstart = self.get_sim_time()
+            while self.get_sim_time_cached() - tstart < 20:
+                m = self.mav.recv_match(type='ADSB_VEHICLE', blocking=True, timeout=1)
+                if m is None:
+                    continue
+                seen.add(m.ICAO_address)
+            self.progress("Saw %u distinct aircraft" % len(seen))
+            if len(seen) < 50:
+                raise NotAchievedException("Too few aircraft tracked (%u)" % len(seen))
+
+            # the vehicle must still be responsive with a full list
+            self.change_mode("FBWA")
+            self.change_mode("MANUAL")
+        except Exception as e:
+            self.print_exception_caught(e)
+            ex = e
+        self.context_pop()
+        self.reboot_sitl()
+        if ex is not None:
+            raise ex
+
     def fly_do_guided_request(self, target_system=1, target_component=1):
         self.progress("Takeoff")
         self.takeoff(alt=50)
@@ -2958,6 +2996,10 @@ class AutoTestPlane(AutoTest):
              "Test ADSB",
              self.test_adsb),
 
+            ("ADSBStress",
+             "Test ADSB with a large simulated traffic set",
+             self.test_adsb_stress),
+
             ("Button",
              "Test Buttons",
              self.test_button),
@@ -4515,6 +4515,90 @@ class AutoTest(ABC):
         self.assert_capability(mavutil.mavlink.MAV_PROTOCOL_CAPABILITY_PARAM_FLOAT)
         self.assert_capability(mavutil.mavlink.MAV_PROTOCOL_CAPABILITY_COMPASS_CALIBRATION)
 
+    def ftp_send(self, seq, session, opcode, size=0, offset=0, data=b''):
+        '''send a MAVFTP request'''
+        payload = bytearray(251)
+        struct.pack_into("<HBBBBBxI", payload, 0, seq, session, opcode, size, 0, 0, offset)
+        payload[12:12+len(data)] = data
+        self.mav.mav.file_transfer_protocol_send(
+            0,
+            self.sysid_thismav(),
+            1,
+            payload)
+
+    def ftp_recv(self, timeout=5):
+        '''receive a MAVFTP reply, returns (seq, session, opcode, size, req_opcode, burst_complete, offset, data)'''
+        m = self.mav.recv_match(type='FILE_TRANSFER_PROTOCOL', blocking=True, timeout=timeout)
+        if m is None:
+            return None
+        payload = bytearray(m.payload)
+        (seq, session, opcode, size, req_opcode, burst_complete, offset) = struct.unpack_from("<HBBBBBxI", payload, 0)
+        return (seq, session, opcode, size, req_opcode, burst_complete, offset, payload[12:12+size])
+
+    def ftp_read_files(self, filename, sessions):
+        '''read a file on several concurrent MAVFTP sessions using burst
+        reads, returns the contents read on each session'''
+        OP_TerminateSession = 1
+        OP_OpenFileRO = 4
+        OP_BurstReadFile = 15
+        OP_Ack = 128
+        seq = 0
+        contents = {}
+        for session in sessions:
+            self.ftp_send(seq, session, OP_OpenFileRO, size=len(filename), data=filename.encode('ascii'))
+            seq += 1
+            reply = self.ftp_recv()
+            if reply is None or reply[2] != OP_Ack:
+                raise NotAchievedException("Failed to open %s on session %u (%s)" % (filename, session, str(reply)))
+            contents[session] = bytearray()
+        # request a burst on every session, interleaving the replies
+        pending = set(sessions)
+        for session in sessions:
+            self.ftp_send(seq, session, OP_BurstReadFile, size=239, offset=0)
+            seq += 1
+        tstart = self.get_sim_time()
+        while len(pending) > 0:
+            if self.get_sim_time_cached() - tstart > 120:
+                raise NotAchievedException("Timeout reading %s" % filename)
+            reply = self.ftp_recv()
+            if reply is None:
+                # re-request from where each pending session got to
+                for session in pending:
+                    self.ftp_send(seq, session, OP_BurstReadFile, size=239, offset=len(contents[session]))
+                    seq += 1
+                continue
+            (_, session, opcode, size, req_opcode, burst_complete, offset, data) = reply
+            if session not in pending or req_opcode != OP_BurstReadFile:
+                continue
+            if opcode != OP_Ack:
+                # end of file
+                pending.discard(session)
+                continue
+            if offset == len(contents[session]):
+                contents[session].extend(data)
+            if burst_complete:
+                self.ftp_send(seq, session, OP_BurstReadFile, size=239, offset=len(contents[session]))
+                seq += 1
+        for session in sessions:
+            self.ftp_send(seq, session, OP_TerminateSession)
+            seq += 1
+            self.ftp_recv()
+        return contents
+
+    def test_ftp(self):
+        '''read a file on concurrent MAVFTP sessions and report throughput'''
+        filename = "@PARAM/param.pck"
+        tstart = time.time()
+        contents = self.ftp_read_files(filename, [1, 2])
+        elapsed = time.time() - tstart
+        total = sum([len(x) for x in contents.values()])
+        self.progress("Read %u bytes over %u sessions in %.2fs (%.0f bytes/s)" %
+                      (total, len(contents), elapsed, total/elapsed))
+        if len(contents[1]) == 0:
+            raise NotAchievedException("Did not read any data")
+        if contents[1] != contents[2]:
+            raise NotAchievedException("Sessions returned different data")
+
     def get_mode_from_mode_mapping(self, mode):
         """Validate and return the mode number from a string or int."""
         mode_map = self.mav.mode_mapping()
@@ -10353,6 +10437,10 @@ switch value'''
                  "Get Capabilities",
                  self.test_get_autopilot_capabilities),
 
+            Test("FTP",
+                 "Test MAVFTP concurrent sessions and throughput",
+                 self.test_ftp),
+
             Test("InitialMode",
                  "Test initial mode switching",
                  self.test_initial_mode),
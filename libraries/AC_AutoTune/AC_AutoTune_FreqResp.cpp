@@ -0,0 +1,405 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  The vehicle is flown in closed loop, so the actuator output u is
+  correlated with the noise in the body rate y through the controller.
+  Dividing cross spectra of each with the sweep excitation r, which is
+  not, gives the plant without that bias:
+
+    G(f) = S_ry(f) / S_ru(f)
+
+  The spectra are averaged over Hann windowed FFTs overlapping by half
+  (Welch's method). The plant is fitted to the coherent points as an
+  integrator with a delay, K*exp(-sT)/s, which covers the rigid body
+  and lumps the motor lag, filters and loop delay into T.
+ */
+
+#include "AC_AutoTune_FreqResp.h"
+#include <AP_Math/AP_Math.h>
+
+extern const AP_HAL::HAL& hal;
+
+#define FREQRESP_STACK_SIZE     2048
+#define FREQRESP_WINDOW_MIN     32
+
+#if HAL_WITH_DSP
+bool AC_AutoTune_FreqResp::init(uint16_t loop_rate_hz, float min_hz, float max_hz)
+{
+    if (!is_positive(min_hz) || max_hz <= min_hz || loop_rate_hz == 0) {
+        return false;
+    }
+
+    WITH_SEMAPHORE(_sem);
+
+    free_buffers();
+
+    // sample the sweep at 2.5 times its highest frequency or more
+    _decimation = constrain_int32(loop_rate_hz / (2.5f * max_hz), 1, UINT8_MAX);
+    const uint16_t sample_rate_hz = loop_rate_hz / _decimation;
+
+    // two cycles of the lowest frequency in each window
+    uint16_t window_size = FREQRESP_WINDOW_MIN;
+    while (window_size < 2 * sample_rate_hz / min_hz && window_size < AC_AUTOTUNE_FREQRESP_WINDOW_MAX) {
+        window_size *= 2;
+    }
+
+    _state = hal.dsp->fft_init(window_size, sample_rate_hz, 1);
+    if (_state == nullptr) {
+        return false;
+    }
+
+    const uint16_t start_bin = constrain_int32(floorf(min_hz / _state->_bin_resolution), 1, _state->_bin_count - 1);
+    const uint16_t end_bin = constrain_int32(ceilf(max_hz / _state->_bin_resolution), start_bin, _state->_bin_count - 1);
+
+    // room for a window and a half, so samples keep arriving while one is analysed
+    const uint16_t buffer_size = window_size + window_size / 2;
+    _excitation = new FloatBuffer(buffer_size);
+    _actuator = new FloatBuffer(buffer_size);
+    _rate = new FloatBuffer(buffer_size);
+
+    if (_excitation == nullptr || _excitation->get_size() == 0 ||
+        _actuator == nullptr || _actuator->get_size() == 0 ||
+        _rate == nullptr || _rate->get_size() == 0 ||
+        !init_spectra(sample_rate_hz, _state->_bin_resolution, start_bin, end_bin - start_bin + 1)) {
+        free_buffers();
+        return false;
+    }
+
+    _decimation_count = 0;
+    _excitation_sum = 0;
+    _actuator_sum = 0;
+    _rate_sum = 0;
+
+    return true;
+}
+#endif // HAL_WITH_DSP
+
+bool AC_AutoTune_FreqResp::init_spectra(uint16_t sample_rate_hz, float bin_resolution, uint16_t start_bin, uint16_t bin_count)
+{
+    WITH_SEMAPHORE(_sem);
+
+    delete[] _s_rr;
+    delete[] _s_yy;
+    delete[] _s_ru_re;
+    delete[] _s_ru_im;
+    delete[] _s_ry_re;
+    delete[] _s_ry_im;
+    delete[] _r_re;
+    delete[] _r_im;
+
+    _sample_rate_hz = sample_rate_hz;
+    _bin_resolution = bin_resolution;
+    _start_bin = start_bin;
+    _bin_count = bin_count;
+    _s_rr = new float[_bin_count];
+    _s_yy = new float[_bin_count];
+    _s_ru_re = new float[_bin_count];
+    _s_ru_im = new float[_bin_count];
+    _s_ry_re = new float[_bin_count];
+    _s_ry_im = new float[_bin_count];
+    _r_re = new float[_bin_count];
+    _r_im = new float[_bin_count];
+
+    if (_s_rr == nullptr || _s_yy == nullptr ||
+        _s_ru_re == nullptr || _s_ru_im == nullptr ||
+        _s_ry_re == nullptr || _s_ry_im == nullptr ||
+        _r_re == nullptr || _r_im == nullptr) {
+        free_buffers();
+        return false;
+    }
+
+    memset(_s_rr, 0, sizeof(float) * _bin_count);
+    memset(_s_yy, 0, sizeof(float) * _bin_count);
+    memset(_s_ru_re, 0, sizeof(float) * _bin_count);
+    memset(_s_ru_im, 0, sizeof(float) * _bin_count);
+    memset(_s_ry_re, 0, sizeof(float) * _bin_count);
+    memset(_s_ry_im, 0, sizeof(float) * _bin_count);
+    _window_count = 0;
+
+    return true;
+}
+
+void AC_AutoTune_FreqResp::free_buffers()
+{
+#if HAL_WITH_DSP
+    delete _state;
+    delete _excitation;
+    delete _actuator;
+    delete _rate;
+    _state = nullptr;
+    _excitation = nullptr;
+    _actuator = nullptr;
+    _rate = nullptr;
+#endif
+    delete[] _s_rr;
+    delete[] _s_yy;
+    delete[] _s_ru_re;
+    delete[] _s_ru_im;
+    delete[] _s_ry_re;
+    delete[] _s_ry_im;
+    delete[] _r_re;
+    delete[] _r_im;
+    _s_rr = nullptr;
+    _s_yy = nullptr;
+    _s_ru_re = nullptr;
+    _s_ru_im = nullptr;
+    _s_ry_re = nullptr;
+    _s_ry_im = nullptr;
+    _r_re = nullptr;
+    _r_im = nullptr;
+    _bin_count = 0;
+}
+
+void AC_AutoTune_FreqResp::reset()
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (_s_rr == nullptr) {
+        return;
+    }
+#if HAL_WITH_DSP
+    if (_state != nullptr) {
+        _excitation->clear();
+        _actuator->clear();
+        _rate->clear();
+        _decimation_count = 0;
+        _excitation_sum = 0;
+        _actuator_sum = 0;
+        _rate_sum = 0;
+    }
+#endif
+    memset(_s_rr, 0, sizeof(float) * _bin_count);
+    memset(_s_yy, 0, sizeof(float) * _bin_count);
+    memset(_s_ru_re, 0, sizeof(float) * _bin_count);
+    memset(_s_ru_im, 0, sizeof(float) * _bin_count);
+    memset(_s_ry_re, 0, sizeof(float) * _bin_count);
+    memset(_s_ry_im, 0, sizeof(float) * _bin_count);
+    _window_count = 0;
+}
+
+#if HAL_WITH_DSP
+void AC_AutoTune_FreqResp::push_sample(float excitation, float actuator, float rate)
+{
+    if (_state == nullptr) {
+        return;
+    }
+
+    _excitation_sum += excitation;
+    _actuator_sum += actuator;
+    _rate_sum += rate;
+    if (++_decimation_count < _decimation) {
+        return;
+    }
+
+    // the rate buffer is advanced last by update() so has the least
+    // room. Dropping the sample from all three keeps them aligned
+    if (_rate->space() > 0) {
+        _excitation->push(_excitation_sum / _decimation);
+        _actuator->push(_actuator_sum / _decimation);
+        _rate->push(_rate_sum / _decimation);
+    }
+    _decimation_count = 0;
+    _excitation_sum = 0;
+    _actuator_sum = 0;
+    _rate_sum = 0;
+}
+
+bool AC_AutoTune_FreqResp::busy() const
+{
+    return _state != nullptr && _rate->available() >= _state->_window_size;
+}
+
+bool AC_AutoTune_FreqResp::update()
+{
+    WITH_SEMAPHORE(_sem);
+
+    // the rate buffer is pushed last so has the fewest samples
+    if (_state == nullptr || _rate->available() < _state->_window_size) {
+        return false;
+    }
+
+    const uint16_t advance = _state->_window_size / 2;
+    const float *bins = &_state->_rfft_data[2 * _start_bin];
+
+    hal.dsp->fft_transform(_state, *_excitation, advance);
+    add_spectrum(Signal::EXCITATION, bins);
+    hal.dsp->fft_transform(_state, *_actuator, advance);
+    add_spectrum(Signal::ACTUATOR, bins);
+    hal.dsp->fft_transform(_state, *_rate, advance);
+    add_spectrum(Signal::RATE, bins);
+
+    return true;
+}
+#endif // HAL_WITH_DSP
+
+void AC_AutoTune_FreqResp::add_spectrum(Signal signal, const float *bins)
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (_s_rr == nullptr) {
+        return;
+    }
+
+    switch (signal) {
+    case Signal::EXCITATION:
+        for (uint16_t i = 0; i < _bin_count; i++) {
+            _r_re[i] = bins[2*i];
+            _r_im[i] = bins[2*i+1];
+            _s_rr[i] += sq(_r_re[i], _r_im[i]);
+        }
+        break;
+
+    case Signal::ACTUATOR:
+        // conj(R) * U
+        for (uint16_t i = 0; i < _bin_count; i++) {
+            _s_ru_re[i] += _r_re[i] * bins[2*i] + _r_im[i] * bins[2*i+1];
+            _s_ru_im[i] += _r_re[i] * bins[2*i+1] - _r_im[i] * bins[2*i];
+        }
+        break;
+
+    case Signal::RATE:
+        // conj(R) * Y, which completes the window
+        for (uint16_t i = 0; i < _bin_count; i++) {
+            _s_ry_re[i] += _r_re[i] * bins[2*i] + _r_im[i] * bins[2*i+1];
+            _s_ry_im[i] += _r_re[i] * bins[2*i+1] - _r_im[i] * bins[2*i];
+            _s_yy[i] += sq(bins[2*i], bins[2*i+1]);
+        }
+        _window_count++;
+        break;
+    }
+}
+
+uint16_t AC_AutoTune_FreqResp::get_response(Response *response, uint16_t max_points, float min_coherence) const
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (_s_rr == nullptr || _window_count == 0) {
+        return 0;
+    }
+
+    uint16_t n = 0;
+    for (uint16_t i = 0; i < _bin_count && n < max_points; i++) {
+        const float ru_sq = sq(_s_ru_re[i], _s_ru_im[i]);
+        const float ry_sq = sq(_s_ry_re[i], _s_ry_im[i]);
+        if (!is_positive(ru_sq) || !is_positive(_s_rr[i] * _s_yy[i])) {
+            continue;
+        }
+        const float coherence = ry_sq / (_s_rr[i] * _s_yy[i]);
+        if (coherence < min_coherence) {
+            continue;
+        }
+        // S_ry / S_ru
+        const float g_re = (_s_ry_re[i] * _s_ru_re[i] + _s_ry_im[i] * _s_ru_im[i]) / ru_sq;
+        const float g_im = (_s_ry_im[i] * _s_ru_re[i] - _s_ry_re[i] * _s_ru_im[i]) / ru_sq;
+        Response &r = response[n++];
+        r.freq_hz = (_start_bin + i) * _bin_resolution;
+        r.gain = norm(g_re, g_im);
+        r.phase_deg = degrees(atan2f(g_im, g_re));
+        r.coherence = coherence;
+    }
+    return n;
+}
+
+bool AC_AutoTune_FreqResp::propose_gains(Result &result, float phase_margin_deg, float d_lead_deg, float pi_ratio) const
+{
+    Response *response = new Response[_bin_count];
+    if (response == nullptr) {
+        return false;
+    }
+    const uint16_t n = get_response(response, _bin_count, AC_AUTOTUNE_FREQRESP_MIN_COHERENCE);
+    if (n < 4) {
+        delete[] response;
+        return false;
+    }
+
+    // least squares fit of the phase beyond the integrator's -90
+    // degrees to -wT, and of log(|G|w) to log(K), weighted by coherence
+    float sum_wphase = 0;
+    float sum_ww = 0;
+    float sum_logk = 0;
+    float sum_weight = 0;
+    float unwrapped_last = 0;
+    float max_freq_hz = 0;
+    for (uint16_t i = 0; i < n; i++) {
+        const Response &r = response[i];
+        const float w = M_2PI * r.freq_hz;
+        float phase = wrap_PI(radians(r.phase_deg + 90));
+        if (i > 0) {
+            // keep each point within half a turn of the one before
+            phase += M_2PI * roundf((unwrapped_last - phase) / M_2PI);
+        }
+        unwrapped_last = phase;
+        sum_wphase += r.coherence * w * phase;
+        sum_ww += r.coherence * w * w;
+        sum_logk += r.coherence * logf(r.gain * w);
+        sum_weight += r.coherence;
+        max_freq_hz = r.freq_hz;
+    }
+    delete[] response;
+
+    const float plant_gain = expf(sum_logk / sum_weight);
+    // at least half a sample of delay
+    const float delay_s = MAX(-sum_wphase / sum_ww, 0.5f / _sample_rate_hz);
+
+    // choose the crossover wc where the phase margin is met, with the
+    // controller C = kP + kI/s + kD*s at wc being kP*(1 + j*(tan(lead) - pi_ratio/wc))
+    const float tan_lead = tanf(radians(d_lead_deg));
+    const float wc_max = M_2PI * max_freq_hz;
+    float wc = wc_max;
+    for (uint8_t i = 0; i < 5; i++) {
+        const float lead = atanf(tan_lead - pi_ratio / wc);
+        wc = (M_PI_2 - radians(phase_margin_deg) + lead) / delay_s;
+        // don't extrapolate the fit beyond the coherent points
+        wc = MIN(wc, wc_max);
+        if (!is_positive(wc)) {
+            return false;
+        }
+    }
+
+    // unity loop gain at wc, |C||G| = 1 with |G| = K/wc
+    const float c_imag = tan_lead - pi_ratio / wc;
+    result.plant_gain = plant_gain;
+    result.delay_s = delay_s;
+    result.crossover_hz = wc / M_2PI;
+    result.kP = wc / (plant_gain * norm(1.0f, c_imag));
+    result.kI = result.kP * pi_ratio;
+    result.kD = result.kP * tan_lead / wc;
+    return true;
+}
+
+#if HAL_WITH_DSP
+// thread for analysing samples as they arrive
+void AC_AutoTune_FreqResp::update_thread()
+{
+    while (true) {
+        if (!update()) {
+            hal.scheduler->delay(10);
+        }
+    }
+}
+
+bool AC_AutoTune_FreqResp::start_thread()
+{
+    if (_thread_created) {
+        return true;
+    }
+    if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&AC_AutoTune_FreqResp::update_thread, void), "freqresp", FREQRESP_STACK_SIZE, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+        return false;
+    }
+    _thread_created = true;
+    return true;
+}
+
+#endif // HAL_WITH_DSP
@@ -0,0 +1,148 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  onboard frequency response estimate of one rate axis from a
+  frequency sweep, and rate PID gains proposed from it
+ */
+
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL/utility/RingBuffer.h>
+
+// largest FFT window used for the estimate
+#ifndef AC_AUTOTUNE_FREQRESP_WINDOW_MAX
+#define AC_AUTOTUNE_FREQRESP_WINDOW_MAX 512
+#endif
+
+// coherence needed for a point to be used in the plant fit
+#define AC_AUTOTUNE_FREQRESP_MIN_COHERENCE 0.6f
+
+class AC_AutoTune_FreqResp {
+public:
+    // response of the body rate to the actuator output at one frequency
+    struct Response {
+        float freq_hz;
+        float gain;         // rad/s per unit of actuator output
+        float phase_deg;
+        float coherence;    // 0 to 1, the part of the rate explained by the sweep
+    };
+
+    // fitted plant and the gains proposed for it
+    struct Result {
+        float plant_gain;   // K of the plant model K*exp(-sT)/s
+        float delay_s;      // T of the plant model
+        float crossover_hz;
+        float kP;
+        float kI;
+        float kD;
+    };
+
+    // the signals whose spectra are combined
+    enum class Signal : uint8_t {
+        EXCITATION = 0,
+        ACTUATOR   = 1,
+        RATE       = 2,
+    };
+
+#if HAL_WITH_DSP
+    // allocate for samples from a loop running at loop_rate_hz, with a
+    // sweep between min_hz and max_hz. Called from the main thread
+    bool init(uint16_t loop_rate_hz, float min_hz, float max_hz);
+
+    // add the sweep excitation, the actuator output and the body rate
+    // from one loop. Called from the main thread
+    void push_sample(float excitation, float actuator, float rate);
+
+    // analyse one window of samples, returning false if there wasn't a
+    // full window waiting. Called from the analysis thread
+    bool update();
+
+    // true while there are samples waiting to be analysed
+    bool busy() const;
+
+    // start the thread that calls update()
+    bool start_thread();
+#endif
+
+    // allocate the spectra of bin_count FFT bins from start_bin, for
+    // samples at sample_rate_hz. Called by init(), or directly when
+    // the spectra are worked out without the DSP
+    bool init_spectra(uint16_t sample_rate_hz, float bin_resolution, uint16_t start_bin, uint16_t bin_count);
+
+    // add the spectrum of one signal over a Hann window, as the real
+    // and imaginary parts of each bin from start_bin in turn. Each
+    // window needs the excitation, the actuator and then the rate
+    void add_spectrum(Signal signal, const float *bins);
+
+    // discard samples and results for a new sweep
+    void reset();
+
+    // number of windows analysed since reset()
+    uint16_t window_count() const { return _window_count; }
+
+    // the response at the frequency bins with at least min_coherence,
+    // returning the number of points filled in
+    uint16_t get_response(Response *response, uint16_t max_points, float min_coherence) const;
+
+    // fit the plant to the coherent part of the response and propose
+    // gains giving phase_margin_deg at crossover, with the D term
+    // giving d_lead_deg of phase lead and I set to pi_ratio times P
+    bool propose_gains(Result &result, float phase_margin_deg, float d_lead_deg, float pi_ratio) const;
+
+private:
+    // free everything allocated by init()
+    void free_buffers();
+
+    mutable HAL_Semaphore _sem;
+
+#if HAL_WITH_DSP
+    void update_thread();
+
+    AP_HAL::DSP::FFTWindowState *_state;
+
+    // samples at _sample_rate_hz, averaged over _decimation loops
+    FloatBuffer *_excitation;
+    FloatBuffer *_actuator;
+    FloatBuffer *_rate;
+    uint8_t _decimation;
+    uint8_t _decimation_count;
+    float _excitation_sum;
+    float _actuator_sum;
+    float _rate_sum;
+    bool _thread_created;
+#endif
+
+    // FFT bins covering the sweep, of samples at _sample_rate_hz
+    uint16_t _sample_rate_hz;
+    float _bin_resolution;
+    uint16_t _start_bin;
+    uint16_t _bin_count;
+
+    // cross spectra of the excitation r with the actuator u and the
+    // rate y, and the auto spectra of r and y, summed over the windows
+    float *_s_rr;
+    float *_s_yy;
+    float *_s_ru_re;
+    float *_s_ru_im;
+    float *_s_ry_re;
+    float *_s_ry_im;
+
+    // spectrum of the excitation in the window being analysed
+    float *_r_re;
+    float *_r_im;
+
+    uint16_t _window_count;
+};
@@ -0,0 +1,193 @@
+#include <AP_gtest.h>
+
+#include <AC_AutoTune/AC_AutoTune_FreqResp.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#include <AP_Math/AP_Math.h>
+
+#define LOOP_RATE_HZ    400
+#define PLANT_GAIN      20.0f
+#define PLANT_DELAY_LOOPS 4
+// the integration step adds a loop to the delay
+#define PLANT_DELAY_S   ((PLANT_DELAY_LOOPS + 1) / float(LOOP_RATE_HZ))
+#define SWEEP_MIN_HZ    1.0f
+#define SWEEP_MAX_HZ    40.0f
+#define SWEEP_TIME_S    30.0f
+#define SWEEP_LOOPS     uint32_t(SWEEP_TIME_S * LOOP_RATE_HZ)
+
+/*
+  sweep the actuator of a rate loop around the plant K*exp(-sT)/s,
+  with a P controller closing the loop and noise on the measured rate
+ */
+static void fly_sweep(float *excitation, float *actuator, float *measured)
+{
+    const float dt = 1.0f / LOOP_RATE_HZ;
+    const float w_min = M_2PI * SWEEP_MIN_HZ;
+    const float B = logf(SWEEP_MAX_HZ / SWEEP_MIN_HZ);
+    float delay_line[PLANT_DELAY_LOOPS] {};
+    uint16_t delay_idx = 0;
+    float rate = 0;
+    uint32_t seed = 1;
+
+    for (uint32_t i = 0; i < SWEEP_LOOPS; i++) {
+        const float t = i * dt;
+        excitation[i] = 0.05f * sinf((w_min * SWEEP_TIME_S / B) * (expf(B * t / SWEEP_TIME_S) - 1));
+        seed = seed * 1664525U + 1013904223U;
+        const float noise = 0.05f * ((seed >> 8) / float(1U << 24) - 0.5f);
+        measured[i] = rate + noise;
+        actuator[i] = -0.02f * measured[i] + excitation[i];
+
+        rate += PLANT_GAIN * delay_line[delay_idx] * dt;
+        delay_line[delay_idx] = actuator[i];
+        delay_idx = (delay_idx + 1) % PLANT_DELAY_LOOPS;
+    }
+}
+
+/*
+  check the response and proposed gains against the simulated plant
+ */
+static void check_estimate(AC_AutoTune_FreqResp &freqresp)
+{
+    EXPECT_GT(freqresp.window_count(), 10U);
+
+    // the closed loop doesn't bias the well measured part of the response
+    AC_AutoTune_FreqResp::Response response[64];
+    const uint16_t n = freqresp.get_response(response, ARRAY_SIZE(response), 0.9f);
+    ASSERT_GT(n, 8U);
+    for (uint16_t i = 0; i < n; i++) {
+        if (response[i].freq_hz < SWEEP_MIN_HZ) {
+            continue;
+        }
+        const float w = M_2PI * response[i].freq_hz;
+        EXPECT_NEAR(response[i].gain, PLANT_GAIN / w, 0.15f * PLANT_GAIN / w);
+        EXPECT_NEAR(response[i].phase_deg, -90 - degrees(w * PLANT_DELAY_S), 10);
+    }
+
+    AC_AutoTune_FreqResp::Result result;
+    ASSERT_TRUE(freqresp.propose_gains(result, 45, 30, 1.0f));
+    EXPECT_NEAR(result.plant_gain, PLANT_GAIN, 0.1f * PLANT_GAIN);
+    EXPECT_NEAR(result.delay_s, PLANT_DELAY_S, 0.003f);
+    EXPECT_GT(result.kP, 0);
+    EXPECT_GT(result.kD, 0);
+    EXPECT_FLOAT_EQ(result.kI, result.kP);
+
+    // the proposed loop has close to the phase margin asked for
+    const float wc = M_2PI * result.crossover_hz;
+    const float phase_margin = degrees(M_PI_2 - wc * PLANT_DELAY_S + atanf((result.kD * wc - result.kI / wc) / result.kP));
+    EXPECT_NEAR(phase_margin, 45, 10);
+
+    // a new sweep starts from nothing
+    freqresp.reset();
+    EXPECT_EQ(freqresp.window_count(), 0U);
+    EXPECT_FALSE(freqresp.propose_gains(result, 45, 30, 1.0f));
+}
+
+// the decimation, window and bins init() picks for this sweep
+#define DFT_DECIMATION  4
+#define DFT_RATE_HZ     (LOOP_RATE_HZ / DFT_DECIMATION)
+#define DFT_WINDOW      256
+#define DFT_START_BIN   2
+#define DFT_BIN_COUNT   102
+
+/*
+  Hann windowed DFT of the bins used, with the sign convention of
+  the DSP's forward transform
+ */
+static void dft(const float *samples, float *bins)
+{
+    for (uint16_t b = 0; b < DFT_BIN_COUNT; b++) {
+        const uint16_t k = DFT_START_BIN + b;
+        float re = 0, im = 0;
+        for (uint16_t i = 0; i < DFT_WINDOW; i++) {
+            const float x = samples[i] * (0.5f - 0.5f * cosf(M_2PI * i / DFT_WINDOW));
+            const float angle = M_2PI * k * i / DFT_WINDOW;
+            re += x * cosf(angle);
+            im -= x * sinf(angle);
+        }
+        bins[2*b] = re;
+        bins[2*b+1] = im;
+    }
+}
+
+/*
+  average each DFT_DECIMATION samples, as push_sample() does
+ */
+static void decimate(float *samples)
+{
+    for (uint32_t i = 0; i < SWEEP_LOOPS / DFT_DECIMATION; i++) {
+        float sum = 0;
+        for (uint8_t j = 0; j < DFT_DECIMATION; j++) {
+            sum += samples[i * DFT_DECIMATION + j];
+        }
+        samples[i] = sum / DFT_DECIMATION;
+    }
+}
+
+/*
+  the spectral averaging and the plant fit, with spectra from a DFT
+  so it runs on boards without the DSP
+ */
+TEST(FreqRespTest, PlantFitSpectra)
+{
+    float *excitation = new float[SWEEP_LOOPS];
+    float *actuator = new float[SWEEP_LOOPS];
+    float *measured = new float[SWEEP_LOOPS];
+    fly_sweep(excitation, actuator, measured);
+    decimate(excitation);
+    decimate(actuator);
+    decimate(measured);
+
+    AC_AutoTune_FreqResp *freqresp = new AC_AutoTune_FreqResp();
+    ASSERT_TRUE(freqresp->init_spectra(DFT_RATE_HZ, float(DFT_RATE_HZ) / DFT_WINDOW, DFT_START_BIN, DFT_BIN_COUNT));
+
+    // windows overlapping by half
+    float bins[2 * DFT_BIN_COUNT];
+    for (uint32_t start = 0; start + DFT_WINDOW <= SWEEP_LOOPS / DFT_DECIMATION; start += DFT_WINDOW / 2) {
+        dft(&excitation[start], bins);
+        freqresp->add_spectrum(AC_AutoTune_FreqResp::Signal::EXCITATION, bins);
+        dft(&actuator[start], bins);
+        freqresp->add_spectrum(AC_AutoTune_FreqResp::Signal::ACTUATOR, bins);
+        dft(&measured[start], bins);
+        freqresp->add_spectrum(AC_AutoTune_FreqResp::Signal::RATE, bins);
+    }
+
+    check_estimate(*freqresp);
+
+    delete freqresp;
+    delete[] excitation;
+    delete[] actuator;
+    delete[] measured;
+}
+
+#if HAL_WITH_DSP
+/*
+  the whole estimate, decimating the samples and transforming them
+  with the DSP
+ */
+TEST(FreqRespTest, PlantFit)
+{
+    float *excitation = new float[SWEEP_LOOPS];
+    float *actuator = new float[SWEEP_LOOPS];
+    float *measured = new float[SWEEP_LOOPS];
+    fly_sweep(excitation, actuator, measured);
+
+    AC_AutoTune_FreqResp *freqresp = new AC_AutoTune_FreqResp();
+    ASSERT_TRUE(freqresp->init(LOOP_RATE_HZ, SWEEP_MIN_HZ, SWEEP_MAX_HZ));
+
+    for (uint32_t i = 0; i < SWEEP_LOOPS; i++) {
+        freqresp->push_sample(excitation[i], actuator[i], measured[i]);
+        while (freqresp->update()) {}
+    }
+    EXPECT_FALSE(freqresp->busy());
+
+    check_estimate(*freqresp);
+
+    delete freqresp;
+    delete[] excitation;
+    delete[] actuator;
+    delete[] measured;
+}
+#endif // HAL_WITH_DSP
+
+AP_GTEST_MAIN()
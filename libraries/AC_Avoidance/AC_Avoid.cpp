@@ -1117,7 +1117,7 @@ void AC_Avoid::adjust_velocity_proximity(float kP, float accel_cmss, Vector3f &d
         return;
     }
     // get total number of obstacles
-    const uint8_t obstacle_num = _proximity.get_obstacle_count();
+    const uint16_t obstacle_num = _proximity.get_obstacle_count();
     if (obstacle_num == 0) {
         // no obstacles
         return;
@@ -1146,7 +1146,7 @@ void AC_Avoid::adjust_velocity_proximity(float kP, float accel_cmss, Vector3f &d
         stopping_point = safe_vel * ((2.0f + get_stopping_distance(kP, accel_cmss, speed))/speed);
     }
 
-    for (uint8_t i = 0; i<obstacle_num; i++) {
+    for (uint16_t i = 0; i<obstacle_num; i++) {
         // get obstacle from proximity library
         Vector3f vector_to_obstacle;
         if (!_proximity.get_obstacle(i, vector_to_obstacle)) {
@@ -1180,6 +1180,12 @@ void AC_Avoid::adjust_velocity_proximity(float kP, float accel_cmss, Vector3f &d
 
         switch (_behavior) {
         case BEHAVIOR_SLIDE: {
+            // obstacles away from the direction of travel cannot limit velocity
+            // dense proximity boundaries have hundreds of these so skip them early
+            if (((Vector2f{safe_vel.x, safe_vel.y} * Vector2f{vector_to_obstacle.x, vector_to_obstacle.y}) <= 0.0f) &&
+                ((safe_vel.z * vector_to_obstacle.z) <= 0.0f)) {
+                continue;
+            }
             Vector3f limit_direction{vector_to_obstacle};
             // distance to closest point
             const float limit_distance_cm = limit_direction.length();
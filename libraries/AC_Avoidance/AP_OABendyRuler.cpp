@@ -659,17 +659,17 @@ bool AP_OABendyRuler::calc_margin_from_object_database(const Location &start, co
         return false;
     }
 
-    // check each obstacle's distance from segment
+    // check the distance from the segment of each obstacle close enough to
+    // affect the path chosen, obstacles further than the maximum margin are ignored
     float smallest_margin = FLT_MAX;
-    for (uint16_t i=0; i<oaDb->database_count(); i++) {
-        const AP_OADatabase::OA_DbItem& item = oaDb->get_item(i);
+    oaDb->foreach_item_near_segment(start_NEU * 0.01f, end_NEU * 0.01f, _margin_max + _lookahead, [&](const AP_OADatabase::OA_DbItem &item) {
         const Vector3f point_cm = item.pos * 100.0f;
         // margin is distance between line segment and obstacle minus obstacle's radius
         const float m = Vector3f::closest_distance_between_line_and_point(start_NEU, end_NEU, point_cm) * 0.01f - item.radius;
         if (m < smallest_margin) {
             smallest_margin = m;
         }
-    }
+    });
 
     // return smallest margin
     if (smallest_margin < FLT_MAX) {
@@ -35,6 +35,9 @@ extern const AP_HAL::HAL& hal;
     #define AP_OADATABASE_DISTANCE_FROM_HOME 3
 #endif
 
+#define AP_OADATABASE_QUEUE_BATCH   32                      // number of items moved from the queue each time the semaphore is taken
+#define AP_OADATABASE_INDEX_NONE    UINT16_MAX              // end of a bucket or expiry list
+
 const AP_Param::GroupInfo AP_OADatabase::var_info[] = {
 
     // @Param: SIZE
@@ -127,6 +130,12 @@ void AP_OADatabase::init()
         gcs().send_text(MAV_SEVERITY_INFO, "DB init failed . Sizes queue:%u, db:%u", (unsigned int)_queue.size, (unsigned int)_database.size);
         delete _queue.items;
         delete[] _database.items;
+        delete[] _database.bucket_head;
+        delete[] _database.bucket_next;
+        delete[] _database.expiry_prev;
+        delete[] _database.expiry_next;
+        _queue.items = nullptr;
+        _database.items = nullptr;
         return;
     }
 }
@@ -174,9 +183,19 @@ void AP_OADatabase::queue_push(const Vector3f &pos, uint32_t timestamp_ms, float
     }
 
     const OA_DbItem item = {pos, timestamp_ms, MAX(_radius_min, distance * dist_to_radius_scalar), 0, AP_OADatabase::OA_DbItemImportance::Normal};
+    bool warn_full = false;
     {
         WITH_SEMAPHORE(_queue.sem);
-        _queue.items->push(item);
+        if (!_queue.items->push(item)) {
+            const uint32_t now_ms = AP_HAL::millis();
+            if (now_ms - _queue.last_full_warning_ms > 5000) {
+                _queue.last_full_warning_ms = now_ms;
+                warn_full = true;
+            }
+        }
+    }
+    if (warn_full) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "DB queue full, points dropped");
     }
 }
 
@@ -198,6 +217,29 @@ void AP_OADatabase::init_database()
     }
 
     _database.items = new OA_DbItem[_database.size];
+
+    // at least two buckets per object keeps the bucket chains short
+    _database.bucket_count = 16;
+    while (_database.bucket_count < 2U * _database.size) {
+        _database.bucket_count *= 2;
+    }
+    _database.bucket_head = new uint16_t[_database.bucket_count];
+    _database.bucket_next = new uint16_t[_database.size];
+    _database.expiry_prev = new uint16_t[_database.size];
+    _database.expiry_next = new uint16_t[_database.size];
+    if (_database.bucket_head == nullptr || _database.bucket_next == nullptr ||
+        _database.expiry_prev == nullptr || _database.expiry_next == nullptr) {
+        delete[] _database.items;
+        _database.items = nullptr;
+        return;
+    }
+    for (uint16_t i=0; i<_database.bucket_count; i++) {
+        _database.bucket_head[i] = AP_OADATABASE_INDEX_NONE;
+    }
+    for (uint8_t i=0; i<ARRAY_SIZE(_database.expiry_head); i++) {
+        _database.expiry_head[i] = AP_OADATABASE_INDEX_NONE;
+    }
+    _database.expiry_checked_ms = AP_HAL::millis() / 1000U * 1000U;
 }
 
 // get bitmask of gcs channels item should be sent to based on its importance
@@ -226,52 +268,48 @@ uint8_t AP_OADatabase::get_send_to_gcs_flags(const OA_DbItemImportance importanc
     return 0x0;
 }
 
-// returns true when there's more work inthe queue to do
+// move everything in the queue into the database. Returns true if any items were processed
 bool AP_OADatabase::process_queue()
 {
     if (!healthy()) {
         return false;
     }
 
-    // processing queue by moving those entries into the database
-    // Using a for with fixed size is better than while(!empty) because the
-    // while could get us stuck here longer than expected if we're getting
-    // a lot of values pushing into it while we're trying to empty it. With
-    // the for we know we will exit at an expected time
-    const uint16_t queue_available = MIN(_queue.items->available(), 100U);
+    // only process what is in the queue now so we are not stuck here
+    // if items are being pushed as fast as we take them out.  Items are
+    // taken out in batches so the semaphore is not taken for every item
+    uint32_t queue_available = _queue.items->available();
     if (queue_available == 0) {
         return false;
     }
 
-    for (uint16_t queue_index=0; queue_index<queue_available; queue_index++) {
-        OA_DbItem item;
-
-        bool pop_success;
+    while (queue_available > 0) {
+        OA_DbItem batch[AP_OADATABASE_QUEUE_BATCH];
+        uint32_t batch_count;
         {
             WITH_SEMAPHORE(_queue.sem);
-            pop_success = _queue.items->pop(item);
+            batch_count = _queue.items->peek(batch, MIN(queue_available, (uint32_t)ARRAY_SIZE(batch)));
+            _queue.items->advance(batch_count);
         }
-        if (!pop_success) {
-            return false;
+        if (batch_count == 0) {
+            break;
         }
-
-        item.send_to_gcs = get_send_to_gcs_flags(item.importance);
-
-        // compare item to all items in database. If found a similar item, update the existing, else add it as a new one
-        bool found = false;
-        for (uint16_t i=0; i<_database.count; i++) {
-            if (is_close_to_item_in_database(i, item)) {
-                database_item_refresh(i, item.timestamp_ms, item.radius);
-                found = true;
-                break;
+        queue_available -= batch_count;
+
+        for (uint32_t i=0; i<batch_count; i++) {
+            OA_DbItem &item = batch[i];
+            item.send_to_gcs = get_send_to_gcs_flags(item.importance);
+
+            // if there is a similar item update the existing, else add it as a new one
+            const int32_t index = find_close_item(item);
+            if (index >= 0) {
+                database_item_refresh(index, item.timestamp_ms, item.radius);
+            } else {
+                database_item_add(item);
             }
         }
-
-        if (!found) {
-            database_item_add(item);
-        }
     }
-    return (_queue.items->available() > 0);
+    return true;
 }
 
 void AP_OADatabase::database_item_add(const OA_DbItem &item)
@@ -281,6 +319,9 @@ void AP_OADatabase::database_item_add(const OA_DbItem &item)
     }
     _database.items[_database.count] = item;
     _database.items[_database.count].send_to_gcs = get_send_to_gcs_flags(_database.items[_database.count].importance);
+    cell_insert(_database.count);
+    expiry_insert(_database.count);
+    _database.radius_max = MAX(_database.radius_max, item.radius);
     _database.count++;
 }
 
@@ -291,19 +332,27 @@ void AP_OADatabase::database_item_remove(const uint16_t index)
         return;
     }
 
+    cell_remove(index);
+    expiry_remove(index);
+
     // radius of 0 tells the GCS we don't care about it any more (aka it expired)
     _database.items[index].radius = 0;
     _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
 
     _database.count--;
     if (_database.count == 0) {
+        _database.radius_max = 0;
         return;
     }
 
     if (index != _database.count) {
-        // copy last object in array over expired object
-        _database.items[index] = _database.items[_database.count];
+        // move last object in array over expired object
+        const uint16_t last = _database.count;
+        cell_remove(last);
+        _database.items[index] = _database.items[last];
         _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
+        cell_insert(index);
+        expiry_move(last, index);
     }
 }
 
@@ -321,15 +370,21 @@ void AP_OADatabase::database_item_refresh(const uint16_t index, const uint32_t t
     if (is_different) {
         // update timestamp and radius on close object so it stays around longer
         // and trigger resending to GCS
+        expiry_remove(index);
         _database.items[index].timestamp_ms = timestamp_ms;
         _database.items[index].radius = radius;
+        _database.radius_max = MAX(_database.radius_max, radius);
+        expiry_insert(index);
         _database.items[index].send_to_gcs = get_send_to_gcs_flags(_database.items[index].importance);
     }
 }
 
 void AP_OADatabase::database_items_remove_all_expired()
 {
-    // calculate age of all items in the _database
+    // check the expiry list of each second that has passed the expiry
+    // time since the last call.  An expiry list holds objects from every
+    // second that is the same modulo the number of lists so the age of
+    // each object on it is still checked
 
     if (_database_expiry_seconds <= 0) {
         // zero means never expire. This is not normal behavior but perhaps you could send a static
@@ -339,13 +394,135 @@ void AP_OADatabase::database_items_remove_all_expired()
 
     const uint32_t now_ms = AP_HAL::millis();
     const uint32_t expiry_ms = (uint32_t)_database_expiry_seconds * 1000;
-    uint16_t index = 0;
-    while (index < _database.count) {
-        if (now_ms - _database.items[index].timestamp_ms > expiry_ms) {
-            database_item_remove(index);
-        } else {
-            index++;
+    const uint32_t check_to_ms = now_ms - expiry_ms;
+    if ((int32_t)(check_to_ms - _database.expiry_checked_ms) >= (int32_t)ARRAY_SIZE(_database.expiry_head) * 1000) {
+        // every list needs checking
+        _database.expiry_checked_ms = (check_to_ms / 1000U + 1U - ARRAY_SIZE(_database.expiry_head)) * 1000U;
+    }
+
+    // the latest second may still have unexpired objects so it is checked again next time
+    for (uint32_t t_ms=_database.expiry_checked_ms; (int32_t)(check_to_ms - t_ms) >= 0; t_ms += 1000) {
+        uint16_t index = _database.expiry_head[expiry_slot(t_ms)];
+        while (index != AP_OADATABASE_INDEX_NONE) {
+            uint16_t next = _database.expiry_next[index];
+            if (now_ms - _database.items[index].timestamp_ms > expiry_ms) {
+                // removal moves the last object into this index
+                const uint16_t last = _database.count - 1;
+                database_item_remove(index);
+                if (next == last) {
+                    next = index;
+                }
+            }
+            index = next;
+        }
+    }
+    _database.expiry_checked_ms = check_to_ms / 1000U * 1000U;
+}
+
+// returns index of an item in the database close to "item" or -1 if there is none
+int32_t AP_OADatabase::find_close_item(const OA_DbItem &item) const
+{
+    // objects are close if either's radius reaches the other's centre
+    // so look in every cell within the larger of those radii
+    const float range = MAX(item.radius, _database.radius_max);
+    const int32_t x_min = cell_of(item.pos.x - range);
+    const int32_t x_max = cell_of(item.pos.x + range);
+    const int32_t y_min = cell_of(item.pos.y - range);
+    const int32_t y_max = cell_of(item.pos.y + range);
+
+    // searching every object is quicker than visiting mostly empty cells
+    const float num_cells = float(x_max - x_min + 1) * float(y_max - y_min + 1);
+    if (num_cells >= _database.count) {
+        for (uint16_t i=0; i<_database.count; i++) {
+            if (is_close_to_item_in_database(i, item)) {
+                return i;
+            }
         }
+        return -1;
+    }
+
+    for (int32_t x=x_min; x<=x_max; x++) {
+        for (int32_t y=y_min; y<=y_max; y++) {
+            for (uint16_t i=_database.bucket_head[bucket_of(x, y)]; i!=AP_OADATABASE_INDEX_NONE; i=_database.bucket_next[i]) {
+                if (is_close_to_item_in_database(i, item)) {
+                    return i;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+// add an object to the front of the bucket for its grid cell
+void AP_OADatabase::cell_insert(const uint16_t index)
+{
+    const Vector3f &pos = _database.items[index].pos;
+    uint16_t &head = _database.bucket_head[bucket_of(cell_of(pos.x), cell_of(pos.y))];
+    _database.bucket_next[index] = head;
+    head = index;
+}
+
+// unlink an object from the bucket for its grid cell
+void AP_OADatabase::cell_remove(const uint16_t index)
+{
+    const Vector3f &pos = _database.items[index].pos;
+    uint16_t *link = &_database.bucket_head[bucket_of(cell_of(pos.x), cell_of(pos.y))];
+    while (*link != AP_OADATABASE_INDEX_NONE) {
+        if (*link == index) {
+            *link = _database.bucket_next[index];
+            return;
+        }
+        link = &_database.bucket_next[*link];
+    }
+}
+
+// add an object to the front of the expiry list for its timestamp
+void AP_OADatabase::expiry_insert(const uint16_t index)
+{
+    // make sure the list is checked even if the object is older than those already checked
+    const uint32_t timestamp_ms = _database.items[index].timestamp_ms / 1000U * 1000U;
+    if ((int32_t)(timestamp_ms - _database.expiry_checked_ms) < 0) {
+        _database.expiry_checked_ms = timestamp_ms;
+    }
+
+    uint16_t &head = _database.expiry_head[expiry_slot(_database.items[index].timestamp_ms)];
+    _database.expiry_prev[index] = AP_OADATABASE_INDEX_NONE;
+    _database.expiry_next[index] = head;
+    if (head != AP_OADATABASE_INDEX_NONE) {
+        _database.expiry_prev[head] = index;
+    }
+    head = index;
+}
+
+// replace object "from" with object "to" in its expiry list, keeping its place in the list
+void AP_OADatabase::expiry_move(const uint16_t from, const uint16_t to)
+{
+    const uint16_t prev = _database.expiry_prev[from];
+    const uint16_t next = _database.expiry_next[from];
+    _database.expiry_prev[to] = prev;
+    _database.expiry_next[to] = next;
+    if (prev != AP_OADATABASE_INDEX_NONE) {
+        _database.expiry_next[prev] = to;
+    } else {
+        _database.expiry_head[expiry_slot(_database.items[to].timestamp_ms)] = to;
+    }
+    if (next != AP_OADATABASE_INDEX_NONE) {
+        _database.expiry_prev[next] = to;
+    }
+}
+
+// unlink an object from the expiry list for its timestamp
+void AP_OADatabase::expiry_remove(const uint16_t index)
+{
+    const uint16_t prev = _database.expiry_prev[index];
+    const uint16_t next = _database.expiry_next[index];
+    if (prev != AP_OADATABASE_INDEX_NONE) {
+        _database.expiry_next[prev] = next;
+    } else {
+        _database.expiry_head[expiry_slot(_database.items[index].timestamp_ms)] = next;
+    }
+    if (next != AP_OADATABASE_INDEX_NONE) {
+        _database.expiry_prev[next] = prev;
     }
 }
 
@@ -5,6 +5,10 @@
 #include <GCS_MAVLink/GCS_MAVLink.h>
 #include <AP_Param/AP_Param.h>
 
+#ifndef AP_OADATABASE_VOXEL_SIZE
+    #define AP_OADATABASE_VOXEL_SIZE 2.0f               // horizontal size in meters of the grid cells used to find nearby objects
+#endif
+
 class AP_OADatabase {
 public:
 
@@ -46,9 +50,16 @@ public:
     // get number of items in the database
     uint16_t database_count() const { return _database.count; }
 
-    // empty queue and try and put into database. Return true if there's more work to do
+    // empty queue and try and put into database. Return true if items were processed
     bool process_queue();
 
+    // call fn(item) for every item that may be within dist meters of
+    // the segment from start to end.  start and end are offsets in
+    // meters from the EKF origin.  Items further away may also be
+    // visited so the caller must still check the actual distance
+    template <typename Fn>
+    void foreach_item_near_segment(const Vector3f &start, const Vector3f &end, float dist, Fn fn) const;
+
     // send ADSB_VEHICLE mavlink messages
     void send_adsb_vehicle(mavlink_channel_t chan, uint16_t interval_ms);
 
@@ -73,6 +84,23 @@ private:
     // returns true if database item "index" is close to "item"
     bool is_close_to_item_in_database(const uint16_t index, const OA_DbItem &item) const;
 
+    // returns index of an item in the database close to "item" or -1 if there is none
+    int32_t find_close_item(const OA_DbItem &item) const;
+
+    // grid cell holding a position and the hash bucket holding a grid cell
+    static int32_t cell_of(float pos) { return (int32_t)floorf(pos * (1.0f / AP_OADATABASE_VOXEL_SIZE)); }
+    uint16_t bucket_of(int32_t cell_x, int32_t cell_y) const {
+        return ((uint32_t)cell_x * 73856093U ^ (uint32_t)cell_y * 19349663U) & (_database.bucket_count - 1);
+    }
+
+    // cell hash and expiry list maintenance, "index" must be a valid item
+    void cell_insert(const uint16_t index);
+    void cell_remove(const uint16_t index);
+    void expiry_insert(const uint16_t index);
+    void expiry_remove(const uint16_t index);
+    void expiry_move(const uint16_t from, const uint16_t to);
+    uint8_t expiry_slot(uint32_t timestamp_ms) const { return (timestamp_ms / 1000U) % ARRAY_SIZE(_database.expiry_head); }
+
     // enum for use with _OUTPUT parameter
     enum class OA_DbOutputLevel {
         OUTPUT_LEVEL_DISABLED = 0,
@@ -95,6 +123,7 @@ private:
         ObjectBuffer<OA_DbItem> *items;                     // thread safe incoming queue of points from proximity sensor to be put into database
         uint16_t        size;                               // cached value of _queue_size_param.
         HAL_Semaphore   sem;                                // semaphore for multi-thread use of queue
+        uint32_t        last_full_warning_ms;               // system time the queue full warning was last sent
     } _queue;
     float dist_to_radius_scalar;                            // scalar to convert the distance and beam width to an object radius
 
@@ -102,6 +131,20 @@ private:
         OA_DbItem       *items;                             // array of objects in the database
         uint16_t        count;                              // number of objects in the items array
         uint16_t        size;                               // cached value of _database_size_param that sticks after initialized
+        float           radius_max;                         // largest radius of any object in the database since it was last empty
+
+        // objects are hashed into buckets by the horizontal grid cell
+        // holding them so close objects can be found without a search
+        uint16_t        *bucket_head;                       // first object in each bucket
+        uint16_t        *bucket_next;                       // next object in the same bucket as each object
+        uint16_t        bucket_count;                       // number of buckets, a power of two
+
+        // objects are also linked into one list per second of their
+        // timestamp so expired objects can be found without a search
+        uint16_t        *expiry_prev;                       // previous object in the same expiry list as each object
+        uint16_t        *expiry_next;                       // next object in the same expiry list as each object
+        uint16_t        expiry_head[128];                   // first object in each expiry list, must be more than the maximum EXPIRE
+        uint32_t        expiry_checked_ms;                  // expiry lists have been checked up to the second starting at this system time
     } _database;
 
     uint16_t _next_index_to_send[MAVLINK_COMM_NUM_BUFFERS]; // index of next object in _database to send to GCS
@@ -115,4 +158,40 @@ namespace AP {
     AP_OADatabase *oadatabase();
 };
 
+template <typename Fn>
+void AP_OADatabase::foreach_item_near_segment(const Vector3f &start, const Vector3f &end, float dist, Fn fn) const
+{
+    if (!healthy()) {
+        return;
+    }
+
+    // grid cells that may hold an object whose edge is within dist of the segment
+    const float range = dist + _database.radius_max;
+    const int32_t x_min = cell_of(MIN(start.x, end.x) - range);
+    const int32_t x_max = cell_of(MAX(start.x, end.x) + range);
+    const int32_t y_min = cell_of(MIN(start.y, end.y) - range);
+    const int32_t y_max = cell_of(MAX(start.y, end.y) + range);
+
+    // visiting every object is quicker than visiting mostly empty cells
+    const float num_cells = float(x_max - x_min + 1) * float(y_max - y_min + 1);
+    if (num_cells >= _database.count) {
+        for (uint16_t i=0; i<_database.count; i++) {
+            fn(_database.items[i]);
+        }
+        return;
+    }
+
+    for (int32_t x=x_min; x<=x_max; x++) {
+        for (int32_t y=y_min; y<=y_max; y++) {
+            for (uint16_t i=_database.bucket_head[bucket_of(x, y)]; i<_database.count; i=_database.bucket_next[i]) {
+                // buckets are shared with distant cells, only visit each object from its own cell
+                const OA_DbItem &item = _database.items[i];
+                if (cell_of(item.pos.x) == x && cell_of(item.pos.y) == y) {
+                    fn(item);
+                }
+            }
+        }
+    }
+}
+
 
@@ -236,7 +236,7 @@ void AP_OAPathPlanner::avoidance_thread()
 
     while (true) {
 
-        // if database queue needs attention, service it faster
+        // while points are arriving, service the database queue faster
         if (_oadatabase.process_queue()) {
             hal.scheduler->delay(1);
         } else {
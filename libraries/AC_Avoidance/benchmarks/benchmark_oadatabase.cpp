@@ -0,0 +1,56 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AC_Avoidance/AP_OADatabase.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// the database is a singleton so every benchmark shares one
+static AP_OADatabase &get_database()
+{
+    static AP_OADatabase *db;
+    if (db == nullptr) {
+        db = new AP_OADatabase();
+        AP_Param::set_object_value(db, AP_OADatabase::var_info, "SIZE", 10000);
+        AP_Param::set_object_value(db, AP_OADatabase::var_info, "QUEUE_SIZE", 200);
+        db->init();
+    }
+    return *db;
+}
+
+/*
+  time merging lidar returns into a database already holding one
+  object for each post on a square grid 5m apart.  Each iteration is
+  10ms of a 10k point/s lidar.  The argument is the number of posts
+  along each side of the grid
+ */
+static void BM_OADatabaseMerge(benchmark::State& state)
+{
+    AP_OADatabase &db = get_database();
+    if (!db.healthy()) {
+        state.SkipWithError("database init failed");
+        return;
+    }
+
+    const uint32_t side = state.range(0);
+    const float distance = 1.0f / tanf(radians(5.0f));
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        const uint32_t now_ms = AP_HAL::millis();
+        for (uint8_t i=0; i<100; i++) {
+            const uint32_t post = (n++ * 7919U) % (side * side);
+            db.queue_push(Vector3f((post % side) * 5.0f, (post / side) * 5.0f, 0.0f), now_ms, distance);
+        }
+        db.process_queue();
+        gbenchmark_escape(&db);
+    }
+    state.SetItemsProcessed(state.iterations() * 100);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%u objects", (unsigned)db.database_count());
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_OADatabaseMerge)->Arg(10)->Arg(30)->Arg(90);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,134 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AC_Avoidance/AP_OADatabase.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static float rand_float(float low, float high)
+{
+    return low + (high - low) * (float)random() / (float)RAND_MAX;
+}
+
+// the database is a singleton so every test shares one
+static AP_OADatabase &get_database()
+{
+    static AP_OADatabase *db;
+    if (db == nullptr) {
+        db = new AP_OADatabase();
+        AP_Param::set_object_value(db, AP_OADatabase::var_info, "SIZE", 2000);
+        AP_Param::set_object_value(db, AP_OADatabase::var_info, "QUEUE_SIZE", 200);
+        db->init();
+    }
+    return *db;
+}
+
+// returns number of objects visited by a query for each object in the database
+static void count_visits(const AP_OADatabase &db, const Vector3f &start, const Vector3f &end, float dist, uint16_t *visits)
+{
+    memset(visits, 0, sizeof(visits[0]) * db.database_count());
+    db.foreach_item_near_segment(start, end, dist, [&](const AP_OADatabase::OA_DbItem &item) {
+        visits[&item - &db.get_item(0)]++;
+    });
+}
+
+/*
+  push noisy lidar returns from a grid of posts, as a spinning lidar
+  would see them, and check each post ends up as exactly one object
+ */
+TEST(OADatabase, ReturnsAreMerged)
+{
+    srandom(0x4f414442);
+    AP_OADatabase &db = get_database();
+    ASSERT_TRUE(db.healthy());
+
+    // returns from this distance have a radius of 1m with the default beam width
+    const float distance = 1.0f / tanf(radians(5.0f));
+
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint16_t n=0; n<5000; n++) {
+        const Vector3f post(int32_t(random() % 20) * 5.0f - 50.0f, int32_t(random() % 20) * 5.0f - 50.0f, 0.0f);
+        const Vector3f noise(rand_float(-0.3f, 0.3f), rand_float(-0.3f, 0.3f), rand_float(-0.3f, 0.3f));
+        db.queue_push(post + noise, now_ms, distance);
+        if (n % 100 == 99) {
+            EXPECT_TRUE(db.process_queue());
+        }
+    }
+    EXPECT_FALSE(db.process_queue());
+    EXPECT_EQ(db.database_count(), 20 * 20);
+
+    uint16_t on_post[20][20] {};
+    for (uint16_t i=0; i<db.database_count(); i++) {
+        const Vector3f &pos = db.get_item(i).pos;
+        const int32_t x = lroundf((pos.x + 50.0f) / 5.0f);
+        const int32_t y = lroundf((pos.y + 50.0f) / 5.0f);
+        ASSERT_TRUE(x >= 0 && x < 20 && y >= 0 && y < 20);
+        EXPECT_LT((pos - Vector3f(x * 5.0f - 50.0f, y * 5.0f - 50.0f, 0.0f)).length(), 0.6f);
+        on_post[x][y]++;
+    }
+    for (uint8_t x=0; x<20; x++) {
+        for (uint8_t y=0; y<20; y++) {
+            EXPECT_EQ(on_post[x][y], 1);
+        }
+    }
+}
+
+/*
+  a query must visit every object whose edge is within the distance
+  of the segment, and visit each object at most once
+ */
+static void check_queries(const AP_OADatabase &db)
+{
+    uint16_t *visits = new uint16_t[db.database_count()];
+    for (uint16_t n=0; n<200; n++) {
+        const Vector3f start(rand_float(-60.0f, 210.0f), rand_float(-60.0f, 210.0f), 0.0f);
+        const Vector3f end = start + Vector3f(rand_float(-10.0f, 10.0f), rand_float(-10.0f, 10.0f), 0.0f);
+        const float dist = rand_float(0.0f, 5.0f);
+        count_visits(db, start, end, dist, visits);
+        for (uint16_t i=0; i<db.database_count(); i++) {
+            const AP_OADatabase::OA_DbItem &item = db.get_item(i);
+            EXPECT_LE(visits[i], 1);
+            if (Vector3f::closest_distance_between_line_and_point(start, end, item.pos) - item.radius <= dist) {
+                EXPECT_EQ(visits[i], 1);
+            }
+        }
+    }
+    delete[] visits;
+}
+
+TEST(OADatabase, QueryFindsNearbyObjects)
+{
+    srandom(0x51455259);
+    AP_OADatabase &db = get_database();
+    ASSERT_GT(db.database_count(), 0);
+    check_queries(db);
+}
+
+/*
+  objects older than the expiry time are removed on the next update,
+  leaving the others where they can still be found
+ */
+TEST(OADatabase, OldObjectsExpire)
+{
+    srandom(0x45585052);
+    AP_OADatabase &db = get_database();
+
+    // add objects older than the default 10 second expiry well away from the others
+    const uint32_t now_ms = AP_HAL::millis();
+    const uint16_t count_before = db.database_count();
+    for (uint8_t i=0; i<150; i++) {
+        db.queue_push(Vector3f(rand_float(100.0f, 200.0f), rand_float(100.0f, 200.0f), 0.0f), now_ms - 20000, 1.0f);
+    }
+    db.process_queue();
+    ASSERT_GT(db.database_count(), count_before);
+
+    db.update();
+    EXPECT_EQ(db.database_count(), count_before);
+    for (uint16_t i=0; i<db.database_count(); i++) {
+        EXPECT_LT(db.get_item(i).pos.x, 100.0f);
+    }
+    check_queries(db);
+}
+
+AP_GTEST_MAIN()
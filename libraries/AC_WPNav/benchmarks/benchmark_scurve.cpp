@@ -0,0 +1,69 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/SCurve.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  follow a square mission using the same three leg scheme as
+  AC_WPNav::advance_wp_target_along_track(), timing one 400Hz update
+ */
+static void BM_SCurveAdvanceTarget(benchmark::State& state)
+{
+    const Vector3f wp[] {
+        Vector3f(0.0f, 0.0f, 1000.0f),
+        Vector3f(10000.0f, 0.0f, 1000.0f),
+        Vector3f(10000.0f, 10000.0f, 2000.0f),
+        Vector3f(0.0f, 10000.0f, 2000.0f),
+        Vector3f(0.0f, 0.0f, 1000.0f),
+    };
+    const float dt = 1.0f / 400.0f;
+    const float speed_xy = 1000.0f;
+    const float speed_up = 250.0f;
+    const float speed_down = 150.0f;
+    const float accel_xy = 250.0f;
+    const float accel_z = 100.0f;
+    const float jerk_time = 0.2f;
+    const float jerk_max = 1000.0f;
+    const float wp_radius = 200.0f;
+
+    SCurve prev_leg, this_leg, next_leg;
+    uint8_t leg = 0;
+
+    while (state.KeepRunning()) {
+        if (leg == 0) {
+            // (re)start the mission
+            prev_leg.init();
+            this_leg.calculate_track(wp[0], wp[1], speed_xy, speed_up, speed_down, accel_xy, accel_z, jerk_time, jerk_max);
+            next_leg.calculate_track(wp[1], wp[2], speed_xy, speed_up, speed_down, accel_xy, accel_z, jerk_time, jerk_max);
+            leg = 1;
+        }
+
+        const bool fast_waypoint = (leg + 1 < ARRAY_SIZE(wp));
+        Vector3f target_pos = wp[leg - 1];
+        Vector3f target_vel, target_accel;
+        const bool finished = this_leg.advance_target_along_track(prev_leg, next_leg, wp_radius, fast_waypoint, dt, target_pos, target_vel, target_accel);
+        gbenchmark_escape(&target_pos);
+
+        if (finished) {
+            // promote the legs as AC_WPNav::set_wp_destination() does
+            leg++;
+            if (leg >= ARRAY_SIZE(wp)) {
+                leg = 0;
+                continue;
+            }
+            prev_leg = this_leg;
+            this_leg = next_leg;
+            if (leg + 1 < ARRAY_SIZE(wp)) {
+                next_leg.calculate_track(wp[leg], wp[leg + 1], speed_xy, speed_up, speed_down, accel_xy, accel_z, jerk_time, jerk_max);
+            } else {
+                next_leg.init();
+            }
+        }
+    }
+}
+
+BENCHMARK(BM_SCurveAdvanceTarget);
+
+BENCHMARK_MAIN();
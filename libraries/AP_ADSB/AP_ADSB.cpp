@@ -186,9 +186,19 @@ void AP_ADSB::init(void)
         in_state.list_size_param = constrain_int16(in_state.list_size_param, 1, INT16_MAX);
 
         in_state.vehicle_list = new adsb_vehicle_t[in_state.list_size_param];
+        in_state.icao_index = new uint16_t[in_state.list_size_param];
+        in_state.vehicle_distance = new float[in_state.list_size_param];
 
-        if (in_state.vehicle_list == nullptr) {
+        if (in_state.vehicle_list == nullptr ||
+            in_state.icao_index == nullptr ||
+            in_state.vehicle_distance == nullptr) {
             // dynamic RAM allocation of in_state.vehicle_list[] failed
+            delete [] in_state.vehicle_list;
+            delete [] in_state.icao_index;
+            delete [] in_state.vehicle_distance;
+            in_state.vehicle_list = nullptr;
+            in_state.icao_index = nullptr;
+            in_state.vehicle_distance = nullptr;
             _init_failed = true; // this keeps us from constantly trying to init forever in main update
             gcs().send_text(MAV_SEVERITY_INFO, "ADSB: Unable to initialize ADSB vehicle list");
             return;
@@ -365,7 +375,9 @@ void AP_ADSB::update(void)
 
 /*
  * determine index and distance of furthest vehicle. This is
- * used to bump it off when a new closer aircraft is detected
+ * used to bump it off when a new closer aircraft is detected. The
+ * distance cached when each vehicle was last updated is used so
+ * this does not need any location maths per vehicle
  */
 void AP_ADSB::determine_furthest_aircraft(void)
 {
@@ -376,7 +388,7 @@ void AP_ADSB::determine_furthest_aircraft(void)
         if (is_special_vehicle(in_state.vehicle_list[index].info.ICAO_address)) {
             continue;
         }
-        const float distance = _my_loc.get_distance(get_location(in_state.vehicle_list[index]));
+        const float distance = in_state.vehicle_distance[index];
         if (max_distance < distance || index == 0) {
             max_distance = distance;
             max_distance_index = index;
@@ -417,12 +429,65 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
         in_state.furthest_vehicle_distance = 0;
         in_state.furthest_vehicle_index = 0;
     }
-    if (index != (in_state.vehicle_count-1)) {
-        in_state.vehicle_list[index] = in_state.vehicle_list[in_state.vehicle_count-1];
+    const uint16_t last = in_state.vehicle_count-1;
+    icao_index_remove(index);
+    in_state.vehicle_count--;
+    if (index != last) {
+        // the last vehicle moves into the hole, so re-point its entry
+        // in the sorted index
+        const uint16_t pos = icao_index_lower_bound(in_state.vehicle_list[last].info.ICAO_address);
+        in_state.icao_index[pos] = index;
+        in_state.vehicle_list[index] = in_state.vehicle_list[last];
+        in_state.vehicle_distance[index] = in_state.vehicle_distance[last];
+        if (in_state.furthest_vehicle_index == last) {
+            in_state.furthest_vehicle_index = index;
+        }
     }
     // TODO: is memset needed? When we decrement the index we essentially forget about it
-    memset(&in_state.vehicle_list[in_state.vehicle_count-1], 0, sizeof(adsb_vehicle_t));
-    in_state.vehicle_count--;
+    memset(&in_state.vehicle_list[last], 0, sizeof(adsb_vehicle_t));
+}
+
+/*
+ * return the position in the sorted ICAO index of the first entry
+ * with an ICAO address not less than icao
+ */
+uint16_t AP_ADSB::icao_index_lower_bound(const uint32_t icao) const
+{
+    uint16_t lo = 0;
+    uint16_t hi = in_state.vehicle_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if (in_state.vehicle_list[in_state.icao_index[mid]].info.ICAO_address < icao) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+/*
+ * add vehicle_list[index] to the sorted ICAO index. Must be called
+ * before vehicle_count is incremented to include the new vehicle
+ */
+void AP_ADSB::icao_index_insert(const uint16_t index)
+{
+    const uint16_t pos = icao_index_lower_bound(in_state.vehicle_list[index].info.ICAO_address);
+    memmove(&in_state.icao_index[pos+1], &in_state.icao_index[pos], (in_state.vehicle_count - pos) * sizeof(in_state.icao_index[0]));
+    in_state.icao_index[pos] = index;
+}
+
+/*
+ * remove vehicle_list[index] from the sorted ICAO index. Must be
+ * called before vehicle_count is decremented
+ */
+void AP_ADSB::icao_index_remove(const uint16_t index)
+{
+    const uint16_t pos = icao_index_lower_bound(in_state.vehicle_list[index].info.ICAO_address);
+    if (pos >= in_state.vehicle_count || in_state.icao_index[pos] != index) {
+        return;
+    }
+    memmove(&in_state.icao_index[pos], &in_state.icao_index[pos+1], (in_state.vehicle_count - pos - 1) * sizeof(in_state.icao_index[0]));
 }
 
 /*
@@ -432,11 +497,11 @@ void AP_ADSB::delete_vehicle(const uint16_t index)
  */
 bool AP_ADSB::find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const
 {
-    for (uint16_t i = 0; i < in_state.vehicle_count; i++) {
-        if (in_state.vehicle_list[i].info.ICAO_address == vehicle.info.ICAO_address) {
-            *index = i;
-            return true;
-        }
+    const uint16_t pos = icao_index_lower_bound(vehicle.info.ICAO_address);
+    if (pos < in_state.vehicle_count &&
+        in_state.vehicle_list[in_state.icao_index[pos]].info.ICAO_address == vehicle.info.ICAO_address) {
+        *index = in_state.icao_index[pos];
+        return true;
     }
     return false;
 }
@@ -481,12 +546,13 @@ void AP_ADSB::handle_adsb_vehicle(const adsb_vehicle_t &vehicle)
     } else if (is_tracked_in_list) {
 
         // found, update it
-        set_vehicle(index, vehicle);
+        set_vehicle(index, vehicle, my_loc_distance_to_vehicle);
 
     } else if (in_state.vehicle_count < in_state.list_size_allocated) {
 
         // not found and there's room, add it to the end of the list
-        set_vehicle(in_state.vehicle_count, vehicle);
+        set_vehicle(in_state.vehicle_count, vehicle, my_loc_distance_to_vehicle);
+        icao_index_insert(in_state.vehicle_count);
         in_state.vehicle_count++;
 
     } else {
@@ -504,8 +570,11 @@ void AP_ADSB::handle_adsb_vehicle(const adsb_vehicle_t &vehicle)
             }
 
             if (my_loc_distance_to_vehicle < in_state.furthest_vehicle_distance) { // is closer than the furthest
-                // replace with the furthest vehicle
-                set_vehicle(in_state.furthest_vehicle_index, vehicle);
+                // replace the furthest vehicle with the new one
+                delete_vehicle(in_state.furthest_vehicle_index);
+                set_vehicle(in_state.vehicle_count, vehicle, my_loc_distance_to_vehicle);
+                icao_index_insert(in_state.vehicle_count);
+                in_state.vehicle_count++;
 
                 // in_state.furthest_vehicle_index is now invalid because the vehicle was overwritten, need
                 // to run determine_furthest_aircraft() to determine a new one next time
@@ -529,13 +598,14 @@ void AP_ADSB::handle_adsb_vehicle(const adsb_vehicle_t &vehicle)
 /*
  * Copy a vehicle's data into the list
  */
-void AP_ADSB::set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle)
+void AP_ADSB::set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle, const float distance)
 {
     if (index >= in_state.list_size_allocated) {
         // out of range
         return;
     }
     in_state.vehicle_list[index] = vehicle;
+    in_state.vehicle_distance[index] = distance;
 
     write_log(vehicle);
 }
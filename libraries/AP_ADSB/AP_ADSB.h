@@ -155,10 +155,17 @@ private:
     // return index of given vehicle if ICAO_ADDRESS matches. return -1 if no match
     bool find_index(const adsb_vehicle_t &vehicle, uint16_t *index) const;
 
+    // return position in icao_index where an ICAO address is or would be inserted
+    uint16_t icao_index_lower_bound(const uint32_t icao) const;
+
+    // add or remove a vehicle list entry from the sorted ICAO index
+    void icao_index_insert(const uint16_t index);
+    void icao_index_remove(const uint16_t index);
+
     // remove a vehicle from the list
     void delete_vehicle(const uint16_t index);
 
-    void set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle);
+    void set_vehicle(const uint16_t index, const adsb_vehicle_t &vehicle, const float distance);
 
     // Generates pseudorandom ICAO from gps time, lat, and lon
     uint32_t genICAO(const Location &loc) const;
@@ -187,6 +194,12 @@ private:
         uint16_t    list_size_allocated;
         adsb_vehicle_t *vehicle_list;
         uint16_t    vehicle_count;
+
+        // vehicle_list indexes sorted by ICAO address for O(log n) lookup
+        uint16_t    *icao_index;
+
+        // distance from us to each vehicle at the time it was last updated
+        float       *vehicle_distance;
         AP_Int32    list_radius;
         AP_Int16    list_altitude;
 
@@ -163,6 +163,13 @@ const AP_Param::GroupInfo AP_AHRS::var_info[] = {
     // @User: Advanced
     AP_GROUPINFO("CUSTOM_YAW", 17, AP_AHRS, _custom_yaw, 0),
 
+    // @Param: OPTIONS
+    // @DisplayName: AHRS options
+    // @Description: Bitmask of AHRS options. Propagating the attitude with every gyro sample gives the rate controllers the body rates of the newest gyro sample rather than of the last main loop, at the cost of some CPU in the IMU thread.
+    // @Bitmask: 0:Propagate attitude with every gyro sample
+    // @User: Advanced
+    AP_GROUPINFO("OPTIONS", 18, AP_AHRS, _options, 0),
+
     AP_GROUPEND
 };
 
@@ -176,9 +183,40 @@ void AP_AHRS::init()
 #endif
 }
 
+// give the predictor the attitude for the IMU data consumed by this
+// update, only taking gyro samples while the option is set
+void AP_AHRS::update_predictor(void)
+{
+    AP_InertialSensor &ins = AP::ins();
+    if (!option_set(Options::PROPAGATE_ATTITUDE)) {
+        if (_predictor_enabled) {
+            ins.set_gyro_sample_listener(nullptr, 0);
+            _predictor.reset();
+            _predictor_enabled = false;
+        }
+        return;
+    }
+
+    const uint8_t primary_gyro = get_primary_gyro_index();
+    Quaternion quat;
+    get_quat_body_to_ned(quat);
+    _predictor.set_reference(quat, get_gyro_drift(), primary_gyro);
+    ins.set_gyro_sample_listener(&_predictor, primary_gyro);
+    _predictor_enabled = true;
+}
+
 // return a smoothed and corrected gyro vector using the latest ins data (which may not have been consumed by the EKF yet)
 Vector3f AP_AHRS::get_gyro_latest(void) const
 {
+    if (_predictor_enabled) {
+        // body rates of the newest gyro sample, drift corrected
+        Quaternion quat;
+        Vector3f gyro;
+        uint64_t sample_us;
+        if (_predictor.get_attitude(quat, gyro, sample_us) && sample_us != 0) {
+            return gyro;
+        }
+    }
     const uint8_t primary_gyro = get_primary_gyro_index();
     return AP::ins().get_gyro(primary_gyro) + get_gyro_drift();
 }
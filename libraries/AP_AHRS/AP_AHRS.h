@@ -25,6 +25,7 @@
 #include <AP_Compass/AP_Compass.h>
 #include <AP_Airspeed/AP_Airspeed.h>
 #include <AP_InertialSensor/AP_InertialSensor.h>
+#include "AP_AHRS_Predictor.h"
 #include <AP_Param/AP_Param.h>
 #include <AP_Common/Location.h>
 
@@ -210,6 +211,14 @@ public:
     // return a smoothed and corrected gyro vector in radians/second using the latest ins data (which may not have been consumed by the EKF yet)
     Vector3f get_gyro_latest(void) const;
 
+    // return the attitude and corrected body rates propagated to the
+    // newest gyro sample, which may be several samples after the last
+    // update(). Lock free and safe to call from any thread, returns
+    // false unless AHRS_OPTIONS enables the propagation
+    bool get_attitude_latest(Quaternion &quat, Vector3f &gyro, uint64_t &sample_us) const {
+        return _predictor.get_attitude(quat, gyro, sample_us);
+    }
+
     // return the current estimate of the gyro drift
     virtual const Vector3f &get_gyro_drift(void) const = 0;
 
@@ -643,6 +652,14 @@ protected:
     AP_Float _custom_roll;
     AP_Float _custom_pitch;
     AP_Float _custom_yaw;
+    AP_Int16 _options;
+
+    enum class Options : uint16_t {
+        PROPAGATE_ATTITUDE = (1U<<0),
+    };
+    bool option_set(Options option) const {
+        return (_options & uint16_t(option)) != 0;
+    }
 
     Matrix3f _custom_rotation;
 
@@ -716,6 +733,11 @@ protected:
     // optional view class
     AP_AHRS_View *_view;
 
+    // attitude propagated at the gyro sample rate
+    AP_AHRS_Predictor _predictor;
+    bool _predictor_enabled;
+    void update_predictor(void);
+
     // AOA and SSA
     float _AOA, _SSA;
     uint32_t _last_AOA_update_ms;
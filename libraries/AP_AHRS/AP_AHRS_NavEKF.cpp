@@ -209,6 +209,8 @@ void AP_AHRS_NavEKF::update(bool skip_ins_update)
         }
         GCS_SEND_TEXT(MAV_SEVERITY_INFO, "AHRS: %s active", shortname);
     }
+
+    update_predictor();
 }
 
 void AP_AHRS_NavEKF::update_DCM(bool skip_ins_update)
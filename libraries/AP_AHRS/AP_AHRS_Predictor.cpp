@@ -0,0 +1,135 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  AHRS attitude predictor
+ *
+ *  The main loop latches the delta angle accumulated from the gyro
+ *  samples since the previous loop, and the AHRS update then produces
+ *  an attitude for the end of those samples. Every sample arriving
+ *  after the latch is applied on top of that attitude, as the EKF
+ *  output predictor does with its delta angles, so the published
+ *  attitude is never more than one gyro sample old.
+ *
+ */
+
+#include "AP_AHRS_Predictor.h"
+
+void AP_AHRS_Predictor::set_reference(const Quaternion &quat, const Vector3f &gyro_drift, uint8_t gyro_instance)
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (!_have_reference || gyro_instance != _instance) {
+        // samples already accumulated were from another gyro, or
+        // from before there was an attitude to apply them to
+        _delta.initialise();
+        _last_sample_us = 0;
+    }
+    _reference = quat;
+    _delta_latched.initialise();
+    _gyro_drift = gyro_drift;
+    _instance = gyro_instance;
+    _have_reference = true;
+
+    publish(_last_gyro, _last_sample_us);
+}
+
+void AP_AHRS_Predictor::reset(void)
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (!_have_reference) {
+        return;
+    }
+    _have_reference = false;
+
+    output out {};
+    out.valid = false;
+    write_output(out);
+}
+
+void AP_AHRS_Predictor::gyro_sample(uint8_t instance, const Vector3f &delta_angle, const Vector3f &gyro_filtered,
+                                    float dt, uint64_t sample_us)
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (!_have_reference || instance != _instance) {
+        return;
+    }
+    _delta.rotate_fast(delta_angle + _gyro_drift * dt);
+    _last_gyro = gyro_filtered + _gyro_drift;
+    _last_sample_us = sample_us;
+
+    publish(_last_gyro, sample_us);
+}
+
+void AP_AHRS_Predictor::gyro_frame_latched(uint8_t instance)
+{
+    WITH_SEMAPHORE(_sem);
+
+    if (!_have_reference || instance != _instance) {
+        return;
+    }
+    // normally the AHRS update consumes each latched frame before the
+    // next, but keep the rotation if it skipped one
+    _delta_latched *= _delta;
+    _delta_latched.normalize();
+    _delta.initialise();
+}
+
+// called with _sem held
+void AP_AHRS_Predictor::publish(const Vector3f &gyro, uint64_t sample_us)
+{
+    output out;
+    out.quat = _reference * _delta_latched * _delta;
+    out.quat.normalize();
+    out.gyro = gyro;
+    out.sample_us = sample_us;
+    out.valid = true;
+
+    write_output(out);
+}
+
+// called with _sem held
+void AP_AHRS_Predictor::write_output(const output &out)
+{
+    // readers use the other copy while each one is written
+    const uint32_t seq = _output_seq.load(std::memory_order_relaxed);
+    _output_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    _output[0] = out;
+    _output_seq.store(seq + 2, std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_release);
+    _output[1] = out;
+}
+
+bool AP_AHRS_Predictor::get_attitude(Quaternion &quat, Vector3f &gyro, uint64_t &sample_us) const
+{
+    for (uint8_t tries = 0; tries < 4; tries++) {
+        const uint32_t seq = _output_seq.load(std::memory_order_acquire);
+        const output out = _output[seq & 1];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_output_seq.load(std::memory_order_relaxed) == seq) {
+            if (!out.valid) {
+                return false;
+            }
+            quat = out.quat;
+            gyro = out.gyro;
+            sample_us = out.sample_us;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ *  AHRS attitude predictor - propagates the attitude from the last
+ *  AHRS update with every gyro sample, so consumers running faster
+ *  than the main loop can see attitude at the sensor rate without
+ *  running the EKF faster
+ *
+ */
+
+#include <atomic>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_Math/AP_Math.h>
+
+class AP_AHRS_Predictor final : public AP_InertialSensor::GyroSampleListener
+{
+public:
+    /*
+      set the attitude estimate for the gyro data up to the last
+      AP_InertialSensor::update(), together with the gyro drift
+      estimate and the gyro it applies to. Called from the main loop
+     */
+    void set_reference(const Quaternion &quat, const Vector3f &gyro_drift, uint8_t gyro_instance);
+
+    // drop the reference, get_attitude() returns false until the next
+    // set_reference()
+    void reset(void);
+
+    /*
+      get the attitude propagated to the newest gyro sample, the
+      corrected and filtered body rates of that sample and its
+      timestamp. Lock free and safe to call from any thread, returns
+      false until there is a reference
+     */
+    bool get_attitude(Quaternion &quat, Vector3f &gyro, uint64_t &sample_us) const;
+
+    // AP_InertialSensor::GyroSampleListener
+    void gyro_sample(uint8_t instance, const Vector3f &delta_angle, const Vector3f &gyro_filtered,
+                     float dt, uint64_t sample_us) override;
+    void gyro_frame_latched(uint8_t instance) override;
+
+private:
+    struct output {
+        Quaternion quat;
+        Vector3f gyro;
+        uint64_t sample_us;
+        bool valid;
+    };
+
+    void publish(const Vector3f &gyro, uint64_t sample_us);
+    void write_output(const output &out);
+
+    // protects the propagation state, which is written both by the
+    // sensor thread and the main loop
+    HAL_Semaphore _sem;
+
+    Quaternion _reference;
+    // rotation over the samples handed to the main loop but not yet
+    // covered by _reference
+    Quaternion _delta_latched;
+    // rotation over the samples since the last hand over
+    Quaternion _delta;
+    Vector3f _gyro_drift;
+    Vector3f _last_gyro;
+    uint64_t _last_sample_us;
+    uint8_t _instance;
+    bool _have_reference;
+
+    /*
+      two copies of the output selected by the low bit of the
+      sequence, so a reader always finds a complete copy even if it
+      preempts the writer part way through an update
+     */
+    output _output[2];
+    std::atomic<uint32_t> _output_seq{0};
+};
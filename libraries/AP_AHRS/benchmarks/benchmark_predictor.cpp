@@ -0,0 +1,49 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_AHRS/AP_AHRS_Predictor.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  cost added to the sensor thread for each gyro sample
+ */
+static void BM_PredictorGyroSample(benchmark::State& state)
+{
+    AP_AHRS_Predictor *predictor = new AP_AHRS_Predictor();
+    predictor->set_reference(Quaternion(), Vector3f(0.01f, 0.0f, -0.02f), 0);
+
+    const float dt = 1.0f / 8000.0f;
+    const Vector3f gyro(0.3f, -0.2f, 1.0f);
+    uint64_t n = 0;
+    while (state.KeepRunning()) {
+        predictor->gyro_sample(0, gyro * dt, gyro, dt, n);
+        if (++n % 20 == 0) {
+            predictor->gyro_frame_latched(0);
+        }
+        gbenchmark_escape(predictor);
+    }
+    delete predictor;
+}
+
+/*
+  cost of a query from a fast rate loop
+ */
+static void BM_PredictorGetAttitude(benchmark::State& state)
+{
+    AP_AHRS_Predictor *predictor = new AP_AHRS_Predictor();
+    predictor->set_reference(Quaternion(), Vector3f(), 0);
+
+    Quaternion quat;
+    Vector3f gyro;
+    uint64_t sample_us;
+    while (state.KeepRunning()) {
+        predictor->get_attitude(quat, gyro, sample_us);
+        gbenchmark_escape(&quat);
+    }
+    delete predictor;
+}
+
+BENCHMARK(BM_PredictorGyroSample);
+BENCHMARK(BM_PredictorGetAttitude);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,157 @@
+#include <AP_gtest.h>
+
+#include <AP_AHRS/AP_AHRS_Predictor.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static float attitude_error(const Quaternion &a, const Quaternion &b)
+{
+    Quaternion diff = a.inverse() * b;
+    Vector3f v;
+    diff.to_axis_angle(v);
+    return v.length();
+}
+
+/*
+  a gyro at 8kHz under a 400Hz main loop. The main loop latches the
+  samples so far, then gives the predictor the true attitude at the
+  latch a few samples later, as an AHRS update would
+ */
+class PredictorFlight
+{
+public:
+    static constexpr float dt = 1.0f / 8000.0f;
+    static constexpr uint16_t samples_per_loop = 20;
+    static constexpr uint16_t update_delay = 3;
+
+    PredictorFlight(const Vector3f &_gyro_bias) :
+        gyro_bias(_gyro_bias)
+    {
+        // allocated as the predictor relies on new zeroing the memory
+        predictor = new AP_AHRS_Predictor();
+        truth.from_euler(0.1f, -0.2f, 1.0f);
+    }
+
+    ~PredictorFlight()
+    {
+        delete predictor;
+    }
+
+    // advance by one gyro sample, returning the true attitude
+    const Quaternion &step()
+    {
+        const float t = n * dt;
+        const Vector3f rate(2.0f * sinf(3.0f * t), 1.0f, -1.5f * cosf(2.0f * t));
+        const Vector3f delta_angle = rate * dt;
+        truth.rotate(delta_angle);
+        truth.normalize();
+        n++;
+        predictor->gyro_sample(0, delta_angle + gyro_bias * dt, rate + gyro_bias, dt, n);
+
+        if (n % samples_per_loop == 0) {
+            predictor->gyro_frame_latched(0);
+            latched = truth;
+        } else if (n % samples_per_loop == update_delay) {
+            predictor->set_reference(latched, -gyro_bias, 0);
+            reference = latched;
+        }
+        return truth;
+    }
+
+    AP_AHRS_Predictor *predictor;
+    Quaternion reference;
+
+private:
+    Vector3f gyro_bias;
+    Quaternion truth;
+    Quaternion latched;
+    uint32_t n = 0;
+};
+
+TEST(AHRSPredictor, NoAttitudeBeforeReference)
+{
+    AP_AHRS_Predictor *predictor = new AP_AHRS_Predictor();
+    Quaternion quat;
+    Vector3f gyro;
+    uint64_t sample_us;
+    predictor->gyro_sample(0, Vector3f(0.01f, 0, 0), Vector3f(1, 0, 0), 0.01f, 1000);
+    predictor->gyro_frame_latched(0);
+    EXPECT_FALSE(predictor->get_attitude(quat, gyro, sample_us));
+    delete predictor;
+}
+
+/*
+  the predicted attitude must track every sample, where the attitude
+  from the last update lags by up to a main loop period
+ */
+TEST(AHRSPredictor, TracksGyroSamples)
+{
+    PredictorFlight flight(Vector3f(0.02f, -0.01f, 0.03f));
+
+    float max_error = 0.0f;
+    float max_lag_error = 0.0f;
+    for (uint32_t i = 0; i < 8000 * 5; i++) {
+        const Quaternion &truth = flight.step();
+        if (i < 100) {
+            continue;
+        }
+        Quaternion quat;
+        Vector3f gyro;
+        uint64_t sample_us;
+        ASSERT_TRUE(flight.predictor->get_attitude(quat, gyro, sample_us));
+        EXPECT_EQ(sample_us, i + 1);
+        max_error = MAX(max_error, attitude_error(quat, truth));
+        max_lag_error = MAX(max_lag_error, attitude_error(flight.reference, truth));
+    }
+    EXPECT_LT(max_error, radians(0.01f));
+    EXPECT_GT(max_lag_error, radians(0.3f));
+}
+
+// samples from a gyro other than the one the AHRS uses are ignored
+TEST(AHRSPredictor, FollowsReferenceGyro)
+{
+    AP_AHRS_Predictor *predictor = new AP_AHRS_Predictor();
+    Quaternion reference;
+    predictor->set_reference(reference, Vector3f(), 1);
+    predictor->gyro_sample(0, Vector3f(0.1f, 0, 0), Vector3f(10, 0, 0), 0.01f, 1000);
+
+    Quaternion quat;
+    Vector3f gyro;
+    uint64_t sample_us;
+    ASSERT_TRUE(predictor->get_attitude(quat, gyro, sample_us));
+    EXPECT_FLOAT_EQ(attitude_error(quat, reference), 0.0f);
+
+    predictor->gyro_sample(1, Vector3f(0.1f, 0, 0), Vector3f(10, 0, 0), 0.01f, 2000);
+    ASSERT_TRUE(predictor->get_attitude(quat, gyro, sample_us));
+    EXPECT_NEAR(attitude_error(quat, reference), 0.1f, 1e-4f);
+    EXPECT_EQ(sample_us, 2000U);
+    EXPECT_FLOAT_EQ(gyro.x, 10.0f);
+    delete predictor;
+}
+
+// once reset, nothing is published until there is a new reference
+TEST(AHRSPredictor, ResetDropsAttitude)
+{
+    AP_AHRS_Predictor *predictor = new AP_AHRS_Predictor();
+    Quaternion reference;
+    predictor->set_reference(reference, Vector3f(), 0);
+    predictor->gyro_sample(0, Vector3f(0.1f, 0, 0), Vector3f(10, 0, 0), 0.01f, 1000);
+
+    Quaternion quat;
+    Vector3f gyro;
+    uint64_t sample_us;
+    ASSERT_TRUE(predictor->get_attitude(quat, gyro, sample_us));
+
+    predictor->reset();
+    EXPECT_FALSE(predictor->get_attitude(quat, gyro, sample_us));
+    predictor->gyro_sample(0, Vector3f(0.1f, 0, 0), Vector3f(10, 0, 0), 0.01f, 2000);
+    EXPECT_FALSE(predictor->get_attitude(quat, gyro, sample_us));
+
+    predictor->set_reference(reference, Vector3f(), 0);
+    ASSERT_TRUE(predictor->get_attitude(quat, gyro, sample_us));
+    EXPECT_FLOAT_EQ(attitude_error(quat, reference), 0.0f);
+    EXPECT_EQ(sample_us, 0U);
+    delete predictor;
+}
+
+AP_GTEST_MAIN()
@@ -342,13 +342,31 @@ void AP_Avoidance::update_threat_level(const Location &my_loc,
     obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_NONE;
 
     const uint32_t obstacle_age = AP_HAL::millis() - obstacle.timestamp_ms;
-    float closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _fail_time_horizon + obstacle_age/1000);
-    if (closest_xy < _fail_distance_xy) {
-        obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_HIGH;
-    } else {
+    const float current_distance = my_loc.get_distance(obstacle_loc);
+
+    // cheap conservative check before refining with the closest
+    // approach maths. The two vehicles can not get any closer than
+    // their current distance less the distance they can close at
+    // their current relative speed over the longest time horizon
+    const Vector2f net_velocity_ne = Vector2f(my_vel[0] - obstacle_vel[0], my_vel[1] - obstacle_vel[1]);
+    const float net_speed_ne = net_velocity_ne.length();
+    const uint8_t max_time_horizon = MAX(_fail_time_horizon, _warn_time_horizon) + obstacle_age/1000;
+    const float min_possible_xy = current_distance - net_speed_ne * max_time_horizon;
+    float closest_xy;
+    if (min_possible_xy >= MAX(_fail_distance_xy, _warn_distance_xy)) {
+        // can not be a threat, so skip the fail horizon check. The
+        // bound is not the closest approach, so we still work that
+        // out over the warn horizon for reporting and threat ordering
         closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _warn_time_horizon + obstacle_age/1000);
-        if (closest_xy < _warn_distance_xy) {
-            obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_LOW;
+    } else {
+        closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _fail_time_horizon + obstacle_age/1000);
+        if (closest_xy < _fail_distance_xy) {
+            obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_HIGH;
+        } else {
+            closest_xy = closest_approach_xy(my_loc, my_vel, obstacle_loc, obstacle_vel, _warn_time_horizon + obstacle_age/1000);
+            if (closest_xy < _warn_distance_xy) {
+                obstacle.threat_level = MAV_COLLISION_THREAT_LEVEL_LOW;
+            }
         }
     }
 
@@ -375,13 +393,11 @@ void AP_Avoidance::update_threat_level(const Location &my_loc,
     // level is none - but only *once the GCS has been informed*!
     obstacle.closest_approach_xy = closest_xy;
     obstacle.closest_approach_z = closest_z;
-    float current_distance = my_loc.get_distance(obstacle_loc);
     obstacle.distance_to_closest_approach = current_distance - closest_xy;
-    Vector2f net_velocity_ne = Vector2f(my_vel[0] - obstacle_vel[0], my_vel[1] - obstacle_vel[1]);
     obstacle.time_to_closest_approach = 0.0f;
     if (!is_zero(obstacle.distance_to_closest_approach) &&
-        ! is_zero(net_velocity_ne.length())) {
-        obstacle.time_to_closest_approach = obstacle.distance_to_closest_approach / net_velocity_ne.length();
+        ! is_zero(net_speed_ne)) {
+        obstacle.time_to_closest_approach = obstacle.distance_to_closest_approach / net_speed_ne;
     }
 }
 
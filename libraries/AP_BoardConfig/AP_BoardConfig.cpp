@@ -269,8 +269,8 @@ const AP_Param::GroupInfo AP_BoardConfig::var_info[] = {
 
     // @Param: OPTIONS
     // @DisplayName: Board options
-    // @Description: Board specific option flags
-    // @Bitmask: 0:Enable hardware watchdog, 1:Disable MAVftp, 2:Enable set of internal parameters
+    // @Description: Board specific option flags. Compacting parameter storage frees space when it is full by removing saved parameters that are at their default value. Those parameters then follow any later change of their default, such as from a new defaults file or firmware
+    // @Bitmask: 0:Enable hardware watchdog, 1:Disable MAVftp, 2:Enable set of internal parameters, 3:Compact parameter storage when full
     // @User: Advanced
     AP_GROUPINFO("OPTIONS", 19, AP_BoardConfig, _options, HAL_BRD_OPTIONS_DEFAULT),
 
@@ -176,6 +176,7 @@ public:
         BOARD_OPTION_WATCHDOG = (1 << 0),
         DISABLE_FTP = (1<<1),
         ALLOW_SET_INTERNAL_PARM = (1<<2),
+        COMPACT_PARAM_STORAGE = (1<<3),
     };
 
     // return true if ftp is disabled
@@ -192,6 +193,11 @@ public:
     static bool allow_set_internal_parameters(void) {
         return _singleton?(_singleton->_options & ALLOW_SET_INTERNAL_PARM)!=0:false;
     }
+
+    // return true if full parameter storage may be compacted
+    static bool param_compact_enabled(void) {
+        return _singleton?(_singleton->_options & COMPACT_PARAM_STORAGE)!=0:false;
+    }
     
     // handle press of safety button. Return true if safety state
     // should be toggled
@@ -50,6 +50,8 @@ int AP_Filesystem_Param::open(const char *fname, int flags)
             errno = ENOMEM;
             return -1;
         }
+        // checkpoints are only an optimisation, carry on without them
+        r.checkpoints = new cursor[num_checkpoints];
     }
     r.file_ofs = 0;
     r.open = true;
@@ -98,6 +100,9 @@ int AP_Filesystem_Param::open(const char *fname, int flags)
 
 failed:
     delete [] r.cursors;
+    r.cursors = nullptr;
+    delete [] r.checkpoints;
+    r.checkpoints = nullptr;
     r.open = false;
     errno = EINVAL;
     return -1;
@@ -118,6 +123,8 @@ int AP_Filesystem_Param::close(int fd)
     r.open = false;
     delete [] r.cursors;
     r.cursors = nullptr;
+    delete [] r.checkpoints;
+    r.checkpoints = nullptr;
     delete r.writebuf;
     r.writebuf = nullptr;
     return ret;
@@ -219,7 +226,11 @@ bool AP_Filesystem_Param::token_seek(const struct rfile &r, const uint32_t data_
         memset(&c, 0, sizeof(c));
         return true;
     }
-    if (c.token_ofs > data_ofs) {
+    const struct cursor *cp = find_checkpoint(r, data_ofs);
+    if (cp != nullptr && (c.token_ofs > data_ofs || cp->token_ofs > c.token_ofs)) {
+        // resume from the closest checkpoint before data_ofs
+        c = *cp;
+    } else if (c.token_ofs > data_ofs) {
         memset(&c, 0, sizeof(c));
     }
 
@@ -230,6 +241,7 @@ bool AP_Filesystem_Param::token_seek(const struct rfile &r, const uint32_t data_
         }
         c.trailer_len -= n;
         c.token_ofs += n;
+        save_checkpoint(r, c);
     }
     
     while (data_ofs != c.token_ofs) {
@@ -246,10 +258,46 @@ bool AP_Filesystem_Param::token_seek(const struct rfile &r, const uint32_t data_
             memcpy(c.trailer, &tbuf[n], c.trailer_len);
         }
         c.token_ofs += n;
+        save_checkpoint(r, c);
     }
     return data_ofs == c.token_ofs;
 }
 
+/*
+  record the cursor the first time it passes a checkpoint boundary
+ */
+void AP_Filesystem_Param::save_checkpoint(const struct rfile &r, const struct cursor &c)
+{
+    if (r.checkpoints == nullptr) {
+        return;
+    }
+    const uint32_t slot = c.token_ofs / checkpoint_interval;
+    if (slot == 0 || slot > num_checkpoints) {
+        return;
+    }
+    struct cursor &cp = r.checkpoints[slot-1];
+    if (cp.token_ofs == 0) {
+        cp = c;
+    }
+}
+
+/*
+  find the checkpoint closest to and not after data_ofs
+ */
+const struct AP_Filesystem_Param::cursor *AP_Filesystem_Param::find_checkpoint(const struct rfile &r, const uint32_t data_ofs) const
+{
+    if (r.checkpoints == nullptr) {
+        return nullptr;
+    }
+    for (int8_t i=MIN(data_ofs / checkpoint_interval, num_checkpoints)-1; i>=0; i--) {
+        const struct cursor &cp = r.checkpoints[i];
+        if (cp.token_ofs != 0 && cp.token_ofs <= data_ofs) {
+            return &cp;
+        }
+    }
+    return nullptr;
+}
+
 int32_t AP_Filesystem_Param::read(int fd, void *buf, uint32_t count)
 {
     if (fd < 0 || fd >= max_open_file || !file[fd].open) {
@@ -347,6 +395,7 @@ int32_t AP_Filesystem_Param::read(int fd, void *buf, uint32_t count)
         c.trailer_len -= n;
         total += n;
         c.token_ofs += n;
+        save_checkpoint(r, c);
     }
 
     while (count > 0) {
@@ -372,6 +421,7 @@ int32_t AP_Filesystem_Param::read(int fd, void *buf, uint32_t count)
         ubuf += n;
         total += n;
         c.token_ofs += n;
+        save_checkpoint(r, c);
     }
     r.file_ofs += total;
     return total + header_total;
@@ -575,15 +625,20 @@ bool AP_Filesystem_Param::param_upload_parse(const rfile &r, bool &need_retry)
  */
 bool AP_Filesystem_Param::finish_upload(const rfile &r)
 {
+    // new parameters are appended to storage in one pass
+    AP_Param::save_bulk_begin();
+    bool ret = true;
     uint8_t loops = 0;
     while (loops++ < 4) {
         bool need_retry;
         if (!param_upload_parse(r, need_retry)) {
-            return false;
+            ret = false;
+            break;
         }
         if (!need_retry) {
             break;
         }
     }
-    return true;
+    AP_Param::save_bulk_end();
+    return ret;
 }
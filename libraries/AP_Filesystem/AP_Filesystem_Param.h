@@ -22,6 +22,8 @@
 
 class AP_Filesystem_Param : public AP_Filesystem_Backend
 {
+    friend class AP_Filesystem_Param_Test;
+
 public:
     // functions that closely match the equivalent posix calls
     int open(const char *fname, int flags) override;
@@ -36,6 +38,12 @@ private:
     // when filling in gaps
     static constexpr uint8_t num_cursors = 2;
 
+    // cursor positions saved every checkpoint_interval bytes of the
+    // first pass through the file, so filling in a gap near the end
+    // doesn't have to walk every parameter from the start
+    static constexpr uint8_t num_checkpoints = 16;
+    static constexpr uint16_t checkpoint_interval = 1024;
+
     // only allow up to 4 files at a time
     static constexpr uint8_t max_open_file = 4;
 
@@ -68,10 +76,13 @@ private:
         uint32_t file_ofs;
         uint32_t file_size;
         struct cursor *cursors;
+        struct cursor *checkpoints;
         ExpandingString *writebuf; // for upload
     } file[max_open_file];
 
     bool token_seek(const struct rfile &r, const uint32_t data_ofs, struct cursor &c);
+    void save_checkpoint(const struct rfile &r, const struct cursor &c);
+    const struct cursor *find_checkpoint(const struct rfile &r, const uint32_t data_ofs) const;
     uint8_t pack_param(const struct rfile &r, struct cursor &c, uint8_t *buf);
     bool check_file_name(const char *fname);
 
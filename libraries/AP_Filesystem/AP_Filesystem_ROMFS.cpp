@@ -31,7 +31,7 @@ int AP_Filesystem_ROMFS::open(const char *fname, int flags)
     }
     uint8_t idx;
     for (idx=0; idx<max_open_file; idx++) {
-        if (file[idx].data == nullptr) {
+        if (file[idx].stream == nullptr) {
             break;
         }
     }
@@ -39,12 +39,12 @@ int AP_Filesystem_ROMFS::open(const char *fname, int flags)
         errno = ENFILE;
         return -1;
     }
-    if (file[idx].data != nullptr) {
+    if (file[idx].stream != nullptr) {
         errno = EBUSY;
         return -1;
     }
-    file[idx].data = AP_ROMFS::find_decompress(fname, file[idx].size);
-    if (file[idx].data == nullptr) {
+    file[idx].stream = AP_ROMFS::stream_open(fname, file[idx].size);
+    if (file[idx].stream == nullptr) {
         errno = ENOENT;
         return -1;
     }
@@ -54,28 +54,28 @@ int AP_Filesystem_ROMFS::open(const char *fname, int flags)
 
 int AP_Filesystem_ROMFS::close(int fd)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd].stream == nullptr) {
         errno = EBADF;
         return -1;
     }
-    AP_ROMFS::free(file[fd].data);
-    file[fd].data = nullptr;
+    AP_ROMFS::stream_close(file[fd].stream);
+    file[fd].stream = nullptr;
     return 0;
 }
 
 int32_t AP_Filesystem_ROMFS::read(int fd, void *buf, uint32_t count)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd].stream == nullptr) {
         errno = EBADF;
         return -1;
     }
-    count = MIN(file[fd].size - file[fd].ofs, count);
-    if (count == 0) {
-        return 0;
+    const int32_t ret = AP_ROMFS::stream_read(file[fd].stream, file[fd].ofs, (uint8_t *)buf, count);
+    if (ret < 0) {
+        errno = EIO;
+        return -1;
     }
-    memcpy(buf, &file[fd].data[file[fd].ofs], count);
-    file[fd].ofs += count;
-    return count;
+    file[fd].ofs += ret;
+    return ret;
 }
 
 int32_t AP_Filesystem_ROMFS::write(int fd, const void *buf, uint32_t count)
@@ -91,7 +91,7 @@ int AP_Filesystem_ROMFS::fsync(int fd)
 
 int32_t AP_Filesystem_ROMFS::lseek(int fd, int32_t offset, int seek_from)
 {
-    if (fd < 0 || fd >= max_open_file || file[fd].data == nullptr) {
+    if (fd < 0 || fd >= max_open_file || file[fd].stream == nullptr) {
         errno = EBADF;
         return -1;
     }
@@ -116,12 +116,10 @@ int32_t AP_Filesystem_ROMFS::lseek(int fd, int32_t offset, int seek_from)
 int AP_Filesystem_ROMFS::stat(const char *name, struct stat *stbuf)
 {
     uint32_t size;
-    const uint8_t *data = AP_ROMFS::find_decompress(name, size);
-    if (data == nullptr) {
+    if (!AP_ROMFS::find_size(name, size)) {
         errno = ENOENT;
         return -1;
     }
-    AP_ROMFS::free(data);
     memset(stbuf, 0, sizeof(*stbuf));
     stbuf->st_size = size;
     return 0;
@@ -16,6 +16,7 @@
 #pragma once
 
 #include "AP_Filesystem_backend.h"
+#include <AP_ROMFS/AP_ROMFS.h>
 
 class AP_Filesystem_ROMFS : public AP_Filesystem_Backend
 {
@@ -55,8 +56,10 @@ private:
     // only allow up to 4 files at a time
     static constexpr uint8_t max_open_file = 4;
     static constexpr uint8_t max_open_dir = 4;
+    // files are streamed through a small window rather than
+    // decompressed in full on open
     struct rfile {
-        const uint8_t *data;
+        AP_ROMFS::Stream *stream;
         uint32_t size;
         uint32_t ofs;
     } file[max_open_file];
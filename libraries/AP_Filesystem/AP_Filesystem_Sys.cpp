@@ -22,6 +22,7 @@
 #include <AP_Math/AP_Math.h>
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Scheduler/AP_Scheduler.h>
+#include <GCS_MAVLink/GCS.h>
 #include <AP_Common/ExpandingString.h>
 
 extern const AP_HAL::HAL& hal;
@@ -36,6 +37,9 @@ static const SysFileList sysfs_file_list[] = {
     {"dma.txt"},
     {"memory.txt"},
     {"uarts.txt"},
+#if !defined(HAL_NO_GCS) && GCS_STREAM_SCHEDULER_ENABLED
+    {"streams.txt"},
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     {"can_log.txt"},
     {"can0_stats.txt"},
@@ -104,6 +108,11 @@ int AP_Filesystem_Sys::open(const char *fname, int flags)
     if (strcmp(fname, "uarts.txt") == 0) {
         hal.util->uart_info(*r.str);
     }
+#if !defined(HAL_NO_GCS) && GCS_STREAM_SCHEDULER_ENABLED
+    if (strcmp(fname, "streams.txt") == 0) {
+        gcs().stream_info(*r.str);
+    }
+#endif
 #if HAL_MAX_CAN_PROTOCOL_DRIVERS
     int8_t can_stats_num = -1;
     if (strcmp(fname, "can_log.txt") == 0) {
@@ -0,0 +1,103 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Filesystem/AP_Filesystem_Param.h>
+#include <AP_Param/tests/param_test.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+const struct AP_Param::Info var_info[] = {
+    TEST_VAR_INFO,
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+static AP_Filesystem_Param fs;
+
+// the block size MAVFTP reads with
+#define READ_SIZE 239
+
+class AP_Filesystem_Param_Test {
+public:
+    // as if the checkpoints could not be allocated, which is how
+    // reads worked before there were checkpoints
+    static void drop_checkpoints(int fd)
+    {
+        AP_Filesystem_Param::rfile &r = fs.file[fd];
+        delete [] r.checkpoints;
+        r.checkpoints = nullptr;
+    }
+};
+
+// read to the end of the file, returning the bytes read
+static uint32_t read_file(int fd)
+{
+    uint8_t buf[READ_SIZE];
+    uint32_t total = 0;
+    int32_t n;
+    while ((n = fs.read(fd, buf, sizeof(buf))) > 0) {
+        total += n;
+    }
+    return total;
+}
+
+/*
+  download the whole of param.pck as MAVFTP does
+ */
+static void BM_ParamPckDownload(benchmark::State& state)
+{
+    uint32_t size = 0;
+    while (state.KeepRunning()) {
+        const int fd = fs.open("param.pck", O_RDONLY);
+        if (fd < 0) {
+            state.SkipWithError("open failed");
+            break;
+        }
+        size = read_file(fd);
+        fs.close(fd);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+BENCHMARK(BM_ParamPckDownload);
+
+/*
+  after a download, fill in every fourth block starting from the end,
+  as after packet loss on a long link. With range(0) of 0 the
+  checkpoints are dropped
+ */
+static void BM_ParamPckGapFill(benchmark::State& state)
+{
+    const int fd = fs.open("param.pck", O_RDONLY);
+    if (fd < 0) {
+        state.SkipWithError("open failed");
+        return;
+    }
+    if (state.range(0) == 0) {
+        AP_Filesystem_Param_Test::drop_checkpoints(fd);
+        state.SetLabel("no checkpoints");
+    } else {
+        state.SetLabel("checkpoints");
+    }
+    const uint32_t size = read_file(fd);
+    uint8_t buf[READ_SIZE];
+    uint32_t blocks = 0;
+    while (state.KeepRunning()) {
+        for (int32_t ofs = (size-1) / READ_SIZE * READ_SIZE; ofs >= 0; ofs -= 4*READ_SIZE) {
+            fs.lseek(fd, ofs, SEEK_SET);
+            if (fs.read(fd, buf, sizeof(buf)) <= 0) {
+                state.SkipWithError("read failed");
+                break;
+            }
+            gbenchmark_escape(buf);
+            blocks++;
+        }
+    }
+    fs.close(fd);
+    state.SetItemsProcessed(blocks);
+}
+
+BENCHMARK(BM_ParamPckGapFill)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
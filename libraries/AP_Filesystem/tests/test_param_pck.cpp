@@ -0,0 +1,139 @@
+#include <AP_gtest.h>
+
+#include <AP_Filesystem/AP_Filesystem.h>
+#include <AP_Filesystem/AP_Filesystem_Param.h>
+#include <AP_Param/tests/param_test.h>
+
+#include <vector>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+const struct AP_Param::Info var_info[] = {
+    TEST_VAR_INFO,
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+// the block size MAVFTP reads with
+#define READ_SIZE 239
+
+class AP_Filesystem_Param_Test : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        for (uint8_t i=0; i<TEST_GROUPS; i++) {
+            for (uint8_t j=0; j<TEST_GAINS; j++) {
+                groups[i].gain[j].set(i*TEST_GAINS + j);
+            }
+        }
+    }
+
+    // read a whole file from the start
+    std::vector<uint8_t> read_file(int fd)
+    {
+        std::vector<uint8_t> data;
+        uint8_t buf[READ_SIZE];
+        int32_t n;
+        while ((n = fs.read(fd, buf, sizeof(buf))) > 0) {
+            data.insert(data.end(), buf, buf+n);
+        }
+        return data;
+    }
+
+    // number of checkpoints recorded for an open file
+    uint8_t checkpoints_used(int fd) const
+    {
+        const AP_Filesystem_Param::rfile &r = fs.file[fd];
+        uint8_t n = 0;
+        for (uint8_t i=0; i<AP_Filesystem_Param::num_checkpoints; i++) {
+            if (r.checkpoints != nullptr && r.checkpoints[i].token_ofs != 0) {
+                n++;
+            }
+        }
+        return n;
+    }
+
+    // as if the checkpoints could not be allocated
+    void drop_checkpoints(int fd)
+    {
+        AP_Filesystem_Param::rfile &r = fs.file[fd];
+        delete [] r.checkpoints;
+        r.checkpoints = nullptr;
+    }
+
+    // re-read blocks from the end back to the start, as when filling
+    // in gaps, checking they match the first read
+    void check_gap_fill(int fd, const std::vector<uint8_t> &data)
+    {
+        uint8_t buf[READ_SIZE];
+        for (int32_t ofs = (data.size()-1) / READ_SIZE * READ_SIZE; ofs >= 0; ofs -= 3*READ_SIZE) {
+            ASSERT_EQ(fs.lseek(fd, ofs, SEEK_SET), ofs);
+            const int32_t n = fs.read(fd, buf, sizeof(buf));
+            ASSERT_EQ(n, MIN(int32_t(data.size()) - ofs, READ_SIZE)) << "offset " << ofs;
+            EXPECT_EQ(memcmp(buf, &data[ofs], n), 0) << "offset " << ofs;
+        }
+    }
+
+    AP_Filesystem_Param fs;
+
+    static constexpr uint16_t checkpoint_interval = AP_Filesystem_Param::checkpoint_interval;
+    static constexpr uint8_t num_checkpoints = AP_Filesystem_Param::num_checkpoints;
+    static constexpr uint8_t header_size = sizeof(AP_Filesystem_Param::header);
+};
+
+TEST_F(AP_Filesystem_Param_Test, GapFillCheckpoints)
+{
+    const int fd = fs.open("param.pck", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    const std::vector<uint8_t> data = read_file(fd);
+    ASSERT_GT(data.size(), 3U * checkpoint_interval);
+
+    // one checkpoint for each interval passed
+    const uint8_t expected = MIN((data.size() - header_size) / checkpoint_interval, size_t(num_checkpoints));
+    EXPECT_EQ(checkpoints_used(fd), expected);
+
+    check_gap_fill(fd, data);
+    EXPECT_EQ(fs.close(fd), 0);
+}
+
+TEST_F(AP_Filesystem_Param_Test, GapFillNoCheckpoints)
+{
+    int fd = fs.open("param.pck", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    const std::vector<uint8_t> data = read_file(fd);
+    EXPECT_EQ(fs.close(fd), 0);
+
+    // without checkpoints the same bytes come from walking the
+    // parameters from the start
+    fd = fs.open("param.pck", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    drop_checkpoints(fd);
+    EXPECT_EQ(read_file(fd), data);
+    check_gap_fill(fd, data);
+    EXPECT_EQ(fs.close(fd), 0);
+}
+
+TEST_F(AP_Filesystem_Param_Test, GapFillAfterSeek)
+{
+    int fd = fs.open("param.pck", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    const std::vector<uint8_t> data = read_file(fd);
+    EXPECT_EQ(fs.close(fd), 0);
+
+    // seeking over a gap records checkpoints on the way, and filling
+    // the gap from them gives the same bytes
+    fd = fs.open("param.pck", O_RDONLY);
+    ASSERT_GE(fd, 0);
+    const int32_t gap_end = 2 * checkpoint_interval / READ_SIZE * READ_SIZE;
+    uint8_t buf[READ_SIZE];
+    ASSERT_EQ(fs.read(fd, buf, sizeof(buf)), READ_SIZE);
+    ASSERT_EQ(fs.lseek(fd, gap_end, SEEK_SET), gap_end);
+    while (fs.read(fd, buf, sizeof(buf)) > 0) {
+    }
+    EXPECT_GT(checkpoints_used(fd), 0U);
+    check_gap_fill(fd, data);
+    EXPECT_EQ(fs.close(fd), 0);
+}
+
+AP_GTEST_MAIN()
@@ -79,6 +79,10 @@ public:
     virtual void fft_start(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) = 0;
     // perform remaining steps of an FFT analysis
     virtual uint16_t fft_analyse(FFTWindowState* state, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff) = 0;
+    // window and transform samples without analysing them, leaving bin k of the forward
+    // transform sum(x[n]*exp(-j*2*pi*k*n/N)) in _rfft_data[2k] (real) and _rfft_data[2k+1]
+    // (imaginary) for 0 < k < _bin_count
+    virtual void fft_transform(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) = 0;
 
 protected:
     // step 3: find the magnitudes of the complex data
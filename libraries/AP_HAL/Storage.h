@@ -11,4 +11,6 @@ public:
     virtual void write_block(uint16_t dst, const void* src, size_t n) = 0;
     virtual void _timer_tick(void) {};
     virtual bool healthy(void) { return true; }
+    // true when all writes so far have reached the storage device
+    virtual bool flushed(void) { return true; }
 };
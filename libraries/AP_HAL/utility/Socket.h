@@ -58,6 +58,11 @@ public:
     // start listening for new tcp connections
     bool listen(uint16_t backlog) const;
 
+    // file descriptor for waiting on the socket with poll or epoll
+    int get_fd(void) const { return fd; }
+
+    static void make_sockaddr(const char *address, uint16_t port, struct sockaddr_in &sockaddr);
+
     // accept a new connection. Only valid for TCP connections after
     // listen has been used. A new socket is returned
     SocketAPM *accept(uint32_t timeout_ms);
@@ -67,8 +72,6 @@ private:
     struct sockaddr_in in_addr {};
 
     int fd = -1;
-
-    void make_sockaddr(const char *address, uint16_t port, struct sockaddr_in &sockaddr);
 };
 
 #endif // HAL_OS_SOCKETS
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+/*
+  wait-free handoff of the latest copy of an object from one writer
+  thread to one reader thread.
+
+  The writer fills in the back copy and swaps it with the middle one,
+  the reader swaps the middle copy with its front one when a new one
+  has been published. Neither side ever waits for the other and the
+  reader always sees a complete copy. Copies the reader doesn't pick up
+  before the next publish() are overwritten, not queued.
+ */
+template <class T>
+class ObjectTripleBuffer {
+public:
+    // the copy for the writer to fill in. It is whatever was in the
+    // slot before, so the writer must set every field it publishes
+    T &back() { return buf[back_idx]; }
+
+    // make the back copy the one the reader gets next
+    void publish() {
+        back_idx = state.exchange(back_idx | NEW_FLAG, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // make the last published copy the front one. Returns false if
+    // nothing was published since the last update()
+    bool update() {
+        if ((state.load(std::memory_order_relaxed) & NEW_FLAG) == 0) {
+            return false;
+        }
+        front_idx = state.exchange(front_idx, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    // the copy the reader got from the last successful update()
+    const T &front() const { return buf[front_idx]; }
+
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t NEW_FLAG = 0x4;
+
+    T buf[3];
+    uint8_t back_idx = 0;
+    uint8_t front_idx = 1;
+    // index of the middle copy, with NEW_FLAG set if it is unread
+    std::atomic<uint8_t> state{2};
+};
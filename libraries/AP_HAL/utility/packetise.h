@@ -1,7 +1,8 @@
 #pragma once
 
 /*
-  return the number of bytes to send for a packetised connection
+  return the number of bytes to send for a packetised connection, for
+  the n bytes starting ofs bytes into writebuf
 */
-uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n);
+uint16_t mavlink_packetise(ByteBuffer &writebuf, uint16_t n, uint32_t ofs=0);
 
@@ -0,0 +1,101 @@
+#include <AP_gtest.h>
+
+#include <pthread.h>
+
+#include <AP_HAL/utility/TripleBuffer.h>
+
+struct Outputs {
+    uint32_t seq;
+    uint16_t pulse[18];
+};
+
+// fill every field from the sequence number so a torn copy shows up
+static void fill(Outputs &out, uint32_t seq)
+{
+    out.seq = seq;
+    for (uint16_t &p : out.pulse) {
+        p = uint16_t(seq);
+    }
+}
+
+static bool consistent(const Outputs &out)
+{
+    for (const uint16_t &p : out.pulse) {
+        if (p != uint16_t(out.seq)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST(TripleBufferTest, LatestWins)
+{
+    ObjectTripleBuffer<Outputs> buf;
+
+    EXPECT_FALSE(buf.update());
+
+    fill(buf.back(), 1);
+    buf.publish();
+    EXPECT_TRUE(buf.update());
+    EXPECT_EQ(buf.front().seq, 1U);
+    EXPECT_FALSE(buf.update());
+    EXPECT_EQ(buf.front().seq, 1U);
+
+    // the reader only sees the last of several publishes
+    for (uint32_t seq = 2; seq <= 5; seq++) {
+        fill(buf.back(), seq);
+        buf.publish();
+    }
+    EXPECT_TRUE(buf.update());
+    EXPECT_EQ(buf.front().seq, 5U);
+    EXPECT_TRUE(consistent(buf.front()));
+    EXPECT_FALSE(buf.update());
+}
+
+#define CONCURRENT_PUBLISHES 1000000
+
+static void *writer_thread(void *arg)
+{
+    ObjectTripleBuffer<Outputs> *buf = (ObjectTripleBuffer<Outputs> *)arg;
+    for (uint32_t seq = 1; seq <= CONCURRENT_PUBLISHES; seq++) {
+        fill(buf->back(), seq);
+        buf->publish();
+    }
+    return nullptr;
+}
+
+/*
+  a reader racing the writer always gets a complete copy, never an
+  older one than it already had, and ends up with the last one
+ */
+TEST(TripleBufferTest, ConcurrentHandoff)
+{
+    ObjectTripleBuffer<Outputs> *buf = new ObjectTripleBuffer<Outputs>();
+
+    pthread_t writer;
+    ASSERT_EQ(pthread_create(&writer, nullptr, writer_thread, buf), 0);
+
+    uint32_t updates = 0;
+    uint32_t bad = 0;
+    uint32_t last = 0;
+    while (last < CONCURRENT_PUBLISHES) {
+        if (!buf->update()) {
+            continue;
+        }
+        const Outputs &out = buf->front();
+        if (!consistent(out) || out.seq <= last) {
+            bad++;
+        }
+        last = out.seq;
+        updates++;
+    }
+    pthread_join(writer, nullptr);
+
+    EXPECT_EQ(bad, 0U);
+    EXPECT_GT(updates, 0U);
+    EXPECT_FALSE(buf->update());
+
+    delete buf;
+}
+
+AP_GTEST_MAIN()
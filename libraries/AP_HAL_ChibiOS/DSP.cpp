@@ -76,6 +76,16 @@ uint16_t DSP::fft_analyse(AP_HAL::DSP::FFTWindowState* state, uint16_t start_bin
     return step_calc_frequencies_f32(fft, start_bin, end_bin);
 }
 
+// window and transform samples without analysing them
+void DSP::fft_transform(FFTWindowState* state, FloatBuffer& samples, uint16_t advance)
+{
+    FFTWindowStateARM* fft = (FFTWindowStateARM*)state;
+    step_hanning(fft, samples, advance);
+    step_arm_cfft_f32(fft);
+    step_bitreversal(fft);
+    step_stage_rfft_f32(fft);
+}
+
 // create an instance of the FFT state machine
 DSP::FFTWindowStateARM::FFTWindowStateARM(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics)
     : AP_HAL::DSP::FFTWindowState::FFTWindowState(window_size, sample_rate, harmonics)
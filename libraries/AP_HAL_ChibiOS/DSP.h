@@ -34,6 +34,8 @@ public:
     virtual void fft_start(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) override;
     // perform remaining steps of an FFT analysis
     virtual uint16_t fft_analyse(FFTWindowState* state, uint16_t start_bin, uint16_t end_bin, float noise_att_cutoff) override;
+    // window and transform samples without analysing them
+    virtual void fft_transform(FFTWindowState* state, FloatBuffer& samples, uint16_t advance) override;
 
     // STM32-based FFT state
     class FFTWindowStateARM : public AP_HAL::DSP::FFTWindowState {
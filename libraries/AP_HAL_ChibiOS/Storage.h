@@ -46,6 +46,7 @@ public:
 
     void _timer_tick(void) override;
     bool healthy(void) override;
+    bool flushed(void) override { return _dirty_mask.empty(); }
 
 private:
     enum class StorageBackend: uint8_t {
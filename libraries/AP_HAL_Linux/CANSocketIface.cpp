@@ -34,9 +34,14 @@
 
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/eventfd.h>
 #include <net/if.h>
 #include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <algorithm>
 #include <cstring>
+#include <time.h>
 #include "Scheduler.h"
 #include <AP_CANManager/AP_CANManager.h>
 #include <AP_Common/ExpandingString.h>
@@ -125,8 +130,12 @@ int CANIface::_openSocket(const std::string& iface_name)
     // Configure
     {
         const int on = 1;
-        // Timestamping
-        if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0) {
+        // Timestamping, from the controller when it supports it and from
+        // the kernel otherwise
+        const int timestamping = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                                 SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+        if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping)) < 0 &&
+            setsockopt(s, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on)) < 0) {
             return -1;
         }
         // Socket loopback
@@ -156,7 +165,16 @@ int CANIface::_openSocket(const std::string& iface_name)
 int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline,
                        const CANIface::CanIOFlags flags)
 {
-    CanTxItem tx_item {};
+    const uint64_t now_us = AP_HAL::native_micros64();
+    if (_tx_queue.size() >= HAL_LINUX_CAN_TX_QUEUE_LEN) {
+        _purgeExpiredTx(now_us);
+        if (_tx_queue.size() >= HAL_LINUX_CAN_TX_QUEUE_LEN) {
+            stats.tx_queue_full++;
+            return 0;
+        }
+    }
+
+    TxItem tx_item {};
     tx_item.frame = frame;
     if (flags & Loopback) {
         tx_item.loopback = true;
@@ -167,7 +185,9 @@ int16_t CANIface::send(const AP_HAL::CANFrame& frame, const uint64_t tx_deadline
     tx_item.setup = true;
     tx_item.index = _tx_frame_counter;
     tx_item.deadline = tx_deadline;
-    _tx_queue.emplace(tx_item);
+    tx_item.queued_us = now_us;
+    _tx_queue.push_back(tx_item);
+    std::push_heap(_tx_queue.begin(), _tx_queue.end());
     _tx_frame_counter++;
     stats.tx_requests++;
     _pollRead();     // Read poll is necessary because it can release the pending TX flag
@@ -260,49 +280,95 @@ uint32_t CANIface::getErrorCount() const
     return ec;
 }
 
+void CANIface::_purgeExpiredTx(const uint64_t now_us)
+{
+    const auto expired = std::remove_if(_tx_queue.begin(), _tx_queue.end(),
+                                        [now_us](const TxItem& tx) { return tx.deadline < now_us; });
+    stats.tx_timedout += _tx_queue.end() - expired;
+    _tx_queue.erase(expired, _tx_queue.end());
+    std::make_heap(_tx_queue.begin(), _tx_queue.end());
+}
+
 void CANIface::_pollWrite()
 {
     while (_hasReadyTx()) {
-        const CanTxItem tx = _tx_queue.top();
-        uint64_t curr_time = AP_HAL::native_micros64();
-        if (tx.deadline >= curr_time) {
-            // hal.console->printf("%x TDEAD: %lu CURRT: %lu DEL: %lu\n",tx.frame.id,  tx.deadline, curr_time, tx.deadline-curr_time);
-            const int res = _write(tx.frame);
-            if (res == 1) {                   // Transmitted successfully
+        // take as many frames in priority order as the socket tx queue has room for
+        TxItem batch[CAN_BATCH_MAX];
+        uint8_t count = 0;
+        const uint64_t curr_time = AP_HAL::native_micros64();
+        while (!_tx_queue.empty() && count < CAN_BATCH_MAX &&
+               _frames_in_socket_tx_queue + count < _max_frames_in_socket_tx_queue) {
+            std::pop_heap(_tx_queue.begin(), _tx_queue.end());
+            const TxItem& tx = _tx_queue.back();
+            if (tx.deadline >= curr_time) {
+                batch[count++] = tx;
+            } else {
+                stats.tx_timedout++;
+            }
+            _tx_queue.pop_back();
+        }
+        if (count == 0) {
+            break;
+        }
+
+        const int res = _writeBatch(batch, count);
+        stats.tx_batches++;
+        uint8_t sent = 0;
+        if (res > 0) {                        // Transmitted successfully
+            sent = res;
+            for (uint8_t i = 0; i < sent; i++) {
                 _incrementNumFramesInSocketTxQueue();
-                if (tx.loopback) {
-                    _pending_loopback_ids.insert(tx.frame.id);
+                if (batch[i].loopback) {
+                    _pending_loopback_ids.insert(batch[i].frame.id);
                 }
-                stats.tx_success++;
-            } else if (res == 0) {            // Not transmitted, nor is it an error
-                stats.tx_full++;
-                break;                        // Leaving the loop, the frame remains enqueued for the next retry
-            } else {                          // Transmission error
-                stats.tx_write_fail++;
+                const uint32_t latency_us = curr_time - batch[i].queued_us;
+                period_stats.tx_latency_sum_us += latency_us;
+                period_stats.tx_latency_max_us = std::max(period_stats.tx_latency_max_us, latency_us);
             }
-        } else {
-            // hal.console->printf("TDEAD: %lu CURRT: %lu DEL: %lu\n", tx.deadline, curr_time, curr_time-tx.deadline);
-            stats.tx_timedout++;
+            stats.tx_success += sent;
+            period_stats.tx_frames += sent;
+        } else if (res == 0) {                // Not transmitted, nor is it an error
+            stats.tx_full++;
+        } else {                              // Transmission error, the first frame is dropped
+            stats.tx_write_fail++;
+            sent = 1;
         }
 
-        // Removing the frame from the queue even if transmission failed
-        (void)_tx_queue.pop();
+        // the frames not written remain enqueued for the next retry
+        for (uint8_t i = sent; i < count; i++) {
+            _tx_queue.push_back(batch[i]);
+            std::push_heap(_tx_queue.begin(), _tx_queue.end());
+        }
+        if (res == 0 || sent < count) {
+            break;
+        }
     }
 }
 
 bool CANIface::_pollRead()
 {
+    bool received = false;
     uint8_t iterations_count = 0;
     while (iterations_count < CAN_MAX_POLL_ITERATIONS_COUNT)
     {
-        iterations_count++;
-        CanRxItem rx;
-        rx.timestamp_us = AP_HAL::native_micros64();  // Monotonic timestamp is not required to be precise (unlike UTC)
-        bool loopback = false;
-        const int res = _read(rx.frame, rx.timestamp_us, loopback);
-        if (res == 1) {
+        RxFrame frames[CAN_BATCH_MAX];
+        uint8_t count = 0;
+        const int res = _readBatch(frames, count);
+        if (res < 0) {
+            stats.rx_errors++;
+            break;
+        }
+        if (res == 0) {
+            break;
+        }
+        stats.rx_batches++;
+        iterations_count += res;
+        for (uint8_t i = 0; i < count; i++) {
+            CanRxItem rx;
+            rx.frame = frames[i].frame;
+            rx.timestamp_us = frames[i].timestamp_us;
             bool accept = true;
-            if (loopback) {           // We receive loopback for all CAN frames
+            if (frames[i].loopback) {           // We receive loopback for all CAN frames
                 _confirmSentFrame();
                 rx.flags |= Loopback;
                 accept = _wasInPendingLoopbackSet(rx.frame);
@@ -311,80 +377,161 @@ bool CANIface::_pollRead()
             if (accept) {
                 _rx_queue.push(rx);
                 stats.rx_received++;
-                return true;
+                period_stats.rx_frames++;
+                received = true;
             }
-        } else if (res == 0) {
-            break;
-        } else {
-            stats.rx_errors++;
+        }
+        if (received || res < CAN_BATCH_MAX) {
             break;
         }
     }
-    return false;
+    return received;
 }
 
-int CANIface::_write(const AP_HAL::CANFrame& frame) const
+int CANIface::_writeBatch(const TxItem* items, const uint8_t count)
 {
     if (_fd < 0) {
         return -1;
     }
     errno = 0;
 
-    const can_frame sockcan_frame = makeSocketCanFrame(frame);
+    can_frame sockcan_frames[CAN_BATCH_MAX];
+    iovec iovs[CAN_BATCH_MAX];
+    mmsghdr msgs[CAN_BATCH_MAX] {};
+    for (uint8_t i = 0; i < count; i++) {
+        sockcan_frames[i] = makeSocketCanFrame(items[i].frame);
+        iovs[i].iov_base = &sockcan_frames[i];
+        iovs[i].iov_len = sizeof(sockcan_frames[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
 
-    const int res = write(_fd, &sockcan_frame, sizeof(sockcan_frame));
+    const int res = sendmmsg(_fd, msgs, count, MSG_DONTWAIT);
     if (res <= 0) {
         if (errno == ENOBUFS || errno == EAGAIN) {  // Writing is not possible atm, not an error
             return 0;
         }
-        return res;
+        return res < 0 ? res : -1;
     }
-    if (res != sizeof(sockcan_frame)) {
-        return -1;
-    }
-    return 1;
+    return res;
 }
 
-
-int CANIface::_read(AP_HAL::CANFrame& frame, uint64_t& timestamp_us, bool& loopback) const
+int CANIface::_readBatch(RxFrame* frames, uint8_t& count)
 {
     if (_fd < 0) {
         return -1;
     }
-    auto iov = iovec();
-    auto sockcan_frame = can_frame();
-    iov.iov_base = &sockcan_frame;
-    iov.iov_len  = sizeof(sockcan_frame);
+    can_frame sockcan_frames[CAN_BATCH_MAX];
+    iovec iovs[CAN_BATCH_MAX];
     union {
-        uint8_t data[CMSG_SPACE(sizeof(::timeval))];
+        uint8_t data[CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(::timeval))];
         struct cmsghdr align;
-    } control;
-
-    auto msg = msghdr();
-    msg.msg_iov    = &iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = control.data;
-    msg.msg_controllen = sizeof(control.data);
-
-    const int res = recvmsg(_fd, &msg, MSG_DONTWAIT);
+    } control[CAN_BATCH_MAX];
+    mmsghdr msgs[CAN_BATCH_MAX] {};
+    for (uint8_t i = 0; i < CAN_BATCH_MAX; i++) {
+        iovs[i].iov_base = &sockcan_frames[i];
+        iovs[i].iov_len = sizeof(sockcan_frames[i]);
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_control = control[i].data;
+        msgs[i].msg_hdr.msg_controllen = sizeof(control[i].data);
+    }
+
+    const int res = recvmmsg(_fd, msgs, CAN_BATCH_MAX, MSG_DONTWAIT, nullptr);
     if (res <= 0) {
         return (res < 0 && errno == EWOULDBLOCK) ? 0 : res;
     }
-    /*
-     * Flags
-     */
-    loopback = (msg.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
 
-    if (!loopback && !_checkHWFilters(sockcan_frame)) {
-        return 0;
+    const uint64_t now_us = AP_HAL::native_micros64();
+    timespec realtime_now;
+    clock_gettime(CLOCK_REALTIME, &realtime_now);
+    const int64_t realtime_now_ns = realtime_now.tv_sec * 1000000000LL + realtime_now.tv_nsec;
+
+    count = 0;
+    for (uint8_t i = 0; i < res; i++) {
+        /*
+         * Flags
+         */
+        const bool loopback = (msgs[i].msg_hdr.msg_flags & static_cast<int>(MSG_CONFIRM)) != 0;
+        if (!loopback && !_checkHWFilters(sockcan_frames[i])) {
+            continue;
+        }
+        frames[count].frame = makeUavcanFrame(sockcan_frames[i]);
+        frames[count].loopback = loopback;
+        /*
+         * Timestamp
+         */
+        frames[count].timestamp_us = _rxTimestamp(msgs[i].msg_hdr, now_us, realtime_now_ns);
+        count++;
+    }
+    return res;
+}
+
+/*
+  Software timestamps are taken by the kernel in CLOCK_REALTIME, so they
+  are converted by their age. Hardware timestamps are in the
+  controller's clock. They are mapped to the kernel's clock using the
+  smallest difference seen between the two timestamps of a frame, as
+  that frame was delayed least on its way to the kernel. The offset is
+  allowed to grow by 100ppm to follow drift between the clocks
+ */
+uint64_t CANIface::_rxTimestamp(const msghdr& msg, const uint64_t now_us, const int64_t realtime_now_ns)
+{
+    bool sw_valid = false;
+    bool hw_valid = false;
+    int64_t sw_ns = 0;
+    int64_t hw_ns = 0;
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&msg), cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+            scm_timestamping ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            if (ts.ts[0].tv_sec != 0 || ts.ts[0].tv_nsec != 0) {
+                sw_ns = ts.ts[0].tv_sec * 1000000000LL + ts.ts[0].tv_nsec;
+                sw_valid = true;
+            }
+            if (ts.ts[2].tv_sec != 0 || ts.ts[2].tv_nsec != 0) {
+                hw_ns = ts.ts[2].tv_sec * 1000000000LL + ts.ts[2].tv_nsec;
+                hw_valid = true;
+            }
+        } else if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+            ::timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            sw_ns = tv.tv_sec * 1000000000LL + tv.tv_usec * 1000LL;
+            sw_valid = true;
+        }
+    }
+    if (!sw_valid) {
+        return now_us;
     }
 
-    frame = makeUavcanFrame(sockcan_frame);
-    /*
-     * Timestamp
-     */
-    timestamp_us = AP_HAL::native_micros64();
-    return 1;
+    if (hw_valid) {
+        const int64_t offset_ns = sw_ns - hw_ns;
+        if (_hw_ts_valid) {
+            _hw_ts_offset_ns += (hw_ns - _hw_ts_last_ns) / 10000;
+        }
+        // start again if the clocks have jumped
+        if (!_hw_ts_valid || offset_ns < _hw_ts_offset_ns || offset_ns - _hw_ts_offset_ns > 100000000LL) {
+            _hw_ts_offset_ns = offset_ns;
+        }
+        _hw_ts_last_ns = hw_ns;
+        _hw_ts_valid = true;
+        sw_ns = hw_ns + _hw_ts_offset_ns;
+        stats.rx_hw_timestamps++;
+    }
+
+    // a frame from the future or older than a second means the realtime clock has been stepped
+    const int64_t age_ns = realtime_now_ns - sw_ns;
+    if (age_ns < 0 || age_ns > 1000000000LL) {
+        return now_us;
+    }
+    const uint32_t age_us = age_ns / 1000;
+    period_stats.rx_latency_count++;
+    period_stats.rx_latency_sum_us += age_us;
+    period_stats.rx_latency_max_us = std::max(period_stats.rx_latency_max_us, age_us);
+    return now_us - age_us;
 }
 
 // Might block forever, only to be used for testing
@@ -451,6 +598,13 @@ void CANIface::_updateDownStatusFromPollResult(const pollfd& pfd)
     }
 }
 
+void CANIface::_init_socket(int fd)
+{
+    _fd = fd;
+    _initialized = true;
+    period_stats.start_us = AP_HAL::native_micros64();
+}
+
 bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
 {
     char iface_name[16];
@@ -466,7 +620,7 @@ bool CANIface::init(const uint32_t bitrate, const OperatingMode mode)
     Debug("Socket opened iface_name: %s fd: %d", iface_name, _fd);
     if (_fd > 0) {
         _bitrate = bitrate;
-        _initialized = true;
+        _init_socket(_fd);
     } else {
         _initialized = false;
     }
@@ -518,18 +672,31 @@ bool CANIface::select(bool &read_select, bool &write_select,
 
 bool CANIface::set_event_handle(AP_HAL::EventHandle* handle) {
     _evt_handle = handle;
-    evt_can_socket[_self_index]._ifaces[_self_index] = this;
-    _evt_handle->set_source(&evt_can_socket[_self_index]);
+    CANSocketEventSource &evt_src = evt_can_socket[_self_index];
+    evt_src._ifaces[_self_index] = this;
+    if (evt_src._wake_fd < 0) {
+        evt_src._wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    _evt_handle->set_source(&evt_src);
     return true;
 }
 
+void CANIface::CANSocketEventSource::signal(uint32_t evt_mask)
+{
+    if (_wake_fd < 0) {
+        return;
+    }
+    const uint64_t one = 1;
+    UNUSED_RESULT(::write(_wake_fd, &one, sizeof(one)));
+}
+
 
 bool CANIface::CANSocketEventSource::wait(uint64_t duration, AP_HAL::EventHandle* evt_handle)
 {
     if (evt_handle == nullptr) {
         return false;
     }
-    pollfd pollfds[HAL_NUM_CAN_IFACES] {};
+    pollfd pollfds[HAL_NUM_CAN_IFACES + 1] {};
     uint8_t pollfd_iface_map[HAL_NUM_CAN_IFACES] {};
     unsigned long int num_pollfds = 0;
     
@@ -551,18 +718,31 @@ bool CANIface::CANSocketEventSource::wait(uint64_t duration, AP_HAL::EventHandle
         return true;
     }
 
+    // the wake fd goes after the sockets so they keep their indexes
+    unsigned long int num_wait_fds = num_pollfds;
+    if (_wake_fd >= 0) {
+        pollfds[num_wait_fds].fd = _wake_fd;
+        pollfds[num_wait_fds].events = POLLIN;
+        num_wait_fds++;
+    }
+
     // Timeout conversion
     auto ts = timespec();
     ts.tv_sec = duration / 1000000LL;
     ts.tv_nsec = (duration % 1000000LL) * 1000;
 
     // Blocking here
-    const int res = ppoll(pollfds, num_pollfds, &ts, nullptr);
+    const int res = ppoll(pollfds, num_wait_fds, &ts, nullptr);
 
     if (res < 0) {
         return false;
     }
 
+    if (num_wait_fds > num_pollfds && (pollfds[num_pollfds].revents & POLLIN)) {
+        uint64_t count;
+        UNUSED_RESULT(::read(_wake_fd, &count, sizeof(count)));
+    }
+
     // Handling poll output
     for (unsigned i = 0; i < num_pollfds; i++) {
         if (_ifaces[pollfd_iface_map[i]] == nullptr) {
@@ -592,7 +772,11 @@ void CANIface::get_stats(ExpandingString &str)
                "num_tx_poll_req:  %u\n"
                "num_poll_waits:   %u\n"
                "num_poll_tx_events: %u\n"
-               "num_poll_rx_events: %u\n",
+               "num_poll_rx_events: %u\n"
+               "tx_queue_full:  %u\n"
+               "tx_batches:     %u\n"
+               "rx_batches:     %u\n"
+               "rx_hw_timestamps: %u\n",
                stats.tx_requests,
                stats.tx_write_fail,
                stats.tx_full,
@@ -606,7 +790,29 @@ void CANIface::get_stats(ExpandingString &str)
                stats.num_tx_poll_req,
                stats.num_poll_waits,
                stats.num_poll_tx_events,
-               stats.num_poll_rx_events);
+               stats.num_poll_rx_events,
+               stats.tx_queue_full,
+               stats.tx_batches,
+               stats.rx_batches,
+               stats.rx_hw_timestamps);
+
+    // throughput and latency since the last fetch
+    const uint64_t now_us = AP_HAL::native_micros64();
+    const float dt = (now_us - period_stats.start_us) * 1.0e-6f;
+    if (dt > 0) {
+        str.printf("tx_rate:        %.0f frames/s\n"
+                   "rx_rate:        %.0f frames/s\n"
+                   "tx_queue_latency: %u us avg, %u us max\n"
+                   "rx_latency:     %u us avg, %u us max\n",
+                   period_stats.tx_frames / dt,
+                   period_stats.rx_frames / dt,
+                   unsigned(period_stats.tx_frames ? period_stats.tx_latency_sum_us / period_stats.tx_frames : 0),
+                   unsigned(period_stats.tx_latency_max_us),
+                   unsigned(period_stats.rx_latency_count ? period_stats.rx_latency_sum_us / period_stats.rx_latency_count : 0),
+                   unsigned(period_stats.rx_latency_max_us));
+    }
+    period_stats = {};
+    period_stats.start_us = now_us;
 }
 
 #endif
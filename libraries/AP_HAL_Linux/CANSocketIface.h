@@ -39,7 +39,9 @@
 #include <memory>
 #include <map>
 #include <unordered_set>
+#include <vector>
 #include <poll.h>
+#include <sys/socket.h>
 
 namespace Linux {
 
@@ -53,13 +55,29 @@ enum class SocketCanError
 #define CAN_MAX_POLL_ITERATIONS_COUNT 100
 #define CAN_MAX_INIT_TRIES_COUNT 100
 #define CAN_FILTER_NUMBER 8
+// frames read or written with one system call
+#define CAN_BATCH_MAX 16
+
+// frames written to the socket and not yet seen back through loopback. A
+// deeper queue keeps a busy bus fed, at the cost of new high priority
+// frames waiting behind the ones already in the kernel
+#ifndef HAL_LINUX_CAN_TX_INFLIGHT_MAX
+#define HAL_LINUX_CAN_TX_INFLIGHT_MAX 8
+#endif
+
+// frames waiting to be written to the socket. When full, frames past
+// their deadline are dropped to make room, and if there are none send()
+// reports the queue as full
+#ifndef HAL_LINUX_CAN_TX_QUEUE_LEN
+#define HAL_LINUX_CAN_TX_QUEUE_LEN 256
+#endif
 
 class CANIface: public AP_HAL::CANIface {
 public:
-    CANIface(int index)
+    CANIface(int index, uint8_t max_tx_inflight = HAL_LINUX_CAN_TX_INFLIGHT_MAX)
       : _self_index(index)
+      , _max_frames_in_socket_tx_queue(max_tx_inflight)
       , _frames_in_socket_tx_queue(0)
-      , _max_frames_in_socket_tx_queue(2)
     { }
 
     ~CANIface() { }
@@ -118,25 +136,58 @@ public:
     class CANSocketEventSource : public AP_HAL::EventSource {
         friend class CANIface;
         CANIface *_ifaces[HAL_NUM_CAN_IFACES];
+        // eventfd polled with the sockets so a thread can be woken
+        int _wake_fd = -1;
         
     public:
-        // we just poll fd, no signaling is done
-        void signal(uint32_t evt_mask) override { return; }
+        // wake a thread waiting on the sockets, the mask is ignored
+        void signal(uint32_t evt_mask) override;
         bool wait(uint64_t duration, AP_HAL::EventHandle* evt_handle) override;
     };
 
+protected:
+    // use an already open socket, for tests with a stand-in for the CAN bus
+    void _init_socket(int fd);
+
+    // a frame written to the socket has been seen back through loopback
+    void _confirmSentFrame();
+
+    // read and write the socket as the event source does when it is ready
+    void _poll(bool read, bool write);
+
 private:
+    // a queued frame and the time send() was called for it
+    struct TxItem : CanTxItem {
+        uint64_t queued_us;
+    };
+
+    // a received frame, as returned by _readBatch()
+    struct RxFrame {
+        AP_HAL::CANFrame frame;
+        uint64_t timestamp_us;
+        bool loopback;
+    };
+
     void _pollWrite();
 
     bool _pollRead();
 
-    int _write(const AP_HAL::CANFrame& frame) const;
+    // write frames to the socket with one system call, returns the number
+    // written, which may be fewer than count, or negative on error
+    int _writeBatch(const TxItem* items, uint8_t count);
 
-    int _read(AP_HAL::CANFrame& frame, uint64_t& ts_usec, bool& loopback) const;
+    // read up to CAN_BATCH_MAX frames with one system call, returns the
+    // number read, 0 when none are waiting, or negative on error. count is
+    // set to the number passing the filters and put in frames
+    int _readBatch(RxFrame* frames, uint8_t& count);
 
-    void _incrementNumFramesInSocketTxQueue();
+    // convert the kernel receive time of a frame to the native_micros64() timebase
+    uint64_t _rxTimestamp(const msghdr& msg, uint64_t now_us, int64_t realtime_now_ns);
 
-    void _confirmSentFrame();
+    // drop frames past their deadline from the tx queue
+    void _purgeExpiredTx(uint64_t now_us);
+
+    void _incrementNumFramesInSocketTxQueue();
 
     bool _wasInPendingLoopbackSet(const AP_HAL::CANFrame& frame);
 
@@ -146,8 +197,6 @@ private:
 
     bool _hasReadyRx() const;
 
-    void _poll(bool read, bool write);
-
     int _openSocket(const std::string& iface_name);
 
     void _updateDownStatusFromPollResult(const pollfd& pfd);
@@ -167,9 +216,15 @@ private:
     AP_HAL::EventHandle *_evt_handle;
     static CANSocketEventSource evt_can_socket[HAL_NUM_CAN_IFACES];
 
+    // hardware timestamps are mapped to the kernel's clock by this offset
+    bool _hw_ts_valid;
+    int64_t _hw_ts_offset_ns;
+    int64_t _hw_ts_last_ns;
+
     pollfd _pollfd;
     std::map<SocketCanError, uint64_t> _errors;
-    std::priority_queue<CanTxItem> _tx_queue;
+    // heap of frames waiting to be written, highest priority first
+    std::vector<TxItem> _tx_queue;
     std::queue<CanRxItem> _rx_queue;
     std::unordered_multiset<uint32_t> _pending_loopback_ids;
     std::vector<can_filter> _hw_filters_container;
@@ -189,7 +244,23 @@ private:
         uint32_t num_poll_waits;
         uint32_t num_poll_tx_events;
         uint32_t num_poll_rx_events;
+        uint32_t tx_queue_full;
+        uint32_t tx_batches;
+        uint32_t rx_batches;
+        uint32_t rx_hw_timestamps;
     } stats;
+
+    // throughput and latency since the stats were last fetched
+    struct {
+        uint64_t start_us;
+        uint32_t tx_frames;
+        uint32_t rx_frames;
+        uint64_t tx_latency_sum_us;
+        uint32_t tx_latency_max_us;
+        uint32_t rx_latency_count;
+        uint64_t rx_latency_sum_us;
+        uint32_t rx_latency_max_us;
+    } period_stats;
 };
 
 }
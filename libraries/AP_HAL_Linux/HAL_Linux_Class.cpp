@@ -4,6 +4,7 @@
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
@@ -274,6 +275,8 @@ void _usage(void)
     printf("\tnetworking UDP:\n");
     printf("\t                  -A udp:11.0.0.255:14550:bcast\n");
     printf("\t                  -A udpin:0.0.0.0:14550\n");
+    printf("\tnetworking UDP, to every recent client, several MAVLink packets per datagram:\n");
+    printf("\t                  -A udpin:0.0.0.0:14550:fanout,coalesce\n");
     printf("\tcustom log path:\n");
     printf("\t                  --log-directory /var/APM/logs\n");
     printf("\t                  -l /var/APM/logs\n");
@@ -283,6 +286,12 @@ void _usage(void)
     printf("\tcustom storage path:\n");
     printf("\t                   --storage-directory /var/APM/storage\n");
     printf("\t                   -s /var/APM/storage\n");
+    printf("\tCPU affinity of all threads:\n");
+    printf("\t                   --cpu-affinity 0-2\n");
+    printf("\t                   -c 0-2\n");
+    printf("\tCPU affinity of one thread, e.g. the main loop on a core isolated with isolcpus=3:\n");
+    printf("\t                   --thread-affinity main=3\n");
+    printf("\t                   -T main=3\n");
 #if AP_MODULE_SUPPORTED
     printf("\tmodule support:\n");
     printf("\t                   --module-directory %s\n", AP_MODULE_DEFAULT_DIRECTORY);
@@ -312,11 +321,13 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         {"storage-directory",   true,  0, 's'},
         {"module-directory",    true,  0, 'M'},
         {"defaults",            true,  0, 'd'},
+        {"cpu-affinity",        true,  0, 'c'},
+        {"thread-affinity",     true,  0, 'T'},
         {"help",                false,  0, 'h'},
         {0, false, 0, 0}
     };
 
-    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:",
+    GetOptLong gopt(argc, argv, "A:B:C:D:E:F:G:H:l:t:s:he:SM:c:T:",
                     options);
 
     /*
@@ -368,6 +379,21 @@ void HAL_Linux::run(int argc, char* const argv[], Callbacks* callbacks) const
         case 'd':
             utilInstance.set_custom_defaults_path(gopt.optarg);
             break;
+        case 'c':
+            if (!Scheduler::from(scheduler)->set_cpu_affinity(nullptr, 0, gopt.optarg)) {
+                printf("Bad CPU affinity '%s'\n", gopt.optarg);
+                exit(1);
+            }
+            break;
+        case 'T': {
+            const char *cpus = strchr(gopt.optarg, '=');
+            if (cpus == nullptr ||
+                !Scheduler::from(scheduler)->set_cpu_affinity(gopt.optarg, cpus - gopt.optarg, cpus + 1)) {
+                printf("Bad thread affinity '%s', expected name=cpus\n", gopt.optarg);
+                exit(1);
+            }
+            break;
+        }
         case 'h':
             _usage();
             exit(0);
@@ -98,6 +98,11 @@ public:
      */
     bool register_pollable(Pollable *p, uint32_t events);
 
+    /*
+     * Change the events @p registered with register_pollable() waits for.
+     */
+    bool modify_pollable(Pollable *p, uint32_t events);
+
     /*
      * Unregister @p from this Poller so it doesn't generate any more
      * event. Note that this doesn't destroy @p.
@@ -107,9 +112,10 @@ public:
     /*
      * Wait for events on all Pollable objects registered with
      * register_pollable(). New Pollable objects can be registered at any
-     * time, including when a thread is sleeping on a poll() call.
+     * time, including when a thread is sleeping on a poll() call. Gives
+     * up after @timeout_ms if it is not negative.
      */
-    int poll() const;
+    int poll(int timeout_ms = -1) const;
 
     /*
      * Wake up the thread sleeping on a poll() call if it is in fact
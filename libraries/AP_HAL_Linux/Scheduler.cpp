@@ -5,10 +5,12 @@
 #include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/time.h>
 #include <unistd.h>
 
+#include <AP_Common/ExpandingString.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
@@ -101,6 +103,13 @@ void Scheduler::init()
 
     init_realtime();
 
+    cpu_set_t cpu_set;
+    if (_get_cpu_affinity("main", cpu_set) &&
+        (ret = pthread_setaffinity_np(_main_ctx, sizeof(cpu_set), &cpu_set)) != 0) {
+        AP_HAL::panic("Scheduler: failed to set main thread CPU affinity: %s",
+                      strerror(ret));
+    }
+
     /* set barrier to N + 1 threads: worker threads + main */
     unsigned n_threads = ARRAY_SIZE(sched_table) + 1;
     ret = pthread_barrier_init(&_initialized_barrier, nullptr, n_threads);
@@ -109,11 +118,17 @@ void Scheduler::init()
                       strerror(ret));
     }
 
+    // the UART thread waits for serial devices between its ticks
+    _uart_thread.set_poller(&_uart_poller);
+
     for (size_t i = 0; i < ARRAY_SIZE(sched_table); i++) {
         const struct sched_table *t = &sched_table[i];
 
         t->thread->set_rate(t->rate);
         t->thread->set_stack_size(1024 * 1024);
+        if (_get_cpu_affinity(t->name, cpu_set)) {
+            t->thread->set_cpu_affinity(cpu_set);
+        }
         t->thread->start(t->name, t->policy, t->prio);
     }
 
@@ -170,7 +185,16 @@ void Scheduler::delay_microseconds(uint16_t us)
     if (_stopped_clock_usec) {
         return;
     }
+    if (!in_main_thread()) {
+        microsleep(us);
+        return;
+    }
+    // the main loop waits here for the next IMU sample, so how late it
+    // wakes is the main loop's wakeup latency
+    const uint64_t wake_usec = AP_HAL::micros64() + us;
     microsleep(us);
+    const uint64_t now = AP_HAL::micros64();
+    _main_wakeup_stats.record(now > wake_usec ? now - wake_usec : 0);
 }
 
 void Scheduler::register_timer_process(AP_HAL::MemberProc proc)
@@ -250,7 +274,8 @@ void Scheduler::_run_io(void)
 }
 
 /*
-  run timers for all UARTs
+  run timers for all UARTs. Ports with a device registered with the
+  UART poller only do their reads and writes when it is ready
  */
 void Scheduler::_run_uarts()
 {
@@ -399,6 +424,11 @@ bool Scheduler::thread_create(AP_HAL::MemberProc proc, const char *name, uint32_
      */
     thread->set_auto_free(true);
 
+    cpu_set_t cpu_set;
+    if (_get_cpu_affinity(name, cpu_set)) {
+        thread->set_cpu_affinity(cpu_set);
+    }
+
     if (!thread->start(name, SCHED_FIFO, thread_priority)) {
         delete thread;
         return false;
@@ -406,3 +436,71 @@ bool Scheduler::thread_create(AP_HAL::MemberProc proc, const char *name, uint32_
 
     return true;
 }
+
+bool Scheduler::set_cpu_affinity(const char *name, size_t name_len, const char *cpus)
+{
+    if (_num_cpu_affinity >= ARRAY_SIZE(_cpu_affinity)) {
+        return false;
+    }
+
+    struct cpu_affinity &a = _cpu_affinity[_num_cpu_affinity];
+    if (name != nullptr && (name_len == 0 || name_len >= sizeof(a.name))) {
+        return false;
+    }
+    if (!Thread::parse_cpu_set(cpus, a.cpu_set)) {
+        return false;
+    }
+    memset(a.name, 0, sizeof(a.name));
+    if (name != nullptr) {
+        memcpy(a.name, name, name_len);
+    }
+    _num_cpu_affinity++;
+
+    return true;
+}
+
+/*
+  a thread's own setting takes precedence over the default, and later
+  settings over earlier ones
+ */
+bool Scheduler::_get_cpu_affinity(const char *name, cpu_set_t &cpu_set) const
+{
+    const struct cpu_affinity *found = nullptr;
+    for (uint8_t i = 0; i < _num_cpu_affinity; i++) {
+        const struct cpu_affinity &a = _cpu_affinity[i];
+        if (a.name[0] == '\0') {
+            if (found == nullptr || found->name[0] == '\0') {
+                found = &a;
+            }
+        } else if (name != nullptr && strcmp(a.name, name) == 0) {
+            found = &a;
+        }
+    }
+    if (found == nullptr) {
+        return false;
+    }
+    cpu_set = found->cpu_set;
+    return true;
+}
+
+void Scheduler::thread_info(ExpandingString &str)
+{
+    str.printf("ThreadsLinux\n");
+
+    struct sched_param param;
+    int policy;
+    if (pthread_getschedparam(_main_ctx, &policy, &param) != 0) {
+        param.sched_priority = 0;
+    }
+    str.printf("%-15s PRI=%2d CPUS=", "main", param.sched_priority);
+    cpu_set_t cpu_set;
+    if (pthread_getaffinity_np(_main_ctx, sizeof(cpu_set), &cpu_set) == 0) {
+        Thread::print_cpu_set(str, cpu_set);
+    } else {
+        str.printf("?");
+    }
+    _main_wakeup_stats.print(str);
+    str.printf("\n");
+
+    Thread::threads_info(str);
+}
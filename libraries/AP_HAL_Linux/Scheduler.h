@@ -4,12 +4,14 @@
 
 #include "AP_HAL_Linux.h"
 
+#include "Poller.h"
 #include "Semaphores.h"
 #include "Thread.h"
 
 #define LINUX_SCHEDULER_MAX_TIMER_PROCS 10
 #define LINUX_SCHEDULER_MAX_TIMESLICED_PROCS 10
 #define LINUX_SCHEDULER_MAX_IO_PROCS 10
+#define LINUX_SCHEDULER_MAX_AFFINITIES 8
 
 #define AP_LINUX_SENSORS_STACK_SIZE  256 * 1024
 #define AP_LINUX_SENSORS_SCHED_POLICY  SCHED_FIFO
@@ -53,7 +55,27 @@ public:
       create a new thread
      */
     bool thread_create(AP_HAL::MemberProc, const char *name, uint32_t stack_size, priority_base base, int8_t priority) override;
-    
+
+    /*
+      set the CPUs a thread may run on, from a list such as "0,2-3".
+      @name is the thread name, "main" for the main loop, or nullptr
+      for the default of all threads without their own setting.
+      @name_len limits the characters of @name used. Must be called
+      before init()
+     */
+    bool set_cpu_affinity(const char *name, size_t name_len, const char *cpus);
+
+    /*
+      print the state of the threads for @SYS/threads.txt
+     */
+    void thread_info(ExpandingString &str);
+
+    /*
+      serial devices with a file descriptor register it here to be
+      serviced by the UART thread as soon as they are ready
+     */
+    Poller &get_uart_poller() { return _uart_poller; }
+
 private:
     class SchedulerThread : public PeriodicThread {
     public:
@@ -70,6 +92,15 @@ private:
 
     void     init_realtime();
 
+    // CPU affinity for the named thread, false if it has none
+    bool _get_cpu_affinity(const char *name, cpu_set_t &cpu_set) const;
+
+    struct cpu_affinity {
+        char name[16];          // thread name, empty for the default
+        cpu_set_t cpu_set;
+    } _cpu_affinity[LINUX_SCHEDULER_MAX_AFFINITIES];
+    uint8_t _num_cpu_affinity;
+
     void _wait_all_threads();
 
     void     _debug_stack();
@@ -95,6 +126,8 @@ private:
     SchedulerThread _rcin_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_rcin_task, void), *this};
     SchedulerThread _uart_thread{FUNCTOR_BIND_MEMBER(&Scheduler::_uart_task, void), *this};
 
+    Poller _uart_poller;
+
     void _timer_task();
     void _io_task();
     void _rcin_task();
@@ -107,6 +140,9 @@ private:
     uint64_t _last_stack_debug_msec;
     pthread_t _main_ctx;
 
+    // how late the main loop wakes from its waits for the next sample
+    WakeupStats _main_wakeup_stats;
+
     Semaphore _io_semaphore;
 };
 
@@ -23,4 +23,29 @@ public:
 
     /* Depends on lower level to implement, most devices are fine with defaults */
     virtual void set_parity(int v) { }
+
+    /*
+     * File descriptor that becomes readable when there is data to read
+     * and writable when there is room to write, or -1 if the device has
+     * to be polled
+     */
+    virtual int get_fd() const { return -1; }
+
+    /*
+     * Send @count datagrams of @lens[i] bytes each, packed one after the
+     * other in @buf. Returns the number sent or -1 if none could be.
+     * Devices that can send several with one system call override this
+     */
+    virtual int write_datagrams(const uint8_t *buf, const uint16_t *lens, uint8_t count)
+    {
+        int sent = 0;
+        for (uint8_t i = 0; i < count; i++) {
+            if (write(buf, lens[i]) != lens[i]) {
+                break;
+            }
+            buf += lens[i];
+            sent++;
+        }
+        return sent > 0 ? sent : -1;
+    }
 };
@@ -4,23 +4,29 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/crc.h>
 #include <AP_Vehicle/AP_Vehicle_Type.h>
 
 using namespace Linux;
 
 /*
-  This stores 'eeprom' data on the SD card, with a 4k size, and a
+  This stores 'eeprom' data on the SD card, with a 16k size, and a
   in-memory buffer. This keeps the latency down.
  */
 
 // name the storage file after the sketch so you can use the same board
 // card for ArduCopter and ArduPlane
 #define STORAGE_FILE SKETCHNAME ".stg"
+#define STORAGE_JOURNAL_FILE SKETCHNAME ".stj"
+#define STORAGE_JOURNAL_TMP_FILE SKETCHNAME ".stj.tmp"
+
+#define STORAGE_JOURNAL_MAGIC 0x4A545353 // "SSTJ"
 
 extern const AP_HAL::HAL& hal;
 
@@ -91,46 +97,29 @@ static int mkdir_p(const char *path, int len, mode_t mode)
     return 0;
 }
 
-int Storage::_storage_create(const char *dpath)
+int Storage::_storage_open()
 {
-    int dfd = -1;
-
-    mkdir_p(dpath, strlen(dpath), 0777);
-    dfd = open(dpath, O_RDONLY|O_CLOEXEC);
-    if (dfd == -1) {
-        fprintf(stderr, "Failed to open storage directory: %s (%m)\n", dpath);
-        return -1;
-    }
-
-    unlinkat(dfd, dpath, 0);
-    int fd = openat(dfd, STORAGE_FILE, O_RDWR|O_CREAT|O_CLOEXEC, 0666);
-
-    close(dfd);
-
+    int fd = openat(_dir_fd, STORAGE_FILE, O_RDWR|O_CREAT|O_CLOEXEC, 0666);
     if (fd == -1) {
-        fprintf(stderr, "Failed to create storage file %s/%s\n", dpath,
-                STORAGE_FILE);
-        goto fail;
+        return -1;
     }
 
-    // take up all needed space
-    if (ftruncate(fd, sizeof(_buffer)) == -1) {
+    // take up all needed space, a new or short file reads as zeros
+    struct stat st;
+    if (fstat(fd, &st) == -1 ||
+        (st.st_size != sizeof(_buffer) && ftruncate(fd, sizeof(_buffer)) == -1)) {
         fprintf(stderr, "Failed to set file size to %u kB (%m)\n",
                 unsigned(sizeof(_buffer) / 1024));
-        goto fail;
+        close(fd);
+        return -1;
     }
 
-    // ensure the directory is updated with the new size
-    fsync(fd);
-    fsync(dfd);
-
-    close(dfd);
+    if (pread(fd, _buffer, sizeof(_buffer), 0) != sizeof(_buffer)) {
+        close(fd);
+        return -1;
+    }
 
     return fd;
-
-fail:
-    close(dfd);
-    return -1;
 }
 
 void Storage::init()
@@ -141,45 +130,234 @@ void Storage::init()
         return;
     }
 
-    _dirty_mask = 0;
-
     dpath = hal.util->get_custom_storage_directory();
     if (!dpath) {
         dpath = HAL_BOARD_STORAGE_DIRECTORY;
     }
 
-    int fd = open(dpath, O_RDWR|O_CLOEXEC);
-    if (fd == -1) {
-        fd = _storage_create(dpath);
-        if (fd == -1) {
-            AP_HAL::panic("Cannot create storage %s (%m)", dpath);
-        }
+    _init(dpath);
+}
+
+void Storage::_init(const char *dpath)
+{
+    _dirty_mask = 0;
+
+    mkdir_p(dpath, strlen(dpath), 0777);
+    _dir_fd = open(dpath, O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+    if (_dir_fd == -1) {
+        AP_HAL::panic("Cannot open storage directory %s (%m)", dpath);
     }
 
-    ssize_t ret = read(fd, _buffer, sizeof(_buffer));
+    _fd = _storage_open();
+    if (_fd == -1) {
+        AP_HAL::panic("Cannot create storage %s/%s (%m)", dpath, STORAGE_FILE);
+    }
 
-    if (ret != sizeof(_buffer)) {
-        close(fd);
-        _storage_create(dpath);
-        fd = open(dpath, O_RDONLY|O_CLOEXEC);
-        if (fd == -1) {
-            AP_HAL::panic("Failed to open %s (%m)", dpath);
+    _journal_open();
+    if (_journal_fd == -1) {
+        AP_HAL::panic("Cannot create storage journal %s/%s (%m)", dpath, STORAGE_JOURNAL_FILE);
+    }
+
+    _initialised = true;
+}
+
+/*
+  open the journal and apply its complete records to the buffer
+ */
+void Storage::_journal_open()
+{
+    _journal_fd = openat(_dir_fd, STORAGE_JOURNAL_FILE, O_RDWR|O_CREAT|O_CLOEXEC, 0666);
+    if (_journal_fd == -1) {
+        return;
+    }
+    _journal_replay();
+
+    // a new journal is only found after a crash if its directory
+    // entry is on disk
+    fsync(_dir_fd);
+}
+
+void Storage::_journal_replay()
+{
+    _journal_size = 0;
+    _journal_seq = 0;
+
+    struct journal_header hdr;
+    while (pread(_journal_fd, &hdr, sizeof(hdr), _journal_size) == sizeof(hdr)) {
+        const uint32_t len = __builtin_popcount(hdr.line_mask) * LINUX_STORAGE_LINE_SIZE;
+        if (hdr.magic != STORAGE_JOURNAL_MAGIC || hdr.line_mask == 0 ||
+            (LINUX_STORAGE_NUM_LINES < 32 && (hdr.line_mask >> LINUX_STORAGE_NUM_LINES) != 0) ||
+            (_journal_size != 0 && hdr.seq != _journal_seq + 1)) {
+            break;
         }
-        if (read(fd, _buffer, sizeof(_buffer)) != sizeof(_buffer)) {
-            AP_HAL::panic("Failed to read %s (%m)", dpath);
+
+        uint8_t *lines = &_record[sizeof(hdr)];
+        if (pread(_journal_fd, lines, len, _journal_size + sizeof(hdr)) != ssize_t(len)) {
+            break;
         }
+        const uint32_t crc = hdr.crc;
+        hdr.crc = 0;
+        if (crc_crc32(crc_crc32(0, (const uint8_t *)&hdr, sizeof(hdr)), lines, len) != crc) {
+            break;
+        }
+
+        for (uint8_t line = 0; line < LINUX_STORAGE_NUM_LINES; line++) {
+            if (hdr.line_mask & (1U << line)) {
+                memcpy(&_buffer[line << LINUX_STORAGE_LINE_SHIFT], lines, LINUX_STORAGE_LINE_SIZE);
+                lines += LINUX_STORAGE_LINE_SIZE;
+            }
+        }
+        _journal_size += sizeof(hdr) + len;
+        _journal_seq = hdr.seq;
     }
 
-    _fd = fd;
-    _initialised = true;
+    // drop a record torn by a power loss so new ones follow the last
+    // complete one
+    if (_ftruncate_journal() == -1) {
+        close(_journal_fd);
+        _journal_fd = -1;
+    }
 }
 
 /*
-  mark some lines as dirty. Note that there is no attempt to avoid
-  the race condition between this code and the _timer_tick() code
-  below, which both update _dirty_mask. If we lose the race then the
-  result is that a line is written more than once, but it won't result
-  in a line not being written.
+  build a record of the lines in line_mask in _record, returning its length
+ */
+uint32_t Storage::_journal_record(uint32_t line_mask)
+{
+    struct journal_header *hdr = (struct journal_header *)_record;
+    uint8_t *lines = &_record[sizeof(*hdr)];
+    for (uint8_t line = 0; line < LINUX_STORAGE_NUM_LINES; line++) {
+        if (line_mask & (1U << line)) {
+            memcpy(lines, &_buffer[line << LINUX_STORAGE_LINE_SHIFT], LINUX_STORAGE_LINE_SIZE);
+            lines += LINUX_STORAGE_LINE_SIZE;
+        }
+    }
+    const uint32_t len = lines - _record;
+
+    hdr->magic = STORAGE_JOURNAL_MAGIC;
+    hdr->seq = _journal_seq + 1;
+    hdr->line_mask = line_mask;
+    hdr->crc = 0;
+    hdr->crc = crc_crc32(crc_crc32(0, _record, sizeof(*hdr)), &_record[sizeof(*hdr)], len - sizeof(*hdr));
+
+    return len;
+}
+
+bool Storage::_journal_append(uint32_t line_mask)
+{
+    // records must not go into a journal that may be lost from the
+    // directory after a power loss
+    if (!_dir_sync()) {
+        return false;
+    }
+
+    const uint32_t len = _journal_record(line_mask);
+
+    if (pwrite(_journal_fd, _record, len, _journal_size) != ssize_t(len) ||
+        _fdatasync(_journal_fd) != 0) {
+        // leave the journal ending with the last complete record
+        _journal_truncate();
+        return false;
+    }
+
+    _journal_size += len;
+    _journal_seq++;
+
+    if (_journal_torn) {
+        // cut off what is left of a longer failed record
+        _journal_truncate();
+    }
+
+    return true;
+}
+
+/*
+  cut the journal back to its last complete record. If that fails the
+  next record is written over the torn one, and we try again after it
+ */
+void Storage::_journal_truncate()
+{
+    const bool torn = _ftruncate_journal() != 0;
+    if (torn && !_journal_torn) {
+        fprintf(stderr, "Storage: failed to truncate journal (%m)\n");
+    }
+    _journal_torn = torn;
+}
+
+/*
+  sync the directory if compaction could not, returning true once it
+  is on disk
+ */
+bool Storage::_dir_sync()
+{
+    if (_dir_sync_pending) {
+        _dir_sync_pending = _fsync_dir() != 0;
+    }
+    return !_dir_sync_pending;
+}
+
+/*
+  replace the journal with a checkpoint of every line. The new journal
+  is written to a temporary file and renamed over the old one, so after
+  a power loss we find one or the other
+ */
+bool Storage::_journal_compact()
+{
+    const uint32_t all_lines = LINUX_STORAGE_NUM_LINES < 32 ? (1U << LINUX_STORAGE_NUM_LINES) - 1 : 0xFFFFFFFF;
+    const uint32_t len = _journal_record(all_lines);
+
+    int fd = openat(_dir_fd, STORAGE_JOURNAL_TMP_FILE, O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0666);
+    if (fd == -1) {
+        return false;
+    }
+    if (write(fd, _record, len) != ssize_t(len) ||
+        _fdatasync(fd) != 0 ||
+        renameat(_dir_fd, STORAGE_JOURNAL_TMP_FILE, _dir_fd, STORAGE_JOURNAL_FILE) != 0) {
+        close(fd);
+        unlinkat(_dir_fd, STORAGE_JOURNAL_TMP_FILE, 0);
+        return false;
+    }
+
+    // the old journal has left the directory, so carry on with the new
+    // one even if the rename isn't on disk yet. Until it is, appends
+    // retry the directory sync first
+    close(_journal_fd);
+    _journal_fd = fd;
+    _journal_size = len;
+    _journal_seq++;
+    _journal_torn = false;
+    _dir_sync_pending = true;
+    _dir_sync();
+
+    // the plain storage file only needs to be consistent for firmware
+    // that doesn't know about the journal, a torn write is repaired by
+    // the checkpoint
+    if (pwrite(_fd, &_record[sizeof(struct journal_header)], sizeof(_buffer), 0) == sizeof(_buffer)) {
+        fdatasync(_fd);
+    }
+
+    return true;
+}
+
+int Storage::_fsync_dir()
+{
+    return fsync(_dir_fd);
+}
+
+int Storage::_fdatasync(int fd)
+{
+    return fdatasync(fd);
+}
+
+int Storage::_ftruncate_journal()
+{
+    return ftruncate(_journal_fd, _journal_size);
+}
+
+/*
+  mark some lines as dirty. The IO thread takes the whole mask
+  atomically, so a line marked while a record is being written is left
+  dirty for the next one.
  */
 void Storage::_mark_dirty(uint16_t loc, uint16_t length)
 {
@@ -187,11 +365,14 @@ void Storage::_mark_dirty(uint16_t loc, uint16_t length)
         return;
     }
     uint16_t end = loc + length - 1;
+    uint32_t mask = 0;
     for (uint8_t line=loc>>LINUX_STORAGE_LINE_SHIFT;
          line <= end>>LINUX_STORAGE_LINE_SHIFT;
          line++) {
-        _dirty_mask |= 1U << line;
+        mask |= 1U << line;
     }
+    _last_write_ms = AP_HAL::millis();
+    _dirty_mask |= mask;
 }
 
 void Storage::read_block(void *dst, uint16_t loc, size_t n)
@@ -217,52 +398,41 @@ void Storage::write_block(uint16_t loc, const void *src, size_t n)
 
 void Storage::_timer_tick(void)
 {
-    if (!_initialised || _dirty_mask == 0 || _fd == -1) {
+    if (_initialised) {
+        // finish a compaction that couldn't sync the directory
+        _dir_sync();
+    }
+
+    if (!_initialised || _dirty_mask == 0 || _journal_fd == -1) {
+        _dirty_since_ms = 0;
         return;
     }
 
-    // write out the first dirty set of lines. We don't write more
-    // than one to keep the latency of this call to a minimum
-    uint8_t i, n;
-    for (i=0; i<LINUX_STORAGE_NUM_LINES; i++) {
-        if (_dirty_mask & (1<<i)) {
-            break;
-        }
+    /*
+      wait for a burst of writes such as a mission upload or parameter
+      reset to finish so it goes in one record, within a bound
+     */
+    const uint32_t now_ms = AP_HAL::millis();
+    if (_dirty_since_ms == 0) {
+        _dirty_since_ms = now_ms;
     }
-    if (i == LINUX_STORAGE_NUM_LINES) {
-        // this shouldn't be possible
+    if (now_ms - _last_write_ms < LINUX_STORAGE_SETTLE_MS &&
+        now_ms - _dirty_since_ms < LINUX_STORAGE_MAX_DELAY_MS) {
         return;
     }
-    uint32_t write_mask = (1U<<i);
-    // see how many lines to write
-    for (n=1; (i+n) < LINUX_STORAGE_NUM_LINES &&
-             n < (LINUX_STORAGE_MAX_WRITE>>LINUX_STORAGE_LINE_SHIFT); n++) {
-        if (!(_dirty_mask & (1<<(n+i)))) {
-            break;
-        }
-        // mark that line clean
-        write_mask |= (1<<(n+i));
+
+    _appending = true;
+    const uint32_t write_mask = _dirty_mask.exchange(0);
+    if (!_journal_append(write_mask)) {
+        // retry on the next tick
+        _dirty_mask |= write_mask;
+        _appending = false;
+        return;
     }
+    _appending = false;
+    _dirty_since_ms = 0;
 
-    /*
-      write the lines. This also updates _dirty_mask. Note that
-      because this is a SCHED_FIFO thread it will not be preempted
-      by the main task except during blocking calls. This means we
-      don't need a semaphore around the _dirty_mask updates.
-     */
-    if (lseek(_fd, i<<LINUX_STORAGE_LINE_SHIFT, SEEK_SET) == (i<<LINUX_STORAGE_LINE_SHIFT)) {
-        _dirty_mask &= ~write_mask;
-        if (write(_fd, &_buffer[i<<LINUX_STORAGE_LINE_SHIFT], n<<LINUX_STORAGE_LINE_SHIFT) != n<<LINUX_STORAGE_LINE_SHIFT) {
-            // write error - likely EINTR
-            _dirty_mask |= write_mask;
-            close(_fd);
-            _fd = -1;
-        }
-        if (_dirty_mask == 0) {
-            if (fsync(_fd) != 0) {
-                close(_fd);
-                _fd = -1;
-            }
-        }
+    if (_journal_size > LINUX_STORAGE_JOURNAL_MAX && _dirty_mask == 0) {
+        _journal_compact();
     }
 }
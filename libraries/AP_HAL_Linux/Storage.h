@@ -1,19 +1,39 @@
 #pragma once
 
+#include <atomic>
+
+#include <AP_Common/AP_Common.h>
 #include <AP_HAL/AP_HAL.h>
 
 #define LINUX_STORAGE_SIZE HAL_STORAGE_SIZE
-#define LINUX_STORAGE_MAX_WRITE 512
 #define LINUX_STORAGE_LINE_SHIFT 9
 #define LINUX_STORAGE_LINE_SIZE (1<<LINUX_STORAGE_LINE_SHIFT)
 #define LINUX_STORAGE_NUM_LINES (LINUX_STORAGE_SIZE/LINUX_STORAGE_LINE_SIZE)
 
+// changes are journaled once writes have paused for this long...
+#define LINUX_STORAGE_SETTLE_MS 20
+// ...or they have been waiting for this long
+#define LINUX_STORAGE_MAX_DELAY_MS 200
+// the journal is replaced by a checkpoint of all lines when it grows past this
+#define LINUX_STORAGE_JOURNAL_MAX (4 * LINUX_STORAGE_SIZE)
+
 namespace Linux {
 
+/*
+  Storage is kept in memory and persisted in a journal: each record
+  holds every line that changed since the previous one and is appended
+  with a single write and fdatasync. After a power loss the journal is
+  replayed up to the last complete record, so a record is either fully
+  applied or not at all. When the journal grows too long it is replaced
+  with a single record of every line.
+
+  The plain storage file is written at each compaction so it stays
+  readable by firmware without the journal.
+ */
 class Storage : public AP_HAL::Storage
 {
 public:
-    Storage() : _fd(-1),_dirty_mask(0) { }
+    Storage() : _fd(-1), _dir_fd(-1), _journal_fd(-1), _dirty_mask(0), _appending(false), _dir_sync_pending(false), _journal_torn(false) { }
 
     static Storage *from(AP_HAL::Storage *storage) {
         return static_cast<Storage*>(storage);
@@ -33,15 +53,54 @@ public:
     void write_block(uint16_t dst, const void* src, size_t n) override;
 
     virtual void _timer_tick(void) override;
+    bool flushed(void) override { return _dirty_mask == 0 && !_appending && !_dir_sync_pending; }
 
 protected:
+    struct PACKED journal_header {
+        uint32_t magic;
+        uint32_t seq;       // one more than the previous record
+        uint32_t line_mask; // lines that follow, lowest first
+        uint32_t crc;       // crc32 of the header, with this zero, and the lines
+    };
+
+    void _init(const char *dpath);
     void _mark_dirty(uint16_t loc, uint16_t length);
-    int _storage_create(const char *dpath);
+    int _storage_open();
+
+    void _journal_open();
+    void _journal_replay();
+    bool _journal_append(uint32_t line_mask);
+    bool _journal_compact();
+    uint32_t _journal_record(uint32_t line_mask);
+    void _journal_truncate();
+    bool _dir_sync();
+
+    // system calls that can fail on a bad card, overridden by tests
+    virtual int _fsync_dir();
+    virtual int _fdatasync(int fd);
+    virtual int _ftruncate_journal();
 
     int _fd;
+    int _dir_fd;
+    int _journal_fd;
+    uint32_t _journal_size;
+    uint32_t _journal_seq;
     volatile bool _initialised;
-    volatile uint32_t _dirty_mask;
+    std::atomic<uint32_t> _dirty_mask;
+    // set while lines taken from _dirty_mask are written
+    std::atomic<bool> _appending;
+    // the journal was renamed by compaction but the directory entry
+    // may not be on disk yet
+    std::atomic<bool> _dir_sync_pending;
+    // a failed record could not be cut off the end of the journal
+    bool _journal_torn;
+    volatile uint32_t _last_write_ms;
+    uint32_t _dirty_since_ms;
     uint8_t _buffer[LINUX_STORAGE_SIZE];
+
+    // a record being written, copied from _buffer so it can't change
+    // under the crc
+    uint8_t _record[sizeof(struct journal_header) + LINUX_STORAGE_SIZE];
 };
 
 }
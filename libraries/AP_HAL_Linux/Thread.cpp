@@ -20,12 +20,15 @@
 #include <limits.h>
 #include <sys/types.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <utility>
 
+#include <AP_Common/ExpandingString.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_Math/AP_Math.h>
 
+#include "Poller.h"
 #include "Scheduler.h"
 
 #define STACK_POISON 0xBEBACAFE
@@ -34,13 +37,39 @@ extern const AP_HAL::HAL &hal;
 
 namespace Linux {
 
+Thread *Thread::_first_started;
+pthread_mutex_t Thread::_started_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+Thread::~Thread()
+{
+    pthread_mutex_lock(&_started_mtx);
+    for (Thread **t = &_first_started; *t != nullptr; t = &(*t)->_next_started) {
+        if (*t == this) {
+            *t = _next_started;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&_started_mtx);
+}
 
 void *Thread::_run_trampoline(void *arg)
 {
     Thread *thread = static_cast<Thread *>(arg);
     thread->_poison_stack();
+
+    pthread_mutex_lock(&_started_mtx);
+    thread->_have_running_cpu_set =
+        pthread_getaffinity_np(pthread_self(), sizeof(thread->_running_cpu_set), &thread->_running_cpu_set) == 0;
+    thread->_running = true;
+    pthread_mutex_unlock(&_started_mtx);
+
     thread->_run();
 
+    // the stack goes with the thread, so stop reporting on it first
+    pthread_mutex_lock(&_started_mtx);
+    thread->_running = false;
+    pthread_mutex_unlock(&_started_mtx);
+
     if (thread->_auto_free) {
         delete thread;
     }
@@ -191,6 +220,13 @@ bool Thread::start(const char *name, int policy, int prio)
         }
     }
 
+    if (_have_cpu_set) {
+        if ((r = pthread_attr_setaffinity_np(&attr, sizeof(_cpu_set), &_cpu_set)) != 0) {
+            AP_HAL::panic("Failed to set CPU affinity for thread '%s': %s",
+                          name, strerror(r));
+        }
+    }
+
     r = pthread_create(&_ctx, &attr, &Thread::_run_trampoline, this);
     if (r != 0) {
         AP_HAL::panic("Failed to create thread '%s': %s",
@@ -200,13 +236,110 @@ bool Thread::start(const char *name, int policy, int prio)
 
     if (name) {
         pthread_setname_np(_ctx, name);
+        strncpy(_name, name, sizeof(_name) - 1);
     }
+    _prio = prio;
 
     _started = true;
 
+    pthread_mutex_lock(&_started_mtx);
+    _next_started = _first_started;
+    _first_started = this;
+    pthread_mutex_unlock(&_started_mtx);
+
     return true;
 }
 
+bool Thread::set_cpu_affinity(const cpu_set_t &cpu_set)
+{
+    if (_started || CPU_COUNT(&cpu_set) == 0) {
+        return false;
+    }
+
+    _cpu_set = cpu_set;
+    _have_cpu_set = true;
+
+    return true;
+}
+
+void Thread::threads_info(ExpandingString &str)
+{
+    pthread_mutex_lock(&_started_mtx);
+    for (Thread *t = _first_started; t != nullptr; t = t->_next_started) {
+        str.printf("%-15s PRI=%2d CPUS=", t->_name[0] ? t->_name : "?", t->_prio);
+        if (!t->_running) {
+            // not yet running or already exited
+            str.printf("- STOPPED\n");
+            continue;
+        }
+        if (t->_have_running_cpu_set) {
+            print_cpu_set(str, t->_running_cpu_set);
+        } else {
+            str.printf("?");
+        }
+        str.printf(" STACK=%u/%u", unsigned(t->get_stack_usage() * sizeof(uint32_t)), unsigned(t->_stack_size));
+        t->_thread_info(str);
+        str.printf("\n");
+    }
+    pthread_mutex_unlock(&_started_mtx);
+}
+
+bool Thread::parse_cpu_set(const char *str, cpu_set_t &cpu_set)
+{
+    CPU_ZERO(&cpu_set);
+
+    while (*str != '\0') {
+        char *end;
+        const long first = strtol(str, &end, 10);
+        long last = first;
+        if (end == str) {
+            return false;
+        }
+        if (*end == '-') {
+            str = end + 1;
+            last = strtol(str, &end, 10);
+            if (end == str) {
+                return false;
+            }
+        }
+        if (first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, &cpu_set);
+        }
+        if (*end == ',' && end[1] != '\0') {
+            end++;
+        } else if (*end != '\0') {
+            return false;
+        }
+        str = end;
+    }
+
+    return CPU_COUNT(&cpu_set) > 0;
+}
+
+void Thread::print_cpu_set(ExpandingString &str, const cpu_set_t &cpu_set)
+{
+    const char *sep = "";
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &cpu_set)) {
+            continue;
+        }
+        int last = cpu;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &cpu_set)) {
+            last++;
+        }
+        if (last == cpu) {
+            str.printf("%s%d", sep, cpu);
+        } else {
+            str.printf("%s%d-%d", sep, cpu, last);
+        }
+        sep = ",";
+        cpu = last;
+    }
+}
+
 bool Thread::is_current_thread()
 {
     return pthread_equal(pthread_self(), _ctx);
@@ -264,8 +397,20 @@ bool PeriodicThread::_run()
         if (dt > _period_usec) {
             // we've lost sync - restart
             next_run_usec = AP_HAL::micros64();
+            _wakeup_stats.record_overrun();
         } else {
-            Scheduler::from(hal.scheduler)->microsleep(dt);
+            if (_poller != nullptr) {
+                // handle events until the task is due, rounding the
+                // timeout up so we don't spin in the last millisecond
+                _poller->poll(int((dt + AP_USEC_PER_MSEC - 1) / AP_USEC_PER_MSEC));
+                if (AP_HAL::micros64() < next_run_usec) {
+                    continue;
+                }
+            } else {
+                Scheduler::from(hal.scheduler)->microsleep(dt);
+            }
+            const uint64_t now = AP_HAL::micros64();
+            _wakeup_stats.record(now > next_run_usec ? now - next_run_usec : 0);
         }
         next_run_usec += _period_usec;
 
@@ -278,6 +423,62 @@ bool PeriodicThread::_run()
     return true;
 }
 
+bool PeriodicThread::set_poller(Poller *poller)
+{
+    if (_started) {
+        return false;
+    }
+
+    _poller = poller;
+
+    return true;
+}
+
+void PeriodicThread::_thread_info(ExpandingString &str)
+{
+    str.printf(" RATE=%u", unsigned(_period_usec ? 1000000ULL / _period_usec : 0));
+    _wakeup_stats.print(str);
+}
+
+void WakeupStats::record(uint32_t late_us)
+{
+    pthread_mutex_lock(&_mtx);
+    _counts.count++;
+    _counts.late_sum_us += late_us;
+    _counts.late_max_us = MAX(_counts.late_max_us, late_us);
+    pthread_mutex_unlock(&_mtx);
+}
+
+void WakeupStats::record_overrun()
+{
+    pthread_mutex_lock(&_mtx);
+    _counts.overruns++;
+    pthread_mutex_unlock(&_mtx);
+}
+
+WakeupStats::Counts WakeupStats::get(bool reset)
+{
+    pthread_mutex_lock(&_mtx);
+    const Counts ret = _counts;
+    if (reset) {
+        _counts.count = 0;
+        _counts.late_sum_us = 0;
+        _counts.late_max_us = 0;
+    }
+    pthread_mutex_unlock(&_mtx);
+    return ret;
+}
+
+void WakeupStats::print(ExpandingString &str)
+{
+    const Counts c = get(true);
+    str.printf(" WAKE=%u LATE_AVG=%uus LATE_MAX=%uus OVERRUN=%u",
+               unsigned(c.count),
+               unsigned(c.count ? c.late_sum_us / c.count : 0),
+               unsigned(c.late_max_us),
+               unsigned(c.overruns));
+}
+
 bool PeriodicThread::stop()
 {
     if (!is_started()) {
@@ -18,12 +18,49 @@
 
 #include <pthread.h>
 #include <inttypes.h>
+#include <sched.h>
 #include <stdlib.h>
 
 #include <AP_HAL/utility/functor.h>
 
+class ExpandingString;
+
 namespace Linux {
 
+class Poller;
+
+/*
+ * How late a thread woke up from its sleeps. Recorded by the thread and
+ * read from others for @SYS/threads.txt, so access is locked
+ */
+class WakeupStats {
+public:
+    struct Counts {
+        uint32_t count;         // wakeups since the last reset
+        uint32_t late_max_us;   // largest wakeup latency since the last reset
+        uint64_t late_sum_us;   // sum of the wakeup latencies since the last reset
+        uint32_t overruns;      // times the task overran its period, never reset
+    };
+
+    void record(uint32_t late_us);
+    void record_overrun();
+
+    /*
+     * Copy of the counts, resetting all but the overruns if @reset
+     */
+    Counts get(bool reset = false);
+
+    /*
+     * Print the latencies since the last report and reset them, like
+     * the ChibiOS thread load statistics
+     */
+    void print(ExpandingString &str);
+
+private:
+    pthread_mutex_t _mtx = PTHREAD_MUTEX_INITIALIZER;
+    Counts _counts {};
+};
+
 /*
  * Interface abstracting threads
  */
@@ -33,7 +70,7 @@ public:
 
     Thread(task_t t) : _task(t) { }
 
-    virtual ~Thread() { }
+    virtual ~Thread();
 
     bool start(const char *name, int policy, int prio);
 
@@ -47,13 +84,39 @@ public:
 
     void set_auto_free(bool auto_free) { _auto_free = auto_free; }
 
+    /*
+     * Restrict the thread to run on the CPUs in @cpu_set. Must be called
+     * before start().
+     */
+    bool set_cpu_affinity(const cpu_set_t &cpu_set);
+
     virtual bool stop() { return false; }
 
     bool join();
 
+    /*
+     * Print one line per started thread for @SYS/threads.txt
+     */
+    static void threads_info(ExpandingString &str);
+
+    /*
+     * Parse a list of CPUs such as "0,2-3" into @cpu_set
+     */
+    static bool parse_cpu_set(const char *str, cpu_set_t &cpu_set);
+
+    /*
+     * Print @cpu_set as a list of CPUs such as "0,2-3"
+     */
+    static void print_cpu_set(ExpandingString &str, const cpu_set_t &cpu_set);
+
 protected:
     static void *_run_trampoline(void *arg);
 
+    /*
+     * Print the thread specific part of the @SYS/threads.txt line
+     */
+    virtual void _thread_info(ExpandingString &str) { }
+
     /*
      * Run the task assigned in the constructor. May be overriden in case it's
      * preferred to use Thread as an interface or when user wants to aggregate
@@ -75,6 +138,22 @@ protected:
     } _stack_debug;
 
     size_t _stack_size = 0;
+
+    char _name[16] = "";
+    int _prio = 0;
+    cpu_set_t _cpu_set;
+    bool _have_cpu_set = false;
+
+    // set by the thread itself while it runs, as its handle and stack
+    // can't be used for reporting once it exits
+    bool _running = false;
+    bool _have_running_cpu_set = false;
+    cpu_set_t _running_cpu_set;
+
+    // started threads, for reporting
+    Thread *_next_started = nullptr;
+    static Thread *_first_started;
+    static pthread_mutex_t _started_mtx;
 };
 
 class PeriodicThread : public Thread {
@@ -87,10 +166,28 @@ public:
 
     bool stop() override;
 
+    /*
+     * Sleep between runs of the periodic task on @poller, so events on the
+     * file descriptors registered with it are handled by this thread as
+     * they arrive. Must be called before start().
+     */
+    bool set_poller(Poller *poller);
+
+    /*
+     * How late the thread woke up for its periodic task
+     */
+    WakeupStats::Counts get_wakeup_stats() { return _wakeup_stats.get(); }
+
 protected:
     bool _run() override;
 
+    void _thread_info(ExpandingString &str) override;
+
     uint64_t _period_usec = 0;
+
+    Poller *_poller = nullptr;
+
+    WakeupStats _wakeup_stats;
 };
 
 }
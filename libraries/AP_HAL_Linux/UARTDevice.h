@@ -20,6 +20,7 @@ public:
         return _flow_control;
     }
     virtual void set_parity(int v) override;
+    virtual int get_fd() const override { return _fd; }
 
 private:
     void _disable_crlf();
@@ -10,16 +10,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
 #include "ConsoleDevice.h"
+#include "Scheduler.h"
 #include "TCPServerDevice.h"
 #include "UARTDevice.h"
 #include "UDPDevice.h"
@@ -39,6 +43,13 @@ UARTDriver::UARTDriver(bool default_console) :
     if (default_console) {
         _console = true;
     }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&_rx_wait_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&_rx_wait_mtx, nullptr);
 }
 
 /*
@@ -130,11 +141,35 @@ void UARTDriver::_deallocate_buffers()
     _writebuf.set_size(0);
 }
 
+/*
+  check for a flag in a comma separated list of them
+ */
+static bool has_flag(const char *flags, const char *name)
+{
+    const size_t len = strlen(name);
+    while (flags != nullptr && *flags != '\0') {
+        if (strncmp(flags, name, len) == 0 && (flags[len] == ',' || flags[len] == '\0')) {
+            return true;
+        }
+        flags = strchr(flags, ',');
+        if (flags != nullptr) {
+            flags++;
+        }
+    }
+    return false;
+}
+
 /*
     Device path accepts the following syntaxes:
         - /dev/ttyO1
         - tcp:*:1243:wait
         - udp:192.168.2.15:1243
+        - udpin:0.0.0.0:14550:fanout,coalesce
+
+    UDP flags:
+        - bcast: send to a broadcast address until a reply arrives
+        - fanout: send to every client heard from recently, udpin only
+        - coalesce: pack several MAVLink packets in each datagram
 */
 AP_HAL::OwnPtr<SerialDevice> UARTDriver::_parseDevicePath(const char *arg)
 {
@@ -188,19 +223,24 @@ AP_HAL::OwnPtr<SerialDevice> UARTDriver::_parseDevicePath(const char *arg)
     AP_HAL::OwnPtr<SerialDevice> device = nullptr;
 
     if (strcmp(protocol, "udp") == 0 || strcmp(protocol, "udpin") == 0) {
-        bool bcast = (_flag && strcmp(_flag, "bcast") == 0);
+        bool bcast = has_flag(_flag, "bcast");
+        bool fanout = has_flag(_flag, "fanout");
         _packetise = true;
+        _coalesce = has_flag(_flag, "coalesce");
         if (strcmp(protocol, "udp") == 0) {
+            if (fanout) {
+                AP_HAL::panic("fanout needs udpin");
+            }
             device = new UDPDevice(_ip, _base_port, bcast, false);
         } else {
             if (bcast) {
                 AP_HAL::panic("Can't combine udpin with bcast");
             }
-            device = new UDPDevice(_ip, _base_port, false, true);
+            device = new UDPDevice(_ip, _base_port, false, true, fanout);
 
         }
     } else {
-        bool wait = (_flag && strcmp(_flag, "wait") == 0);
+        bool wait = has_flag(_flag, "wait");
         device = new TCPServerDevice(_ip, _base_port, wait);
     }
 
@@ -220,6 +260,9 @@ void UARTDriver::end()
         hal.scheduler->delay(1);
     }
 
+    _unregister_pollable();
+    _poll_disabled = false;
+
     _device->close();
     _deallocate_buffers();
 }
@@ -302,6 +345,37 @@ bool UARTDriver::discard_input()
     return true;
 }
 
+bool UARTDriver::wait_timeout(uint16_t n, uint32_t timeout_ms)
+{
+    if (!_initialised) {
+        return false;
+    }
+    if (_readbuf.available() >= n) {
+        return true;
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ms / 1000U;
+    ts.tv_nsec += (timeout_ms % 1000U) * AP_USEC_PER_MSEC * AP_NSEC_PER_USEC;
+    if (ts.tv_nsec >= long(AP_NSEC_PER_SEC)) {
+        ts.tv_sec++;
+        ts.tv_nsec -= AP_NSEC_PER_SEC;
+    }
+
+    pthread_mutex_lock(&_rx_wait_mtx);
+    _rx_wait_n = n;
+    while (_readbuf.available() < n) {
+        if (pthread_cond_timedwait(&_rx_wait_cond, &_rx_wait_mtx, &ts) == ETIMEDOUT) {
+            break;
+        }
+    }
+    _rx_wait_n = 0;
+    pthread_mutex_unlock(&_rx_wait_mtx);
+
+    return _readbuf.available() >= n;
+}
+
 /* Linux implementations of Print virtual methods */
 size_t UARTDriver::write(uint8_t c)
 {
@@ -321,6 +395,7 @@ size_t UARTDriver::write(uint8_t c)
     }
     size_t ret = _writebuf.write(&c, 1);
     _write_mutex.give();
+    _kick_writes();
     return ret;
 }
 
@@ -350,6 +425,7 @@ size_t UARTDriver::write(const uint8_t *buffer, size_t size)
 
     size_t ret = _writebuf.write(buffer, size);
     _write_mutex.give();
+    _kick_writes();
     return ret;
 }
 
@@ -372,6 +448,21 @@ int UARTDriver::_write_fd(const uint8_t *buf, uint16_t n)
     return _device->write(buf, n);
 }
 
+/*
+  try writing count datagrams, handling an unresponsive port
+ */
+int UARTDriver::_write_datagrams_fd(const uint8_t *buf, const uint16_t *lens, uint8_t count)
+{
+    if (!_connected) {
+        _connected = _device->open();
+    }
+    if (!_connected) {
+        return 0;
+    }
+
+    return _device->write_datagrams(buf, lens, count);
+}
+
 /*
   try reading n bytes, handling an unresponsive port
  */
@@ -381,6 +472,49 @@ int UARTDriver::_read_fd(uint8_t *buf, uint16_t n)
 }
 
 
+/*
+  send whole MAVLink packets as datagrams, a batch of them with each
+  system call. With coalescing, packets are combined into datagrams of
+  up to UART_DATAGRAM_MAX bytes rather than sent one per datagram
+ */
+void UARTDriver::_write_pending_datagrams(void)
+{
+    const uint32_t available_bytes = _writebuf.available();
+    uint16_t lens[UART_DATAGRAM_BATCH];
+    uint8_t count = 0;
+    uint32_t ofs = 0;
+
+    while (count < ARRAY_SIZE(lens) && ofs < available_bytes) {
+        uint16_t len = 0;
+        do {
+            const uint16_t remaining = MIN(available_bytes - ofs - len, uint32_t(UINT16_MAX));
+            const uint16_t n = mavlink_packetise(_writebuf, remaining, ofs + len);
+            if (n == 0 || (len > 0 && len + n > UART_DATAGRAM_MAX)) {
+                break;
+            }
+            len += n;
+        } while (_coalesce && ofs + len < available_bytes);
+        if (len == 0) {
+            break;
+        }
+        lens[count++] = len;
+        ofs += len;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    uint8_t tmpbuf[ofs];
+    _writebuf.peekbytes(tmpbuf, ofs);
+    const int sent = _write_datagrams_fd(tmpbuf, lens, count);
+    uint32_t sent_bytes = 0;
+    for (int i = 0; i < sent; i++) {
+        sent_bytes += lens[i];
+    }
+    _writebuf.advance(sent_bytes);
+}
+
 /*
   try to push out one lump of pending bytes
   return true if progress is made
@@ -391,35 +525,23 @@ bool UARTDriver::_write_pending_bytes(void)
     uint32_t available_bytes = _writebuf.available();
     uint16_t n = available_bytes;
 
-    if (_packetise && n > 0) {
+    if (_packetise) {
         // send on MAVLink packet boundaries if possible
-        n = mavlink_packetise(_writebuf, n);
-    }
-
-    if (n > 0) {
+        _write_pending_datagrams();
+    } else if (n > 0) {
         int ret;
+        ByteBuffer::IoVec vec[2];
+        const auto n_vec = _writebuf.peekiovec(vec, n);
+        for (int i = 0; i < n_vec; i++) {
+            ret = _write_fd(vec[i].data, (uint16_t)vec[i].len);
+            if (ret < 0) {
+                break;
+            }
+            _writebuf.advance(ret);
 
-        if (_packetise) {
-            // keep as a single UDP packet
-            uint8_t tmpbuf[n];
-            _writebuf.peekbytes(tmpbuf, n);
-            ret = _write_fd(tmpbuf, n);
-            if (ret > 0)
-                _writebuf.advance(ret);
-        } else {
-            ByteBuffer::IoVec vec[2];
-            const auto n_vec = _writebuf.peekiovec(vec, n);
-            for (int i = 0; i < n_vec; i++) {
-                ret = _write_fd(vec[i].data, (uint16_t)vec[i].len);
-                if (ret < 0) {
-                    break;
-                }
-                _writebuf.advance(ret);
-
-                /* We wrote less than we asked for, stop */
-                if ((unsigned)ret != vec[i].len) {
-                    break;
-                }
+            /* We wrote less than we asked for, stop */
+            if ((unsigned)ret != vec[i].len) {
+                break;
             }
         }
     }
@@ -427,23 +549,16 @@ bool UARTDriver::_write_pending_bytes(void)
     return _writebuf.available() != available_bytes;
 }
 
-/*
-  push any pending bytes to/from the serial port. This is called at
-  1kHz in the timer thread. Doing it this way reduces the system call
-  overhead in the main task enormously.
- */
-void UARTDriver::_timer_tick(void)
+void UARTDriver::_flush_writes()
 {
-    if (!_initialised) return;
-
-    _in_timer = true;
-
     uint8_t num_send = 10;
     while (num_send != 0 && _write_pending_bytes()) {
         num_send--;
     }
+}
 
-    // try to fill the read buffer
+void UARTDriver::_fill_read_buffer()
+{
     int ret;
     ByteBuffer::IoVec vec[2];
 
@@ -465,9 +580,181 @@ void UARTDriver::_timer_tick(void)
         }
     }
 
+    const uint16_t rx_wait_n = _rx_wait_n;
+    if (rx_wait_n != 0 && _readbuf.available() >= rx_wait_n) {
+        pthread_mutex_lock(&_rx_wait_mtx);
+        pthread_cond_signal(&_rx_wait_cond);
+        pthread_mutex_unlock(&_rx_wait_mtx);
+    }
+}
+
+/*
+  push any pending bytes to/from the serial port. This is called at
+  100Hz in the UART thread. Doing it this way reduces the system call
+  overhead in the main task enormously. Ports with a device that can be
+  waited on are instead serviced by _handle_events() when it is ready.
+ */
+void UARTDriver::_timer_tick(void)
+{
+    if (!_initialised) return;
+
+    if (!_pollable_registered && !_poll_disabled) {
+        _register_pollable();
+    }
+
+    if (_pollable_registered) {
+        // resume what the poller had to give up on
+        if (_write_stalled) {
+            _handle_events(false);
+        }
+        if (!(_poll_events & EPOLLIN) && _readbuf.space() > 0) {
+            _update_poll_events(EPOLLIN, 0);
+        }
+        return;
+    }
+
+    _in_timer = true;
+
+    _flush_writes();
+
+    // try to fill the read buffer
+    _fill_read_buffer();
+
     _in_timer = false;
 }
 
+void UARTDriver::_register_pollable()
+{
+    const int fd = _device->get_fd();
+    if (fd < 0 || !_connected) {
+        return;
+    }
+
+    {
+        WITH_SEMAPHORE(_poll_sem);
+        _pollable.set_fd(fd);
+        _poll_events = EPOLLIN;
+        if (!Scheduler::from(hal.scheduler)->get_uart_poller().register_pollable(&_pollable, EPOLLIN)) {
+            _pollable.set_fd(-1);
+            _poll_disabled = true;
+            return;
+        }
+        _pollable_registered = true;
+    }
+
+    // anything written before we were registered
+    _kick_writes();
+}
+
+void UARTDriver::_unregister_pollable()
+{
+    WITH_SEMAPHORE(_poll_sem);
+
+    if (!_pollable_registered) {
+        return;
+    }
+
+    _pollable_registered = false;
+    Scheduler::from(hal.scheduler)->get_uart_poller().unregister_pollable(&_pollable);
+    _pollable.set_fd(-1);
+
+    // on an error or hang up the device is polled from the timer tick
+    // until the port is restarted
+    _poll_disabled = true;
+}
+
+/*
+  the device is ready to read or write
+ */
+void UARTDriver::_handle_events(bool can_read)
+{
+    if (!_initialised || !_pollable_registered) {
+        return;
+    }
+
+    _in_timer = true;
+
+    const bool sendable = _sendable();
+    const uint32_t pending = _writebuf.available();
+    _flush_writes();
+    const bool progress = _writebuf.available() != pending;
+
+    if (can_read) {
+        _fill_read_buffer();
+        if (_readbuf.space() == 0) {
+            // stop waiting for input until the main loop has made room
+            _update_poll_events(0, EPOLLIN);
+        }
+    }
+
+    _write_stalled = sendable && !progress;
+    if (_write_stalled) {
+        // the device says it is ready but won't take our data, don't
+        // spin on it
+        _update_poll_events(0, EPOLLOUT);
+    } else {
+        if (!_sendable()) {
+            _update_poll_events(0, EPOLLOUT);
+        }
+        // the main loop may have written since the check above without
+        // waking us as we were waiting for the device to be writable
+        if (_sendable()) {
+            _update_poll_events(EPOLLOUT, 0);
+        }
+    }
+
+    _in_timer = false;
+}
+
+void UARTDriver::_update_poll_events(uint32_t set, uint32_t clear)
+{
+    WITH_SEMAPHORE(_poll_sem);
+
+    // a writer may get here after the UART thread has unregistered
+    if (!_pollable_registered) {
+        return;
+    }
+
+    const uint32_t events = (_poll_events | set) & ~clear;
+    if (events != _poll_events) {
+        _poll_events = events;
+        Scheduler::from(hal.scheduler)->get_uart_poller().modify_pollable(&_pollable, events);
+    }
+}
+
+/*
+  true if there are bytes to send that _write_pending_bytes() won't
+  hold back waiting for the rest of a MAVLink packet
+ */
+bool UARTDriver::_sendable()
+{
+    const uint16_t n = _writebuf.available();
+    if (n == 0) {
+        return false;
+    }
+    if (_packetise) {
+        return mavlink_packetise(_writebuf, n) > 0;
+    }
+    return true;
+}
+
+/*
+  wait for the device to be writable when the first complete packet is
+  queued. Later writes are picked up when the UART thread services the
+  port. This runs on the writer's thread, so it only reads the UART
+  thread's state and any change to the poller goes through
+  _update_poll_events()
+ */
+void UARTDriver::_kick_writes()
+{
+    if (!_pollable_registered || _write_stalled || (_poll_events & EPOLLOUT)) {
+        return;
+    }
+    if (_sendable()) {
+        _update_poll_events(EPOLLOUT, 0);
+    }
+}
+
 void UARTDriver::configure_parity(uint8_t v) {
     _device->set_parity(v);
 }
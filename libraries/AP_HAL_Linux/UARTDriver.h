@@ -3,10 +3,18 @@
 #include <AP_HAL/utility/OwnPtr.h>
 #include <AP_HAL/utility/RingBuffer.h>
 
+#include <atomic>
+
 #include "AP_HAL_Linux.h"
+#include "Poller.h"
 #include "SerialDevice.h"
 #include "Semaphores.h"
 
+// datagrams handed to the device at once on packetised links
+#define UART_DATAGRAM_BATCH 8
+// largest coalesced datagram, within a typical 1500 byte MTU
+#define UART_DATAGRAM_MAX 1400
+
 namespace Linux {
 
 class UARTDriver : public AP_HAL::UARTDriver {
@@ -33,6 +41,13 @@ public:
 
     bool discard_input() override;
 
+    /*
+      wait for at least n bytes of incoming data, with timeout in
+      milliseconds. Return true if n bytes are available, false if
+      timed out
+     */
+    bool wait_timeout(uint16_t n, uint32_t timeout_ms) override;
+
     /* Linux implementations of Print virtual methods */
     size_t write(uint8_t c) override;
     size_t write(const uint8_t *buffer, size_t size) override;
@@ -80,10 +95,59 @@ private:
     char *_flag;
     bool _connected; // true if a client has connected
     bool _packetise; // true if writes should try to be on mavlink boundaries
+    bool _coalesce; // true if several mavlink packets may share a datagram
 
     void _allocate_buffers(uint16_t rxS, uint16_t txS);
     void _deallocate_buffers();
 
+    void _write_pending_datagrams(void);
+    void _flush_writes();
+    void _fill_read_buffer();
+
+    /*
+      services the port from the UART thread's poller when the device
+      is ready, so idle ports cost no system calls
+     */
+    class DevicePollable : public Pollable {
+    public:
+        DevicePollable(UARTDriver &uart) : _uart(uart) { }
+
+        // the file descriptor belongs to the device
+        ~DevicePollable() { _fd = -1; }
+
+        void set_fd(int fd) { _fd = fd; }
+
+        void on_can_read() override { _uart._handle_events(true); }
+        void on_can_write() override { _uart._handle_events(false); }
+        void on_error() override { _uart._unregister_pollable(); }
+        void on_hang_up() override { _uart._unregister_pollable(); }
+
+    private:
+        UARTDriver &_uart;
+    };
+
+    // these are changed on the UART thread and read by writers on
+    // other threads in _kick_writes(). _poll_sem is held while the
+    // poller registration or the events waited for change
+    DevicePollable _pollable{*this};
+    std::atomic<bool> _pollable_registered{false};
+    std::atomic<bool> _poll_disabled{false};    // the device failed, poll it on the timer tick
+    std::atomic<bool> _write_stalled{false};    // the device refused data, retry on the timer tick
+    std::atomic<uint32_t> _poll_events{0};
+    Linux::Semaphore _poll_sem;
+
+    void _register_pollable();
+    void _unregister_pollable();
+    void _handle_events(bool can_read);
+    void _update_poll_events(uint32_t set, uint32_t clear);
+    bool _sendable();
+    void _kick_writes();
+
+    // wakeup of wait_timeout() callers
+    pthread_mutex_t _rx_wait_mtx;
+    pthread_cond_t _rx_wait_cond;
+    std::atomic<uint16_t> _rx_wait_n{0};
+
     AP_HAL::OwnPtr<SerialDevice> _parseDevicePath(const char *arg);
 
     // timestamp for receiving data on the UART, avoiding a lock
@@ -100,6 +164,7 @@ protected:
     ByteBuffer _writebuf{0};
 
     virtual int _write_fd(const uint8_t *buf, uint16_t n);
+    virtual int _write_datagrams_fd(const uint8_t *buf, const uint16_t *lens, uint8_t count);
     virtual int _read_fd(uint8_t *buf, uint16_t n);
 
     Linux::Semaphore _write_mutex;
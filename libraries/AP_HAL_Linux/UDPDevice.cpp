@@ -1,16 +1,24 @@
 #include "UDPDevice.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/ioctl.h>
 
 #include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
 
-UDPDevice::UDPDevice(const char *ip, uint16_t port, bool bcast, bool input):
+UDPDevice::UDPDevice(const char *ip, uint16_t port, bool bcast, bool input, bool fanout):
     _ip(ip),
     _port(port),
     _bcast(bcast),
-    _input(input)
+    _input(input),
+    _fanout(fanout),
+    _num_clients(0),
+    _rx_count(0),
+    _rx_next(0),
+    _rx_ofs(0)
 {
 }
 
@@ -20,37 +28,212 @@ UDPDevice::~UDPDevice()
 
 ssize_t UDPDevice::write(const uint8_t *buf, uint16_t n)
 {
-    if (!socket.pollout(0)) {
+    const uint16_t len = n;
+    const int ret = write_datagrams(buf, &len, 1);
+    if (ret <= 0) {
         return -1;
     }
-    if (_connected) {
-        return socket.send(buf, n);
+    return n;
+}
+
+/*
+  send count datagrams of lens[i] bytes each, packed one after the other
+  in buf, with a single system call. Returns the number of datagrams
+  sent, or -1 if none could be sent
+ */
+int UDPDevice::write_datagrams(const uint8_t *buf, const uint16_t *lens, uint8_t count)
+{
+    count = MIN(count, UDPDEVICE_BATCH_MAX);
+
+    struct iovec iov[UDPDEVICE_BATCH_MAX];
+    for (uint8_t i = 0; i < count; i++) {
+        iov[i].iov_base = const_cast<uint8_t *>(buf);
+        iov[i].iov_len = lens[i];
+        buf += lens[i];
     }
-    if (_input) {
+
+    // the destinations of each datagram, nullptr when connected
+    const struct sockaddr_in *dests[UDPDEVICE_FANOUT_MAX_CLIENTS];
+    uint8_t num_dests = 0;
+    if (_fanout) {
+        _expire_clients();
+        for (uint8_t c = 0; c < _num_clients; c++) {
+            dests[num_dests++] = &_clients[c].addr;
+        }
+    } else if (_connected) {
+        dests[num_dests++] = nullptr;
+    } else if (!_input) {
+        dests[num_dests++] = &_dest;
+    }
+    if (num_dests == 0) {
         // can't send yet
         return -1;
     }
-    return socket.sendto(buf, n, _ip, _port);
+
+    /*
+      each datagram goes to every destination before the next one, so
+      the data in the iovecs is shared between the destinations and
+      the datagrams sent to all of them are simple to find. Clients
+      that got the first datagram from a partly sent write are skipped
+     */
+    struct mmsghdr msgs[UDPDEVICE_BATCH_MAX * UDPDEVICE_FANOUT_MAX_CLIENTS] {};
+    uint8_t msg_datagram[ARRAY_SIZE(msgs)];
+    uint8_t msg_dest[ARRAY_SIZE(msgs)];
+    unsigned n = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        for (uint8_t d = 0; d < num_dests; d++) {
+            if (_fanout && i == 0 && _clients[d].has_next) {
+                continue;
+            }
+            msg_datagram[n] = i;
+            msg_dest[n] = d;
+            struct msghdr &hdr = msgs[n++].msg_hdr;
+            hdr.msg_iov = &iov[i];
+            hdr.msg_iovlen = 1;
+            if (dests[d] != nullptr) {
+                hdr.msg_name = const_cast<struct sockaddr_in *>(dests[d]);
+                hdr.msg_namelen = sizeof(struct sockaddr_in);
+            }
+        }
+    }
+    if (n == 0) {
+        // every client already had the only datagram
+        _clear_has_next();
+        return count;
+    }
+
+    const int ret = sendmmsg(socket.get_fd(), msgs, n, MSG_DONTWAIT);
+    if (ret <= 0) {
+        return -1;
+    }
+    if (unsigned(ret) == n) {
+        _clear_has_next();
+        return count;
+    }
+
+    /*
+      the first datagram not sent to every destination is sent again
+      by the next write, so note which clients already have it rather
+      than sending them a duplicate. Clients noted before still have
+      it if that is still the first datagram
+     */
+    const uint8_t sent = msg_datagram[ret];
+    if (sent > 0) {
+        _clear_has_next();
+    }
+    if (_fanout) {
+        for (int m = ret - 1; m >= 0 && msg_datagram[m] == sent; m--) {
+            _clients[msg_dest[m]].has_next = true;
+        }
+    }
+    return sent > 0 ? sent : -1;
+}
+
+void UDPDevice::_clear_has_next()
+{
+    for (uint8_t c = 0; c < _num_clients; c++) {
+        _clients[c].has_next = false;
+    }
 }
 
 ssize_t UDPDevice::read(uint8_t *buf, uint16_t n)
 {
-    ssize_t ret = socket.recv(buf, n, 0);
-    if (!_connected && ret > 0) {
-        const char *ip;
-        uint16_t port;
-        socket.last_recv_address(ip, port);
-        _connected = socket.connect(ip, port);
+    if (_rx_next == _rx_count && !_recv_batch()) {
+        return -1;
+    }
+
+    ssize_t ret = 0;
+    while (n > 0 && _rx_next < _rx_count) {
+        const uint16_t len = MIN(n, uint16_t(_rx_len[_rx_next] - _rx_ofs));
+        memcpy(buf, &_rx_buf[_rx_next][_rx_ofs], len);
+        buf += len;
+        n -= len;
+        ret += len;
+        _rx_ofs += len;
+        if (_rx_ofs == _rx_len[_rx_next]) {
+            _rx_next++;
+            _rx_ofs = 0;
+        }
     }
+
     return ret;
 }
 
+bool UDPDevice::_recv_batch()
+{
+    struct iovec iov[UDPDEVICE_BATCH_MAX];
+    struct sockaddr_in from[UDPDEVICE_BATCH_MAX];
+    struct mmsghdr msgs[UDPDEVICE_BATCH_MAX] {};
+    for (uint8_t i = 0; i < UDPDEVICE_BATCH_MAX; i++) {
+        iov[i].iov_base = _rx_buf[i];
+        iov[i].iov_len = sizeof(_rx_buf[i]);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = &from[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(from[i]);
+    }
+
+    const int ret = recvmmsg(socket.get_fd(), msgs, UDPDEVICE_BATCH_MAX, MSG_DONTWAIT, nullptr);
+    if (ret <= 0) {
+        return false;
+    }
+
+    _rx_count = ret;
+    _rx_next = 0;
+    _rx_ofs = 0;
+    for (uint8_t i = 0; i < _rx_count; i++) {
+        _rx_len[i] = msgs[i].msg_len;
+        if (_fanout) {
+            _add_client(from[i]);
+        }
+    }
+
+    if (!_connected && !_fanout) {
+        // reply to whoever talks to us first
+        _connected = ::connect(socket.get_fd(), (struct sockaddr *)&from[0], sizeof(from[0])) == 0;
+    }
+
+    return true;
+}
+
+void UDPDevice::_add_client(const struct sockaddr_in &addr)
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint8_t c = 0; c < _num_clients; c++) {
+        if (_clients[c].addr.sin_addr.s_addr == addr.sin_addr.s_addr &&
+            _clients[c].addr.sin_port == addr.sin_port) {
+            _clients[c].last_recv_ms = now_ms;
+            return;
+        }
+    }
+    if (_num_clients == UDPDEVICE_FANOUT_MAX_CLIENTS) {
+        return;
+    }
+    _clients[_num_clients].addr = addr;
+    _clients[_num_clients].last_recv_ms = now_ms;
+    _clients[_num_clients].has_next = false;
+    _num_clients++;
+}
+
+void UDPDevice::_expire_clients()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint8_t c = 0; c < _num_clients; ) {
+        if (now_ms - _clients[c].last_recv_ms > UDPDEVICE_FANOUT_TIMEOUT_MS) {
+            _clients[c] = _clients[--_num_clients];
+        } else {
+            c++;
+        }
+    }
+}
+
 bool UDPDevice::open()
 {
     if (_input) {
         socket.bind(_ip, _port);
         return true;
     }
+    SocketAPM::make_sockaddr(_ip, _port, _dest);
     if (_bcast) {
         // open now, then connect on first received packet
         socket.set_broadcast();
@@ -1,11 +1,27 @@
 #pragma once
 
+#include <netinet/in.h>
+#include <sys/socket.h>
+
 #include "SerialDevice.h"
 #include <AP_HAL/utility/Socket.h>
 
+// datagrams sent or received with one system call
+#define UDPDEVICE_BATCH_MAX 8
+// largest datagram received, longer ones are truncated
+#define UDPDEVICE_RX_DATAGRAM_MAX 2048
+// clients served by a fan-out device
+#define UDPDEVICE_FANOUT_MAX_CLIENTS 4
+// a fan-out client is dropped when it hasn't sent anything for this long
+#define UDPDEVICE_FANOUT_TIMEOUT_MS 10000
+
 class UDPDevice: public SerialDevice {
 public:
-    UDPDevice(const char *ip, uint16_t port, bool bcast, bool input);
+    /*
+      With @fanout the device sends to every client it has recently
+      received from instead of connecting to the first one
+     */
+    UDPDevice(const char *ip, uint16_t port, bool bcast, bool input, bool fanout = false);
     virtual ~UDPDevice();
 
     virtual bool open() override;
@@ -14,11 +30,41 @@ public:
     virtual void set_speed(uint32_t speed) override;
     virtual ssize_t write(const uint8_t *buf, uint16_t n) override;
     virtual ssize_t read(uint8_t *buf, uint16_t n) override;
+    virtual int write_datagrams(const uint8_t *buf, const uint16_t *lens, uint8_t count) override;
+    virtual int get_fd() const override { return socket.get_fd(); }
 private:
     SocketAPM socket{true};
     const char *_ip;
     uint16_t _port;
     bool _bcast;
     bool _input;
+    bool _fanout;
     bool _connected = false;
+
+    // destination of an output device that isn't connected
+    struct sockaddr_in _dest {};
+
+    struct Client {
+        struct sockaddr_in addr;
+        uint32_t last_recv_ms;
+        // the client already has the first datagram of the next
+        // write, which the last write only got to some clients with
+        bool has_next;
+    } _clients[UDPDEVICE_FANOUT_MAX_CLIENTS] {};
+    uint8_t _num_clients;
+
+    void _add_client(const struct sockaddr_in &addr);
+    void _expire_clients();
+    void _clear_has_next();
+
+    /*
+      datagrams received by the last recvmmsg(), copied out by read()
+      as the caller has room
+     */
+    bool _recv_batch();
+    uint8_t _rx_buf[UDPDEVICE_BATCH_MAX][UDPDEVICE_RX_DATAGRAM_MAX];
+    uint16_t _rx_len[UDPDEVICE_BATCH_MAX];
+    uint8_t _rx_count;
+    uint8_t _rx_next;
+    uint16_t _rx_ofs;
 };
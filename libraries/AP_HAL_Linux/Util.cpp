@@ -10,6 +10,7 @@
 #include <AP_HAL/AP_HAL.h>
 
 #include "Heat_Pwm.h"
+#include "Scheduler.h"
 #include "ToneAlarm_Disco.h"
 #include "Util.h"
 
@@ -146,6 +147,11 @@ bool Util::get_system_id(char buf[40])
 }
 
 
+void Util::thread_info(ExpandingString &str)
+{
+    Scheduler::from(hal.scheduler)->thread_info(str);
+}
+
 int Util::write_file(const char *path, const char *fmt, ...)
 {
     errno = 0;
@@ -89,6 +89,9 @@ public:
 
     int get_hw_arm32();
 
+    // per thread priority, CPU affinity and wakeup latency
+    void thread_info(ExpandingString &str) override;
+
     bool toneAlarm_init(uint8_t types) override { return _toneAlarm.init(); }
     void toneAlarm_set_buzzer_tone(float frequency, float volume, uint32_t duration_ms) override {
         _toneAlarm.set_buzzer_tone(frequency, volume, duration_ms);
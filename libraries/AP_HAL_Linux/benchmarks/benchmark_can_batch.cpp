@@ -0,0 +1,124 @@
+#include <AP_gbenchmark.h>
+#include <AP_HAL/AP_HAL.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX && HAL_NUM_CAN_IFACES
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/can.h>
+
+#include <AP_HAL_Linux/CANSocketIface.h>
+
+using namespace Linux;
+
+/*
+  a CAN interface on one end of a socket pair, standing in for a
+  SocketCAN interface. The bus end is drained by the benchmark
+ */
+class BenchCANIface final : public CANIface {
+public:
+    BenchCANIface(uint8_t max_tx_inflight)
+        : CANIface(0, max_tx_inflight)
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, fds);
+        const int on = 1;
+        setsockopt(fds[0], SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+        _init_socket(fds[0]);
+        bus_fd = fds[1];
+    }
+
+    ~BenchCANIface()
+    {
+        close(bus_fd);
+    }
+
+    // read and confirm everything on the bus, as loopback would
+    uint16_t drain_bus()
+    {
+        can_frame frame;
+        uint16_t n = 0;
+        while (::read(bus_fd, &frame, sizeof(frame)) == sizeof(frame)) {
+            _confirmSentFrame();
+            n++;
+        }
+        return n;
+    }
+
+    void service()
+    {
+        _poll(true, true);
+    }
+
+    int bus_fd;
+};
+
+/*
+  send a burst of range(0) ESC commands, as AP_UAVCAN does each loop,
+  with at most range(1) frames in the socket. A range(1) of 1 is one
+  frame per system call
+ */
+static void BM_CANSendBurst(benchmark::State& state)
+{
+    BenchCANIface *iface = new BenchCANIface(state.range(1));
+    const uint16_t burst = state.range(0);
+    const uint8_t data[8] {};
+
+    while (state.KeepRunning()) {
+        const uint64_t deadline = AP_HAL::native_micros64() + 100000U;
+        for (uint16_t i = 0; i < burst; i++) {
+            iface->send(AP_HAL::CANFrame((0x1400 + i) | AP_HAL::CANFrame::FlagEFF, data, sizeof(data)), deadline, 0);
+        }
+        uint16_t sent = 0;
+        while (sent < burst) {
+            sent += iface->drain_bus();
+            iface->service();
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * burst);
+
+    delete iface;
+}
+
+BENCHMARK(BM_CANSendBurst)
+    ->ArgPair(8, 1)
+    ->ArgPair(8, 8)
+    ->ArgPair(32, 1)
+    ->ArgPair(32, 16);
+
+/*
+  receive range(0) frames waiting on the socket
+ */
+static void BM_CANReceive(benchmark::State& state)
+{
+    BenchCANIface *iface = new BenchCANIface(HAL_LINUX_CAN_TX_INFLIGHT_MAX);
+    const uint16_t count = state.range(0);
+    can_frame frame {};
+    frame.can_dlc = 8;
+
+    AP_HAL::CANFrame rx_frame;
+    uint64_t timestamp_us;
+    AP_HAL::CANIface::CanIOFlags flags;
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        for (uint16_t i = 0; i < count; i++) {
+            frame.can_id = (0x1400 + i) | CAN_EFF_FLAG;
+            ::write(iface->bus_fd, &frame, sizeof(frame));
+        }
+        state.ResumeTiming();
+        for (uint16_t i = 0; i < count; i++) {
+            iface->receive(rx_frame, timestamp_us, flags);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+
+    delete iface;
+}
+
+BENCHMARK(BM_CANReceive)->Arg(1)->Arg(32);
+
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,130 @@
+#include <AP_gbenchmark.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Storage.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define MISSION_ITEMS 1000
+#define MISSION_ITEM_SIZE 15
+// the IO thread runs the storage tick at 50Hz
+#define TICK_USEC 20000
+
+class BenchStorage final : public Storage {
+public:
+    BenchStorage(const char *dpath) { _init(dpath); }
+    bool dirty() const { return _dirty_mask != 0; }
+    uint32_t records() const { return _journal_seq; }
+};
+
+static void upload_mission(Storage *storage, uint32_t n)
+{
+    uint8_t item[MISSION_ITEM_SIZE];
+    for (uint16_t i = 0; i < MISSION_ITEMS; i++) {
+        memset(item, uint8_t(n + i), sizeof(item));
+        storage->write_block(i * MISSION_ITEM_SIZE, item, sizeof(item));
+    }
+}
+
+/*
+  time from the start of a 1000 item mission upload until it is on
+  disk, with the storage tick run as often as the IO thread runs it
+ */
+static void BM_MissionPersistJournal(benchmark::State& state)
+{
+    char dpath[] = "/tmp/ap_storage_XXXXXX";
+    if (mkdtemp(dpath) == nullptr) {
+        state.SkipWithError("mkdtemp failed");
+        return;
+    }
+    // allocated as Storage relies on new zeroing the memory
+    BenchStorage *storage = new BenchStorage(dpath);
+
+    uint32_t n = 0;
+    const uint32_t records_start = storage->records();
+    while (state.KeepRunning()) {
+        upload_mission(storage, n++);
+        while (storage->dirty()) {
+            usleep(TICK_USEC);
+            storage->_timer_tick();
+        }
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "%.1f fdatasync per upload",
+             double(storage->records() - records_start) / n);
+    state.SetLabel(label);
+
+    delete storage;
+    char cmd[64];
+    snprintf(cmd, sizeof(cmd), "rm -rf %s", dpath);
+    if (system(cmd) != 0) {
+        state.SkipWithError("cleanup failed");
+    }
+}
+
+/*
+  the same with the previous scheme, which wrote the first dirty 512
+  byte line each tick and called fsync once no lines were dirty
+ */
+static void BM_MissionPersistLineByLine(benchmark::State& state)
+{
+    char path[] = "/tmp/ap_storage_XXXXXX";
+    const int fd = mkstemp(path);
+    if (fd == -1 || ftruncate(fd, LINUX_STORAGE_SIZE) != 0) {
+        state.SkipWithError("mkstemp failed");
+        return;
+    }
+
+    uint8_t *buffer = new uint8_t[LINUX_STORAGE_SIZE];
+    uint32_t n = 0;
+    uint32_t fsyncs = 0;
+    while (state.KeepRunning()) {
+        uint32_t dirty_mask = 0;
+        uint8_t item[MISSION_ITEM_SIZE];
+        for (uint16_t i = 0; i < MISSION_ITEMS; i++) {
+            const uint16_t loc = i * MISSION_ITEM_SIZE;
+            memset(item, uint8_t(n + i), sizeof(item));
+            memcpy(&buffer[loc], item, sizeof(item));
+            for (uint8_t line = loc >> LINUX_STORAGE_LINE_SHIFT;
+                 line <= (loc + sizeof(item) - 1) >> LINUX_STORAGE_LINE_SHIFT; line++) {
+                dirty_mask |= 1U << line;
+            }
+        }
+        n++;
+        while (dirty_mask != 0) {
+            usleep(TICK_USEC);
+            const uint8_t line = __builtin_ctz(dirty_mask);
+            const off_t ofs = line << LINUX_STORAGE_LINE_SHIFT;
+            if (pwrite(fd, &buffer[ofs], LINUX_STORAGE_LINE_SIZE, ofs) != LINUX_STORAGE_LINE_SIZE) {
+                state.SkipWithError("write failed");
+                break;
+            }
+            dirty_mask &= ~(1U << line);
+            if (dirty_mask == 0) {
+                fsync(fd);
+                fsyncs++;
+            }
+        }
+    }
+
+    char label[64];
+    snprintf(label, sizeof(label), "%.1f fsync per upload", double(fsyncs) / n);
+    state.SetLabel(label);
+
+    delete[] buffer;
+    close(fd);
+    unlink(path);
+}
+
+BENCHMARK(BM_MissionPersistJournal)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_MissionPersistLineByLine)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,125 @@
+#include <AP_gbenchmark.h>
+
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Thread.h>
+#include <AP_Math/AP_Math.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define MAX_LOAD_THREADS 16
+
+/*
+  a thread spinning on the CPUs it is given, standing in for the
+  rest of the vehicle code and the system
+ */
+class LoadThread : public Thread {
+public:
+    LoadThread() : Thread(nullptr) { }
+
+    volatile bool running = true;
+    volatile uint64_t spins;
+
+protected:
+    bool _run() override {
+        while (running) {
+            spins++;
+        }
+        return true;
+    }
+};
+
+static uint64_t timespec_nsec(const struct timespec &ts)
+{
+    return uint64_t(ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+  wakeup latency of a 1kHz loop like the main loop, with range_x() spinning
+  threads competing for the CPUs. With range_y() set the loop is pinned to
+  the last CPU and the load to the others, as with --cpu-affinity and
+  --thread-affinity main=N on a CPU isolated with isolcpus=N. The reported
+  time is one period plus the wakeup latency; the label has the latencies
+ */
+static void BM_PeriodicWakeup(benchmark::State& state)
+{
+    const long n_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    const bool pinned = state.range_y() != 0 && n_cpus > 1;
+    cpu_set_t load_cpus, loop_cpus, saved_cpus;
+    CPU_ZERO(&load_cpus);
+    CPU_ZERO(&loop_cpus);
+    for (long cpu = 0; cpu < n_cpus - 1; cpu++) {
+        CPU_SET(cpu, &load_cpus);
+    }
+    CPU_SET(n_cpus - 1, &loop_cpus);
+
+    pthread_getaffinity_np(pthread_self(), sizeof(saved_cpus), &saved_cpus);
+    if (pinned) {
+        pthread_setaffinity_np(pthread_self(), sizeof(loop_cpus), &loop_cpus);
+    }
+
+    LoadThread *load[MAX_LOAD_THREADS] {};
+    const uint8_t n_load = MIN(state.range_x(), MAX_LOAD_THREADS);
+    for (uint8_t i = 0; i < n_load; i++) {
+        load[i] = new LoadThread();
+        if (pinned) {
+            load[i]->set_cpu_affinity(load_cpus);
+        }
+        load[i]->start("load", SCHED_OTHER, 0);
+    }
+
+    const uint64_t period_nsec = 1000000;
+    uint64_t late_max_nsec = 0;
+    uint64_t late_sum_nsec = 0;
+    uint32_t wakeups = 0;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (state.KeepRunning()) {
+        next.tv_nsec += period_nsec;
+        if (next.tv_nsec >= 1000000000) {
+            next.tv_nsec -= 1000000000;
+            next.tv_sec++;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, nullptr) == EINTR) { }
+
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const uint64_t late_nsec = timespec_nsec(now) - timespec_nsec(next);
+        late_max_nsec = MAX(late_max_nsec, late_nsec);
+        late_sum_nsec += late_nsec;
+        wakeups++;
+
+        // don't let one long stall turn into a burst of catch up wakeups
+        if (late_nsec > period_nsec) {
+            next = now;
+        }
+    }
+
+    for (uint8_t i = 0; i < n_load; i++) {
+        load[i]->running = false;
+        load[i]->join();
+        delete load[i];
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(saved_cpus), &saved_cpus);
+
+    char label[64];
+    snprintf(label, sizeof(label), "late avg %uus max %uus",
+             unsigned(wakeups ? late_sum_nsec / wakeups / 1000 : 0),
+             unsigned(late_max_nsec / 1000));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_PeriodicWakeup)
+    ->ArgPair(0, 0)
+    ->ArgPair(4, 0)
+    ->ArgPair(4, 1)
+    ->ArgPair(16, 0)
+    ->ArgPair(16, 1);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+#include <AP_gbenchmark.h>
+
+#include <atomic>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Poller.h>
+#include <AP_Math/AP_Math.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  delivery latency and CPU cost of servicing a serial device, either
+  polled by a 100Hz tick as the UART thread used to or woken by the
+  Poller when the device is readable. A datagram socket pair stands in
+  for the device.
+ */
+class ServiceThread : public Pollable {
+public:
+    ServiceThread(int fd, bool events) : Pollable(fd), _events(events) { }
+
+    // the file descriptor belongs to the benchmark
+    ~ServiceThread() { _fd = -1; }
+
+    void on_can_read() override { _read(); }
+
+    void start() { pthread_create(&_ctx, nullptr, &ServiceThread::_run, this); }
+
+    void stop()
+    {
+        _should_exit = true;
+        _poller.wakeup();
+        pthread_join(_ctx, nullptr);
+    }
+
+    std::atomic<uint32_t> received{0};
+    uint32_t reads;
+    struct timespec cpu_time;
+
+private:
+    static void *_run(void *arg)
+    {
+        ServiceThread *t = static_cast<ServiceThread *>(arg);
+        if (t->_events) {
+            t->_poller.register_pollable(t, EPOLLIN);
+        }
+        while (!t->_should_exit) {
+            if (t->_events) {
+                t->_poller.poll();
+            } else {
+                usleep(10000);
+                t->_read();
+            }
+        }
+        if (t->_events) {
+            t->_poller.unregister_pollable(t);
+        }
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t->cpu_time);
+        return nullptr;
+    }
+
+    void _read()
+    {
+        uint8_t buf[64];
+        while (true) {
+            reads++;
+            if (::recv(_fd, buf, sizeof(buf), MSG_DONTWAIT) <= 0) {
+                break;
+            }
+            received++;
+        }
+    }
+
+    Poller _poller;
+    pthread_t _ctx;
+    bool _events;
+    volatile bool _should_exit;
+};
+
+static void BM_UARTServiceLatency(benchmark::State& state)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) < 0) {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+
+    // allocated as the statistics rely on new zeroing the memory
+    ServiceThread *t = new ServiceThread(fds[1], state.range_x() != 0);
+    t->start();
+
+    const uint8_t msg[32] {};
+    uint32_t sent = 0;
+    while (state.KeepRunning()) {
+        if (::send(fds[0], msg, sizeof(msg), 0) != sizeof(msg)) {
+            state.SkipWithError("send failed");
+            break;
+        }
+        sent++;
+        while (t->received != sent) {
+            sched_yield();
+        }
+    }
+
+    t->stop();
+
+    char label[64];
+    snprintf(label, sizeof(label), "%s: %.2f reads, %.1fus CPU per message",
+             state.range_x() ? "events" : "polled",
+             sent ? double(t->reads) / sent : 0.0,
+             sent ? (t->cpu_time.tv_sec * 1e6 + t->cpu_time.tv_nsec * 1e-3) / sent : 0.0);
+    state.SetLabel(label);
+
+    delete t;
+    close(fds[0]);
+    close(fds[1]);
+}
+
+BENCHMARK(BM_UARTServiceLatency)->Arg(0)->Arg(1)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,126 @@
+#include <AP_gbenchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/UDPDevice.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define PACKET_LEN 100
+#define DEVICE_PORT 24550
+
+/*
+  a fan-out UDP device on the loopback interface, with clients that
+  have each sent it one datagram. Loopback drops what the clients
+  don't read, so they are never drained
+ */
+class LoopbackLink {
+public:
+    LoopbackLink(uint8_t n_clients)
+    {
+        device = new UDPDevice("127.0.0.1", DEVICE_PORT, false, true, true);
+        device->open();
+        device->set_blocking(false);
+
+        struct sockaddr_in dest {};
+        SocketAPM::make_sockaddr("127.0.0.1", DEVICE_PORT, dest);
+        for (uint8_t i = 0; i < n_clients; i++) {
+            clients[i] = socket(AF_INET, SOCK_DGRAM, 0);
+            sendto(clients[i], "hi", 2, 0, (struct sockaddr *)&dest, sizeof(dest));
+        }
+        this->n_clients = n_clients;
+
+        uint8_t buf[16];
+        usleep(1000);
+        while (device->read(buf, sizeof(buf)) > 0) { }
+    }
+
+    ~LoopbackLink()
+    {
+        for (uint8_t i = 0; i < n_clients; i++) {
+            close(clients[i]);
+        }
+        delete device;
+    }
+
+    UDPDevice *device;
+    int clients[UDPDEVICE_FANOUT_MAX_CLIENTS];
+    uint8_t n_clients;
+};
+
+/*
+  send MAVLink sized packets, range_x() per call to the device, to
+  range_y() clients. range_x() of 1 to one client is the cost of the
+  one datagram per system call the device used to make
+ */
+static void BM_UDPSend(benchmark::State& state)
+{
+    LoopbackLink link(state.range_y());
+    const uint8_t batch = state.range_x();
+
+    uint8_t buf[UDPDEVICE_BATCH_MAX * PACKET_LEN] {};
+    uint16_t lens[UDPDEVICE_BATCH_MAX];
+    for (uint8_t i = 0; i < batch; i++) {
+        lens[i] = PACKET_LEN;
+    }
+
+    while (state.KeepRunning()) {
+        if (link.device->write_datagrams(buf, lens, batch) != batch) {
+            state.SkipWithError("send failed");
+            break;
+        }
+    }
+
+    // packets delivered to a client, one system call per iteration
+    const uint32_t packets = batch * link.n_clients;
+    state.SetItemsProcessed(state.iterations() * packets);
+    state.SetBytesProcessed(state.iterations() * packets * PACKET_LEN);
+    char label[32];
+    snprintf(label, sizeof(label), "%u packets per syscall", unsigned(packets));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_UDPSend)
+    ->ArgPair(1, 1)
+    ->ArgPair(8, 1)
+    ->ArgPair(1, 3)
+    ->ArgPair(8, 3);
+
+/*
+  send coalesced datagrams of 14 MAVLink sized packets, in batches of
+  range_x() datagrams
+ */
+static void BM_UDPSendCoalesced(benchmark::State& state)
+{
+    LoopbackLink link(1);
+    const uint8_t batch = state.range_x();
+    const uint8_t packets_per_datagram = 14;
+
+    uint8_t buf[UDPDEVICE_BATCH_MAX * packets_per_datagram * PACKET_LEN] {};
+    uint16_t lens[UDPDEVICE_BATCH_MAX];
+    for (uint8_t i = 0; i < batch; i++) {
+        lens[i] = packets_per_datagram * PACKET_LEN;
+    }
+
+    while (state.KeepRunning()) {
+        if (link.device->write_datagrams(buf, lens, batch) != batch) {
+            state.SkipWithError("send failed");
+            break;
+        }
+    }
+
+    const uint32_t packets = batch * packets_per_datagram;
+    state.SetItemsProcessed(state.iterations() * packets);
+    state.SetBytesProcessed(state.iterations() * packets * PACKET_LEN);
+    char label[32];
+    snprintf(label, sizeof(label), "%u packets per syscall", unsigned(packets));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_UDPSendCoalesced)->Arg(1)->Arg(8);
+
+BENCHMARK_MAIN();
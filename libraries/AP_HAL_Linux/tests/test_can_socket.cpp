@@ -0,0 +1,270 @@
+#include <AP_gtest.h>
+#include <AP_HAL/AP_HAL.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if CONFIG_HAL_BOARD == HAL_BOARD_LINUX && HAL_NUM_CAN_IFACES
+
+#include <pthread.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/can.h>
+
+#include <AP_Common/ExpandingString.h>
+#include <AP_HAL/EventHandle.h>
+#include <AP_HAL_Linux/CANSocketIface.h>
+
+using namespace Linux;
+
+/*
+  a CAN interface on one end of a socket pair, the test is the bus on
+  the other end. The stand-in has no loopback, so the test confirms
+  the frames it reads
+ */
+class TestCANIface final : public CANIface {
+public:
+    TestCANIface(uint8_t max_tx_inflight)
+        : CANIface(0, max_tx_inflight)
+    {
+        int fds[2];
+        socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0, fds);
+        const int on = 1;
+        setsockopt(fds[0], SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+        _init_socket(fds[0]);
+        bus_fd = fds[1];
+        mode_ = NormalMode;
+    }
+
+    ~TestCANIface()
+    {
+        close(bus_fd);
+    }
+
+    // write any frames the socket has room for
+    void service()
+    {
+        _poll(true, true);
+    }
+
+    // read the frames written to the bus, confirming each as loopback would
+    uint16_t read_bus(can_frame *frames, uint16_t max)
+    {
+        uint16_t n = 0;
+        while (n < max && ::read(bus_fd, &frames[n], sizeof(frames[n])) == sizeof(frames[n])) {
+            _confirmSentFrame();
+            n++;
+        }
+        return n;
+    }
+
+    void write_bus(uint32_t can_id)
+    {
+        can_frame frame {};
+        frame.can_id = can_id | CAN_EFF_FLAG;
+        frame.can_dlc = 1;
+        ::write(bus_fd, &frame, sizeof(frame));
+    }
+
+    void set_filtered()
+    {
+        mode_ = FilteredMode;
+    }
+
+    uint32_t get_stat(const char *name)
+    {
+        // allocated as ExpandingString relies on new zeroing the memory
+        ExpandingString *str = new ExpandingString();
+        get_stats(*str);
+        const char *p = strstr(str->get_string(), name);
+        const uint32_t ret = p == nullptr ? UINT32_MAX : strtoul(p + strlen(name) + 1, nullptr, 10);
+        delete str;
+        return ret;
+    }
+
+    int bus_fd;
+};
+
+static AP_HAL::CANFrame make_frame(uint32_t id)
+{
+    const uint8_t data[1] {};
+    return AP_HAL::CANFrame(id | AP_HAL::CANFrame::FlagEFF, data, sizeof(data));
+}
+
+static uint64_t deadline()
+{
+    return AP_HAL::native_micros64() + 1000000U;
+}
+
+/*
+  frames queued behind a full socket go out in priority order, as many
+  in one write as the socket has room for
+ */
+TEST(CANSocketIface, BatchedPriorityWrite)
+{
+    TestCANIface *iface = new TestCANIface(4);
+
+    // the first four fill the socket queue, the rest wait
+    for (uint32_t id = 100; id < 110; id++) {
+        EXPECT_EQ(iface->send(make_frame(id), deadline(), 0), 1);
+    }
+    can_frame frames[16];
+    ASSERT_EQ(iface->read_bus(frames, 16), 4);
+    for (uint8_t i = 0; i < 4; i++) {
+        EXPECT_EQ(frames[i].can_id & CAN_EFF_MASK, 100U + i);
+    }
+
+    // a high priority frame overtakes the waiting ones, and the four
+    // highest priority frames are written together
+    const uint32_t batches = iface->get_stat("tx_batches:");
+    EXPECT_EQ(iface->send(make_frame(50), deadline(), 0), 1);
+    ASSERT_EQ(iface->read_bus(frames, 16), 4);
+    EXPECT_EQ(frames[0].can_id & CAN_EFF_MASK, 50U);
+    for (uint8_t i = 1; i < 4; i++) {
+        EXPECT_EQ(frames[i].can_id & CAN_EFF_MASK, 103U + i);
+    }
+    EXPECT_EQ(iface->get_stat("tx_batches:"), batches + 1);
+
+    delete iface;
+}
+
+/*
+  frames past their deadline are never written, and make room in a
+  full queue
+ */
+TEST(CANSocketIface, DeadlineDropping)
+{
+    TestCANIface *iface = new TestCANIface(1);
+
+    // one in the socket, the queue full behind it with every other
+    // frame about to expire
+    for (uint16_t i = 0; i <= HAL_LINUX_CAN_TX_QUEUE_LEN; i++) {
+        const uint64_t frame_deadline = (i % 2) ? AP_HAL::native_micros64() + 2000 : deadline();
+        EXPECT_EQ(iface->send(make_frame(i), frame_deadline, 0), 1);
+    }
+    EXPECT_EQ(iface->send(make_frame(1000), deadline(), 0), 0);
+    usleep(3000);
+
+    // the expired half of the queue makes room for more
+    for (uint16_t i = 0; i < HAL_LINUX_CAN_TX_QUEUE_LEN / 2; i++) {
+        EXPECT_EQ(iface->send(make_frame(2000 + i), deadline(), 0), 1);
+    }
+    EXPECT_EQ(iface->send(make_frame(3000), deadline(), 0), 0);
+    EXPECT_EQ(iface->get_stat("tx_queue_full:"), 2U);
+    EXPECT_EQ(iface->get_stat("tx_timedout:"), HAL_LINUX_CAN_TX_QUEUE_LEN / 2U);
+
+    // none of the expired frames reach the bus
+    can_frame frames[16];
+    uint16_t total = 0;
+    uint16_t n;
+    do {
+        n = iface->read_bus(frames, 16);
+        for (uint16_t i = 0; i < n; i++) {
+            const uint32_t id = frames[i].can_id & CAN_EFF_MASK;
+            EXPECT_TRUE(id >= 2000 || id % 2 == 0) << id;
+        }
+        total += n;
+        iface->service();
+    } while (n > 0);
+    EXPECT_EQ(total, HAL_LINUX_CAN_TX_QUEUE_LEN + 1);
+
+    delete iface;
+}
+
+/*
+  frames waiting on the socket are read together, in order, with the
+  time they arrived rather than the time they were read
+ */
+TEST(CANSocketIface, BatchedReceive)
+{
+    TestCANIface *iface = new TestCANIface(4);
+    const uint64_t start_us = AP_HAL::native_micros64();
+    for (uint32_t id = 0; id < 40; id++) {
+        iface->write_bus(id);
+    }
+    usleep(5000);
+
+    AP_HAL::CANFrame frame;
+    uint64_t timestamp_us;
+    AP_HAL::CANIface::CanIOFlags flags;
+    for (uint32_t id = 0; id < 40; id++) {
+        ASSERT_EQ(iface->receive(frame, timestamp_us, flags), 1);
+        EXPECT_EQ(frame.id & AP_HAL::CANFrame::MaskExtID, id);
+        EXPECT_TRUE(frame.isExtended());
+        EXPECT_GE(timestamp_us + 100, start_us);
+        EXPECT_LT(timestamp_us, start_us + 4000);
+    }
+    EXPECT_EQ(iface->receive(frame, timestamp_us, flags), 0);
+    EXPECT_EQ(iface->get_stat("rx_batches:"), 3U);
+    EXPECT_EQ(iface->get_stat("rx_received:"), 40U);
+
+    delete iface;
+}
+
+/*
+  frames rejected by the filters don't stop the ones behind them being read
+ */
+TEST(CANSocketIface, FilteredReceive)
+{
+    TestCANIface *iface = new TestCANIface(4);
+    iface->set_filtered();
+    AP_HAL::CANIface::CanFilterConfig filter;
+    filter.id = 7 | AP_HAL::CANFrame::FlagEFF;
+    filter.mask = 0xFF | AP_HAL::CANFrame::FlagEFF;
+    ASSERT_TRUE(iface->configureFilters(&filter, 1));
+
+    for (uint32_t i = 0; i < 40; i++) {
+        iface->write_bus(i * 0x100 + (i == 35 ? 7 : 8));
+    }
+
+    AP_HAL::CANFrame frame;
+    uint64_t timestamp_us;
+    AP_HAL::CANIface::CanIOFlags flags;
+    ASSERT_EQ(iface->receive(frame, timestamp_us, flags), 1);
+    EXPECT_EQ(frame.id & AP_HAL::CANFrame::MaskExtID, 35U * 0x100 + 7);
+    EXPECT_EQ(iface->receive(frame, timestamp_us, flags), 0);
+
+    delete iface;
+}
+
+static void *signal_thread(void *arg)
+{
+    usleep(20000);
+    ((AP_HAL::EventHandle *)arg)->get_source()->signal(0);
+    return nullptr;
+}
+
+/*
+  a signal from another thread ends a wait on an idle bus early, so a
+  driver thread can be woken with new outputs
+ */
+TEST(CANSocketIface, SignalWakesWait)
+{
+    static HAL_EventHandle handle;
+    TestCANIface *iface = new TestCANIface(4);
+    ASSERT_TRUE(iface->set_event_handle(&handle));
+
+    bool read = true;
+    bool write = false;
+    const uint64_t start_us = AP_HAL::native_micros64();
+    iface->select(read, write, nullptr, start_us + 10000);
+    EXPECT_GE(AP_HAL::native_micros64() - start_us, 10000U);
+
+    read = true;
+    write = false;
+    pthread_t thread;
+    ASSERT_EQ(pthread_create(&thread, nullptr, signal_thread, &handle), 0);
+    const uint64_t wait_us = AP_HAL::native_micros64();
+    iface->select(read, write, nullptr, wait_us + 1000000);
+    const uint64_t waited_us = AP_HAL::native_micros64() - wait_us;
+    pthread_join(thread, nullptr);
+    EXPECT_GE(waited_us, 15000U);
+    EXPECT_LT(waited_us, 500000U);
+    EXPECT_FALSE(read);
+
+    delete iface;
+}
+
+#endif
+
+AP_GTEST_MAIN()
@@ -0,0 +1,243 @@
+#include <AP_gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_HAL_Linux/Storage.h>
+
+using namespace Linux;
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  storage in a directory of its own, with the journal writes done on
+  demand rather than by the IO thread
+ */
+class TestStorage final : public Storage {
+public:
+    TestStorage(const char *dpath)
+    {
+        _init(dpath);
+    }
+
+    ~TestStorage()
+    {
+        close(_fd);
+        close(_journal_fd);
+        close(_dir_fd);
+    }
+
+    bool flush()
+    {
+        const uint32_t write_mask = _dirty_mask.exchange(0);
+        if (!_journal_append(write_mask)) {
+            _dirty_mask |= write_mask;
+            return false;
+        }
+        return true;
+    }
+
+    bool compact()
+    {
+        return _journal_compact();
+    }
+
+    uint32_t journal_size() const { return _journal_size; }
+
+    // make the system calls a bad card can fail
+    bool fail_dir_sync = false;
+    bool fail_datasync = false;
+    bool fail_truncate = false;
+
+protected:
+    int _fsync_dir() override
+    {
+        return fail_dir_sync ? -1 : Storage::_fsync_dir();
+    }
+
+    int _fdatasync(int fd) override
+    {
+        return fail_datasync ? -1 : Storage::_fdatasync(fd);
+    }
+
+    int _ftruncate_journal() override
+    {
+        return fail_truncate ? -1 : Storage::_ftruncate_journal();
+    }
+};
+
+class LinuxStorage : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        strcpy(dpath, "/tmp/ap_storage_XXXXXX");
+        ASSERT_NE(mkdtemp(dpath), nullptr);
+        snprintf(journal, sizeof(journal), "%s/%s.stj", dpath, SKETCHNAME);
+    }
+
+    void TearDown() override
+    {
+        char cmd[64];
+        snprintf(cmd, sizeof(cmd), "rm -rf %s", dpath);
+        EXPECT_EQ(system(cmd), 0);
+    }
+
+    void fill(TestStorage *storage, uint8_t value, uint16_t loc, uint16_t n)
+    {
+        uint8_t buf[n];
+        memset(buf, value, n);
+        storage->write_block(loc, buf, n);
+    }
+
+    void expect_filled(TestStorage *storage, uint8_t value, uint16_t loc, uint16_t n)
+    {
+        uint8_t buf[n];
+        storage->read_block(buf, loc, n);
+        for (uint16_t i = 0; i < n; i++) {
+            ASSERT_EQ(buf[i], value) << "at " << loc + i;
+        }
+    }
+
+    off_t file_size(const char *path)
+    {
+        struct stat st;
+        return stat(path, &st) == 0 ? st.st_size : -1;
+    }
+
+    char dpath[32];
+    char journal[64];
+};
+
+TEST_F(LinuxStorage, journal_replay)
+{
+    // allocated as Storage relies on new zeroing the memory
+    TestStorage *storage = new TestStorage(dpath);
+    fill(storage, 0x11, 100, 2000);
+    fill(storage, 0x22, 15000, 1384);
+    EXPECT_TRUE(storage->flush());
+    delete storage;
+
+    storage = new TestStorage(dpath);
+    expect_filled(storage, 0, 0, 100);
+    expect_filled(storage, 0x11, 100, 2000);
+    expect_filled(storage, 0x22, 15000, 1384);
+    delete storage;
+}
+
+TEST_F(LinuxStorage, torn_record_ignored)
+{
+    TestStorage *storage = new TestStorage(dpath);
+    fill(storage, 0x11, 0, 600);
+    EXPECT_TRUE(storage->flush());
+    const off_t first_record = file_size(journal);
+    fill(storage, 0x22, 0, 600);
+    EXPECT_TRUE(storage->flush());
+    delete storage;
+
+    // lose the end of the second record, as a power loss might
+    ASSERT_EQ(truncate(journal, file_size(journal) - 100), 0);
+
+    storage = new TestStorage(dpath);
+    expect_filled(storage, 0x11, 0, 600);
+    EXPECT_EQ(file_size(journal), first_record);
+
+    // new records follow the last complete one
+    fill(storage, 0x33, 1000, 10);
+    EXPECT_TRUE(storage->flush());
+    delete storage;
+
+    storage = new TestStorage(dpath);
+    expect_filled(storage, 0x11, 0, 600);
+    expect_filled(storage, 0x33, 1000, 10);
+    delete storage;
+}
+
+TEST_F(LinuxStorage, compaction)
+{
+    TestStorage *storage = new TestStorage(dpath);
+    for (uint16_t i = 0; i < 100; i++) {
+        fill(storage, i, (i * 997) % (LINUX_STORAGE_SIZE - 100), 100);
+        EXPECT_TRUE(storage->flush());
+    }
+    EXPECT_TRUE(storage->compact());
+    EXPECT_EQ(file_size(journal), LINUX_STORAGE_SIZE + 16);
+
+    uint8_t expected[LINUX_STORAGE_SIZE];
+    storage->read_block(expected, 0, sizeof(expected));
+    fill(storage, 0x44, 5000, 10);
+    EXPECT_TRUE(storage->flush());
+    delete storage;
+
+    storage = new TestStorage(dpath);
+    memset(&expected[5000], 0x44, 10);
+    uint8_t buf[LINUX_STORAGE_SIZE];
+    storage->read_block(buf, 0, sizeof(buf));
+    EXPECT_EQ(memcmp(buf, expected, sizeof(buf)), 0);
+    delete storage;
+}
+
+TEST_F(LinuxStorage, compaction_dir_sync_fails)
+{
+    TestStorage *storage = new TestStorage(dpath);
+    fill(storage, 0x11, 0, 1000);
+    EXPECT_TRUE(storage->flush());
+
+    // the rename happened, so the new journal is used even though the
+    // directory could not be synced
+    storage->fail_dir_sync = true;
+    EXPECT_TRUE(storage->compact());
+    EXPECT_EQ(file_size(journal), LINUX_STORAGE_SIZE + 16);
+    EXPECT_FALSE(storage->flushed());
+
+    // nothing is added to it until the directory is on disk
+    fill(storage, 0x22, 2000, 100);
+    EXPECT_FALSE(storage->flush());
+    EXPECT_EQ(file_size(journal), LINUX_STORAGE_SIZE + 16);
+
+    storage->fail_dir_sync = false;
+    fill(storage, 0x22, 2000, 100);
+    EXPECT_TRUE(storage->flush());
+    EXPECT_TRUE(storage->flushed());
+    delete storage;
+
+    storage = new TestStorage(dpath);
+    expect_filled(storage, 0x11, 0, 1000);
+    expect_filled(storage, 0x22, 2000, 100);
+    delete storage;
+}
+
+TEST_F(LinuxStorage, append_truncate_fails)
+{
+    TestStorage *storage = new TestStorage(dpath);
+    fill(storage, 0x11, 0, 600);
+    EXPECT_TRUE(storage->flush());
+    const off_t first_record = file_size(journal);
+
+    // a failed record that can't be cut off doesn't stop storage
+    storage->fail_datasync = true;
+    storage->fail_truncate = true;
+    fill(storage, 0x22, 1000, 2000);
+    EXPECT_FALSE(storage->flush());
+    EXPECT_GT(file_size(journal), first_record);
+    EXPECT_FALSE(storage->flushed());
+
+    // the retry is written over it
+    storage->fail_datasync = false;
+    fill(storage, 0x33, 5000, 10);
+    EXPECT_TRUE(storage->flush());
+    EXPECT_TRUE(storage->flushed());
+    EXPECT_EQ(file_size(journal), storage->journal_size());
+    delete storage;
+
+    storage = new TestStorage(dpath);
+    expect_filled(storage, 0x11, 0, 600);
+    expect_filled(storage, 0x22, 1000, 2000);
+    expect_filled(storage, 0x33, 5000, 10);
+    delete storage;
+}
+
+AP_GTEST_MAIN()
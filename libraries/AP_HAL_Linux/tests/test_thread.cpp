@@ -17,8 +17,10 @@
 #include <AP_gtest.h>
 
 #include <pthread.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <AP_Common/ExpandingString.h>
 #include <AP_HAL/AP_HAL.h>
 #include <AP_HAL_Linux/Thread.h>
 #include <AP_HAL_Linux/PollerThread.h>
@@ -117,4 +119,83 @@ TEST(LinuxThread, periodic_thread)
     EXPECT_TRUE(thr.join());
 }
 
+TEST(LinuxThread, cpu_set)
+{
+    cpu_set_t cpu_set;
+
+    EXPECT_TRUE(Thread::parse_cpu_set("0,2-4,7", cpu_set));
+    EXPECT_EQ(CPU_COUNT(&cpu_set), 5);
+    EXPECT_TRUE(CPU_ISSET(0, &cpu_set));
+    EXPECT_FALSE(CPU_ISSET(1, &cpu_set));
+    EXPECT_TRUE(CPU_ISSET(3, &cpu_set));
+    EXPECT_TRUE(CPU_ISSET(7, &cpu_set));
+
+    // allocated as ExpandingString relies on new zeroing the memory
+    ExpandingString *str = new ExpandingString();
+    Thread::print_cpu_set(*str, cpu_set);
+    EXPECT_STREQ(str->get_string(), "0,2-4,7");
+    delete str;
+
+    EXPECT_FALSE(Thread::parse_cpu_set("", cpu_set));
+    EXPECT_FALSE(Thread::parse_cpu_set("1,", cpu_set));
+    EXPECT_FALSE(Thread::parse_cpu_set("3-1", cpu_set));
+    EXPECT_FALSE(Thread::parse_cpu_set("a", cpu_set));
+    EXPECT_FALSE(Thread::parse_cpu_set("100000", cpu_set));
+}
+
+TEST(LinuxThread, periodic_thread_affinity)
+{
+    TestPeriodicThread1 thr;
+    cpu_set_t cpu_set;
+    ASSERT_TRUE(Thread::parse_cpu_set("0", cpu_set));
+    EXPECT_TRUE(thr.set_cpu_affinity(cpu_set));
+    EXPECT_TRUE(thr.set_rate(1000));
+    EXPECT_TRUE(thr.start("test", 0, 0));
+
+    while (!thr.is_started()) {
+        usleep(1000);
+    }
+
+    // this must fail as the thread already started
+    EXPECT_FALSE(thr.set_cpu_affinity(cpu_set));
+
+    while (thr.get_wakeup_stats().count == 0) {
+        usleep(1000);
+    }
+
+    ExpandingString *str = new ExpandingString();
+    Thread::threads_info(*str);
+    EXPECT_NE(strstr(str->get_string(), "test            PRI= 0 CPUS=0 "), nullptr);
+    delete str;
+
+    EXPECT_TRUE(thr.stop());
+    EXPECT_TRUE(thr.join());
+
+    // once the thread has exited its stack and handle are not used
+    str = new ExpandingString();
+    Thread::threads_info(*str);
+    EXPECT_NE(strstr(str->get_string(), "test            PRI= 0 CPUS=- STOPPED\n"), nullptr);
+    delete str;
+}
+
+TEST(LinuxThread, wakeup_stats)
+{
+    WakeupStats stats;
+    stats.record(10);
+    stats.record(30);
+    stats.record_overrun();
+
+    WakeupStats::Counts c = stats.get(true);
+    EXPECT_EQ(c.count, 2U);
+    EXPECT_EQ(c.late_max_us, 30U);
+    EXPECT_EQ(c.late_sum_us, 40U);
+    EXPECT_EQ(c.overruns, 1U);
+
+    // overruns are kept across resets
+    c = stats.get();
+    EXPECT_EQ(c.count, 0U);
+    EXPECT_EQ(c.late_max_us, 0U);
+    EXPECT_EQ(c.overruns, 1U);
+}
+
 AP_GTEST_MAIN()
@@ -60,6 +60,18 @@ uint16_t DSP::fft_analyse(AP_HAL::DSP::FFTWindowState* state, uint16_t start_bin
     return step_calc_frequencies(fft, start_bin, end_bin);
 }
 
+// window and transform samples without analysing them
+void DSP::fft_transform(AP_HAL::DSP::FFTWindowState* state, FloatBuffer& samples, uint16_t advance)
+{
+    FFTWindowStateSITL* fft = (FFTWindowStateSITL*)state;
+    step_hanning(fft, samples, advance);
+    step_fft(fft);
+    // calculate_fft() transforms with exp(+jwt), conjugate to match the ARM forward transform
+    for (uint16_t i = 1; i < fft->_window_size; i += 2) {
+        fft->_rfft_data[i] = -fft->_rfft_data[i];
+    }
+}
+
 // create an instance of the FFT state machine
 DSP::FFTWindowStateSITL::FFTWindowStateSITL(uint16_t window_size, uint16_t sample_rate, uint8_t harmonics)
     : AP_HAL::DSP::FFTWindowState::FFTWindowState(window_size, sample_rate, harmonics)
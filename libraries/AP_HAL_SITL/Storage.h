@@ -26,6 +26,7 @@ public:
 
     void _timer_tick(void) override;
     bool healthy(void) override;
+    bool flushed(void) override { return _dirty_mask.empty(); }
 
 private:
     volatile bool _initialised;
@@ -238,6 +238,29 @@ public:
     uint8_t get_primary_accel(void) const { return _primary_accel; }
     uint8_t get_primary_gyro(void) const { return _primary_gyro; }
 
+    /*
+      interface for consumers of gyro samples at the sensor rate, such
+      as the AHRS attitude predictor. Both calls are made with the
+      backend semaphore held, and only for the gyro instance the
+      consumer was set for: gyro_sample() from the sensor thread for
+      every sample, and gyro_frame_latched() from update() when the
+      samples accumulated so far are handed to the main loop as its
+      delta angle
+     */
+    class GyroSampleListener {
+    public:
+        virtual void gyro_sample(uint8_t instance, const Vector3f &delta_angle, const Vector3f &gyro_filtered,
+                                 float dt, uint64_t sample_us) = 0;
+        virtual void gyro_frame_latched(uint8_t instance) = 0;
+    };
+
+    // set the single consumer of gyro samples and the gyro it wants
+    // samples from, nullptr to remove it
+    void set_gyro_sample_listener(GyroSampleListener *listener, uint8_t instance) {
+        _gyro_sample_listener_instance = instance;
+        _gyro_sample_listener = listener;
+    }
+
     // Update the harmonic notch frequency
     void update_harmonic_notch_freq_hz(float scaled_freq);
     // Update the harmonic notch frequencies
@@ -611,6 +634,9 @@ private:
     uint8_t _primary_gyro;
     uint8_t _primary_accel;
 
+    GyroSampleListener *_gyro_sample_listener;
+    uint8_t _gyro_sample_listener_instance;
+
     // mask of accels and gyros which we will be actively using
     // and this should wait for in wait_for_sample()
     uint8_t _gyro_wait_mask;
@@ -288,6 +288,12 @@ void AP_InertialSensor_Backend::_notify_new_gyro_raw_sample(uint8_t instance,
         }
 
         _imu._new_gyro_data[instance] = true;
+
+        AP_InertialSensor::GyroSampleListener *listener = _imu._gyro_sample_listener;
+        if (listener != nullptr && instance == _imu._gyro_sample_listener_instance) {
+            listener->gyro_sample(instance, delta_angle + delta_coning,
+                                  _imu._gyro_filtered[instance], dt, sample_us);
+        }
     }
 
     if (!_imu.batchsampler.doing_post_filter_logging()) {
@@ -527,6 +533,10 @@ void AP_InertialSensor_Backend::update_gyro(uint8_t instance)
         _imu._gyro_raw[instance] = _imu._last_raw_gyro[instance] * _imu._gyro_raw_sampling_multiplier[instance];
 #endif
         _imu._new_gyro_data[instance] = false;
+        AP_InertialSensor::GyroSampleListener *listener = _imu._gyro_sample_listener;
+        if (listener != nullptr && instance == _imu._gyro_sample_listener_instance) {
+            listener->gyro_frame_latched(instance);
+        }
     }
 
     // possibly update filter frequency
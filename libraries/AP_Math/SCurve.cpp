@@ -187,6 +187,7 @@ void SCurve::set_speed_max(float speed_xy, float speed_up, float speed_down)
         segment[SEG_INIT].end_pos = segment[SEG_SPEED_CHANGE_END].end_pos;
 
         // set acceleration and change segments to current constant speed
+        eval_cache.valid = false;
         float Jt_out, At_out, Vt_out, Pt_out;
         get_jerk_accel_vel_pos_at_time(time, Jt_out, At_out, Vt_out, Pt_out);
         for (uint8_t i = SEG_INIT+1; i <= SEG_SPEED_CHANGE_END; i++) {
@@ -325,6 +326,9 @@ void SCurve::set_speed_max(float speed_xy, float speed_up, float speed_down)
         segment[i].end_pos += dP;
     }
 
+    // segments have been modified in place
+    eval_cache.valid = false;
+
     // catch calculation errors
     if (!valid()) {
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
@@ -405,6 +409,9 @@ float SCurve::set_origin_speed_max(float speed)
         segment[i].end_pos += dP;
     }
 
+    // segments have been modified in place
+    eval_cache.valid = false;
+
     // catch calculation errors
     if (!valid()) {
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
@@ -458,6 +465,9 @@ void SCurve::set_destination_speed_max(float speed)
         segment[i].end_pos += dP;
     }
 
+    // segments have been modified in place
+    eval_cache.valid = false;
+
     // catch calculation errors
     if (!valid()) {
 #if CONFIG_HAL_BOARD == HAL_BOARD_SITL
@@ -604,85 +614,151 @@ void SCurve::get_jerk_accel_vel_pos_at_time(float time_now, float &Jt_out, float
         return;
     }
 
-    SegmentType Jtype;
-    uint8_t pnt = num_segs;
-    float Jm, T0, A0, V0, P0;
-
     // find active segment at time_now
-    for (uint8_t i = 0; i < num_segs; i++) {
-        if (time_now < segment[num_segs - 1 - i].end_time) {
-            pnt = num_segs - 1 - i;
-        }
+    if (!eval_cache.valid || !(time_now >= eval_cache.time_min && time_now < eval_cache.time_max)) {
+        update_eval_cache(time_now);
     }
+
+    switch (eval_cache.seg_type) {
+    case SegmentType::CONSTANT_JERK:
+        calc_javp_for_segment_const_jerk(time_now - eval_cache.T0, Jt_out, At_out, Vt_out, Pt_out);
+        break;
+    case SegmentType::POSITIVE_JERK:
+        calc_javp_for_segment_incr_jerk(time_now - eval_cache.T0, Jt_out, At_out, Vt_out, Pt_out);
+        break;
+    case SegmentType::NEGATIVE_JERK:
+        calc_javp_for_segment_decr_jerk(time_now - eval_cache.T0, Jt_out, At_out, Vt_out, Pt_out);
+        break;
+    }
+    Pt_out = MAX(0.0f, Pt_out);
+}
+
+// find the segment active at time_now and load its coefficients into the evaluation cache
+// the active segment is the first segment that ends after time_now, or num_segs if time_now is past the end of the path
+void SCurve::update_eval_cache(float time_now) const
+{
+    uint8_t pnt;
+    float time_min;
+    if (eval_cache.valid && (time_now >= eval_cache.time_min)) {
+        // time has moved forward so all earlier segments have already ended
+        pnt = eval_cache.index;
+        time_min = eval_cache.time_min;
+    } else {
+        pnt = 0;
+        time_min = -FLT_MAX;
+    }
+    while ((pnt < num_segs) && !(time_now < segment[pnt].end_time)) {
+        time_min = MAX(time_min, segment[pnt].end_time);
+        pnt++;
+    }
+
+    eval_cache.valid = true;
+    eval_cache.index = pnt;
+    eval_cache.time_min = time_min;
+    eval_cache.time_max = (pnt < num_segs) ? segment[pnt].end_time : FLT_MAX;
+
+    float Jm, A0, V0, P0;
     if (pnt == 0) {
-        Jtype = SegmentType::CONSTANT_JERK;
+        eval_cache.seg_type = SegmentType::CONSTANT_JERK;
         Jm = 0.0f;
-        T0 = segment[pnt].end_time;
+        eval_cache.T0 = segment[pnt].end_time;
         A0 = segment[pnt].end_accel;
         V0 = segment[pnt].end_vel;
         P0 = segment[pnt].end_pos;
     } else if (pnt == num_segs) {
-        Jtype = SegmentType::CONSTANT_JERK;
+        eval_cache.seg_type = SegmentType::CONSTANT_JERK;
         Jm = 0.0f;
-        T0 = segment[pnt - 1].end_time;
+        eval_cache.T0 = segment[pnt - 1].end_time;
         A0 = segment[pnt - 1].end_accel;
         V0 = segment[pnt - 1].end_vel;
         P0 = segment[pnt - 1].end_pos;
     } else {
-        Jtype = segment[pnt].seg_type;
+        eval_cache.seg_type = segment[pnt].seg_type;
         Jm = segment[pnt].jerk_ref;
-        T0 = segment[pnt - 1].end_time;
+        eval_cache.T0 = segment[pnt - 1].end_time;
         A0 = segment[pnt - 1].end_accel;
         V0 = segment[pnt - 1].end_vel;
         P0 = segment[pnt - 1].end_pos;
     }
 
-    switch (Jtype) {
+    switch (eval_cache.seg_type) {
     case SegmentType::CONSTANT_JERK:
-        calc_javp_for_segment_const_jerk(time_now - T0, Jm, A0, V0, P0, Jt_out, At_out, Vt_out, Pt_out);
+        eval_cache.J0 = Jm;
+        eval_cache.J0_half = 0.5f * Jm;
+        eval_cache.J0_sixth = (1.0f / 6.0f) * Jm;
         break;
     case SegmentType::POSITIVE_JERK:
-        calc_javp_for_segment_incr_jerk(time_now - T0, jerk_time, Jm, A0, V0, P0, Jt_out, At_out, Vt_out, Pt_out);
-        break;
-    case SegmentType::NEGATIVE_JERK:
-        calc_javp_for_segment_decr_jerk(time_now - T0, jerk_time, Jm, A0, V0, P0, Jt_out, At_out, Vt_out, Pt_out);
+    case SegmentType::NEGATIVE_JERK: {
+        const float tj = jerk_time;
+        const float Alpha = Jm * 0.5f;
+        const float Beta = M_PI / tj;
+        eval_cache.J0 = Alpha;
+        eval_cache.J0_half = Alpha * 0.5f;
+        eval_cache.J0_sixth = Alpha / 6.0f;
+        eval_cache.beta = Beta;
+        eval_cache.J0_beta = Alpha / Beta;
+        eval_cache.J0_beta2 = Alpha / (Beta * Beta);
+        eval_cache.J0_beta3 = Alpha / (Beta * Beta * Beta);
+        if (eval_cache.seg_type == SegmentType::NEGATIVE_JERK) {
+            // offset the start state by the end state of the matching increasing jerk segment
+            const float AT = Alpha * tj;
+            const float VT = Alpha * ((tj * tj) * 0.5f - 2.0f / (Beta * Beta));
+            const float PT = Alpha * ((-1.0f / (Beta * Beta)) * tj + (1.0f / 6.0f) * (tj * tj * tj));
+            A0 -= AT;
+            V0 -= VT;
+            P0 -= PT;
+        }
         break;
     }
-    Pt_out = MAX(0.0f, Pt_out);
+    }
+    eval_cache.A0 = A0;
+    eval_cache.V0 = V0;
+    eval_cache.P0 = P0;
+    eval_cache.A0_half = 0.5f * A0;
 }
 
 // calculate the jerk, acceleration, velocity and position at time time_now when running the constant jerk time segment
-void SCurve::calc_javp_for_segment_const_jerk(float time_now, float J0, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const
+void SCurve::calc_javp_for_segment_const_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const
 {
+    const float J0 = eval_cache.J0;
+    const float A0 = eval_cache.A0;
+    const float V0 = eval_cache.V0;
+    const float P0 = eval_cache.P0;
     Jt = J0;
     At = A0 + J0 * time_now;
-    Vt = V0 + A0 * time_now + 0.5f * J0 * (time_now * time_now);
-    Pt = P0 + V0 * time_now + 0.5f * A0 * (time_now * time_now) + (1.0f / 6.0f) * J0 * (time_now * time_now * time_now);
+    Vt = V0 + A0 * time_now + eval_cache.J0_half * (time_now * time_now);
+    Pt = P0 + V0 * time_now + eval_cache.A0_half * (time_now * time_now) + eval_cache.J0_sixth * (time_now * time_now * time_now);
 }
 
 // Calculate the jerk, acceleration, velocity and position at time time_now when running the increasing jerk magnitude time segment based on a raised cosine profile
-void SCurve::calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const
+void SCurve::calc_javp_for_segment_incr_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const
 {
-    const float Alpha = Jm * 0.5f;
-    const float Beta = M_PI / tj;
-    Jt = Alpha * (1.0f - cosf(Beta * time_now));
-    At = A0 + Alpha * time_now - (Alpha / Beta) * sinf(Beta * time_now);
-    Vt = V0 + A0 * time_now + (Alpha * 0.5f) * (time_now * time_now) + (Alpha / (Beta * Beta)) * cosf(Beta * time_now) - Alpha / (Beta * Beta);
-    Pt = P0 + V0 * time_now + 0.5f * A0 * (time_now * time_now) + (-Alpha / (Beta * Beta)) * time_now + Alpha * (time_now * time_now * time_now) / 6.0f + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * time_now);
+    const float Alpha = eval_cache.J0;
+    const float A0 = eval_cache.A0;
+    const float V0 = eval_cache.V0;
+    const float P0 = eval_cache.P0;
+    const float sin_bt = sinf(eval_cache.beta * time_now);
+    const float cos_bt = cosf(eval_cache.beta * time_now);
+    Jt = Alpha * (1.0f - cos_bt);
+    At = A0 + Alpha * time_now - eval_cache.J0_beta * sin_bt;
+    Vt = V0 + A0 * time_now + eval_cache.J0_half * (time_now * time_now) + eval_cache.J0_beta2 * cos_bt - eval_cache.J0_beta2;
+    Pt = P0 + V0 * time_now + eval_cache.A0_half * (time_now * time_now) + (-eval_cache.J0_beta2) * time_now + Alpha * (time_now * time_now * time_now) / 6.0f + eval_cache.J0_beta3 * sin_bt;
 }
 
 // Calculate the jerk, acceleration, velocity and position at time time_now when running the decreasing jerk magnitude time segment based on a raised cosine profile
-void SCurve::calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const
+void SCurve::calc_javp_for_segment_decr_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const
 {
-    const float Alpha = Jm * 0.5f;
-    const float Beta = M_PI / tj;
-    const float AT = Alpha * tj;
-    const float VT = Alpha * ((tj * tj) * 0.5f - 2.0f / (Beta * Beta));
-    const float PT = Alpha * ((-1.0f / (Beta * Beta)) * tj + (1.0f / 6.0f) * (tj * tj * tj));
-    Jt = Alpha * (1.0f - cosf(Beta * (time_now + tj)));
-    At = (A0 - AT) + Alpha * (time_now + tj) - (Alpha / Beta) * sinf(Beta * (time_now + tj));
-    Vt = (V0 - VT) + (A0 - AT) * time_now + 0.5f * Alpha * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta)) * cosf(Beta * (time_now + tj)) - Alpha / (Beta * Beta);
-    Pt = (P0 - PT) + (V0 - VT) * time_now + 0.5f * (A0 - AT) * (time_now * time_now) + (-Alpha / (Beta * Beta)) * (time_now + tj) + (Alpha / 6.0f) * (time_now + tj) * (time_now + tj) * (time_now + tj) + (Alpha / (Beta * Beta * Beta)) * sinf(Beta * (time_now + tj));
+    const float Alpha = eval_cache.J0;
+    const float A0 = eval_cache.A0;
+    const float V0 = eval_cache.V0;
+    const float P0 = eval_cache.P0;
+    const float t_tj = time_now + jerk_time;
+    const float sin_bt = sinf(eval_cache.beta * t_tj);
+    const float cos_bt = cosf(eval_cache.beta * t_tj);
+    Jt = Alpha * (1.0f - cos_bt);
+    At = A0 + Alpha * t_tj - eval_cache.J0_beta * sin_bt;
+    Vt = V0 + A0 * time_now + eval_cache.J0_half * t_tj * t_tj + eval_cache.J0_beta2 * cos_bt - eval_cache.J0_beta2;
+    Pt = P0 + V0 * time_now + eval_cache.A0_half * (time_now * time_now) + (-eval_cache.J0_beta2) * t_tj + eval_cache.J0_sixth * t_tj * t_tj * t_tj + eval_cache.J0_beta3 * sin_bt;
 }
 
 // generate the segments for a path of length L
@@ -892,6 +968,7 @@ void SCurve::add_segment(uint8_t &index, float end_time, SegmentType seg_type, f
     segment[index].end_vel = end_vel;
     segment[index].end_pos = end_pos;
     index++;
+    eval_cache.valid = false;
 }
 
 // set speed and acceleration limits for the path
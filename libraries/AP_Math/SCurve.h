@@ -123,14 +123,17 @@ private:
     // calculate the jerk, acceleration, velocity and position at time t
     void get_jerk_accel_vel_pos_at_time(float time_now, float &Jt_out, float &At_out, float &Vt_out, float &Pt_out) const;
 
-    // calculate the jerk, acceleration, velocity and position at time t when running the constant jerk time segment
-    void calc_javp_for_segment_const_jerk(float time_now, float J0, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
+    // find the segment active at time_now and load its coefficients into the evaluation cache
+    void update_eval_cache(float time_now) const;
 
-    // Calculate the jerk, acceleration, velocity and position at time t when running the increasing jerk magnitude time segment based on a raised cosine profile
-    void calc_javp_for_segment_incr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
+    // calculate the jerk, acceleration, velocity and position at time t (relative to the segment start) when running the cached constant jerk time segment
+    void calc_javp_for_segment_const_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const;
 
-    // Calculate the jerk, acceleration, velocity and position at time t when running the decreasing jerk magnitude time segment based on a raised cosine profile
-    void calc_javp_for_segment_decr_jerk(float time_now, float tj, float Jm, float A0, float V0, float P0, float &Jt, float &At, float &Vt, float &Pt) const;
+    // Calculate the jerk, acceleration, velocity and position at time t (relative to the segment start) when running the cached increasing jerk magnitude time segment based on a raised cosine profile
+    void calc_javp_for_segment_incr_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const;
+
+    // Calculate the jerk, acceleration, velocity and position at time t (relative to the segment start) when running the cached decreasing jerk magnitude time segment based on a raised cosine profile
+    void calc_javp_for_segment_decr_jerk(float time_now, float &Jt, float &At, float &Vt, float &Pt) const;
 
     // generate time segments for straight segment
     void add_segments(float L);
@@ -208,4 +211,27 @@ private:
 
     Vector3f track;       // total change in position from origin to destination
     Vector3f delta_unit;  // reference direction vector for path
+
+    // closed form coefficients of the segment active at the last evaluated time
+    // time normally only moves forward so the active segment changes at most once per segment
+    // must be invalidated whenever the segments are modified
+    mutable struct {
+        bool valid;             // true if the cache matches the current segments
+        uint8_t index;          // index of the active segment, num_segs if past the end of the path
+        float time_min;         // cached segment is active for time_min <= time < time_max
+        float time_max;
+        SegmentType seg_type;   // segment type of the active segment
+        float T0;               // start time of the active segment
+        float J0;               // constant jerk, or half the peak jerk of a raised cosine segment
+        float A0;               // start acceleration, velocity and position of the active segment
+        float V0;               // (offset by the raised cosine end state for decreasing jerk segments)
+        float P0;
+        float A0_half;          // 0.5 * A0
+        float J0_half;          // 0.5 * J0
+        float J0_sixth;         // J0 / 6
+        float beta;             // raised cosine angular rate, M_PI / jerk_time
+        float J0_beta;          // J0 / beta
+        float J0_beta2;         // J0 / beta^2
+        float J0_beta3;         // J0 / beta^3
+    } eval_cache;
 };
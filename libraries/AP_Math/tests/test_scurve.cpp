@@ -0,0 +1,70 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/SCurve.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static float rand_float(float low, float high)
+{
+    return low + (high - low) * (float)random() / (float)RAND_MAX;
+}
+
+/*
+  follow random straight tracks, changing the maximum speed part way
+  along some of them, and check the target stays continuous and ends
+  at the destination.  A stale segment evaluation shows up as a jump
+  in the target position or velocity.
+ */
+TEST(SCurve, RandomTracksAreContinuous)
+{
+    srandom(0x53435256);
+
+    const float dt = 1.0f / 400.0f;
+
+    for (uint16_t n = 0; n < 200; n++) {
+        const Vector3f origin(rand_float(-5000.0f, 5000.0f), rand_float(-5000.0f, 5000.0f), rand_float(0.0f, 1000.0f));
+        const Vector3f destination(rand_float(-5000.0f, 5000.0f), rand_float(-5000.0f, 5000.0f), rand_float(0.0f, 1000.0f));
+        const float speed_xy = rand_float(100.0f, 2000.0f);
+        const float speed_up = rand_float(50.0f, 500.0f);
+        const float speed_down = rand_float(50.0f, 300.0f);
+        const float accel_xy = rand_float(100.0f, 500.0f);
+        const float accel_z = rand_float(50.0f, 300.0f);
+        const float jerk_time = rand_float(0.05f, 0.5f);
+        const float jerk_max = rand_float(100.0f, 2000.0f);
+        const uint32_t speed_change_step = random() % 4000;
+
+        SCurve prev_leg, this_leg, next_leg;
+        this_leg.calculate_track(origin, destination, speed_xy, speed_up, speed_down, accel_xy, accel_z, jerk_time, jerk_max);
+
+        // position may not move faster than the fastest allowed speed
+        const float step_max = MAX(MAX(speed_xy, speed_up), speed_down) * 1.01f * dt * 2.0f;
+        // velocity may not change faster than the fastest allowed acceleration
+        const float vel_step_max = MAX(accel_xy, accel_z) * 1.01f * dt * 2.0f;
+
+        Vector3f last_pos = origin;
+        Vector3f last_vel;
+        bool finished = false;
+        for (uint32_t step = 0; step < 400 * 300 && !finished; step++) {
+            if (step == speed_change_step) {
+                this_leg.set_speed_max(speed_xy * 0.5f, speed_up, speed_down);
+            }
+            Vector3f target_pos = origin;
+            Vector3f target_vel, target_accel;
+            finished = this_leg.advance_target_along_track(prev_leg, next_leg, 0.0f, false, dt, target_pos, target_vel, target_accel);
+
+            ASSERT_FALSE(target_pos.is_nan() || target_pos.is_inf());
+            ASSERT_FALSE(target_vel.is_nan() || target_vel.is_inf());
+            ASSERT_FALSE(target_accel.is_nan() || target_accel.is_inf());
+            EXPECT_LE((target_pos - last_pos).length(), step_max);
+            EXPECT_LE((target_vel - last_vel).length(), vel_step_max);
+            last_pos = target_pos;
+            last_vel = target_vel;
+        }
+
+        EXPECT_TRUE(finished);
+        EXPECT_LE((last_pos - destination).length(), 1.0f);
+    }
+}
+
+AP_GTEST_MAIN()
@@ -106,6 +106,7 @@ bool AP_MotorsMatrix::set_throttle_factor(int8_t motor_num, float throttle_facto
     }
 
     _throttle_factor[motor_num] = throttle_factor;
+    _mixer.valid = false;
     return true;
 }
 
@@ -266,29 +267,47 @@ void AP_MotorsMatrix::output_armed_stabilizing()
 
     // calculate amount of yaw we can fit into the throttle range
     // this is always equal to or less than the requested yaw from the pilot or rate controller
+    if (!_mixer.valid) {
+        update_mixer();
+    }
+    const uint8_t num_motors = _mixer.num_motors;
+    float *thrust = _mixer.thrust;
+
+    // find the mixer row of the lost motor, if any, so it can be excluded from the limits
+    int8_t lost_row = -1;
+    if (_thrust_boost) {
+        for (i = 0; i < num_motors; i++) {
+            if (_mixer.motor_num[i] == _motor_lost_index) {
+                lost_row = i;
+                break;
+            }
+        }
+    }
+
+    // calculate the thrust outputs for roll and pitch
+    for (i = 0; i < num_motors; i++) {
+        thrust[i] = roll_thrust * _mixer.roll[i] + pitch_thrust * _mixer.pitch[i];
+    }
+
+    // record lowest and highest roll + pitch command
+    // Exclude any lost motors from the highest if thrust boost is enabled
     float rp_low = 1.0f;    // lowest thrust value
     float rp_high = -1.0f;  // highest thrust value
-    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            // calculate the thrust outputs for roll and pitch
-            _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
-            // record lowest roll + pitch command
-            if (_thrust_rpyt_out[i] < rp_low) {
-                rp_low = _thrust_rpyt_out[i];
-            }
-            // record highest roll + pitch command
-            if (_thrust_rpyt_out[i] > rp_high && (!_thrust_boost || i != _motor_lost_index)) {
-                rp_high = _thrust_rpyt_out[i];
-            }
+    for (i = 0; i < num_motors; i++) {
+        rp_low = MIN(thrust[i], rp_low);
+        if (i != lost_row) {
+            rp_high = MAX(thrust[i], rp_high);
+        }
+    }
 
-            // Check the maximum yaw control that can be used on this channel
-            // Exclude any lost motors if thrust boost is enabled
-            if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)){
-                if (is_positive(yaw_thrust * _yaw_factor[i])) {
-                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[i]), 0.0f)/_yaw_factor[i]));
-                } else {
-                    yaw_allowed = MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[i], 0.0f)/_yaw_factor[i]));
-                }
+    // Check the maximum yaw control that can be used on each channel
+    // Exclude any lost motors if thrust boost is enabled
+    for (i = 0; i < num_motors; i++) {
+        if (!is_zero(_mixer.yaw[i]) && i != lost_row) {
+            if (is_positive(yaw_thrust * _mixer.yaw[i])) {
+                yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + thrust[i]), 0.0f)/_mixer.yaw[i]));
+            } else {
+                yaw_allowed = MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + thrust[i], 0.0f)/_mixer.yaw[i]));
             }
         }
     }
@@ -304,19 +323,20 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     yaw_allowed = MAX(yaw_allowed, yaw_allowed_min);
 
     // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
-    if (_thrust_boost && motor_enabled[_motor_lost_index]) {
+    if (lost_row >= 0) {
         // record highest roll + pitch command
-        if (_thrust_rpyt_out[_motor_lost_index] > rp_high) {
-            rp_high = _thrust_boost_ratio * rp_high + (1.0f - _thrust_boost_ratio) * _thrust_rpyt_out[_motor_lost_index];
+        if (thrust[lost_row] > rp_high) {
+            rp_high = _thrust_boost_ratio * rp_high + (1.0f - _thrust_boost_ratio) * thrust[lost_row];
         }
 
         // Check the maximum yaw control that can be used on this channel
         // Exclude any lost motors if thrust boost is enabled
-        if (!is_zero(_yaw_factor[_motor_lost_index])){
-            if (is_positive(yaw_thrust * _yaw_factor[_motor_lost_index])) {
-                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index]), 0.0f)/_yaw_factor[_motor_lost_index]));
+        const float lost_yaw_factor = _mixer.yaw[lost_row];
+        if (!is_zero(lost_yaw_factor)){
+            if (is_positive(yaw_thrust * lost_yaw_factor)) {
+                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + thrust[lost_row]), 0.0f)/lost_yaw_factor));
             } else {
-                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index], 0.0f)/_yaw_factor[_motor_lost_index]));
+                yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + thrust[lost_row], 0.0f)/lost_yaw_factor));
             }
         }
     }
@@ -328,28 +348,25 @@ void AP_MotorsMatrix::output_armed_stabilizing()
     }
 
     // add yaw control to thrust outputs
+    for (i = 0; i < num_motors; i++) {
+        thrust[i] = thrust[i] + yaw_thrust * _mixer.yaw[i];
+    }
+
+    // record lowest and highest roll + pitch + yaw command
+    // Exclude any lost motors from the highest if thrust boost is enabled
     float rpy_low = 1.0f;   // lowest thrust value
     float rpy_high = -1.0f; // highest thrust value
-    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
-
-            // record lowest roll + pitch + yaw command
-            if (_thrust_rpyt_out[i] < rpy_low) {
-                rpy_low = _thrust_rpyt_out[i];
-            }
-            // record highest roll + pitch + yaw command
-            // Exclude any lost motors if thrust boost is enabled
-            if (_thrust_rpyt_out[i] > rpy_high && (!_thrust_boost || i != _motor_lost_index)) {
-                rpy_high = _thrust_rpyt_out[i];
-            }
+    for (i = 0; i < num_motors; i++) {
+        rpy_low = MIN(thrust[i], rpy_low);
+        if (i != lost_row) {
+            rpy_high = MAX(thrust[i], rpy_high);
         }
     }
     // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
-    if (_thrust_boost) {
+    if (lost_row >= 0) {
         // record highest roll + pitch + yaw command
-        if (_thrust_rpyt_out[_motor_lost_index] > rpy_high && motor_enabled[_motor_lost_index]) {
-            rpy_high = _thrust_boost_ratio * rpy_high + (1.0f - _thrust_boost_ratio) * _thrust_rpyt_out[_motor_lost_index];
+        if (thrust[lost_row] > rpy_high) {
+            rpy_high = _thrust_boost_ratio * rpy_high + (1.0f - _thrust_boost_ratio) * thrust[lost_row];
         }
     }
 
@@ -389,10 +406,11 @@ void AP_MotorsMatrix::output_armed_stabilizing()
 
     // add scaled roll, pitch, constrained yaw and throttle for each motor
     const float throttle_thrust_best_plus_adj = throttle_thrust_best_rpy + thr_adj;
-    for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
-        if (motor_enabled[i]) {
-            _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
-        }
+    for (i = 0; i < num_motors; i++) {
+        thrust[i] = (throttle_thrust_best_plus_adj * _mixer.throttle[i]) + (rpy_scale * thrust[i]);
+    }
+    for (i = 0; i < num_motors; i++) {
+        _thrust_rpyt_out[_mixer.motor_num[i]] = thrust[i];
     }
 
     // determine throttle thrust for harmonic notch
@@ -524,6 +542,8 @@ void AP_MotorsMatrix::add_motor_raw(int8_t motor_num, float roll_fac, float pitc
         // set order that motor appears in test
         _test_order[motor_num] = testing_order;
 
+        _mixer.valid = false;
+
         // call parent class method
         add_motor_num(motor_num);
     }
@@ -557,6 +577,7 @@ void AP_MotorsMatrix::remove_motor(int8_t motor_num)
         _pitch_factor[motor_num] = 0.0f;
         _yaw_factor[motor_num] = 0.0f;
         _throttle_factor[motor_num] = 0.0f;
+        _mixer.valid = false;
     }
 }
 
@@ -1093,6 +1114,25 @@ void AP_MotorsMatrix::normalise_rpy_factors()
             }
         }
     }
+    _mixer.valid = false;
+}
+
+// rebuild the packed mixer from the roll, pitch, yaw and throttle factors of the enabled motors
+void AP_MotorsMatrix::update_mixer()
+{
+    uint8_t num_motors = 0;
+    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        if (motor_enabled[i]) {
+            _mixer.motor_num[num_motors] = i;
+            _mixer.roll[num_motors] = _roll_factor[i];
+            _mixer.pitch[num_motors] = _pitch_factor[i];
+            _mixer.yaw[num_motors] = _yaw_factor[i];
+            _mixer.throttle[num_motors] = _throttle_factor[i];
+            num_motors++;
+        }
+    }
+    _mixer.num_motors = num_motors;
+    _mixer.valid = true;
 }
 
 
@@ -1117,6 +1157,7 @@ void AP_MotorsMatrix::disable_yaw_torque(void)
     for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
         _yaw_factor[i] = 0;
     }
+    _mixer.valid = false;
 }
 
 // singleton instance
@@ -109,6 +109,10 @@ protected:
     // call vehicle supplied thrust compensation if set
     void                thrust_compensation(void) override;
 
+    // rebuild the packed mixer from the per-motor factors, called
+    // from output_armed_stabilizing() whenever the factors have changed
+    void                update_mixer();
+
     float               _roll_factor[AP_MOTORS_MAX_NUM_MOTORS]; // each motors contribution to roll
     float               _pitch_factor[AP_MOTORS_MAX_NUM_MOTORS]; // each motors contribution to pitch
     float               _yaw_factor[AP_MOTORS_MAX_NUM_MOTORS];  // each motors contribution to yaw (normally 1 or -1)
@@ -116,6 +120,20 @@ protected:
     float               _thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS]; // combined roll, pitch, yaw and throttle outputs to motors in 0~1 range
     uint8_t             _test_order[AP_MOTORS_MAX_NUM_MOTORS];  // order of the motors in the test sequence
 
+    // packed mixer holding only the enabled motors, in increasing motor
+    // number order, so the mixing passes run over dense arrays without
+    // per-motor enable checks
+    struct {
+        uint8_t         num_motors;                             // number of enabled motors
+        uint8_t         motor_num[AP_MOTORS_MAX_NUM_MOTORS];    // motor number of each mixer row
+        float           roll[AP_MOTORS_MAX_NUM_MOTORS];
+        float           pitch[AP_MOTORS_MAX_NUM_MOTORS];
+        float           yaw[AP_MOTORS_MAX_NUM_MOTORS];
+        float           throttle[AP_MOTORS_MAX_NUM_MOTORS];
+        float           thrust[AP_MOTORS_MAX_NUM_MOTORS];       // working thrust for each mixer row
+        bool            valid;                                  // false when the factors have changed since the last rebuild
+    } _mixer;
+
     // motor failure handling
     float               _thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];    // filtered thrust outputs with 1 second time constant
     uint8_t             _motor_lost_index;  // index number of the lost motor
@@ -256,6 +256,8 @@ void AP_MotorsMatrix_6DoF_Scripting::add_motor(int8_t motor_num, float roll_fact
         // set order that motor appears in test
         _test_order[motor_num] = testing_order;
 
+        _mixer.valid = false;
+
         // ensure valid motor number is provided
         SRV_Channel::Aux_servo_function_t function = SRV_Channels::get_motor_function(motor_num);
         SRV_Channels::set_aux_channel_default(function, motor_num);
@@ -0,0 +1,67 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+class AP_MotorsMatrix_Bench : public AP_MotorsMatrix
+{
+public:
+    AP_MotorsMatrix_Bench() : AP_MotorsMatrix(400) {}
+
+    void setup_frame(motor_frame_class frame_class, motor_frame_type frame_type)
+    {
+        setup_motors(frame_class, frame_type);
+        _throttle_filter.reset(0.5f);
+        _throttle_avg_max = 0.5f;
+    }
+
+    void mix(float roll, float pitch, float yaw)
+    {
+        _roll_in = roll;
+        _pitch_in = pitch;
+        _yaw_in = yaw;
+        output_armed_stabilizing();
+    }
+
+    const float *thrust_out() const { return _thrust_rpyt_out; }
+};
+
+static SRV_Channels srv_channels;
+static AP_MotorsMatrix_Bench motors;
+
+static const struct {
+    AP_Motors::motor_frame_class frame_class;
+    AP_Motors::motor_frame_type frame_type;
+} frames[] = {
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_HEXA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_OCTA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_DECA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_DODECAHEXA, AP_Motors::MOTOR_FRAME_TYPE_X },
+};
+
+/*
+  run the matrix mixer once per iteration, sweeping the inputs so
+  both the saturated and unsaturated paths are taken
+ */
+static void BM_MotorsMatrixMix(benchmark::State& state)
+{
+    const auto &frame = frames[state.range(0)];
+    motors.setup_frame(frame.frame_class, frame.frame_type);
+    state.SetLabel(motors.get_frame_string());
+
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        const float roll = (n & 0xFF) * (2.0f / 0xFF) - 1.0f;
+        const float yaw = ((n >> 3) & 0x7F) * (1.0f / 0x7F) - 0.5f;
+        motors.mix(roll, -roll * 0.5f, yaw);
+        gbenchmark_escape((void *)motors.thrust_out());
+        n++;
+    }
+}
+
+BENCHMARK(BM_MotorsMatrixMix)->DenseRange(0, ARRAY_SIZE(frames) - 1);
+
+BENCHMARK_MAIN();
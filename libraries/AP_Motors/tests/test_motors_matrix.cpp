@@ -0,0 +1,413 @@
+#include <AP_gtest.h>
+
+#include <AP_Motors/AP_Motors.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  expose the mixer of AP_MotorsMatrix and carry a copy of the mixer as
+  it was before it was packed over the enabled motors, so the two can
+  be compared on the same inputs
+ */
+class AP_MotorsMatrix_Test : public AP_MotorsMatrix
+{
+public:
+    AP_MotorsMatrix_Test() : AP_MotorsMatrix(400) {}
+
+    struct Inputs {
+        float roll, pitch, yaw;
+        float roll_ff, pitch_ff, yaw_ff;
+        float throttle;
+        float throttle_avg_max;
+        float throttle_thrust_max;
+        float lift_max;
+        float thrust_boost_ratio;
+        bool thrust_boost;
+        uint8_t motor_lost_index;
+        int16_t yaw_headroom;
+    };
+
+    struct Outputs {
+        float thrust_rpyt_out[AP_MOTORS_MAX_NUM_MOTORS];
+        float thrust_rpyt_out_filt[AP_MOTORS_MAX_NUM_MOTORS];
+        float throttle_out;
+        uint8_t motor_lost_index;
+        bool thrust_boost;
+        bool thrust_balanced;
+        bool limit_roll, limit_pitch, limit_yaw, limit_throttle_lower, limit_throttle_upper;
+    };
+
+    bool setup_frame(motor_frame_class frame_class, motor_frame_type frame_type)
+    {
+        setup_motors(frame_class, frame_type);
+        // reset the motor failure state left by the previous frame
+        for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+            _thrust_rpyt_out[i] = 0.0f;
+            _thrust_rpyt_out_filt[i] = 0.0f;
+        }
+        _thrust_balanced = true;
+        return initialised_ok();
+    }
+
+    void run(const Inputs &in, bool reference, Outputs &out)
+    {
+        _roll_in = in.roll;
+        _pitch_in = in.pitch;
+        _yaw_in = in.yaw;
+        _roll_in_ff = in.roll_ff;
+        _pitch_in_ff = in.pitch_ff;
+        _yaw_in_ff = in.yaw_ff;
+        _throttle_filter.reset(in.throttle);
+        _throttle_avg_max = in.throttle_avg_max;
+        _throttle_thrust_max = in.throttle_thrust_max;
+        _lift_max = in.lift_max;
+        _thrust_boost_ratio = in.thrust_boost_ratio;
+        _thrust_boost = in.thrust_boost;
+        _motor_lost_index = in.motor_lost_index;
+        _yaw_headroom.set(in.yaw_headroom);
+        set_limit_flag_pitch_roll_yaw(false);
+        limit.throttle_lower = false;
+        limit.throttle_upper = false;
+
+        if (reference) {
+            output_armed_stabilizing_reference();
+        } else {
+            output_armed_stabilizing();
+        }
+
+        memcpy(out.thrust_rpyt_out, _thrust_rpyt_out, sizeof(out.thrust_rpyt_out));
+        memcpy(out.thrust_rpyt_out_filt, _thrust_rpyt_out_filt, sizeof(out.thrust_rpyt_out_filt));
+        out.throttle_out = _throttle_out;
+        out.motor_lost_index = _motor_lost_index;
+        out.thrust_boost = _thrust_boost;
+        out.thrust_balanced = _thrust_balanced;
+        out.limit_roll = limit.roll;
+        out.limit_pitch = limit.pitch;
+        out.limit_yaw = limit.yaw;
+        out.limit_throttle_lower = limit.throttle_lower;
+        out.limit_throttle_upper = limit.throttle_upper;
+    }
+
+    // save and restore the state carried between mixer runs
+    void save_state(Outputs &state) const
+    {
+        memcpy(state.thrust_rpyt_out, _thrust_rpyt_out, sizeof(state.thrust_rpyt_out));
+        memcpy(state.thrust_rpyt_out_filt, _thrust_rpyt_out_filt, sizeof(state.thrust_rpyt_out_filt));
+        state.thrust_balanced = _thrust_balanced;
+    }
+    void restore_state(const Outputs &state)
+    {
+        memcpy(_thrust_rpyt_out, state.thrust_rpyt_out, sizeof(_thrust_rpyt_out));
+        memcpy(_thrust_rpyt_out_filt, state.thrust_rpyt_out_filt, sizeof(_thrust_rpyt_out_filt));
+        _thrust_balanced = state.thrust_balanced;
+    }
+
+private:
+    // the unpacked mixer, looping over all motors and checking motor_enabled
+    void output_armed_stabilizing_reference()
+    {
+        uint8_t i;                          // general purpose counter
+        float   roll_thrust;                // roll thrust input value, +/- 1.0
+        float   pitch_thrust;               // pitch thrust input value, +/- 1.0
+        float   yaw_thrust;                 // yaw thrust input value, +/- 1.0
+        float   throttle_thrust;            // throttle thrust input value, 0.0 - 1.0
+        float   throttle_avg_max;           // throttle thrust average maximum value, 0.0 - 1.0
+        float   throttle_thrust_max;        // throttle thrust maximum value, 0.0 - 1.0
+        float   throttle_thrust_best_rpy;   // throttle providing maximum roll, pitch and yaw range without climbing
+        float   rpy_scale = 1.0f;           // this is used to scale the roll, pitch and yaw to fit within the motor limits
+        float   yaw_allowed = 1.0f;         // amount of yaw we can fit in
+        float   thr_adj;                    // the difference between the pilot's desired throttle and throttle_thrust_best_rpy
+
+        // apply voltage and air pressure compensation
+        const float compensation_gain = get_compensation_gain(); // compensation for battery voltage and altitude
+        roll_thrust = (_roll_in + _roll_in_ff) * compensation_gain;
+        pitch_thrust = (_pitch_in + _pitch_in_ff) * compensation_gain;
+        yaw_thrust = (_yaw_in + _yaw_in_ff) * compensation_gain;
+        throttle_thrust = get_throttle() * compensation_gain;
+        throttle_avg_max = _throttle_avg_max * compensation_gain;
+
+        // If thrust boost is active then do not limit maximum thrust
+        throttle_thrust_max = _thrust_boost_ratio + (1.0f - _thrust_boost_ratio) * _throttle_thrust_max * compensation_gain;
+
+        // sanity check throttle is above zero and below current limited throttle
+        if (throttle_thrust <= 0.0f) {
+            throttle_thrust = 0.0f;
+            limit.throttle_lower = true;
+        }
+        if (throttle_thrust >= throttle_thrust_max) {
+            throttle_thrust = throttle_thrust_max;
+            limit.throttle_upper = true;
+        }
+
+        // ensure that throttle_avg_max is between the input throttle and the maximum throttle
+        throttle_avg_max = constrain_float(throttle_avg_max, throttle_thrust, throttle_thrust_max);
+
+        // calculate the highest allowed average thrust that will provide maximum control range
+        throttle_thrust_best_rpy = MIN(0.5f, throttle_avg_max);
+
+        // calculate throttle that gives most possible room for yaw which is the lower of:
+        //      1. 0.5f - (rpy_low+rpy_high)/2.0 - this would give the maximum possible margin above the highest motor and below the lowest
+        //      2. the higher of:
+        //            a) the pilot's throttle input
+        //            b) the point _throttle_rpy_mix between the pilot's input throttle and hover-throttle
+        //      Situation #2 ensure we never increase the throttle above hover throttle unless the pilot has commanded this.
+        //      Situation #2b allows us to raise the throttle above what the pilot commanded but not so far that it would actually cause the copter to rise.
+        //      We will choose #1 (the best throttle for yaw control) if that means reducing throttle to the motors (i.e. we favor reducing throttle *because* it provides better yaw control)
+        //      We will choose #2 (a mix of pilot and hover throttle) only when the throttle is quite low.  We favor reducing throttle instead of better yaw control because the pilot has commanded it
+
+        // Under the motor lost condition we remove the highest motor output from our calculations and let that motor go greater than 1.0
+        // To ensure control and maximum righting performance Hex and Octo have some optimal settings that should be used
+        // Y6               : MOT_YAW_HEADROOM = 350, ATC_RAT_RLL_IMAX = 1.0,   ATC_RAT_PIT_IMAX = 1.0,   ATC_RAT_YAW_IMAX = 0.5
+        // Octo-Quad (x8) x : MOT_YAW_HEADROOM = 300, ATC_RAT_RLL_IMAX = 0.375, ATC_RAT_PIT_IMAX = 0.375, ATC_RAT_YAW_IMAX = 0.375
+        // Octo-Quad (x8) + : MOT_YAW_HEADROOM = 300, ATC_RAT_RLL_IMAX = 0.75,  ATC_RAT_PIT_IMAX = 0.75,  ATC_RAT_YAW_IMAX = 0.375
+        // Usable minimums below may result in attitude offsets when motors are lost. Hex aircraft are only marginal and must be handles with care
+        // Hex              : MOT_YAW_HEADROOM = 0,   ATC_RAT_RLL_IMAX = 1.0,   ATC_RAT_PIT_IMAX = 1.0,   ATC_RAT_YAW_IMAX = 0.5
+        // Octo-Quad (x8) x : MOT_YAW_HEADROOM = 300, ATC_RAT_RLL_IMAX = 0.25,  ATC_RAT_PIT_IMAX = 0.25,  ATC_RAT_YAW_IMAX = 0.25
+        // Octo-Quad (x8) + : MOT_YAW_HEADROOM = 300, ATC_RAT_RLL_IMAX = 0.5,   ATC_RAT_PIT_IMAX = 0.5,   ATC_RAT_YAW_IMAX = 0.25
+        // Quads cannot make use of motor loss handling because it doesn't have enough degrees of freedom.
+
+        // calculate amount of yaw we can fit into the throttle range
+        // this is always equal to or less than the requested yaw from the pilot or rate controller
+        float rp_low = 1.0f;    // lowest thrust value
+        float rp_high = -1.0f;  // highest thrust value
+        for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+            if (motor_enabled[i]) {
+                // calculate the thrust outputs for roll and pitch
+                _thrust_rpyt_out[i] = roll_thrust * _roll_factor[i] + pitch_thrust * _pitch_factor[i];
+                // record lowest roll + pitch command
+                if (_thrust_rpyt_out[i] < rp_low) {
+                    rp_low = _thrust_rpyt_out[i];
+                }
+                // record highest roll + pitch command
+                if (_thrust_rpyt_out[i] > rp_high && (!_thrust_boost || i != _motor_lost_index)) {
+                    rp_high = _thrust_rpyt_out[i];
+                }
+
+                // Check the maximum yaw control that can be used on this channel
+                // Exclude any lost motors if thrust boost is enabled
+                if (!is_zero(_yaw_factor[i]) && (!_thrust_boost || i != _motor_lost_index)){
+                    if (is_positive(yaw_thrust * _yaw_factor[i])) {
+                        yaw_allowed = MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[i]), 0.0f)/_yaw_factor[i]));
+                    } else {
+                        yaw_allowed = MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[i], 0.0f)/_yaw_factor[i]));
+                    }
+                }
+            }
+        }
+
+        // calculate the maximum yaw control that can be used
+        // todo: make _yaw_headroom 0 to 1
+        float yaw_allowed_min = (float)_yaw_headroom / 1000.0f;
+
+        // increase yaw headroom to 50% if thrust boost enabled
+        yaw_allowed_min = _thrust_boost_ratio * 0.5f + (1.0f - _thrust_boost_ratio) * yaw_allowed_min;
+
+        // Let yaw access minimum amount of head room
+        yaw_allowed = MAX(yaw_allowed, yaw_allowed_min);
+
+        // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
+        if (_thrust_boost && motor_enabled[_motor_lost_index]) {
+            // record highest roll + pitch command
+            if (_thrust_rpyt_out[_motor_lost_index] > rp_high) {
+                rp_high = _thrust_boost_ratio * rp_high + (1.0f - _thrust_boost_ratio) * _thrust_rpyt_out[_motor_lost_index];
+            }
+
+            // Check the maximum yaw control that can be used on this channel
+            // Exclude any lost motors if thrust boost is enabled
+            if (!is_zero(_yaw_factor[_motor_lost_index])){
+                if (is_positive(yaw_thrust * _yaw_factor[_motor_lost_index])) {
+                    yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(1.0f - (throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index]), 0.0f)/_yaw_factor[_motor_lost_index]));
+                } else {
+                    yaw_allowed = _thrust_boost_ratio * yaw_allowed + (1.0f - _thrust_boost_ratio) * MIN(yaw_allowed, fabsf(MAX(throttle_thrust_best_rpy + _thrust_rpyt_out[_motor_lost_index], 0.0f)/_yaw_factor[_motor_lost_index]));
+                }
+            }
+        }
+
+        if (fabsf(yaw_thrust) > yaw_allowed) {
+            // not all commanded yaw can be used
+            yaw_thrust = constrain_float(yaw_thrust, -yaw_allowed, yaw_allowed);
+            limit.yaw = true;
+        }
+
+        // add yaw control to thrust outputs
+        float rpy_low = 1.0f;   // lowest thrust value
+        float rpy_high = -1.0f; // highest thrust value
+        for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+            if (motor_enabled[i]) {
+                _thrust_rpyt_out[i] = _thrust_rpyt_out[i] + yaw_thrust * _yaw_factor[i];
+
+                // record lowest roll + pitch + yaw command
+                if (_thrust_rpyt_out[i] < rpy_low) {
+                    rpy_low = _thrust_rpyt_out[i];
+                }
+                // record highest roll + pitch + yaw command
+                // Exclude any lost motors if thrust boost is enabled
+                if (_thrust_rpyt_out[i] > rpy_high && (!_thrust_boost || i != _motor_lost_index)) {
+                    rpy_high = _thrust_rpyt_out[i];
+                }
+            }
+        }
+        // Include the lost motor scaled by _thrust_boost_ratio to smoothly transition this motor in and out of the calculation
+        if (_thrust_boost) {
+            // record highest roll + pitch + yaw command
+            if (_thrust_rpyt_out[_motor_lost_index] > rpy_high && motor_enabled[_motor_lost_index]) {
+                rpy_high = _thrust_boost_ratio * rpy_high + (1.0f - _thrust_boost_ratio) * _thrust_rpyt_out[_motor_lost_index];
+            }
+        }
+
+        // calculate any scaling needed to make the combined thrust outputs fit within the output range
+        if (rpy_high - rpy_low > 1.0f) {
+            rpy_scale = 1.0f / (rpy_high - rpy_low);
+        }
+        if (throttle_avg_max + rpy_low < 0) {
+            rpy_scale = MIN(rpy_scale, -throttle_avg_max / rpy_low);
+        }
+
+        // calculate how close the motors can come to the desired throttle
+        rpy_high *= rpy_scale;
+        rpy_low *= rpy_scale;
+        throttle_thrust_best_rpy = -rpy_low;
+        thr_adj = throttle_thrust - throttle_thrust_best_rpy;
+        if (rpy_scale < 1.0f) {
+            // Full range is being used by roll, pitch, and yaw.
+            limit.roll = true;
+            limit.pitch = true;
+            limit.yaw = true;
+            if (thr_adj > 0.0f) {
+                limit.throttle_upper = true;
+            }
+            thr_adj = 0.0f;
+        } else {
+            if (thr_adj < 0.0f) {
+                // Throttle can't be reduced to desired value
+                // todo: add lower limit flag and ensure it is handled correctly in altitude controller
+                thr_adj = 0.0f;
+            } else if (thr_adj > 1.0f - (throttle_thrust_best_rpy + rpy_high)) {
+                // Throttle can't be increased to desired value
+                thr_adj = 1.0f - (throttle_thrust_best_rpy + rpy_high);
+                limit.throttle_upper = true;
+            }
+        }
+
+        // add scaled roll, pitch, constrained yaw and throttle for each motor
+        const float throttle_thrust_best_plus_adj = throttle_thrust_best_rpy + thr_adj;
+        for (i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+            if (motor_enabled[i]) {
+                _thrust_rpyt_out[i] = (throttle_thrust_best_plus_adj * _throttle_factor[i]) + (rpy_scale * _thrust_rpyt_out[i]);
+            }
+        }
+
+        // determine throttle thrust for harmonic notch
+        // compensation_gain can never be zero
+        _throttle_out = throttle_thrust_best_plus_adj / compensation_gain;
+
+        // check for failed motor
+        check_for_failed_motor(throttle_thrust_best_plus_adj);
+    }
+};
+
+static SRV_Channels srv_channels;
+static AP_MotorsMatrix_Test motors;
+
+static const struct {
+    AP_Motors::motor_frame_class frame_class;
+    AP_Motors::motor_frame_type frame_type;
+} frames[] = {
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_PLUS },
+    { AP_Motors::MOTOR_FRAME_QUAD, AP_Motors::MOTOR_FRAME_TYPE_H },
+    { AP_Motors::MOTOR_FRAME_HEXA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_OCTA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_OCTAQUAD, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_DODECAHEXA, AP_Motors::MOTOR_FRAME_TYPE_X },
+    { AP_Motors::MOTOR_FRAME_Y6, AP_Motors::MOTOR_FRAME_TYPE_Y6B },
+    { AP_Motors::MOTOR_FRAME_DECA, AP_Motors::MOTOR_FRAME_TYPE_X },
+};
+
+static float rand_float(float low, float high)
+{
+    return low + (high - low) * (float)random() / (float)RAND_MAX;
+}
+
+/*
+  the packed mixer must give bit-identical outputs, limit flags and
+  motor failure state to the unpacked mixer on random inputs
+ */
+TEST(AP_MotorsMatrix, PackedMixerMatchesReference)
+{
+    srandom(0x4d495852);
+
+    for (const auto &frame : frames) {
+        ASSERT_TRUE(motors.setup_frame(frame.frame_class, frame.frame_type));
+
+        for (uint16_t n = 0; n < 5000; n++) {
+            AP_MotorsMatrix_Test::Inputs in;
+            in.roll = rand_float(-1.0f, 1.0f);
+            in.pitch = rand_float(-1.0f, 1.0f);
+            in.yaw = rand_float(-1.0f, 1.0f);
+            in.roll_ff = rand_float(-0.2f, 0.2f);
+            in.pitch_ff = rand_float(-0.2f, 0.2f);
+            in.yaw_ff = rand_float(-0.2f, 0.2f);
+            in.throttle = rand_float(-0.1f, 1.1f);
+            in.throttle_avg_max = rand_float(0.0f, 1.0f);
+            in.throttle_thrust_max = rand_float(0.5f, 1.0f);
+            in.lift_max = rand_float(0.8f, 1.2f);
+            in.thrust_boost_ratio = (random() & 1) ? 0.0f : rand_float(0.0f, 1.0f);
+            in.thrust_boost = (random() & 1) != 0;
+            in.motor_lost_index = random() % AP_MOTORS_MAX_NUM_MOTORS;
+            in.yaw_headroom = random() % 500;
+
+            AP_MotorsMatrix_Test::Outputs state, expected, result;
+            motors.save_state(state);
+            motors.run(in, true, expected);
+            motors.restore_state(state);
+            motors.run(in, false, result);
+
+            for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+                EXPECT_EQ(expected.thrust_rpyt_out[i], result.thrust_rpyt_out[i]);
+                EXPECT_EQ(expected.thrust_rpyt_out_filt[i], result.thrust_rpyt_out_filt[i]);
+            }
+            EXPECT_EQ(expected.throttle_out, result.throttle_out);
+            EXPECT_EQ(expected.motor_lost_index, result.motor_lost_index);
+            EXPECT_EQ(expected.thrust_boost, result.thrust_boost);
+            EXPECT_EQ(expected.thrust_balanced, result.thrust_balanced);
+            EXPECT_EQ(expected.limit_roll, result.limit_roll);
+            EXPECT_EQ(expected.limit_pitch, result.limit_pitch);
+            EXPECT_EQ(expected.limit_yaw, result.limit_yaw);
+            EXPECT_EQ(expected.limit_throttle_lower, result.limit_throttle_lower);
+            EXPECT_EQ(expected.limit_throttle_upper, result.limit_throttle_upper);
+        }
+    }
+}
+
+/*
+  changing the motor factors after the mixer has run must be picked up
+  by the next run
+ */
+TEST(AP_MotorsMatrix, PackedMixerFollowsFactorChanges)
+{
+    ASSERT_TRUE(motors.setup_frame(AP_Motors::MOTOR_FRAME_HEXA, AP_Motors::MOTOR_FRAME_TYPE_X));
+
+    AP_MotorsMatrix_Test::Inputs in {};
+    in.yaw = 0.3f;
+    in.throttle = 0.5f;
+    in.throttle_avg_max = 0.5f;
+    in.throttle_thrust_max = 1.0f;
+    in.lift_max = 1.0f;
+
+    AP_MotorsMatrix_Test::Outputs state, expected, result;
+    motors.run(in, false, result);
+
+    motors.disable_yaw_torque();
+
+    motors.save_state(state);
+    motors.run(in, true, expected);
+    motors.restore_state(state);
+    motors.run(in, false, result);
+    for (uint8_t i = 0; i < AP_MOTORS_MAX_NUM_MOTORS; i++) {
+        EXPECT_EQ(expected.thrust_rpyt_out[i], result.thrust_rpyt_out[i]);
+    }
+}
+
+AP_GTEST_MAIN()
@@ -37,3 +37,29 @@ void NavEKF_core_common::fill_scratch_variables(void)
     fill_nanf(&Kfusion[0], sizeof(Kfusion)/sizeof(float));
 #endif
 }
+
+/*
+  rank one covariance update for the fusion of a scalar observation,
+  see sparse_HP()
+ */
+bool NavEKF_core_common::rank_one_covariance_update(Matrix24 &P, const Vector28 &K, const Vector24 &HP, uint8_t stateIndexLim, bool check_variances)
+{
+    if (check_variances) {
+        for (uint8_t i = 0; i <= stateIndexLim; i++) {
+            if (K[i] * HP[i] > P[i][i]) {
+                return false;
+            }
+        }
+    }
+    for (uint8_t i = 0; i <= stateIndexLim; i++) {
+        const ftype Ki = K[i];
+        if (Ki == 0) {
+            // states with zero gain, eg. inhibited states, are not changed
+            continue;
+        }
+        for (uint8_t j = 0; j <= stateIndexLim; j++) {
+            P[i][j] -= Ki * HP[j];
+        }
+    }
+    return true;
+}
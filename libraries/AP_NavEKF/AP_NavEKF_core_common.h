@@ -34,13 +34,46 @@ class NavEKF_core_common {
 public:
     typedef float ftype;
 #if MATH_CHECK_INDEXES
+    typedef VectorN<ftype,24> Vector24;
     typedef VectorN<ftype,28> Vector28;
     typedef VectorN<VectorN<ftype,24>,24> Matrix24;
 #else
+    typedef ftype Vector24[24];
     typedef ftype Vector28[28];
     typedef ftype Matrix24[24][24];
 #endif
 
+    /*
+      the covariance update for the fusion of a scalar observation is
+      P = P - K*H*P. H is sparse for every observation the filters
+      fuse, so this is computed as P = P - K*(H*P), which costs one
+      row-weighted sum per non-zero entry of H plus a single rank one
+      update rather than forming the full KH and KHP products.
+
+      sparse_HP() calculates H*P. The template arguments list the
+      state indexes where H is non-zero, eg.
+        sparse_HP<4,5,6,22,23>(HP, H_TAS, P, stateIndexLim);
+     */
+    template <uint8_t... H_index, typename T>
+    static void sparse_HP(Vector24 &HP, const T &H, const Matrix24 &P, uint8_t stateIndexLim)
+    {
+        const uint8_t index[] = { H_index... };
+        for (uint8_t j = 0; j <= stateIndexLim; j++) {
+            ftype res = 0;
+            for (uint8_t k = 0; k < sizeof...(H_index); k++) {
+                res += H[index[k]] * P[index[k]][j];
+            }
+            HP[j] = res;
+        }
+    }
+
+    /*
+      apply P = P - K*HP over states 0 to stateIndexLim. If
+      check_variances is true the update is skipped and false
+      returned when it would drive any variance negative
+     */
+    static bool rank_one_covariance_update(Matrix24 &P, const Vector28 &K, const Vector24 &HP, uint8_t stateIndexLim, bool check_variances);
+
 protected:
     static Matrix24 KH;                   // intermediate result used for covariance updates
     static Matrix24 KHP;                  // intermediate result used for covariance updates
@@ -16,11 +16,11 @@ void EKFGSF_yaw::Log_Write(uint64_t time_us, LogMessages id0, LogMessages id1, u
         core                    : core_index,
         yaw_composite           : GSF.yaw,
         yaw_composite_variance  : sqrtf(MAX(GSF.yaw_variance, 0.0f)),
-        yaw0                    : EKF[0].X[2],
-        yaw1                    : EKF[1].X[2],
-        yaw2                    : EKF[2].X[2],
-        yaw3                    : EKF[3].X[2],
-        yaw4                    : EKF[4].X[2],
+        yaw0                    : EKF.X[2][0],
+        yaw1                    : EKF.X[2][1],
+        yaw2                    : EKF.X[2][2],
+        yaw3                    : EKF.X[2][3],
+        yaw4                    : EKF.X[2][4],
         wgt0                    : GSF.weights[0],
         wgt1                    : GSF.weights[1],
         wgt2                    : GSF.weights[2],
@@ -33,16 +33,16 @@ void EKFGSF_yaw::Log_Write(uint64_t time_us, LogMessages id0, LogMessages id1, u
         LOG_PACKET_HEADER_INIT(id1),
         time_us                 : time_us,
         core                    : core_index,
-        ivn0                    : EKF[0].innov[0],
-        ivn1                    : EKF[1].innov[0],
-        ivn2                    : EKF[2].innov[0],
-        ivn3                    : EKF[3].innov[0],
-        ivn4                    : EKF[4].innov[0],
-        ive0                    : EKF[0].innov[1],
-        ive1                    : EKF[1].innov[1],
-        ive2                    : EKF[2].innov[1],
-        ive3                    : EKF[3].innov[1],
-        ive4                    : EKF[4].innov[1],
+        ivn0                    : EKF.innov[0][0],
+        ivn1                    : EKF.innov[0][1],
+        ivn2                    : EKF.innov[0][2],
+        ivn3                    : EKF.innov[0][3],
+        ivn4                    : EKF.innov[0][4],
+        ive0                    : EKF.innov[1][0],
+        ive1                    : EKF.innov[1][1],
+        ive2                    : EKF.innov[1][2],
+        ive3                    : EKF.innov[1][3],
+        ive4                    : EKF.innov[1][4],
     };
     AP::logger().WriteBlock(&ky1, sizeof(ky1));
 }
@@ -31,6 +31,11 @@ public:
     // set the gyro bias in rad/sec
     void setGyroBias(Vector3f &gyroBias);
 
+    // set the number of IMU updates accumulated for each prediction of the
+    // filter bank. Velocity fusion first applies any accumulated IMU data so
+    // the prediction and correction stay time aligned
+    void setDecimation(uint8_t ratio);
+
     // get yaw estimated and corresponding variance
     // return false if yaw estimation is inactive
     bool getYawData(float &yaw, float &yawVariance) const;
@@ -64,6 +69,9 @@ private:
     const float EKFGSF_gyroBiasGain{0.04f}; // gain applied to integral of gyro correction for complementary filter (1/sec)
     const float EKFGSF_accelFiltRatio{10.0f}; // ratio  of time constant of AHRS tilt correction to time constant of first order LPF applied to accel data used by ahrs
 
+    // The AHRS and EKF model banks are stored as structures of arrays indexed by model last, so that
+    // each step of the algorithm runs across all models in a single pass over contiguous data.
+
     // Declarations used by the bank of AHRS complementary filters that use IMU data augmented by true
     // airspeed data when in fixed wing mode to estimate the quaternions that are used to rotate IMU data into a
     // Front, Right, Yaw frame of reference.
@@ -72,26 +80,35 @@ private:
     float angle_dt;
     float velocity_dt;
     struct ahrs_struct {
-        Matrix3f R;             // matrix that rotates a vector from body to earth frame
-        Vector3f gyro_bias;     // gyro bias learned and used by the quaternion calculation
-        bool aligned{false};    // true when AHRS has been aligned
-        float accel_FR[2];      // front-right acceleration vector in a horizontal plane (m/s/s)
-        float vel_NE[2];        // NE velocity vector from last GPS measurement (m/s)
-        bool fuse_gps;          // true when GPS should be fused on that frame
-        float accel_dt;         // time step used when generating _simple_accel_FR data (sec)
+        float R[3][3][N_MODELS_EKFGSF];     // matrices that rotate a vector from body to earth frame
+        float gyro_bias[3][N_MODELS_EKFGSF]; // gyro bias learned and used by the quaternion calculation
     };
-    ahrs_struct AHRS[N_MODELS_EKFGSF];
+    ahrs_struct AHRS;
     bool ahrs_tilt_aligned;         // true the initial tilt alignment has been calculated
     float accel_gain;               // gain from accel vector tilt error to rate gyro correction used by AHRS calculation
     Vector3f ahrs_accel;            // filtered body frame specific force vector used by AHRS calculation (m/s/s)
     float ahrs_accel_norm;          // length of body frame specific force vector used by AHRS calculation (m/s/s)
     float true_airspeed;            // true airspeed used to correct for centripetal acceleratoin in coordinated turns (m/s)
 
-    // Runs quaternion prediction for the selected AHRS using IMU (and optionally true airspeed) data
-    void predictAHRS(const uint8_t mdl_idx);
+    // IMU data accumulated between predictions when running at a decimated rate
+    uint8_t decimation{1};          // number of IMU updates accumulated for each prediction
+    uint8_t imu_count;              // number of IMU updates accumulated so far
+    Quaternion imu_quat;            // rotation accumulated since the start of the accumulation
+    Vector3f imu_del_vel;           // delta velocity accumulated in the body frame at the start of the accumulation (m/s)
+    float imu_ang_dt;               // accumulated delta angle time interval (sec)
+    float imu_vel_dt;               // accumulated delta velocity time interval (sec)
+
+    // Runs the AHRS and EKF prediction using the IMU data in delta_angle, delta_velocity, angle_dt and velocity_dt
+    void runPrediction();
+
+    // Runs the prediction using the accumulated IMU data and restarts the accumulation
+    void applyAccumulatedIMU();
+
+    // Runs quaternion prediction for all AHRS using IMU (and optionally true airspeed) data
+    void predictAHRS();
 
-    // Applies a body frame delta angle to a body to earth frame rotation matrix using a small angle approximation
-    Matrix3f updateRotMat(const Matrix3f &R, const Vector3f &g) const;
+    // Applies a body frame delta angle to the body to earth frame rotation matrix of each AHRS using a small angle approximation
+    void updateRotMat(const float g[3][N_MODELS_EKFGSF]);
 
     // Initialises the tilt (roll and pitch) for all AHRS using IMU acceleration data
     void alignTilt();
@@ -102,27 +119,27 @@ private:
     // The Following declarations are used by bank of EKF's that estimate yaw angle starting from a different yaw hypothesis for each filter.
 
     struct EKF_struct {
-        float X[3];     // Vel North (m/s),  Vel East (m/s), yaw (rad)
-        float P[3][3];  // covariance matrix
-        float S[2][2];  // N,E velocity innovation variance (m/s)^2
-        float innov[2]; // Velocity N,E innovation (m/s)
+        float X[3][N_MODELS_EKFGSF];        // Vel North (m/s),  Vel East (m/s), yaw (rad)
+        float P[3][3][N_MODELS_EKFGSF];     // covariance matrix
+        float S[2][2][N_MODELS_EKFGSF];     // N,E velocity innovation variance (m/s)^2
+        float innov[2][N_MODELS_EKFGSF];    // Velocity N,E innovation (m/s)
     };
-    EKF_struct EKF[N_MODELS_EKFGSF];
+    EKF_struct EKF;
     bool vel_fuse_running;  // true when the bank of EKF's has started fusing GPS velocity data
     bool run_ekf_gsf;       // true when operating condition is suitable for to run the GSF and EKF models and fuse velocity data
 
     // Resets states and covariances for the EKF's and GSF including GSF weights, but not the AHRS complementary filters
     void resetEKFGSF();
 
-    // Runs the state and covariance prediction for the selected EKF
-    void predict(const uint8_t mdl_idx);
+    // Runs the state and covariance prediction for all EKFs
+    void predict();
 
-    // Runs the state and covariance update for the selected EKF using the GPS NE velocity measurement
-    // Returns false if the sttae and covariance correction failed
-    bool correct(const uint8_t mdl_idx, const Vector2f &vel, const float velObsVar);
+    // Runs the state and covariance update for all EKFs using the GPS NE velocity measurement
+    // Returns false if the state and covariance correction failed for any model
+    bool correct(const Vector2f &vel, const float velObsVar);
 
-    // Forces symmetry on the covariance matrix for the selected EKF
-    void forceSymmetry(const uint8_t mdl_idx);
+    // Forces symmetry on the covariance matrix for all EKFs
+    void forceSymmetry();
 
     // The following declarations are used  by the Gaussian Sum Filter that combines the state estimates from the bank of
     // EKF's to form a single state estimate.
@@ -0,0 +1,105 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_NavEKF/AP_NavEKF_core_common.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  time the scalar observation covariance update for the observation
+  Jacobian sparsity of each of the EKF3 fusion steps. The gains are
+  small enough that the variances stay well conditioned over many
+  iterations so the variance check always passes
+ */
+class CovarianceUpdate_Bench : public NavEKF_core_common
+{
+public:
+    CovarianceUpdate_Bench()
+    {
+        for (uint8_t i = 0; i < 24; i++) {
+            for (uint8_t j = 0; j < 24; j++) {
+                P[i][j] = (i == j) ? 1.0f : 0.0f;
+            }
+            H[i] = 1.0e-4f;
+            Kfusion[i] = 1.0e-4f;
+        }
+    }
+
+    template <uint8_t... H_index>
+    void update()
+    {
+        Vector24 HP;
+        sparse_HP<H_index...>(HP, H, P, 23);
+        rank_one_covariance_update(P, Kfusion, HP, 23, true);
+    }
+
+    Matrix24 P;
+    Vector24 H;
+};
+
+static CovarianceUpdate_Bench bench;
+
+static void BM_CovarianceUpdateMag(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<0,1,2,3,16,17,18,19,20,21>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateAirspeed(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<4,5,6,22,23>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateSideslip(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<0,1,2,3,4,5,6,22,23>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateOptFlow(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<0,1,2,3,4,5,6>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateYaw(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<0,1,2,3>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateRangeBeacon(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<7,8,9>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+static void BM_CovarianceUpdateDeclination(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        bench.update<16,17>();
+        gbenchmark_escape(&bench.P);
+    }
+}
+
+BENCHMARK(BM_CovarianceUpdateMag);
+BENCHMARK(BM_CovarianceUpdateAirspeed);
+BENCHMARK(BM_CovarianceUpdateSideslip);
+BENCHMARK(BM_CovarianceUpdateOptFlow);
+BENCHMARK(BM_CovarianceUpdateYaw);
+BENCHMARK(BM_CovarianceUpdateRangeBeacon);
+BENCHMARK(BM_CovarianceUpdateDeclination);
+
+BENCHMARK_MAIN();
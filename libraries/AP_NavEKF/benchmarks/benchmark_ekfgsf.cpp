@@ -0,0 +1,41 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_NavEKF/EKFGSF_yaw.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  time one IMU update of the yaw estimator filter bank in flight, with
+  GPS velocity fused every 40th update as it would be at 400Hz/10Hz.
+  The argument is the decimation ratio
+ */
+static void BM_EKFGSFUpdate(benchmark::State& state)
+{
+    EKFGSF_yaw *gsf = new EKFGSF_yaw();
+    gsf->setDecimation(state.range(0));
+
+    const float dt = 0.0025f;
+    const Vector3f del_ang(0.001f * dt, -0.0005f * dt, 0.05f * dt);
+    const Vector3f del_vel(0.0f, 0.5f * dt, -GRAVITY_MSS * dt);
+
+    // align the tilt and start the EKF models
+    for (uint8_t i = 0; i < 40; i++) {
+        gsf->update(del_ang, del_vel, dt, dt, true, 0.0f);
+    }
+    gsf->fuseVelData(Vector2f(10.0f, 0.0f), 0.3f);
+
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        gsf->update(del_ang, del_vel, dt, dt, true, 0.0f);
+        if (++n % 40 == 0) {
+            gsf->fuseVelData(Vector2f(10.0f, 0.0f), 0.3f);
+        }
+        gbenchmark_escape(gsf);
+    }
+    delete gsf;
+}
+
+BENCHMARK(BM_EKFGSFUpdate)->Arg(1)->Arg(2)->Arg(4);
+
+BENCHMARK_MAIN();
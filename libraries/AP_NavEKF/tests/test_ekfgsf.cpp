@@ -0,0 +1,115 @@
+#include <AP_gtest.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_NavEKF/EKFGSF_yaw.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+/*
+  a level flight at 400Hz: stationary for 10 seconds, accelerate
+  forwards to 10m/s on a heading of 63 degrees and then weave with a
+  sinusoidal yaw rate. GPS velocity is fused at 10Hz.
+ */
+class GSFFlight
+{
+public:
+    static constexpr float dt = 0.0025f;
+
+    GSFFlight(uint8_t decimation)
+    {
+        // allocate like the EKF does, relying on new zeroing the memory
+        gsf = new EKFGSF_yaw();
+        if (decimation > 1) {
+            gsf->setDecimation(decimation);
+        }
+    }
+
+    ~GSFFlight()
+    {
+        delete gsf;
+    }
+
+    // advance by one IMU sample, returning the true yaw
+    float step()
+    {
+        const float t = n * dt;
+        const float yaw_rate = t > 20.0f ? 0.1f * sinf(0.2f * t) : 0.0f;
+        const float speed = t > 10.0f ? MIN((t - 10.0f) * 2.0f, 10.0f) : 0.0f;
+        const float accel_fwd = (t > 10.0f && speed < 10.0f) ? 2.0f : 0.0f;
+        yaw = wrap_PI(yaw + yaw_rate * dt);
+
+        // small gyro bias and white noise, each flight has its own
+        // generator so flights stepped together see the same noise
+        rand_state = rand_state * 1103515245U + 12345U;
+        const float noise = ((int32_t)((rand_state >> 16) % 1000) - 500) * 2e-8f;
+        const Vector3f del_ang(0.001f * dt + noise, -0.0005f * dt, yaw_rate * dt);
+        const Vector3f del_vel((accel_fwd + noise * 100.0f) * dt, speed * yaw_rate * dt, -GRAVITY_MSS * dt);
+        gsf->update(del_ang, del_vel, dt, dt, t > 10.0f, 0.0f);
+
+        if (n % 40 == 0) {
+            gsf->fuseVelData(Vector2f(speed * cosf(yaw), speed * sinf(yaw)), 0.3f);
+        }
+        n++;
+        return yaw;
+    }
+
+    float time() const { return n * dt; }
+
+    EKFGSF_yaw *gsf;
+
+private:
+    uint32_t n = 0;
+    uint32_t rand_state = 0x47534659;
+    float yaw = 1.1f;
+};
+
+TEST(EKFGSF, SyntheticFlightConverges)
+{
+    GSFFlight flight(1);
+
+    float max_error = 0.0f;
+    while (flight.time() < 120.0f) {
+        const float true_yaw = flight.step();
+        float yaw, yaw_variance;
+        const bool valid = flight.gsf->getYawData(yaw, yaw_variance);
+        if (flight.time() > 11.0f) {
+            EXPECT_TRUE(valid);
+        }
+        if (flight.time() > 60.0f) {
+            ASSERT_TRUE(valid);
+            ASSERT_FALSE(isnan(yaw) || isnan(yaw_variance));
+            max_error = MAX(max_error, fabsf(wrap_PI(yaw - true_yaw)));
+            EXPECT_LT(yaw_variance, sq(radians(10.0f)));
+        }
+    }
+    EXPECT_LT(max_error, 0.15f);
+}
+
+/*
+  running the filter bank on accumulated IMU data must stay close to
+  the full rate estimate
+ */
+TEST(EKFGSF, DecimatedTracksFullRate)
+{
+    for (uint8_t decimation = 2; decimation <= 8; decimation *= 2) {
+        GSFFlight full(1);
+        GSFFlight decimated(decimation);
+
+        float max_diff = 0.0f;
+        while (full.time() < 120.0f) {
+            full.step();
+            decimated.step();
+            float yaw_full, yaw_decimated, var;
+            const bool full_valid = full.gsf->getYawData(yaw_full, var);
+            const bool decimated_valid = decimated.gsf->getYawData(yaw_decimated, var);
+            EXPECT_EQ(full_valid, decimated_valid);
+            if (full.time() > 60.0f) {
+                ASSERT_TRUE(full_valid && decimated_valid);
+                max_diff = MAX(max_diff, fabsf(wrap_PI(yaw_full - yaw_decimated)));
+            }
+        }
+        EXPECT_LT(max_diff, 0.1f) << "decimation " << (unsigned)decimation;
+    }
+}
+
+AP_GTEST_MAIN()
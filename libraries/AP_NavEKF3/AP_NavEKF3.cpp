@@ -712,6 +712,23 @@ const AP_Param::GroupInfo NavEKF3::var_info2[] = {
     // @User: Advanced
     AP_GROUPINFO("GND_EFF_DZ", 7, NavEKF3, _baroGndEffectDeadZone, 4.0f),
 
+    // @Param: FUSE_BUDGET
+    // @DisplayName: Fusion budget per frame
+    // @Description: This sets the number of scalar observations the EKF may fuse in one update before the position, velocity, range beacon, optical flow, body odometry, airspeed and sideslip or drag fusion is deferred to the next update, spreading the processor load more evenly across updates. A fusion step is never deferred on two consecutive updates. When set to 0 there is no budget and, when the IMU is running faster than 200Hz, all of these except range beacon fusion are deferred on updates that fused magnetometer data. Set to -1 to never defer fusion. The XKFU log message records how often fusion was deferred.
+    // @Range: -1 24
+    // @Increment: 1
+    // @User: Advanced
+    AP_GROUPINFO("FUSE_BUDGET", 8, NavEKF3, _fusionBudget, 0),
+
+    // @Param: GSF_DECIM
+    // @DisplayName: EKF-GSF yaw estimator decimation
+    // @Description: This sets the number of IMU updates the EKF-GSF yaw estimator accumulates before running its prediction, reducing the processor load of each estimator enabled by EK3_GSF_RUN_MASK. GPS velocity fusion always uses the IMU data accumulated up to the time of fusion. A value of 1 runs the estimator at the IMU rate.
+    // @Range: 1 4
+    // @Increment: 1
+    // @User: Advanced
+    // @RebootRequired: True
+    AP_GROUPINFO("GSF_DECIM", 9, NavEKF3, _gsfDecimation, 1),
+
     AP_GROUPEND
 };
 
@@ -424,6 +424,8 @@ private:
     AP_Int8 _betaMask;              // Bitmask controlling when sideslip angle fusion is used to estimate non wind states
     AP_Float _ognmTestScaleFactor;  // Scale factor applied to the thresholds used by the on ground not moving test
     AP_Float _baroGndEffectDeadZone;// Dead zone applied to positive baro height innovations when in ground effect (m)
+    AP_Int8 _fusionBudget;          // Number of scalar observations fused per frame before fusion is deferred to a later frame, 0 for automatic, -1 for unlimited
+    AP_Int8 _gsfDecimation;         // Number of IMU updates accumulated for each EKF-GSF yaw estimator prediction
 
 // Possible values for _flowUse
 #define FLOW_USE_NONE    0
@@ -151,38 +151,7 @@ void NavEKF3_core::FuseAirspeed()
             stateStruct.quat.normalize();
 
             // correct the covariance P = (I - K*H)*P
-            // take advantage of the empty columns in KH to reduce the
-            // number of operations
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                for (unsigned j = 0; j<=3; j++) {
-                    KH[i][j] = 0.0f;
-                }
-                for (unsigned j = 4; j<=6; j++) {
-                    KH[i][j] = Kfusion[i] * H_TAS[j];
-                }
-                for (unsigned j = 7; j<=21; j++) {
-                    KH[i][j] = 0.0f;
-                }
-                for (unsigned j = 22; j<=23; j++) {
-                    KH[i][j] = Kfusion[i] * H_TAS[j];
-                }
-            }
-            for (unsigned j = 0; j<=stateIndexLim; j++) {
-                for (unsigned i = 0; i<=stateIndexLim; i++) {
-                    ftype res = 0;
-                    res += KH[i][4] * P[4][j];
-                    res += KH[i][5] * P[5][j];
-                    res += KH[i][6] * P[6][j];
-                    res += KH[i][22] * P[22][j];
-                    res += KH[i][23] * P[23][j];
-                    KHP[i][j] = res;
-                }
-            }
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                for (unsigned j = 0; j<=stateIndexLim; j++) {
-                    P[i][j] = P[i][j] - KHP[i][j];
-                }
-            }
+            SparseCovarianceUpdate<4,5,6,22,23>(H_TAS, false);
         }
     }
 
@@ -194,14 +163,10 @@ void NavEKF3_core::FuseAirspeed()
 // select fusion of true airspeed measurements
 void NavEKF3_core::SelectTasFusion()
 {
-    // Check if the magnetometer has been fused on that time step and the filter is running at faster than 200 Hz
-    // If so, don't fuse measurements on this time step to reduce frame over-runs
-    // Only allow one time slip to prevent high rate magnetometer data locking out fusion of other measurements
-    if (magFusePerformed && dtIMUavg < 0.005f && !airSpdFusionDelayed) {
-        airSpdFusionDelayed = true;
+    // leave the measurements in the buffer for a later frame if the fusion
+    // already performed on this frame has used up the fusion budget
+    if (deferFusion(FusionStep::TAS)) {
         return;
-    } else {
-        airSpdFusionDelayed = false;
     }
 
     // get true airspeed measurement
@@ -221,14 +186,10 @@ void NavEKF3_core::SelectTasFusion()
 // it requires a stable wind for best results and should not be used for aerobatic flight
 void NavEKF3_core::SelectBetaDragFusion()
 {
-    // Check if the magnetometer has been fused on that time step and the filter is running at faster than 200 Hz
-    // If so, don't fuse measurements on this time step to reduce frame over-runs
-    // Only allow one time slip to prevent high rate magnetometer data preventing fusion of other measurements
-    if (magFusePerformed && dtIMUavg < 0.005f && !sideSlipFusionDelayed) {
-        sideSlipFusionDelayed = true;
+    // leave the measurements in the buffer for a later frame if the fusion
+    // already performed on this frame has used up the fusion budget
+    if (deferFusion(FusionStep::BETADRAG)) {
         return;
-    } else {
-        sideSlipFusionDelayed = false;
     }
 
     // set true when the fusion time interval has triggered
@@ -442,39 +403,7 @@ void NavEKF3_core::FuseSideslip()
         stateStruct.quat.normalize();
 
         // correct the covariance P = (I - K*H)*P
-        // take advantage of the empty columns in KH to reduce the
-        // number of operations
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            for (unsigned j = 0; j<=6; j++) {
-                KH[i][j] = Kfusion[i] * H_BETA[j];
-            }
-            for (unsigned j = 7; j<=21; j++) {
-                KH[i][j] = 0.0f;
-            }
-            for (unsigned j = 22; j<=23; j++) {
-                KH[i][j] = Kfusion[i] * H_BETA[j];
-            }
-        }
-        for (unsigned j = 0; j<=stateIndexLim; j++) {
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                ftype res = 0;
-                res += KH[i][0] * P[0][j];
-                res += KH[i][1] * P[1][j];
-                res += KH[i][2] * P[2][j];
-                res += KH[i][3] * P[3][j];
-                res += KH[i][4] * P[4][j];
-                res += KH[i][5] * P[5][j];
-                res += KH[i][6] * P[6][j];
-                res += KH[i][22] * P[22][j];
-                res += KH[i][23] * P[23][j];
-                KHP[i][j] = res;
-            }
-        }
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            for (unsigned j = 0; j<=stateIndexLim; j++) {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
+        SparseCovarianceUpdate<0,1,2,3,4,5,6,22,23>(H_BETA, false);
     }
 
     // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
@@ -717,39 +646,7 @@ void NavEKF3_core::FuseDragForces()
         stateStruct.quat.normalize();
 
         // correct the covariance P = (I - K*H)*P
-        // take advantage of the empty columns in KH to reduce the
-        // number of operations
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            for (unsigned j = 0; j<=6; j++) {
-                KH[i][j] = Kfusion[i] * Hfusion[j];
-            }
-            for (unsigned j = 7; j<=21; j++) {
-                KH[i][j] = 0.0f;
-            }
-            for (unsigned j = 22; j<=23; j++) {
-                KH[i][j] = Kfusion[i] * Hfusion[j];
-            }
-        }
-        for (unsigned j = 0; j<=stateIndexLim; j++) {
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                ftype res = 0;
-                res += KH[i][0] * P[0][j];
-                res += KH[i][1] * P[1][j];
-                res += KH[i][2] * P[2][j];
-                res += KH[i][3] * P[3][j];
-                res += KH[i][4] * P[4][j];
-                res += KH[i][5] * P[5][j];
-                res += KH[i][6] * P[6][j];
-                res += KH[i][22] * P[22][j];
-                res += KH[i][23] * P[23][j];
-                KHP[i][j] = res;
-            }
-        }
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            for (unsigned j = 0; j<=stateIndexLim; j++) {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
+        SparseCovarianceUpdate<0,1,2,3,4,5,6,22,23>(Hfusion, false);
     }
 }
 #endif // EK3_FEATURE_DRAG_FUSION
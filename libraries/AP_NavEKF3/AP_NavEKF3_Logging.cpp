@@ -387,6 +387,8 @@ void NavEKF3_core::Log_Write(uint64_t time_us)
     Log_Write_State_Variances(time_us);
 
     Log_Write_Timing(time_us);
+
+    Log_Write_FusionSchedule(time_us);
 }
 
 void NavEKF3_core::Log_Write_Timing(uint64_t time_us)
@@ -417,6 +419,38 @@ void NavEKF3_core::Log_Write_Timing(uint64_t time_us)
     AP::logger().WriteBlock(&xkt, sizeof(xkt));
 }
 
+void NavEKF3_core::Log_Write_FusionSchedule(uint64_t time_us)
+{
+    // log fusion scheduler statistics every 5s
+    const uint32_t now_ms = AP::dal().millis();
+    if (now_ms - fusionSchedule.last_log_ms <= 5000) {
+        return;
+    }
+    fusionSchedule.last_log_ms = now_ms;
+
+    const struct log_XKFU xkfu{
+        LOG_PACKET_HEADER_INIT(LOG_XKFU_MSG),
+        time_us      : time_us,
+        core         : core_index,
+        frames       : fusionSchedule.frames,
+        obs          : fusionSchedule.obs,
+        obs_max      : fusionSchedule.obs_max,
+        budget       : fusionBudget(),
+        def_velpos   : fusionSchedule.deferred[uint8_t(FusionStep::VELPOS)],
+        def_rngbcn   : fusionSchedule.deferred[uint8_t(FusionStep::RNGBCN)],
+        def_flow     : fusionSchedule.deferred[uint8_t(FusionStep::FLOW)],
+        def_bodyodom : fusionSchedule.deferred[uint8_t(FusionStep::BODYODOM)],
+        def_tas      : fusionSchedule.deferred[uint8_t(FusionStep::TAS)],
+        def_betadrag : fusionSchedule.deferred[uint8_t(FusionStep::BETADRAG)],
+    };
+    fusionSchedule.frames = 0;
+    fusionSchedule.obs = 0;
+    fusionSchedule.obs_max = 0;
+    memset(&fusionSchedule.deferred, 0, sizeof(fusionSchedule.deferred));
+
+    AP::logger().WriteBlock(&xkfu, sizeof(xkfu));
+}
+
 void NavEKF3_core::Log_Write_GSF(uint64_t time_us)
 {
     if (yawEstimator == nullptr) {
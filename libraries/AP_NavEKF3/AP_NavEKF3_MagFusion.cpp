@@ -193,10 +193,6 @@ void NavEKF3_core::alignYawAngle(const yaw_elements &yawAngData)
 // select fusion of magnetometer data
 void NavEKF3_core::SelectMagFusion()
 {
-    // clear the flag that lets other processes know that the expensive magnetometer fusion operation has been performed on that time step
-    // used for load levelling
-    magFusePerformed = false;
-
     // get default yaw source
     const AP_NavEKF_Source::SourceYaw yaw_source = frontend->sources.getYawSource();
     if (yaw_source != yaw_source_last) {
@@ -643,10 +639,6 @@ void NavEKF3_core::FuseMagnetometer()
                 // zero indexes 22 to 23 = 2*4 bytes
                 memset(&Kfusion[22], 0, 8);
             }
-
-            // set flags to indicate to other processes that fusion has been performed and is required on the next frame
-            // this can be used by other fusion processes to avoid fusing on the same frame as this expensive step
-            magFusePerformed = true;
         } else if (obsIndex == 1) { // Fuse Y axis
 
             // calculate observation jacobians
@@ -724,10 +716,6 @@ void NavEKF3_core::FuseMagnetometer()
                 // zero indexes 22 to 23 = 2*4 bytes
                 memset(&Kfusion[22], 0, 8);
             }
-
-            // set flags to indicate to other processes that fusion has been performed and is required on the next frame
-            // this can be used by other fusion processes to avoid fusing on the same frame as this expensive step
-            magFusePerformed = true;
         }
         else if (obsIndex == 2) // we are now fusing the Z measurement
         {
@@ -806,59 +794,15 @@ void NavEKF3_core::FuseMagnetometer()
                 // zero indexes 22 to 23 = 2*4 bytes
                 memset(&Kfusion[22], 0, 8);
             }
-
-            // set flags to indicate to other processes that fusion has been performed and is required on the next frame
-            // this can be used by other fusion processes to avoid fusing on the same frame as this expensive step
-            magFusePerformed = true;
-        }
-        // correct the covariance P = (I - K*H)*P
-        // take advantage of the empty columns in KH to reduce the
-        // number of operations
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            for (unsigned j = 0; j<=3; j++) {
-                KH[i][j] = Kfusion[i] * H_MAG[j];
-            }
-            for (unsigned j = 4; j<=15; j++) {
-                KH[i][j] = 0.0f;
-            }
-            for (unsigned j = 16; j<=21; j++) {
-                KH[i][j] = Kfusion[i] * H_MAG[j];
-            }
-            for (unsigned j = 22; j<=23; j++) {
-                KH[i][j] = 0.0f;
-            }
-        }
-        for (unsigned j = 0; j<=stateIndexLim; j++) {
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                ftype res = 0;
-                res += KH[i][0] * P[0][j];
-                res += KH[i][1] * P[1][j];
-                res += KH[i][2] * P[2][j];
-                res += KH[i][3] * P[3][j];
-                res += KH[i][16] * P[16][j];
-                res += KH[i][17] * P[17][j];
-                res += KH[i][18] * P[18][j];
-                res += KH[i][19] * P[19][j];
-                res += KH[i][20] * P[20][j];
-                res += KH[i][21] * P[21][j];
-                KHP[i][j] = res;
-            }
         }
-        // Check that we are not going to drive any variances negative and skip the update if so
-        bool healthyFusion = true;
-        for (uint8_t i= 0; i<=stateIndexLim; i++) {
-            if (KHP[i][i] > P[i][i]) {
-                healthyFusion = false;
-            }
-        }
-        if (healthyFusion) {
-            // update the covariance matrix
-            for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                    P[i][j] = P[i][j] - KHP[i][j];
-                }
-            }
+        // let the fusion scheduler know this frame has had the expensive
+        // magnetometer fusion
+        fusionSchedule.mag_fused = true;
 
+        // correct the covariance P = (I - K*H)*P, skipping the update if
+        // it would drive any variances negative
+        const bool healthyFusion = SparseCovarianceUpdate<0,1,2,3,16,17,18,19,20,21>(H_MAG, true);
+        if (healthyFusion) {
             // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
             ForceSymmetry();
             ConstrainVariances();
@@ -1175,38 +1119,10 @@ bool NavEKF3_core::fuseEulerYaw(yawFusionMethod method)
         magHealth = true;
     }
 
-    // correct the covariance using P = P - K*H*P taking advantage of the fact that only the first 3 elements in H are non zero
-    // calculate K*H*P
-    for (uint8_t row = 0; row <= stateIndexLim; row++) {
-        for (uint8_t column = 0; column <= 3; column++) {
-            KH[row][column] = Kfusion[row] * H_YAW[column];
-        }
-    }
-    for (uint8_t row = 0; row <= stateIndexLim; row++) {
-        for (uint8_t column = 0; column <= stateIndexLim; column++) {
-            float tmp = KH[row][0] * P[0][column];
-            tmp += KH[row][1] * P[1][column];
-            tmp += KH[row][2] * P[2][column];
-            tmp += KH[row][3] * P[3][column];
-            KHP[row][column] = tmp;
-        }
-    }
-
-    // Check that we are not going to drive any variances negative and skip the update if so
-    bool healthyFusion = true;
-    for (uint8_t i= 0; i<=stateIndexLim; i++) {
-        if (KHP[i][i] > P[i][i]) {
-            healthyFusion = false;
-        }
-    }
+    // correct the covariance using P = P - K*H*P taking advantage of the fact that only the first 4 elements in H are non zero,
+    // skipping the update if it would drive any variances negative
+    const bool healthyFusion = SparseCovarianceUpdate<0,1,2,3>(H_YAW, true);
     if (healthyFusion) {
-        // update the covariance matrix
-        for (uint8_t i= 0; i<=stateIndexLim; i++) {
-            for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
-
         // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
         ForceSymmetry();
         ConstrainVariances();
@@ -1356,41 +1272,10 @@ void NavEKF3_core::FuseDeclination(float declErr)
         innovation = -0.5f;
     }
 
-    // correct the covariance P = (I - K*H)*P
-    // take advantage of the empty columns in KH to reduce the
-    // number of operations
-    for (unsigned i = 0; i<=stateIndexLim; i++) {
-        for (unsigned j = 0; j<=15; j++) {
-            KH[i][j] = 0.0f;
-        }
-        KH[i][16] = Kfusion[i] * H_DECL[16];
-        KH[i][17] = Kfusion[i] * H_DECL[17];
-        for (unsigned j = 18; j<=23; j++) {
-            KH[i][j] = 0.0f;
-        }
-    }
-    for (unsigned j = 0; j<=stateIndexLim; j++) {
-        for (unsigned i = 0; i<=stateIndexLim; i++) {
-            KHP[i][j] = KH[i][16] * P[16][j] + KH[i][17] * P[17][j];
-        }
-    }
-
-    // Check that we are not going to drive any variances negative and skip the update if so
-    bool healthyFusion = true;
-    for (uint8_t i= 0; i<=stateIndexLim; i++) {
-        if (KHP[i][i] > P[i][i]) {
-            healthyFusion = false;
-        }
-    }
-
+    // correct the covariance P = (I - K*H)*P, skipping the update if
+    // it would drive any variances negative
+    const bool healthyFusion = SparseCovarianceUpdate<16,17>(H_DECL, true);
     if (healthyFusion) {
-        // update the covariance matrix
-        for (uint8_t i= 0; i<=stateIndexLim; i++) {
-            for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                P[i][j] = P[i][j] - KHP[i][j];
-            }
-        }
-
         // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
         ForceSymmetry();
         ConstrainVariances();
@@ -945,6 +945,11 @@ void NavEKF3_core::readRngBcnData()
         rngBcnGoodToAlign = false;
     }
 
+    // A measurement whose fusion was deferred on the last frame is still waiting to be fused
+    if (rngBcnDataToFuse && (fusionSchedule.deferred_mask & (1U << uint8_t(FusionStep::RNGBCN)))) {
+        return;
+    }
+
     // Check the buffer for measurements that have been overtaken by the fusion time horizon and need to be fused
     rngBcnDataToFuse = storedRangeBeacon.recall(rngBcnDataDelayed, imuDataDelayed.time_ms);
 
@@ -15,14 +15,10 @@
 // select fusion of optical flow measurements
 void NavEKF3_core::SelectFlowFusion()
 {
-    // Check if the magnetometer has been fused on that time step and the filter is running at faster than 200 Hz
-    // If so, don't fuse measurements on this time step to reduce frame over-runs
-    // Only allow one time slip to prevent high rate magnetometer data preventing fusion of other measurements
-    if (magFusePerformed && dtIMUavg < 0.005f && !optFlowFusionDelayed) {
-        optFlowFusionDelayed = true;
+    // leave the measurements in the buffer for a later frame if the fusion
+    // already performed on this frame has used up the fusion budget
+    if (deferFusion(FusionStep::FLOW)) {
         return;
-    } else {
-        optFlowFusionDelayed = false;
     }
 
     of_elements ofDataDelayed;      // OF data at the fusion time horizon
@@ -690,47 +686,10 @@ void NavEKF3_core::FuseOptFlow(const of_elements &ofDataDelayed)
                 flowFusionActive = true;
                 GCS_SEND_TEXT(MAV_SEVERITY_INFO, "EKF3 IMU%u fusing optical flow",(unsigned)imu_index);
             }
-            // correct the covariance P = (I - K*H)*P
-            // take advantage of the empty columns in KH to reduce the
-            // number of operations
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                for (unsigned j = 0; j<=6; j++) {
-                    KH[i][j] = Kfusion[i] * H_LOS[j];
-                }
-                for (unsigned j = 7; j<=stateIndexLim; j++) {
-                    KH[i][j] = 0.0f;
-                }
-            }
-            for (unsigned j = 0; j<=stateIndexLim; j++) {
-                for (unsigned i = 0; i<=stateIndexLim; i++) {
-                    ftype res = 0;
-                    res += KH[i][0] * P[0][j];
-                    res += KH[i][1] * P[1][j];
-                    res += KH[i][2] * P[2][j];
-                    res += KH[i][3] * P[3][j];
-                    res += KH[i][4] * P[4][j];
-                    res += KH[i][5] * P[5][j];
-                    res += KH[i][6] * P[6][j];
-                    KHP[i][j] = res;
-                }
-            }
-
-            // Check that we are not going to drive any variances negative and skip the update if so
-            bool healthyFusion = true;
-            for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                if (KHP[i][i] > P[i][i]) {
-                    healthyFusion = false;
-                }
-            }
-
+            // correct the covariance P = (I - K*H)*P, skipping the update if
+            // it would drive any variances negative
+            const bool healthyFusion = SparseCovarianceUpdate<0,1,2,3,4,5,6>(H_LOS, true);
             if (healthyFusion) {
-                // update the covariance matrix
-                for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                    for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                        P[i][j] = P[i][j] - KHP[i][j];
-                    }
-                }
-
                 // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
                 ForceSymmetry();
                 ConstrainVariances();
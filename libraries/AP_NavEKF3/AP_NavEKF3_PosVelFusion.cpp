@@ -413,14 +413,10 @@ void NavEKF3_core::CalculateVelInnovationsAndVariances(const Vector3f &velocity,
 // select fusion of velocity, position and height measurements
 void NavEKF3_core::SelectVelPosFusion()
 {
-    // Check if the magnetometer has been fused on that time step and the filter is running at faster than 200 Hz
-    // If so, don't fuse measurements on this time step to reduce frame over-runs
-    // Only allow one time slip to prevent high rate magnetometer data preventing fusion of other measurements
-    if (magFusePerformed && dtIMUavg < 0.005f && !posVelFusionDelayed) {
-        posVelFusionDelayed = true;
+    // leave the measurements in the buffer for a later frame if the fusion
+    // already performed on this frame has used up the fusion budget
+    if (deferFusion(FusionStep::VELPOS)) {
         return;
-    } else {
-        posVelFusionDelayed = false;
     }
 
 #if EK3_FEATURE_EXTERNAL_NAV
@@ -935,28 +931,10 @@ void NavEKF3_core::FuseVelPosNED()
                     memset(&Kfusion[22], 0, 8);
                 }
 
-                // update the covariance - take advantage of direct observation of a single state at index = stateIndex to reduce computations
-                // this is a numerically optimised implementation of standard equation P = (I - K*H)*P;
-                for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                    for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                        KHP[i][j] = Kfusion[i] * P[stateIndex][j];
-                    }
-                }
-                // Check that we are not going to drive any variances negative and skip the update if so
-                bool healthyFusion = true;
-                for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                    if (KHP[i][i] > P[i][i]) {
-                        healthyFusion = false;
-                    }
-                }
+                // update the covariance P = (I - K*H)*P for the direct observation of a single state at index = stateIndex,
+                // skipping the update if it would drive any variances negative
+                const bool healthyFusion = DirectCovarianceUpdate(stateIndex, true);
                 if (healthyFusion) {
-                    // update the covariance matrix
-                    for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                        for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                            P[i][j] = P[i][j] - KHP[i][j];
-                        }
-                    }
-
                     // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
                     ForceSymmetry();
                     ConstrainVariances();
@@ -1788,47 +1766,10 @@ void NavEKF3_core::FuseBodyVel()
                 bodyVelFusionActive = true;
                 GCS_SEND_TEXT(MAV_SEVERITY_INFO, "EKF3 IMU%u fusing odometry",(unsigned)imu_index);
             }
-            // correct the covariance P = (I - K*H)*P
-            // take advantage of the empty columns in KH to reduce the
-            // number of operations
-            for (unsigned i = 0; i<=stateIndexLim; i++) {
-                for (unsigned j = 0; j<=6; j++) {
-                    KH[i][j] = Kfusion[i] * H_VEL[j];
-                }
-                for (unsigned j = 7; j<=stateIndexLim; j++) {
-                    KH[i][j] = 0.0f;
-                }
-            }
-            for (unsigned j = 0; j<=stateIndexLim; j++) {
-                for (unsigned i = 0; i<=stateIndexLim; i++) {
-                    ftype res = 0;
-                    res += KH[i][0] * P[0][j];
-                    res += KH[i][1] * P[1][j];
-                    res += KH[i][2] * P[2][j];
-                    res += KH[i][3] * P[3][j];
-                    res += KH[i][4] * P[4][j];
-                    res += KH[i][5] * P[5][j];
-                    res += KH[i][6] * P[6][j];
-                    KHP[i][j] = res;
-                }
-            }
-
-            // Check that we are not going to drive any variances negative and skip the update if so
-            bool healthyFusion = true;
-            for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                if (KHP[i][i] > P[i][i]) {
-                    healthyFusion = false;
-                }
-            }
-
+            // correct the covariance P = (I - K*H)*P, skipping the update if
+            // it would drive any variances negative
+            const bool healthyFusion = SparseCovarianceUpdate<0,1,2,3,4,5,6>(H_VEL, true);
             if (healthyFusion) {
-                // update the covariance matrix
-                for (uint8_t i= 0; i<=stateIndexLim; i++) {
-                    for (uint8_t j= 0; j<=stateIndexLim; j++) {
-                        P[i][j] = P[i][j] - KHP[i][j];
-                    }
-                }
-
                 // force the covariance matrix to be symmetrical and limit the variances to prevent ill-conditioning.
                 ForceSymmetry();
                 ConstrainVariances();
@@ -1859,14 +1800,10 @@ void NavEKF3_core::FuseBodyVel()
 // select fusion of body odometry measurements
 void NavEKF3_core::SelectBodyOdomFusion()
 {
-    // Check if the magnetometer has been fused on that time step and the filter is running at faster than 200 Hz
-    // If so, don't fuse measurements on this time step to reduce frame over-runs
-    // Only allow one time slip to prevent high rate magnetometer data preventing fusion of other measurements
-    if (magFusePerformed && (dtIMUavg < 0.005f) && !bodyVelFusionDelayed) {
-        bodyVelFusionDelayed = true;
+    // leave the measurements in the buffer for a later frame if the fusion
+    // already performed on this frame has used up the fusion budget
+    if (deferFusion(FusionStep::BODYODOM)) {
         return;
-    } else {
-        bodyVelFusionDelayed = false;
     }
 
     // Check for body odometry data (aka visual position delta) at the fusion time horizon
@@ -180,6 +180,7 @@ bool NavEKF3_core::setup_core(uint8_t _imu_index, uint8_t _core_index)
             GCS_SEND_TEXT(MAV_SEVERITY_CRITICAL, "EKF3 IMU%uGSF: allocation failed",(unsigned)imu_index);
             return false;
         }
+        yawEstimator->setDecimation(constrain_int16(frontend->_gsfDecimation, 1, 4));
     }
 
     return true;
@@ -303,11 +304,8 @@ void NavEKF3_core::InitialiseVariables()
     gpsHorizVelFilt = 0.0f;
     memset(&statesArray, 0, sizeof(statesArray));
     memset(&vertCompFiltState, 0, sizeof(vertCompFiltState));
-    posVelFusionDelayed = false;
-    optFlowFusionDelayed = false;
+    memset(&fusionSchedule, 0, sizeof(fusionSchedule));
     flowFusionActive = false;
-    airSpdFusionDelayed = false;
-    sideSlipFusionDelayed = false;
     airDataFusionWindOnly = false;
     posResetNE.zero();
     velResetNE.zero();
@@ -388,7 +386,6 @@ void NavEKF3_core::InitialiseVariables()
     memset(&innovBodyVel, 0, sizeof(innovBodyVel));
     prevBodyVelFuseTime_ms = 0;
     bodyOdmMeasTime_ms = 0;
-    bodyVelFusionDelayed = false;
     bodyVelFusionActive = false;
 
     // yaw sensor fusion
@@ -659,6 +656,9 @@ void NavEKF3_core::UpdateFilter(bool predict)
 
     // Run the EKF equations to estimate at the fusion time horizon if new IMU data is available in the buffer
     if (runUpdates) {
+        fusionSchedule.frame_obs = 0;
+        fusionSchedule.mag_fused = false;
+
         // Predict states using IMU data from the delayed time horizon
         UpdateStrapdownEquationsNED();
 
@@ -698,6 +698,9 @@ void NavEKF3_core::UpdateFilter(bool predict)
         // Update states using sideslip constraint assumption for fly-forward vehicles or body drag for multicopters
         SelectBetaDragFusion();
 
+        // record how much fusion was done on this frame
+        updateFusionSchedule();
+
         // Update the filter status
         updateFilterStatus();
     }
@@ -1781,6 +1784,87 @@ void NavEKF3_core::StoreQuatRotate(const Quaternion &deltaQuat)
     outputDataDelayed.quat = outputDataDelayed.quat*deltaQuat;
 }
 
+// covariance update for a direct observation of a state, where H has a
+// single unity entry at obsIndex so H*P is row obsIndex of P
+bool NavEKF3_core::DirectCovarianceUpdate(uint8_t obsIndex, bool check_variances)
+{
+    fusionSchedule.frame_obs++;
+    Vector24 HP;
+    for (uint8_t j = 0; j <= stateIndexLim; j++) {
+        HP[j] = P[obsIndex][j];
+    }
+    return rank_one_covariance_update(P, Kfusion, HP, stateIndexLim, check_variances);
+}
+
+/*
+  the fusion scheduler spreads the measurement updates over frames to
+  keep the per-frame cost of the filter flat. Each frame has a budget
+  of scalar observations, counted as they pass through the covariance
+  update. A deferrable fusion step is left for the next frame if its
+  worst case number of observations would take the frame over budget,
+  its measurements staying in their buffers at the fusion time
+  horizon. A step is never deferred on two consecutive frames, so high
+  rate data fused earlier in the frame can't lock it out.
+
+  Without a budget set the original load levelling is kept: when
+  running faster than 200Hz every step but range beacon fusion is
+  deferred on frames that have fused magnetometer data.
+
+  The budget is counted in observations rather than measured time so
+  that the filter output does not depend on CPU load, which keeps it
+  reproducible in Replay
+ */
+bool NavEKF3_core::deferFusion(FusionStep step)
+{
+    // worst case number of scalar observations fused by each step
+    static const uint8_t step_obs[] = {
+        6, // VELPOS
+        1, // RNGBCN
+        2, // FLOW
+        3, // BODYODOM
+        1, // TAS
+        2, // BETADRAG
+    };
+    static_assert(ARRAY_SIZE(step_obs) == uint8_t(FusionStep::COUNT), "step_obs must match FusionStep");
+
+    const uint8_t mask = 1U << uint8_t(step);
+    if (fusionSchedule.deferred_mask & mask) {
+        fusionSchedule.deferred_mask &= ~mask;
+        return false;
+    }
+    if (frontend->_fusionBudget == 0) {
+        // automatic
+        if (!fusionSchedule.mag_fused || dtIMUavg >= 0.005f || step == FusionStep::RNGBCN) {
+            return false;
+        }
+    } else {
+        const uint8_t budget = fusionBudget();
+        if (budget == 0 ||
+            fusionSchedule.frame_obs == 0 ||
+            fusionSchedule.frame_obs + step_obs[uint8_t(step)] <= budget) {
+            return false;
+        }
+    }
+    fusionSchedule.deferred_mask |= mask;
+    fusionSchedule.deferred[uint8_t(step)]++;
+    return true;
+}
+
+// number of scalar observations that may be fused on a frame, zero if
+// not limited by a count
+uint8_t NavEKF3_core::fusionBudget(void) const
+{
+    return MAX(frontend->_fusionBudget.get(), 0);
+}
+
+// update the fusion scheduler statistics at the end of a frame
+void NavEKF3_core::updateFusionSchedule(void)
+{
+    fusionSchedule.frames++;
+    fusionSchedule.obs += fusionSchedule.frame_obs;
+    fusionSchedule.obs_max = MAX(fusionSchedule.obs_max, fusionSchedule.frame_obs);
+}
+
 // force symmetry on the covariance matrix to prevent ill-conditioning
 void NavEKF3_core::ForceSymmetry()
 {
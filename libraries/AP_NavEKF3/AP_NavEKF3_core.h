@@ -611,6 +611,23 @@ private:
     // force symmetry on the state covariance matrix
     void ForceSymmetry();
 
+    // apply the covariance update for the fusion of a scalar observation
+    // whose Jacobian H is non-zero only at the state indexes H_index, see
+    // NavEKF_core_common::sparse_HP(). Uses the gains in Kfusion. If
+    // check_variances is true and the update would drive a variance
+    // negative then P is left unchanged and false is returned
+    template <uint8_t... H_index, typename T>
+    bool SparseCovarianceUpdate(const T &H, bool check_variances)
+    {
+        fusionSchedule.frame_obs++;
+        Vector24 HP;
+        sparse_HP<H_index...>(HP, H, P, stateIndexLim);
+        return rank_one_covariance_update(P, Kfusion, HP, stateIndexLim, check_variances);
+    }
+
+    // apply the covariance update for a direct observation of state obsIndex
+    bool DirectCovarianceUpdate(uint8_t obsIndex, bool check_variances);
+
     // constrain variances (diagonal terms) in the state covariance matrix
     void ConstrainVariances();
 
@@ -712,6 +729,27 @@ private:
     // determine when to perform fusion of drag or synthetic sideslip measurements
     void SelectBetaDragFusion();
 
+    // fusion steps which the fusion scheduler may defer to a later frame
+    enum class FusionStep : uint8_t {
+        VELPOS   = 0,
+        RNGBCN   = 1,
+        FLOW     = 2,
+        BODYODOM = 3,
+        TAS      = 4,
+        BETADRAG = 5,
+        COUNT    = 6,
+    };
+
+    // return true if a fusion step should be deferred to a later frame to
+    // keep the number of observations fused on this frame within budget
+    bool deferFusion(FusionStep step);
+
+    // number of scalar observations that may be fused on a frame, zero if unlimited
+    uint8_t fusionBudget(void) const;
+
+    // update the fusion scheduler statistics at the end of a frame
+    void updateFusionSchedule(void);
+
     // force alignment of the yaw angle using GPS velocity data
     void realignYawGPS();
 
@@ -971,7 +1009,6 @@ private:
     ftype varInnovVtas;             // innovation variance output from fusion of airspeed measurements
     float defaultAirSpeed;          // default equivalent airspeed in m/s to be used if the measurement is unavailable. Do not use if not positive.
     float defaultAirSpeedVariance;  // default equivalent airspeed variance in (m/s)**2 to be used when defaultAirSpeed is specified. 
-    bool magFusePerformed;          // boolean set to true when magnetometer fusion has been perfomred in that time step
     MagCal effectiveMagCal;         // the actual mag calibration being used as the default
     uint32_t prevTasStep_ms;        // time stamp of last TAS fusion step
     uint32_t prevBetaDragStep_ms;   // time stamp of last synthetic sideslip fusion step
@@ -1052,10 +1089,6 @@ private:
     bool consistentMagData;         // true when the magnetometers are passing consistency checks
     bool motorsArmed;               // true when the motors have been armed
     bool prevMotorsArmed;           // value of motorsArmed from previous frame
-    bool posVelFusionDelayed;       // true when the position and velocity fusion has been delayed
-    bool optFlowFusionDelayed;      // true when the optical flow fusion has been delayed
-    bool airSpdFusionDelayed;       // true when the air speed fusion has been delayed
-    bool sideSlipFusionDelayed;     // true when the sideslip fusion has been delayed
     bool airDataFusionWindOnly;     // true when  sideslip and airspeed fusion is only allowed to modify the wind states
     Vector3f lastMagOffsets;        // Last magnetometer offsets from COMPASS_ parameters. Used to detect parameter changes.
     bool lastMagOffsetsValid;       // True when lastMagOffsets has been initialized
@@ -1183,7 +1216,6 @@ private:
     Vector3 innovBodyVel;               // Body velocity XYZ innovations (m/sec)
     uint32_t prevBodyVelFuseTime_ms;    // previous time all body velocity measurement components passed their innovation consistency checks (msec)
     uint32_t bodyOdmMeasTime_ms;        // time body velocity measurements were accepted for input to the data buffer (msec)
-    bool bodyVelFusionDelayed;          // true when body frame velocity fusion has been delayed
     bool bodyVelFusionActive;           // true when body frame velocity fusion is active
 
 #if EK3_FEATURE_BODY_ODOM
@@ -1391,6 +1423,18 @@ private:
     // timing statistics
     struct ekf_timing timing;
 
+    // fusion scheduler state and statistics
+    struct {
+        uint16_t frame_obs;         // scalar observations fused on this frame
+        bool mag_fused;             // true when magnetometer fusion has been performed on this frame
+        uint8_t deferred_mask;      // bitmask of the FusionStep values deferred on the last frame
+        uint32_t last_log_ms;       // time the statistics were last logged
+        uint32_t frames;            // frames with measurement updates since last logged
+        uint32_t obs;               // scalar observations fused since last logged
+        uint16_t obs_max;           // largest number of scalar observations fused on one frame since last logged
+        uint16_t deferred[uint8_t(FusionStep::COUNT)]; // deferrals of each step since last logged
+    } fusionSchedule;
+
     // when was attitude filter status last non-zero?
     uint32_t last_filter_ok_ms;
     
@@ -1469,5 +1513,6 @@ private:
     void Log_Write_BodyOdom(uint64_t time_us);
     void Log_Write_State_Variances(uint64_t time_us) const;
     void Log_Write_Timing(uint64_t time_us);
+    void Log_Write_FusionSchedule(uint64_t time_us);
     void Log_Write_GSF(uint64_t time_us);
 };
@@ -12,6 +12,7 @@
     LOG_XKFD_MSG, \
     LOG_XKFM_MSG, \
     LOG_XKFS_MSG, \
+    LOG_XKFU_MSG, \
     LOG_XKQ_MSG,  \
     LOG_XKT_MSG,  \
     LOG_XKTV_MSG, \
@@ -316,6 +317,37 @@ struct PACKED log_XKFM {
 };
 
 
+// @LoggerMessage: XKFU
+// @Description: EKF3 fusion scheduler statistics
+// @Field: TimeUS: Time since system startup
+// @Field: C: EKF core this message instance applies to
+// @Field: Fr: Number of filter updates since the last message
+// @Field: Obs: Number of scalar observations fused since the last message
+// @Field: Max: Largest number of scalar observations fused in one filter update
+// @Field: Bud: Number of scalar observations allowed per filter update, zero if unlimited
+// @Field: DPV: Number of times position, velocity and height fusion was deferred
+// @Field: DRB: Number of times range beacon fusion was deferred
+// @Field: DOF: Number of times optical flow fusion was deferred
+// @Field: DBO: Number of times body odometry fusion was deferred
+// @Field: DAS: Number of times airspeed fusion was deferred
+// @Field: DBD: Number of times sideslip or drag fusion was deferred
+struct PACKED log_XKFU {
+    LOG_PACKET_HEADER;
+    uint64_t time_us;
+    uint8_t core;
+    uint32_t frames;
+    uint32_t obs;
+    uint16_t obs_max;
+    uint8_t budget;
+    uint16_t def_velpos;
+    uint16_t def_rngbcn;
+    uint16_t def_flow;
+    uint16_t def_bodyodom;
+    uint16_t def_tas;
+    uint16_t def_betadrag;
+};
+
+
 // @LoggerMessage: XKQ
 // @Description: EKF3 quaternion defining the rotation from NED to XYZ (autopilot) axes
 // @Field: TimeUS: Time since system startup
@@ -437,6 +469,8 @@ struct PACKED log_XKV {
       "XKFM", "QBBffff", "TimeUS,C,OGNM,GLR,ALR,GDR,ADR", "s#-----", "F------"}, \
     { LOG_XKFS_MSG, sizeof(log_XKFS), \
       "XKFS","QBBBBB","TimeUS,C,MI,BI,GI,AI", "s#----", "F-----" }, \
+    { LOG_XKFU_MSG, sizeof(log_XKFU), \
+      "XKFU","QBIIHBHHHHHH","TimeUS,C,Fr,Obs,Max,Bud,DPV,DRB,DOF,DBO,DAS,DBD", "s#----------", "F-----------" }, \
     { LOG_XKQ_MSG, sizeof(log_XKQ), "XKQ", "QBffff", "TimeUS,C,Q1,Q2,Q3,Q4", "s#????", "F-????" }, \
     { LOG_XKT_MSG, sizeof(log_XKT),   \
       "XKT", "QBIffffffff", "TimeUS,C,Cnt,IMUMin,IMUMax,EKFMin,EKFMax,AngMin,AngMax,VMin,VMax", "s#sssssssss", "F-000000000"}, \
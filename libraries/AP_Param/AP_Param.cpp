@@ -80,6 +80,24 @@ uint16_t AP_Param::_parameter_count;
 uint16_t AP_Param::_count_marker;
 uint16_t AP_Param::_count_marker_done;
 HAL_Semaphore AP_Param::_count_sem;
+HAL_Semaphore AP_Param::_storage_sem;
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+struct AP_Param::storage_index_entry *AP_Param::storage_index;
+uint16_t AP_Param::storage_index_count;
+uint16_t AP_Param::storage_index_capacity;
+bool AP_Param::storage_index_valid;
+uint8_t AP_Param::bulk_depth;
+bool AP_Param::bulk_pending;
+bool AP_Param::bulk_sentinal_written;
+uint16_t AP_Param::bulk_ofs;
+struct AP_Param::Param_header AP_Param::bulk_header;
+#endif
+
+AP_Param::CompactState AP_Param::compact_state;
+uint16_t AP_Param::compact_end;
+uint32_t AP_Param::compact_start_ms;
+bool AP_Param::compact_failed;
 
 // storage and naming information about all types that can be saved
 const AP_Param::Info *AP_Param::_var_info;
@@ -90,6 +108,7 @@ uint16_t AP_Param::num_read_only = 0;
 
 ObjectBuffer_TS<AP_Param::param_save> AP_Param::save_queue{30};
 bool AP_Param::registered_save_handler;
+struct AP_Param::param_save AP_Param::save_deferred;
 
 // we need a dummy object for the parameter save callback
 static AP_Param save_dummy;
@@ -141,6 +160,8 @@ void AP_Param::write_sentinal(uint16_t ofs)
 // a sentinal
 void AP_Param::erase_all(void)
 {
+    WITH_SEMAPHORE(_storage_sem);
+
     struct EEPROM_header hdr;
 
     // write the header
@@ -152,6 +173,15 @@ void AP_Param::erase_all(void)
 
     // add a sentinal directly after the header
     write_sentinal(sizeof(struct EEPROM_header));
+
+    // both copies are now empty, so any compaction is finished
+    compact_state = CompactState::IDLE;
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    bulk_pending = false;
+    storage_index_reset();
+    storage_index_finish();
+#endif
 }
 
 /* the 'group_id' of a element of a group is the 18 bit identifier
@@ -713,6 +743,30 @@ bool AP_Param::is_sentinal(const Param_header &phdr)
     return false;
 }
 
+/*
+  read the header of the record at ofs as a walk of storage sees
+  it. While a bulk update is pending the header of its first record
+  is held back, and there may be no sentinal yet after its last
+ */
+void AP_Param::read_header(uint16_t ofs, Param_header &phdr)
+{
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    if (bulk_pending) {
+        if (ofs == bulk_ofs) {
+            phdr = bulk_header;
+            return;
+        }
+        if (ofs == sentinal_offset) {
+            phdr.type = _sentinal_type;
+            set_key(phdr, _sentinal_key);
+            phdr.group_element = _sentinal_group;
+            return;
+        }
+    }
+#endif
+    _storage.read_block(&phdr, ofs, sizeof(phdr));
+}
+
 // scan the EEPROM looking for a given variable by header content
 // return true if found, along with the offset in the EEPROM where
 // the variable is stored
@@ -720,10 +774,26 @@ bool AP_Param::is_sentinal(const Param_header &phdr)
 // if the sentinal isn't found either, the offset is set to 0xFFFF
 bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
 {
+    // callers hold this too if they use the offset, as compaction
+    // moves records
+    WITH_SEMAPHORE(_storage_sem);
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    if (storage_index_valid) {
+        const struct storage_index_entry *e = storage_index_find(*target);
+        if (e != nullptr) {
+            *pofs = e->ofs;
+            return true;
+        }
+        *pofs = sentinal_offset;
+        return false;
+    }
+#endif
+
     struct Param_header phdr;
     uint16_t ofs = sizeof(AP_Param::EEPROM_header);
     while (ofs < _storage.size()) {
-        _storage.read_block(&phdr, ofs, sizeof(phdr));
+        read_header(ofs, phdr);
         if (phdr.type == target->type &&
             get_key(phdr) == get_key(*target) &&
             phdr.group_element == target->group_element) {
@@ -744,6 +814,414 @@ bool AP_Param::scan(const AP_Param::Param_header *target, uint16_t *pofs)
     return false;
 }
 
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+/*
+  the header as one value, for ordering the storage index
+ */
+uint32_t AP_Param::header_value(const struct Param_header &phdr)
+{
+    uint32_t v;
+    memcpy(&v, &phdr, sizeof(v));
+    return v;
+}
+
+/*
+  empty the storage index, ready for storage_index_append() calls
+ */
+void AP_Param::storage_index_reset(void)
+{
+    storage_index_count = 0;
+    storage_index_valid = false;
+}
+
+/*
+  add a record to the end of the index, growing it as needed. The
+  index must be sorted with storage_index_finish() before use
+ */
+bool AP_Param::storage_index_append(const struct Param_header &phdr, uint16_t ofs)
+{
+    if (storage_index_count == storage_index_capacity) {
+        const uint16_t capacity = MIN(MAX(storage_index_capacity * 2U, 64U), uint32_t(UINT16_MAX));
+        if (capacity == storage_index_capacity) {
+            return false;
+        }
+        struct storage_index_entry *idx = (struct storage_index_entry *)
+            hal.util->std_realloc(storage_index, capacity * sizeof(struct storage_index_entry));
+        if (idx == nullptr) {
+            return false;
+        }
+        storage_index = idx;
+        storage_index_capacity = capacity;
+    }
+    storage_index[storage_index_count].header = header_value(phdr);
+    storage_index[storage_index_count].ofs = ofs;
+    storage_index_count++;
+    return true;
+}
+
+/*
+  order index entries by header, then by offset
+ */
+int AP_Param::storage_index_cmp(const void *p1, const void *p2)
+{
+    const struct storage_index_entry *e1 = (const struct storage_index_entry *)p1;
+    const struct storage_index_entry *e2 = (const struct storage_index_entry *)p2;
+    if (e1->header != e2->header) {
+        return e1->header < e2->header ? -1 : 1;
+    }
+    return int(e1->ofs) - int(e2->ofs);
+}
+
+/*
+  sort the appended records and make the index live. If a header is
+  stored more than once the first copy is kept, as that is the one a
+  walk of storage finds
+ */
+void AP_Param::storage_index_finish(void)
+{
+    if (storage_index_count > 1) {
+        qsort(storage_index, storage_index_count, sizeof(struct storage_index_entry), storage_index_cmp);
+    }
+    uint16_t n = 0;
+    for (uint16_t i=0; i<storage_index_count; i++) {
+        if (n > 0 && storage_index[n-1].header == storage_index[i].header) {
+            continue;
+        }
+        storage_index[n++] = storage_index[i];
+    }
+    storage_index_count = n;
+    storage_index_valid = true;
+}
+
+/*
+  add a newly stored record to a live index
+ */
+void AP_Param::storage_index_insert(const struct Param_header &phdr, uint16_t ofs)
+{
+    if (!storage_index_valid) {
+        return;
+    }
+    if (!storage_index_append(phdr, ofs)) {
+        // fall back to walking storage
+        storage_index_invalidate();
+        return;
+    }
+    // move it down to its place
+    const struct storage_index_entry e = storage_index[storage_index_count-1];
+    uint16_t i = storage_index_count-1;
+    while (i > 0 && storage_index[i-1].header > e.header) {
+        i--;
+    }
+    if (i != storage_index_count-1) {
+        memmove(&storage_index[i+1], &storage_index[i], (storage_index_count-1-i) * sizeof(e));
+        storage_index[i] = e;
+    }
+}
+
+/*
+  stop using the index
+ */
+void AP_Param::storage_index_invalidate(void)
+{
+    storage_index_valid = false;
+}
+
+/*
+  bisect the index for a header
+ */
+const struct AP_Param::storage_index_entry *AP_Param::storage_index_find(const struct Param_header &phdr)
+{
+    const uint32_t v = header_value(phdr);
+    uint16_t lo = 0;
+    uint16_t hi = storage_index_count;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        if (storage_index[mid].header == v) {
+            return &storage_index[mid];
+        }
+        if (storage_index[mid].header < v) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
+}
+
+/*
+  finish the records appended in a bulk update by writing the
+  sentinal after the last one. bulk_update() joins them to the rest
+  of storage
+ */
+void AP_Param::bulk_commit(void)
+{
+    if (!bulk_pending) {
+        return;
+    }
+    write_sentinal(sentinal_offset);
+    bulk_sentinal_written = true;
+}
+
+/*
+  write the held back header of a committed bulk update once the
+  storage device has everything before it. The device may write the
+  lines of storage in any order, so writing the header with the
+  sentinal could leave it on the device pointing at stale bytes
+ */
+void AP_Param::bulk_update(void)
+{
+    WITH_SEMAPHORE(_storage_sem);
+
+    if (!bulk_pending || bulk_depth > 0 || !bulk_sentinal_written ||
+        compact_state != CompactState::IDLE || !StorageManager::flushed()) {
+        return;
+    }
+    eeprom_write_check(&bulk_header, bulk_ofs, sizeof(bulk_header));
+    bulk_pending = false;
+}
+
+/*
+  build the index from a walk of storage, leaving it unused if it
+  can't be allocated
+ */
+void AP_Param::storage_index_rebuild(void)
+{
+    storage_index_reset();
+    uint16_t ofs = sizeof(struct EEPROM_header);
+    while (ofs < _storage.size()) {
+        struct Param_header phdr;
+        read_header(ofs, phdr);
+        if (is_sentinal(phdr)) {
+            storage_index_finish();
+            return;
+        }
+        if (!storage_index_append(phdr, ofs)) {
+            return;
+        }
+        ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
+    }
+}
+#endif // AP_PARAM_STORAGE_INDEX_ENABLED
+
+/*
+  start a bulk update
+ */
+void AP_Param::save_bulk_begin(void)
+{
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    WITH_SEMAPHORE(_storage_sem);
+    if (bulk_depth < UINT8_MAX) {
+        bulk_depth++;
+    }
+#endif
+}
+
+/*
+  end a bulk update, committing the appended records when the last
+  one ends
+ */
+void AP_Param::save_bulk_end(void)
+{
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    WITH_SEMAPHORE(_storage_sem);
+    if (bulk_depth == 0) {
+        return;
+    }
+    bulk_depth--;
+    if (bulk_depth == 0) {
+        bulk_commit();
+    }
+#endif
+}
+
+/*
+  return true if the stored record at ofs is a known scalar parameter
+  holding its default value, so it can be dropped from storage
+ */
+bool AP_Param::stored_at_default(const struct Param_header &phdr, uint16_t ofs)
+{
+    if (phdr.type > AP_PARAM_FLOAT) {
+        return false;
+    }
+    void *ptr;
+    if (find_by_header(phdr, &ptr) == nullptr) {
+        // unknown or old keys are kept for parameter conversion
+        return false;
+    }
+    const AP_Param *ap = (const AP_Param *)ptr;
+    uint32_t group_element = 0;
+    const struct GroupInfo *ginfo;
+    struct GroupNesting group_nesting {};
+    uint8_t idx;
+    const struct AP_Param::Info *info = ap->find_var_info(&group_element, ginfo, group_nesting, &idx);
+    if (info == nullptr || idx != 0) {
+        return false;
+    }
+
+    union {
+        int8_t i8;
+        int16_t i16;
+        int32_t i32;
+        float f;
+    } value;
+    _storage.read_block(&value, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
+    float v1;
+    switch ((enum ap_var_type)phdr.type) {
+    case AP_PARAM_INT8:
+        v1 = value.i8;
+        break;
+    case AP_PARAM_INT16:
+        v1 = value.i16;
+        break;
+    case AP_PARAM_INT32:
+        v1 = value.i32;
+        break;
+    case AP_PARAM_FLOAT:
+        v1 = value.f;
+        break;
+    default:
+        return false;
+    }
+    const float v2 = get_default_value(ap, ginfo != nullptr ? &ginfo->def_value : &info->def_value);
+
+    // the same test save_sync() uses to skip saving a default
+    return is_equal(v1, v2) ||
+        (phdr.type != AP_PARAM_INT32 && fabsf(v1-v2) < 0.0001f*fabsf(v1));
+}
+
+/*
+  start removing stored parameters that are at their default
+  value. The kept records are written to the backup first, leaving the
+  primary alone, so a power loss at any point leaves one good copy:
+
+  - until the backup is written out the primary is still valid
+  - then the primary header is marked invalid, so setup() restores
+    the compacted backup
+  - then the compacted records are copied to the primary
+  - and last the primary header is made valid again
+
+  compact_update() moves to each step once the storage device has
+  all the writes of the one before
+ */
+bool AP_Param::compact_storage(void)
+{
+    WITH_SEMAPHORE(_storage_sem);
+
+    if (compact_state != CompactState::IDLE || compact_failed) {
+        return false;
+    }
+
+    if (_storage_bak.size() < sentinal_offset + sizeof(struct Param_header)) {
+        // the backup doesn't hold everything, not safe to rewrite
+        return false;
+    }
+
+    uint16_t rofs = sizeof(struct EEPROM_header);
+    uint16_t wofs = rofs;
+    while (rofs < _storage.size()) {
+        struct Param_header phdr;
+        read_header(rofs, phdr);
+        if (is_sentinal(phdr)) {
+            break;
+        }
+        const uint8_t len = sizeof(phdr) + type_size((enum ap_var_type)phdr.type);
+        if (!stored_at_default(phdr, rofs)) {
+            uint8_t rec[sizeof(phdr)+12];
+            _storage.read_block(rec, rofs, len);
+            memcpy(rec, &phdr, sizeof(phdr));
+            _storage_bak.write_block(wofs, rec, len);
+            wofs += len;
+        }
+        rofs += len;
+    }
+
+    if (wofs == rofs) {
+        // nothing removed, and the backup is unchanged
+        return false;
+    }
+
+    struct Param_header phdr;
+    phdr.type = _sentinal_type;
+    set_key(phdr, _sentinal_key);
+    phdr.group_element = _sentinal_group;
+    _storage_bak.write_block(wofs, &phdr, sizeof(phdr));
+
+    compact_end = wofs;
+    compact_start_ms = AP_HAL::millis();
+    compact_state = CompactState::BACKUP_WRITTEN;
+    return true;
+}
+
+/*
+  move storage compaction on once the last step has been written
+  out. Returns true while saves need to wait for it
+ */
+bool AP_Param::compact_update(void)
+{
+    WITH_SEMAPHORE(_storage_sem);
+
+    if (compact_state == CompactState::IDLE) {
+        return false;
+    }
+
+    if (!StorageManager::flushed()) {
+        if (compact_state == CompactState::BACKUP_WRITTEN &&
+            AP_HAL::millis() - compact_start_ms > 5000) {
+            // storage isn't being written. Give up while the primary
+            // is untouched, and don't try again until reboot
+            _storage_bak.copy_area(_storage);
+            compact_state = CompactState::IDLE;
+            compact_failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    struct EEPROM_header hdr;
+    _storage_bak.read_block(&hdr, 0, sizeof(hdr));
+
+    switch (compact_state) {
+    case CompactState::IDLE:
+        break;
+
+    case CompactState::BACKUP_WRITTEN: {
+        struct EEPROM_header bad_hdr = hdr;
+        bad_hdr.magic[0] = ~k_EEPROM_magic0;
+        _storage.write_block(0, &bad_hdr, sizeof(bad_hdr));
+        compact_state = CompactState::PRIMARY_INVALID;
+        break;
+    }
+
+    case CompactState::PRIMARY_INVALID: {
+        // everything after the header, up to and including the sentinal
+        const uint16_t end = compact_end + sizeof(struct Param_header);
+        for (uint16_t ofs = sizeof(hdr); ofs < end; ) {
+            uint8_t buf[64];
+            const uint16_t n = MIN(uint16_t(sizeof(buf)), uint16_t(end - ofs));
+            _storage_bak.read_block(buf, ofs, n);
+            _storage.write_block(ofs, buf, n);
+            ofs += n;
+        }
+        sentinal_offset = compact_end;
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+        // the copy has the held back header of any bulk update
+        bulk_pending = false;
+        storage_index_rebuild();
+#endif
+        compact_state = CompactState::PRIMARY_COPIED;
+        break;
+    }
+
+    case CompactState::PRIMARY_COPIED:
+        _storage.write_block(0, &hdr, sizeof(hdr));
+        compact_state = CompactState::IDLE;
+        hal.console->printf("Param storage compacted, %u bytes used\n", unsigned(sentinal_offset));
+        return false;
+    }
+
+    return true;
+}
+
 /**
  * add a _X, _Y, _Z suffix to the name of a Vector3f element
  * @param buffer
@@ -1098,6 +1576,18 @@ void AP_Param::notify() const {
   Save the variable to HAL storage, synchronous version
 */
 void AP_Param::save_sync(bool force_save, bool send_to_gcs)
+{
+    if (!save_sync_try(force_save, send_to_gcs)) {
+        // storage is being compacted, the IO thread saves it after
+        save(force_save);
+    }
+}
+
+/*
+  save the variable to HAL storage, returning false if the save has to
+  wait for storage compaction
+*/
+bool AP_Param::save_sync_try(bool force_save, bool send_to_gcs)
 {
     uint32_t group_element = 0;
     const struct GroupInfo *ginfo;
@@ -1108,7 +1598,7 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
 
     if (info == nullptr) {
         // we don't have any info on how to store it
-        return;
+        return true;
     }
 
     struct Param_header phdr;
@@ -1125,7 +1615,7 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
     ap = this;
     if (phdr.type != AP_PARAM_VECTOR3F && idx != 0) {
         // only vector3f can have non-zero idx for now
-        return;
+        return true;
     }
     if (idx != 0) {
         ap = (const AP_Param *)((ptrdiff_t)ap) - (idx*sizeof(float));
@@ -1139,6 +1629,12 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
     char name[AP_MAX_NAME_SIZE+1];
     copy_name_info(info, ginfo, group_nesting, idx, name, sizeof(name), true);
 
+    WITH_SEMAPHORE(_storage_sem);
+
+    if (compact_state != CompactState::IDLE) {
+        return false;
+    }
+
     // scan EEPROM to find the right location
     uint16_t ofs;
     if (scan(&phdr, &ofs)) {
@@ -1147,10 +1643,10 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
         if (send_to_gcs) {
             send_parameter(name, (enum ap_var_type)phdr.type, idx);
         }
-        return;
+        return true;
     }
     if (ofs == (uint16_t) ~0) {
-        return;
+        return true;
     }
 
     // if the value is the default value then don't save
@@ -1166,7 +1662,7 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
             if (send_to_gcs) {
                 GCS_SEND_PARAM(name, (enum ap_var_type)info->type, v2);
             }
-            return;
+            return true;
         }
         if (!force_save &&
             (phdr.type != AP_PARAM_INT32 &&
@@ -1176,24 +1672,55 @@ void AP_Param::save_sync(bool force_save, bool send_to_gcs)
             if (send_to_gcs) {
                 GCS_SEND_PARAM(name, (enum ap_var_type)info->type, v2);
             }
-            return;
+            return true;
         }
     }
 
-    if (ofs+type_size((enum ap_var_type)phdr.type)+2*sizeof(phdr) >= _storage.size()) {
+    const uint8_t size = type_size((enum ap_var_type)phdr.type);
+    if (ofs+size+2*sizeof(phdr) >= _storage.size()) {
+        if (AP_BoardConfig::param_compact_enabled() && compact_storage()) {
+            // make room by dropping values that are at their default,
+            // then save this
+            return false;
+        }
         // we are out of room for saving variables
         hal.console->printf("EEPROM full\n");
-        return;
+        return true;
     }
 
-    // write a new sentinal, then the data, then the header
-    write_sentinal(ofs + sizeof(phdr) + type_size((enum ap_var_type)phdr.type));
-    eeprom_write_check(ap, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
-    eeprom_write_check(&phdr, ofs, sizeof(phdr));
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    if (bulk_depth > 0 && storage_index_valid) {
+        // write the record in one go. The header of the first record
+        // and the sentinal are left for bulk_commit()
+        uint8_t rec[sizeof(phdr)+12];
+        memcpy(rec, &phdr, sizeof(phdr));
+        memcpy(&rec[sizeof(phdr)], ap, size);
+        if (!bulk_pending) {
+            bulk_pending = true;
+            bulk_ofs = ofs;
+            bulk_header = phdr;
+            eeprom_write_check(&rec[sizeof(phdr)], ofs+sizeof(phdr), size);
+        } else {
+            eeprom_write_check(rec, ofs, sizeof(phdr)+size);
+        }
+        sentinal_offset = ofs + sizeof(phdr) + size;
+        bulk_sentinal_written = false;
+    } else
+#endif
+    {
+        // write a new sentinal, then the data, then the header
+        write_sentinal(ofs + sizeof(phdr) + size);
+        eeprom_write_check(ap, ofs+sizeof(phdr), size);
+        eeprom_write_check(&phdr, ofs, sizeof(phdr));
+    }
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    storage_index_insert(phdr, ofs);
+#endif
 
     if (send_to_gcs) {
         send_parameter(name, (enum ap_var_type)phdr.type, idx);
     }
+    return true;
 }
 
 /*
@@ -1234,23 +1761,61 @@ void AP_Param::save(bool force_save)
  */
 void AP_Param::save_io_handler(void)
 {
-    struct param_save p;
-    while (save_queue.pop(p)) {
-        p.param->save_sync(p.force_save, true);
+    // saves wait while storage is compacted
+    if (!compact_update()) {
+        save_queued();
     }
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    bulk_update();
+#endif
     if (hal.scheduler->is_system_initialized()) {
         // pay the cost of parameter counting in the IO thread
         count_parameters();
     }
 }
 
+/*
+  save the queued parameters, stopping if a save has to wait for
+  storage compaction
+ */
+void AP_Param::save_queued(void)
+{
+    if (save_deferred.param != nullptr) {
+        // the save that started compaction goes first
+        if (!save_deferred.param->save_sync_try(save_deferred.force_save, true)) {
+            return;
+        }
+        save_deferred.param = nullptr;
+    }
+
+    const bool bulk = save_queue.available() > 1;
+    if (bulk) {
+        // a burst of saves, such as a parameter file load from a GCS
+        save_bulk_begin();
+    }
+    struct param_save p;
+    while (save_queue.pop(p)) {
+        if (!p.param->save_sync_try(p.force_save, true)) {
+            save_deferred = p;
+            break;
+        }
+    }
+    if (bulk) {
+        save_bulk_end();
+    }
+}
+
 /*
   wait for all parameters to save
 */
 void AP_Param::flush(void)
 {
     uint16_t counter = 200; // 2 seconds max
-    while (counter-- && save_queue.available()) {
+    while (counter-- && (save_queue.available() || save_deferred.param != nullptr
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+                         || bulk_pending
+#endif
+                         )) {
         hal.scheduler->expect_delay_ms(10);
         hal.scheduler->delay(10);
         hal.scheduler->expect_delay_ms(0);
@@ -1282,6 +1847,9 @@ bool AP_Param::load(void)
     set_key(phdr, info->key);
     phdr.group_element = group_element;
 
+    // keep the record where scan() finds it until it is read
+    WITH_SEMAPHORE(_storage_sem);
+
     // scan EEPROM to find the right location
     uint16_t ofs;
     if (!scan(&phdr, &ofs)) {
@@ -1357,6 +1925,11 @@ bool AP_Param::configured_in_defaults_file(bool &read_only) const
     if (num_param_overrides == 0) {
         return false;
     }
+    const struct param_override *po = find_param_override(this);
+    if (po == nullptr) {
+        return false;
+    }
+
     uint32_t group_element = 0;
     const struct GroupInfo *ginfo;
     struct GroupNesting group_nesting {};
@@ -1367,14 +1940,8 @@ bool AP_Param::configured_in_defaults_file(bool &read_only) const
         return false;
     }
 
-    for (uint16_t i=0; i<num_param_overrides; i++) {
-        if (this == param_overrides[i].object_ptr) {
-            read_only = param_overrides[i].read_only;
-            return true;
-        }
-    }
-
-    return false;
+    read_only = po->read_only;
+    return true;
 }
 
 bool AP_Param::configured(void) const
@@ -1488,12 +2055,25 @@ bool AP_Param::load_all()
         registered_save_handler = true;
         hal.scheduler->register_io_process(FUNCTOR_BIND((&save_dummy), &AP_Param::save_io_handler, void));
     }
-    
+
+    WITH_SEMAPHORE(_storage_sem);
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    // build the index on the same walk of storage
+    storage_index_reset();
+    bool index_ok = true;
+#endif
+
     while (ofs < _storage.size()) {
-        _storage.read_block(&phdr, ofs, sizeof(phdr));
+        read_header(ofs, phdr);
         if (is_sentinal(phdr)) {
             // we've reached the sentinal
             sentinal_offset = ofs;
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+            if (index_ok) {
+                storage_index_finish();
+            }
+#endif
             return true;
         }
 
@@ -1504,6 +2084,9 @@ bool AP_Param::load_all()
         if (info != nullptr) {
             _storage.read_block(ptr, ofs+sizeof(phdr), type_size((enum ap_var_type)phdr.type));
         }
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+        index_ok = index_ok && storage_index_append(phdr, ofs);
+#endif
 
         ofs += type_size((enum ap_var_type)phdr.type) + sizeof(phdr);
     }
@@ -1560,6 +2143,8 @@ void AP_Param::load_object_from_eeprom(const void *object_pointer, const struct
         hal.console->printf("ERROR: Unable to find param pointer\n");
         return;
     }
+
+    WITH_SEMAPHORE(_storage_sem);
     
     for (uint8_t i=0; group_info[i].type != AP_PARAM_NONE; i++) {
         if (group_info[i].type == AP_PARAM_GROUP) {
@@ -1574,7 +2159,7 @@ void AP_Param::load_object_from_eeprom(const void *object_pointer, const struct
         }
         uint16_t ofs = sizeof(AP_Param::EEPROM_header);
         while (ofs < _storage.size()) {
-            _storage.read_block(&phdr, ofs, sizeof(phdr));
+            read_header(ofs, phdr);
             // note that this is an || not an && for robustness
             // against power off while adding a variable
             if (is_sentinal(phdr)) {
@@ -2065,49 +2650,124 @@ bool AP_Param::parse_param_line(char *line, char **vname, float &value, bool &re
 }
 
 
-#if HAL_OS_POSIX_IO == 1
-#include <stdio.h>
+/*
+  drop the overrides from the last defaults load
+ */
+void AP_Param::clear_param_overrides(void)
+{
+    free(param_overrides);
+    param_overrides = nullptr;
+    num_param_overrides = 0;
+    num_read_only = 0;
+}
 
-// increments num_defaults for each default found in filename
-bool AP_Param::count_defaults_in_file(const char *filename, uint16_t &num_defaults)
+/*
+  add a parameter from the defaults being loaded, setting it unless it
+  has been saved to storage
+ */
+void AP_Param::add_param_override(struct param_override_list &list, AP_Param *vp,
+                                  enum ap_var_type var_type, float value, bool read_only)
 {
-    FILE *f = fopen(filename, "r");
-    if (f == nullptr) {
-        return false;
+    if (list.count == list.capacity) {
+        if (list.capacity == UINT16_MAX) {
+            AP_HAL::panic("AP_Param: Too many defaults");
+        }
+        const uint16_t capacity = MIN(MAX(list.capacity * 2U, 32U), uint32_t(UINT16_MAX));
+        struct param_override *overrides = (struct param_override *)
+            hal.util->std_realloc(list.overrides, capacity * sizeof(struct param_override));
+        if (overrides == nullptr) {
+            AP_HAL::panic("AP_Param: Failed to allocate overrides");
+        }
+        list.overrides = overrides;
+        list.capacity = capacity;
     }
-    char line[100];
+    struct param_override &po = list.overrides[list.count];
+    po.object_ptr = vp;
+    po.value = value;
+    po.read_only = read_only;
+    po.order = list.count;
+    list.count++;
 
-    /*
-      work out how many parameter default structures to allocate
-     */
-    while (fgets(line, sizeof(line)-1, f)) {
-        char *pname;
-        float value;
-        bool read_only;
-        if (!parse_param_line(line, &pname, value, read_only)) {
+    if (!vp->configured_in_storage()) {
+        vp->set_float(value, var_type);
+    }
+}
+
+/*
+  order overrides by object, then by the order they were read
+ */
+int AP_Param::param_override_cmp(const void *p1, const void *p2)
+{
+    const struct param_override *po1 = (const struct param_override *)p1;
+    const struct param_override *po2 = (const struct param_override *)p2;
+    if (po1->object_ptr != po2->object_ptr) {
+        return uintptr_t(po1->object_ptr) < uintptr_t(po2->object_ptr) ? -1 : 1;
+    }
+    return int(po1->order) - int(po2->order);
+}
+
+/*
+  make a loaded list the active overrides, sorted by object so
+  find_param_override() can bisect it. A parameter given more than
+  once keeps the last value, the one that was set
+ */
+void AP_Param::set_param_overrides(struct param_override_list &list)
+{
+    if (list.count > 1) {
+        qsort(list.overrides, list.count, sizeof(struct param_override), param_override_cmp);
+    }
+    uint16_t n = 0;
+    for (uint16_t i=0; i<list.count; i++) {
+        if (i+1 < list.count &&
+            list.overrides[i+1].object_ptr == list.overrides[i].object_ptr) {
             continue;
         }
-        enum ap_var_type var_type;
-        if (!find(pname, &var_type)) {
-            continue;
+        list.overrides[n] = list.overrides[i];
+        if (list.overrides[n].read_only) {
+            num_read_only++;
         }
-        num_defaults++;
+        n++;
     }
+    param_overrides = list.overrides;
+    num_param_overrides = n;
+    list = {};
+}
 
-    fclose(f);
-
-    return true;
+/*
+  find the defaults file override for a parameter
+ */
+const AP_Param::param_override *AP_Param::find_param_override(const AP_Param *vp)
+{
+    uint16_t lo = 0;
+    uint16_t hi = num_param_overrides;
+    while (lo < hi) {
+        const uint16_t mid = (lo + hi) / 2;
+        const uintptr_t obj = uintptr_t(param_overrides[mid].object_ptr);
+        if (obj == uintptr_t(vp)) {
+            return &param_overrides[mid];
+        }
+        if (obj < uintptr_t(vp)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return nullptr;
 }
 
-bool AP_Param::read_param_defaults_file(const char *filename, bool last_pass)
+#if HAL_OS_POSIX_IO == 1
+#include <stdio.h>
+
+/*
+  read one defaults file, adding the parameters it sets to list
+ */
+bool AP_Param::read_param_defaults_file(const char *filename, bool last_pass, struct param_override_list &list)
 {
     FILE *f = fopen(filename, "r");
     if (f == nullptr) {
-        AP_HAL::panic("AP_Param: Failed to re-open defaults file");
         return false;
     }
 
-    uint16_t idx = 0;
     char line[100];
     while (fgets(line, sizeof(line)-1, f)) {
         char *pname;
@@ -2128,23 +2788,15 @@ bool AP_Param::read_param_defaults_file(const char *filename, bool last_pass)
             }
             continue;
         }
-        param_overrides[idx].object_ptr = vp;
-        param_overrides[idx].value = value;
-        param_overrides[idx].read_only = read_only;
-        if (read_only) {
-            num_read_only++;
-        }
-        idx++;
-        if (!vp->configured_in_storage()) {
-            vp->set_float(value, var_type);
-        }
+        add_param_override(list, vp, var_type, value, read_only);
     }
     fclose(f);
     return true;
 }
 
 /*
-  load a default set of parameters from a file
+  load a default set of parameters from a comma separated list of
+  files, reading each once
  */
 bool AP_Param::load_defaults_file(const char *filename, bool last_pass)
 {
@@ -2157,48 +2809,22 @@ bool AP_Param::load_defaults_file(const char *filename, bool last_pass)
         AP_HAL::panic("AP_Param: Failed to allocate mutable string");
     }
 
-    uint16_t num_defaults = 0;
-    char *saveptr = nullptr;
-    for (char *pname = strtok_r(mutable_filename, ",", &saveptr);
-         pname != nullptr;
-         pname = strtok_r(nullptr, ",", &saveptr)) {
-        if (!count_defaults_in_file(pname, num_defaults)) {
-            free(mutable_filename);
-            return false;
-        }
-    }
-    free(mutable_filename);
-
-    delete[] param_overrides;
-    num_param_overrides = 0;
-    num_read_only = 0;
-
-    param_overrides = new param_override[num_defaults];
-    if (param_overrides == nullptr) {
-        AP_HAL::panic("AP_Param: Failed to allocate overrides");
-        return false;
-    }
-
-    if (num_defaults == 0) {
-        return true;
-    }
+    clear_param_overrides();
 
-    saveptr = nullptr;
-    mutable_filename = strdup(filename);
-    if (mutable_filename == nullptr) {
-        AP_HAL::panic("AP_Param: Failed to allocate mutable string");
-    }
+    struct param_override_list list {};
+    char *saveptr = nullptr;
     for (char *pname = strtok_r(mutable_filename, ",", &saveptr);
          pname != nullptr;
          pname = strtok_r(nullptr, ",", &saveptr)) {
-        if (!read_param_defaults_file(pname, last_pass)) {
+        if (!read_param_defaults_file(pname, last_pass, list)) {
             free(mutable_filename);
+            free(list.overrides);
             return false;
         }
     }
     free(mutable_filename);
 
-    num_param_overrides = num_defaults;
+    set_param_overrides(list);
 
     return true;
 }
@@ -2206,56 +2832,6 @@ bool AP_Param::load_defaults_file(const char *filename, bool last_pass)
 #endif // HAL_OS_POSIX_IO
 
 #if AP_PARAM_MAX_EMBEDDED_PARAM > 0
-/*
-  count the number of embedded parameter defaults
- */
-bool AP_Param::count_embedded_param_defaults(uint16_t &count)
-{
-    const volatile char *ptr = param_defaults_data.data;
-    uint16_t length = param_defaults_data.length;
-    count = 0;
-    
-    while (length) {
-        char line[100];
-        char *pname;
-        float value;
-        bool read_only;
-        uint16_t i;
-        uint16_t n = MIN(length, sizeof(line)-1);
-        for (i=0;i<n;i++) {
-            if (ptr[i] == '\n') {
-                break;
-            }
-        }
-        if (i == n) {
-            // no newline
-            break;
-        }
-        
-        memcpy(line, (void *)ptr, i);
-        line[i] = 0;
-
-        length -= i+1;
-        ptr += i+1;
-        
-        if (line[0] == '#' || line[0] == 0) {
-            continue;
-        }
-
-        if (!parse_param_line(line, &pname, value, read_only)) {
-            continue;
-        }
-
-        enum ap_var_type var_type;
-        if (!find(pname, &var_type)) {
-            continue;
-        }
-
-        count++;
-    }
-    return true;
-}
-
 /*
  * load a default set of parameters from a embedded parameter region
  * @last_pass: if this is the last pass on defaults - unknown parameters are
@@ -2263,27 +2839,13 @@ bool AP_Param::count_embedded_param_defaults(uint16_t &count)
  */
 void AP_Param::load_embedded_param_defaults(bool last_pass)
 {
-    delete[] param_overrides;
-    param_overrides = nullptr;
-    num_param_overrides = 0;
-    num_read_only = 0;
-
-    uint16_t num_defaults = 0;
-    if (!count_embedded_param_defaults(num_defaults)) {
-        return;
-    }
-
-    param_overrides = new param_override[num_defaults];
-    if (param_overrides == nullptr) {
-        AP_HAL::panic("AP_Param: Failed to allocate overrides");
-        return;
-    }
+    clear_param_overrides();
 
+    struct param_override_list list {};
     const volatile char *ptr = param_defaults_data.data;
     uint16_t length = param_defaults_data.length;
-    uint16_t idx = 0;
-    
-    while (idx < num_defaults && length) {
+
+    while (length) {
         char line[100];
         char *pname;
         float value;
@@ -2324,18 +2886,10 @@ void AP_Param::load_embedded_param_defaults(bool last_pass)
             }
             continue;
         }
-        param_overrides[idx].object_ptr = vp;
-        param_overrides[idx].value = value;
-        param_overrides[idx].read_only = read_only;
-        if (read_only) {
-            num_read_only++;
-        }
-        idx++;
-        if (!vp->configured_in_storage()) {
-            vp->set_float(value, var_type);
-        }
+        add_param_override(list, vp, var_type, value, read_only);
     }
-    num_param_overrides = num_defaults;
+
+    set_param_overrides(list);
 }
 #endif // AP_PARAM_MAX_EMBEDDED_PARAM > 0
 
@@ -2344,10 +2898,9 @@ void AP_Param::load_embedded_param_defaults(bool last_pass)
  */
 float AP_Param::get_default_value(const AP_Param *vp, const float *def_value_ptr)
 {
-    for (uint16_t i=0; i<num_param_overrides; i++) {
-        if (vp == param_overrides[i].object_ptr) {
-            return param_overrides[i].value;
-        }
+    const struct param_override *po = find_param_override(vp);
+    if (po != nullptr) {
+        return po->value;
     }
     return *def_value_ptr;
 }
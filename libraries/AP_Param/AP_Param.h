@@ -46,6 +46,15 @@
 #endif
 #endif
 
+/*
+  keep a sorted index of where each parameter is in storage so saves
+  and loads don't have to walk storage. Costs 8 bytes per stored
+  parameter
+ */
+#ifndef AP_PARAM_STORAGE_INDEX_ENABLED
+#define AP_PARAM_STORAGE_INDEX_ENABLED (HAL_MEM_CLASS >= HAL_MEM_CLASS_300)
+#endif
+
 /*
   flags for variables in var_info and group tables
  */
@@ -145,6 +154,8 @@ enum ap_var_type {
 ///
 class AP_Param
 {
+    friend class AP_Param_Test;
+
 public:
     // the Info and GroupInfo structures are passed by the main
     // program in setup() to give information on how variables are
@@ -389,6 +400,26 @@ public:
     // returns storage space :
     static uint16_t storage_size() { return _storage.size(); }
 
+    /// Start a bulk update. Parameters newly added to storage by
+    /// save_sync() are appended in one pass, with the end of storage
+    /// only moved when the matching save_bulk_end() is called. Calls
+    /// may be nested
+    ///
+    static void save_bulk_begin(void);
+    static void save_bulk_end(void);
+
+    /// Start removing stored parameters that are at their default
+    /// value to make room in storage. The compacted parameters are
+    /// written to the backup area first and then copied over the
+    /// primary, each step waiting for the last to reach the storage
+    /// device, so the IO thread finishes the job. Saves wait until it
+    /// is done. This happens when storage is full if enabled in
+    /// BRD_OPTIONS
+    ///
+    /// @return                True if compaction was started
+    ///
+    static bool compact_storage(void);
+
     /// reoad the hal.util defaults file. Called after pointer parameters have been allocated
     ///
     static void reload_defaults_file(bool last_pass);
@@ -647,6 +678,7 @@ private:
     static uint16_t             get_key(const Param_header &phdr);
     static void                 set_key(Param_header &phdr, uint16_t key);
     static bool                 is_sentinal(const Param_header &phrd);
+    static void                 read_header(uint16_t ofs, Param_header &phdr);
     static bool                 scan(
                                     const struct Param_header *phdr,
                                     uint16_t *pofs);
@@ -654,6 +686,9 @@ private:
                                     const void *ptr,
                                     uint16_t ofs,
                                     uint8_t size);
+    static bool                 stored_at_default(
+                                    const struct Param_header &phdr,
+                                    uint16_t ofs);
     static AP_Param *           next_group(
                                     const uint16_t vindex,
                                     const struct GroupInfo *group_info,
@@ -670,21 +705,6 @@ private:
 
     static bool parse_param_line(char *line, char **vname, float &value, bool &read_only);
 
-#if HAL_OS_POSIX_IO == 1
-    /*
-      load a parameter defaults file. This happens as part of load_all()
-     */
-    static bool count_defaults_in_file(const char *filename, uint16_t &num_defaults);
-    static bool read_param_defaults_file(const char *filename, bool last_pass);
-    static bool load_defaults_file(const char *filename, bool last_pass);
-#endif
-
-    /*
-      load defaults from embedded parameters
-     */
-    static bool count_embedded_param_defaults(uint16_t &count);
-    static void load_embedded_param_defaults(bool last_pass);
-
     // send a parameter to all GCS instances
     void send_parameter(const char *name, enum ap_var_type param_header_type, uint8_t idx) const;
 
@@ -697,18 +717,108 @@ private:
     static HAL_Semaphore        _count_sem;
     static const struct Info *  _var_info;
 
+    // held while storage is written
+    static HAL_Semaphore        _storage_sem;
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    /*
+      offset in storage of each stored parameter, sorted by header
+     */
+    struct storage_index_entry {
+        uint32_t header;
+        uint16_t ofs;
+    };
+    static struct storage_index_entry *storage_index;
+    static uint16_t storage_index_count;
+    static uint16_t storage_index_capacity;
+    static bool storage_index_valid;
+
+    static uint32_t header_value(const struct Param_header &phdr);
+    static void storage_index_reset(void);
+    static bool storage_index_append(const struct Param_header &phdr, uint16_t ofs);
+    static void storage_index_finish(void);
+    static void storage_index_insert(const struct Param_header &phdr, uint16_t ofs);
+    static void storage_index_invalidate(void);
+    static const struct storage_index_entry *storage_index_find(const struct Param_header &phdr);
+    static int storage_index_cmp(const void *p1, const void *p2);
+
     /*
-      list of overridden values from load_defaults_file()
+      bulk update state. The header of the first record appended in a
+      bulk update is held back so storage still ends at the old
+      sentinal until the update is committed. Walks of storage see it
+      through read_header(), and it is only written by bulk_update()
+      once the device has the sentinal after the last record
+     */
+    static uint8_t bulk_depth;
+    static bool bulk_pending;
+    static bool bulk_sentinal_written;
+    static uint16_t bulk_ofs;
+    static struct Param_header bulk_header;
+    static void bulk_commit(void);
+    static void bulk_update(void);
+    static void storage_index_rebuild(void);
+#endif
+
+    /*
+      stages of compacting storage, advanced by compact_update()
+     */
+    enum class CompactState : uint8_t {
+        IDLE,
+        BACKUP_WRITTEN,     // compacted parameters written to the backup
+        PRIMARY_INVALID,    // primary header marked invalid
+        PRIMARY_COPIED,     // compacted parameters copied to the primary
+    };
+    static CompactState compact_state;
+    static uint16_t compact_end;        // sentinal offset once compacted
+    static uint32_t compact_start_ms;
+    static bool compact_failed;
+    static bool compact_update(void);
+
+    bool save_sync_try(bool force_save, bool send_to_gcs);
+
+    /*
+      list of overridden values from load_defaults_file(), sorted by
+      object_ptr with one entry per parameter
     */
     struct param_override {
         const AP_Param *object_ptr;
         float value;
         bool read_only; // param is marked @READONLY
+        uint16_t order; // position in the defaults, the last one wins
     };
     static struct param_override *param_overrides;
     static uint16_t num_param_overrides;
     static uint16_t num_read_only;
 
+    /*
+      overrides collected while loading defaults, in the order they
+      were read
+     */
+    struct param_override_list {
+        struct param_override *overrides;
+        uint16_t count;
+        uint16_t capacity;
+    };
+    static void clear_param_overrides(void);
+    static void add_param_override(struct param_override_list &list, AP_Param *vp,
+                                   enum ap_var_type var_type, float value, bool read_only);
+    static void set_param_overrides(struct param_override_list &list);
+    static int param_override_cmp(const void *p1, const void *p2);
+    static const struct param_override *find_param_override(const AP_Param *vp);
+
+#if HAL_OS_POSIX_IO == 1
+    /*
+      load a parameter defaults file. This happens as part of load_all()
+     */
+    static bool read_param_defaults_file(const char *filename, bool last_pass, struct param_override_list &list);
+    static bool load_defaults_file(const char *filename, bool last_pass);
+#endif
+
+    /*
+      load defaults from embedded parameters
+     */
+    static void load_embedded_param_defaults(bool last_pass);
+
     // values filled into the EEPROM header
     static const uint8_t        k_EEPROM_magic0      = 0x50;
     static const uint8_t        k_EEPROM_magic1      = 0x41; ///< "AP"
@@ -725,6 +835,10 @@ private:
     static ObjectBuffer_TS<struct param_save> save_queue;
     static bool registered_save_handler;
 
+    // a save from the queue waiting for storage compaction
+    static struct param_save save_deferred;
+    static void save_queued(void);
+
     // background function for saving parameters
     void save_io_handler(void);
 };
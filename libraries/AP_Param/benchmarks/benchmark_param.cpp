@@ -0,0 +1,171 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Param/tests/param_test.h>
+
+#include <stdio.h>
+#include <unistd.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define TEST_NUM_PARAMS (TEST_GROUPS * TEST_GAINS)
+
+const struct AP_Param::Info var_info[] = {
+    TEST_VAR_INFO,
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+class AP_Param_Test {
+public:
+    static bool setup()
+    {
+        StorageManager::erase();
+        return AP_Param::setup() && AP_Param::load_all();
+    }
+
+    static bool load_defaults(const char *filename)
+    {
+        return AP_Param::load_defaults_file(filename, false);
+    }
+
+    static uint16_t num_param_overrides()
+    {
+        return AP_Param::num_param_overrides;
+    }
+
+    static float default_value(const AP_Param &p)
+    {
+        const float def_value = TEST_GAIN_DEFAULT;
+        return AP_Param::get_default_value(&p, &def_value);
+    }
+};
+
+/*
+  a defaults file setting the first n parameters, as a board or
+  vehicle defaults file does
+ */
+static bool write_defaults(char *name, uint16_t n)
+{
+    const int fd = mkstemp(name);
+    if (fd == -1) {
+        return false;
+    }
+    FILE *f = fdopen(fd, "w");
+    if (f == nullptr) {
+        close(fd);
+        return false;
+    }
+    for (uint16_t i=0; i<n; i++) {
+        fprintf(f, "T%u_G%u %u\n", unsigned(i / TEST_GAINS), unsigned(i % TEST_GAINS), unsigned(i));
+    }
+    fclose(f);
+    return true;
+}
+
+/*
+  load a defaults file of range(0) parameters, then look up the default
+  of every parameter as loading them from storage at boot does
+ */
+static void BM_ParamDefaultsBoot(benchmark::State& state)
+{
+    char name[] = "/tmp/ap_param_XXXXXX";
+    if (!AP_Param_Test::setup()) {
+        state.SkipWithError("param setup failed");
+        return;
+    }
+    if (!write_defaults(name, state.range(0))) {
+        state.SkipWithError("can't write defaults file");
+        return;
+    }
+    while (state.KeepRunning()) {
+        if (!AP_Param_Test::load_defaults(name)) {
+            state.SkipWithError("defaults load failed");
+            break;
+        }
+        for (auto &g : groups) {
+            AP_Param::setup_object_defaults(&g, TestGroup::var_info);
+        }
+        gbenchmark_escape(groups);
+    }
+    unlink(name);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ParamDefaultsBoot)->Arg(100)->Arg(TEST_NUM_PARAMS);
+
+/*
+  the default of every parameter with range(0) of them in the defaults
+ */
+static void BM_ParamDefaultLookup(benchmark::State& state)
+{
+    char name[] = "/tmp/ap_param_XXXXXX";
+    if (!AP_Param_Test::setup()) {
+        state.SkipWithError("param setup failed");
+        return;
+    }
+    if (!write_defaults(name, state.range(0)) ||
+        !AP_Param_Test::load_defaults(name) ||
+        AP_Param_Test::num_param_overrides() != state.range(0)) {
+        unlink(name);
+        state.SkipWithError("defaults load failed");
+        return;
+    }
+    unlink(name);
+    float sum = 0;
+    while (state.KeepRunning()) {
+        for (const auto &g : groups) {
+            for (const auto &gain : g.gain) {
+                sum += AP_Param_Test::default_value(gain);
+            }
+        }
+        gbenchmark_escape(&sum);
+    }
+    state.SetItemsProcessed(state.iterations() * TEST_NUM_PARAMS);
+}
+
+BENCHMARK(BM_ParamDefaultLookup)->Arg(100)->Arg(TEST_NUM_PARAMS);
+
+/*
+  save every parameter to empty storage, as applying a parameter file
+  does. With range(0) of 1 they are saved in one bulk update, as the
+  IO thread does with a queue of saves
+ */
+static void BM_ParamSave(benchmark::State& state)
+{
+    const bool bulk = state.range(0) != 0;
+    state.SetLabel(bulk ? "bulk" : "single");
+    while (state.KeepRunning()) {
+        state.PauseTiming();
+        if (!AP_Param_Test::setup()) {
+            state.SkipWithError("param setup failed");
+            break;
+        }
+        for (auto &g : groups) {
+            for (uint8_t i=0; i<TEST_GAINS; i++) {
+                g.gain[i].set(i + 1);
+            }
+        }
+        state.ResumeTiming();
+
+        if (bulk) {
+            AP_Param::save_bulk_begin();
+        }
+        for (auto &g : groups) {
+            for (auto &gain : g.gain) {
+                gain.save_sync(false, false);
+            }
+        }
+        if (bulk) {
+            AP_Param::save_bulk_end();
+        }
+    }
+    if (!groups[TEST_GROUPS-1].gain[TEST_GAINS-1].configured_in_storage()) {
+        state.SkipWithError("parameters not saved");
+    }
+    state.SetItemsProcessed(state.iterations() * TEST_NUM_PARAMS);
+}
+
+BENCHMARK(BM_ParamSave)->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
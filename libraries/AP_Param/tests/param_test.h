@@ -0,0 +1,176 @@
+#pragma once
+
+/*
+  shared by the tests and benchmarks of AP_Param and of the param.pck
+  file: parameter storage in RAM and a table of 500 parameters. Each
+  of them is built as a single program, so the definitions here are
+  only compiled once
+ */
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Param/AP_Param.h>
+#include <StorageManager/StorageManager.h>
+
+/*
+  parameter storage in RAM in front of a simulated storage device.
+  This replaces the StorageAccess in the ap library, so the tests
+  don't depend on the board storage layout and always have a backup
+  area. As on the boards, writes go to RAM and mark lines dirty, and
+  the device is only sent the dirty lines a test flushes. A power cut
+  loses everything the device hasn't been sent
+ */
+#ifndef TEST_STORAGE_SIZE
+#define TEST_STORAGE_SIZE 4096
+#endif
+#define TEST_LINE_SIZE 32
+#define TEST_NUM_LINES (TEST_STORAGE_SIZE / TEST_LINE_SIZE)
+#define TEST_NUM_AREAS (StorageManager::StorageParamBak+1)
+
+static uint8_t storage_ram[TEST_NUM_AREAS][TEST_STORAGE_SIZE];
+static uint8_t storage_device[TEST_NUM_AREAS][TEST_STORAGE_SIZE];
+static bool storage_dirty[TEST_NUM_AREAS][TEST_NUM_LINES];
+
+void StorageManager::erase(void)
+{
+    memset(storage_ram, 0, sizeof(storage_ram));
+    memset(storage_device, 0, sizeof(storage_device));
+    memset(storage_dirty, 0, sizeof(storage_dirty));
+}
+
+bool StorageManager::flushed(void)
+{
+    for (const auto &area : storage_dirty) {
+        for (const bool dirty : area) {
+            if (dirty) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+StorageAccess::StorageAccess(StorageManager::StorageType _type) :
+    type(_type),
+    total_size(TEST_STORAGE_SIZE)
+{
+}
+
+bool StorageAccess::read_block(void *data, uint16_t addr, size_t n) const
+{
+    if (addr + n > total_size) {
+        return false;
+    }
+    memcpy(data, &storage_ram[type][addr], n);
+    return true;
+}
+
+bool StorageAccess::write_block(uint16_t addr, const void *data, size_t n) const
+{
+    if (addr + n > total_size) {
+        return false;
+    }
+    memcpy(&storage_ram[type][addr], data, n);
+    for (uint16_t line = addr / TEST_LINE_SIZE; line <= (addr + n - 1) / TEST_LINE_SIZE; line++) {
+        storage_dirty[type][line] = true;
+    }
+    return true;
+}
+
+uint8_t StorageAccess::read_byte(uint16_t loc) const
+{
+    uint8_t v = 0;
+    read_block(&v, loc, sizeof(v));
+    return v;
+}
+
+uint16_t StorageAccess::read_uint16(uint16_t loc) const
+{
+    uint16_t v = 0;
+    read_block(&v, loc, sizeof(v));
+    return v;
+}
+
+uint32_t StorageAccess::read_uint32(uint16_t loc) const
+{
+    uint32_t v = 0;
+    read_block(&v, loc, sizeof(v));
+    return v;
+}
+
+float StorageAccess::read_float(uint16_t loc) const
+{
+    float v = 0;
+    read_block(&v, loc, sizeof(v));
+    return v;
+}
+
+void StorageAccess::write_byte(uint16_t loc, uint8_t value) const
+{
+    write_block(loc, &value, sizeof(value));
+}
+
+void StorageAccess::write_uint16(uint16_t loc, uint16_t value) const
+{
+    write_block(loc, &value, sizeof(value));
+}
+
+void StorageAccess::write_uint32(uint16_t loc, uint32_t value) const
+{
+    write_block(loc, &value, sizeof(value));
+}
+
+void StorageAccess::write_float(uint16_t loc, float value) const
+{
+    write_block(loc, &value, sizeof(value));
+}
+
+bool StorageAccess::copy_area(const StorageAccess &source) const
+{
+    write_block(0, storage_ram[source.type], MIN(source.size(), size()));
+    return true;
+}
+
+/*
+  500 float parameters in 10 groups, more than fit in 1024 bytes of
+  storage and enough for param.pck to span several checkpoints
+ */
+#define TEST_GROUPS 10
+#define TEST_GAINS 50
+#define TEST_GAIN_DEFAULT 0.5f
+
+class TestGroup {
+public:
+    TestGroup() {
+        AP_Param::setup_object_defaults(this, var_info);
+    }
+    static const struct AP_Param::GroupInfo var_info[];
+    AP_Float gain[TEST_GAINS];
+};
+
+#define TEST_GAIN(i) AP_GROUPINFO("G" #i, i+1, TestGroup, gain[i], TEST_GAIN_DEFAULT)
+#define TEST_GAINS10(t) TEST_GAIN(t##0), TEST_GAIN(t##1), TEST_GAIN(t##2), TEST_GAIN(t##3), TEST_GAIN(t##4), \
+                        TEST_GAIN(t##5), TEST_GAIN(t##6), TEST_GAIN(t##7), TEST_GAIN(t##8), TEST_GAIN(t##9)
+
+const AP_Param::GroupInfo TestGroup::var_info[] = {
+    TEST_GAINS10(),
+    TEST_GAINS10(1),
+    TEST_GAINS10(2),
+    TEST_GAINS10(3),
+    TEST_GAINS10(4),
+    AP_GROUPEND
+};
+
+static AP_Int16 format_version;
+static TestGroup groups[TEST_GROUPS];
+
+#define TEST_GROUP(i) { AP_PARAM_GROUP, "T" #i "_", i+1, (const void *)&groups[i], {group_info : TestGroup::var_info} }
+
+/*
+  the start of a parameter table holding the groups, ended by each
+  program with any parameters of its own and AP_VAREND. The first
+  entry must be a scalar, as in the vehicles
+ */
+#define TEST_VAR_INFO \
+    { AP_PARAM_INT16, "FORMAT_VERSION", 0, &format_version, {def_value : 0} }, \
+    TEST_GROUP(0), TEST_GROUP(1), TEST_GROUP(2), TEST_GROUP(3), TEST_GROUP(4), \
+    TEST_GROUP(5), TEST_GROUP(6), TEST_GROUP(7), TEST_GROUP(8), TEST_GROUP(9)
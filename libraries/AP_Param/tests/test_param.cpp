@@ -0,0 +1,242 @@
+#include <AP_gtest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "param_test.h"
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#define TEST_INT8_DEFAULT 3
+#define TEST_INT32_DEFAULT 100000
+#define TEST_NUM_PARAMS (TEST_GROUPS * TEST_GAINS + 2)
+
+static AP_Int8 test_int8;
+static AP_Int32 test_int32;
+
+const struct AP_Param::Info var_info[] = {
+    TEST_VAR_INFO,
+    { AP_PARAM_INT8,  "TINT8",  11, &test_int8,  {def_value : TEST_INT8_DEFAULT} },
+    { AP_PARAM_INT32, "TINT32", 12, &test_int32, {def_value : TEST_INT32_DEFAULT} },
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+/*
+  each test starts from empty storage with every parameter at its
+  table default
+ */
+class AP_Param_Test : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        StorageManager::erase();
+        AP_Param::clear_param_overrides();
+        ASSERT_TRUE(AP_Param::setup());
+        for (auto &g : groups) {
+            AP_Param::setup_object_defaults(&g, TestGroup::var_info);
+        }
+        AP_Param::setup_sketch_defaults();
+        ASSERT_TRUE(AP_Param::load_all());
+    }
+
+    void TearDown() override
+    {
+        AP_Param::clear_param_overrides();
+        for (const auto &f : files) {
+            unlink(f.c_str());
+        }
+        files.clear();
+    }
+
+    // write a defaults file, returning its name or an empty string
+    std::string defaults_file(const std::string &contents)
+    {
+        char name[] = "/tmp/ap_param_XXXXXX";
+        const int fd = mkstemp(name);
+        if (fd == -1) {
+            return "";
+        }
+        files.push_back(name);
+        const bool ok = write(fd, contents.c_str(), contents.size()) == ssize_t(contents.size());
+        close(fd);
+        return ok ? name : "";
+    }
+
+    static bool load_defaults(const std::string &filenames)
+    {
+        return AP_Param::load_defaults_file(filenames.c_str(), false);
+    }
+
+    static uint16_t num_param_overrides()
+    {
+        return AP_Param::num_param_overrides;
+    }
+
+    static uint16_t num_read_only()
+    {
+        return AP_Param::num_read_only;
+    }
+
+    // the default of a gain, from the overrides or the table
+    static float gain_default(const AP_Float &gain)
+    {
+        const float def_value = TEST_GAIN_DEFAULT;
+        return AP_Param::get_default_value(&gain, &def_value);
+    }
+
+    static bool overridden(const AP_Param &p)
+    {
+        return AP_Param::find_param_override(&p) != nullptr;
+    }
+
+private:
+    std::vector<std::string> files;
+};
+
+TEST_F(AP_Param_Test, DefaultsLastValueWins)
+{
+    const std::string f = defaults_file("T0_G1 1.5\n"
+                                  "T1_G2 3\n"
+                                  "T0_G1 2.5\n");
+    ASSERT_FALSE(f.empty());
+    ASSERT_TRUE(load_defaults(f));
+
+    EXPECT_EQ(num_param_overrides(), 2U);
+    EXPECT_FLOAT_EQ(groups[0].gain[1], 2.5f);
+    EXPECT_FLOAT_EQ(gain_default(groups[0].gain[1]), 2.5f);
+    EXPECT_FLOAT_EQ(groups[1].gain[2], 3);
+    EXPECT_FLOAT_EQ(gain_default(groups[1].gain[2]), 3);
+    EXPECT_FALSE(overridden(groups[0].gain[2]));
+    EXPECT_FLOAT_EQ(gain_default(groups[0].gain[2]), TEST_GAIN_DEFAULT);
+}
+
+TEST_F(AP_Param_Test, DefaultsFilesInOrder)
+{
+    const std::string a = defaults_file("T0_G1 1\n"
+                                  "T1_G2 3\n");
+    const std::string b = defaults_file("T0_G1 2\n");
+    ASSERT_FALSE(a.empty());
+    ASSERT_FALSE(b.empty());
+
+    // a later file overrides an earlier one
+    ASSERT_TRUE(load_defaults(a + "," + b));
+    EXPECT_EQ(num_param_overrides(), 2U);
+    EXPECT_FLOAT_EQ(groups[0].gain[1], 2);
+    EXPECT_FLOAT_EQ(gain_default(groups[0].gain[1]), 2);
+    EXPECT_FLOAT_EQ(groups[1].gain[2], 3);
+
+    ASSERT_TRUE(load_defaults(b + "," + a));
+    EXPECT_EQ(num_param_overrides(), 2U);
+    EXPECT_FLOAT_EQ(groups[0].gain[1], 1);
+    EXPECT_FLOAT_EQ(gain_default(groups[0].gain[1]), 1);
+}
+
+TEST_F(AP_Param_Test, DefaultsReadOnly)
+{
+    const std::string f = defaults_file("T2_G3 4 @READONLY\n"
+                                  "T2_G4 5 @READONLY\n"
+                                  "T2_G4 6\n"
+                                  "TINT8 7\n");
+    ASSERT_FALSE(f.empty());
+    ASSERT_TRUE(load_defaults(f));
+
+    // only the entries that were kept count
+    EXPECT_EQ(num_param_overrides(), 3U);
+    EXPECT_EQ(num_read_only(), 1U);
+    EXPECT_TRUE(groups[2].gain[3].is_read_only());
+    EXPECT_FALSE(groups[2].gain[4].is_read_only());
+    EXPECT_FLOAT_EQ(groups[2].gain[4], 6);
+    EXPECT_EQ(test_int8, 7);
+
+    bool read_only;
+    EXPECT_TRUE(groups[2].gain[3].configured_in_defaults_file(read_only));
+    EXPECT_TRUE(read_only);
+    EXPECT_TRUE(groups[2].gain[4].configured_in_defaults_file(read_only));
+    EXPECT_FALSE(read_only);
+    EXPECT_FALSE(groups[2].gain[5].configured_in_defaults_file(read_only));
+}
+
+TEST_F(AP_Param_Test, DefaultsStorageWins)
+{
+    groups[0].gain[5].set(7);
+    groups[0].gain[5].save_sync(false, false);
+    ASSERT_TRUE(groups[0].gain[5].configured_in_storage());
+
+    const std::string f = defaults_file("T0_G5 9\n"
+                                  "T0_G6 10\n");
+    ASSERT_FALSE(f.empty());
+    ASSERT_TRUE(load_defaults(f));
+
+    // a saved value is kept, but the default still changes
+    EXPECT_FLOAT_EQ(groups[0].gain[5], 7);
+    EXPECT_FLOAT_EQ(gain_default(groups[0].gain[5]), 9);
+    EXPECT_FLOAT_EQ(groups[0].gain[6], 10);
+
+    ASSERT_TRUE(AP_Param::load_all());
+    EXPECT_FLOAT_EQ(groups[0].gain[5], 7);
+}
+
+TEST_F(AP_Param_Test, DefaultsReloadReplaces)
+{
+    const std::string a = defaults_file("T1_G2 3\n");
+    const std::string b = defaults_file("T1_G3 4\n");
+    ASSERT_FALSE(a.empty());
+    ASSERT_FALSE(b.empty());
+
+    ASSERT_TRUE(load_defaults(a));
+    EXPECT_TRUE(overridden(groups[1].gain[2]));
+
+    ASSERT_TRUE(load_defaults(b));
+    EXPECT_EQ(num_param_overrides(), 1U);
+    EXPECT_FALSE(overridden(groups[1].gain[2]));
+    EXPECT_FLOAT_EQ(gain_default(groups[1].gain[2]), TEST_GAIN_DEFAULT);
+    EXPECT_TRUE(overridden(groups[1].gain[3]));
+}
+
+TEST_F(AP_Param_Test, DefaultsMissingFile)
+{
+    const std::string a = defaults_file("T1_G2 3\n");
+    ASSERT_FALSE(a.empty());
+    ASSERT_TRUE(load_defaults(a));
+
+    EXPECT_FALSE(load_defaults(a + ",/nonexistent/defaults.parm"));
+    EXPECT_EQ(num_param_overrides(), 0U);
+    EXPECT_FALSE(overridden(groups[1].gain[2]));
+}
+
+TEST_F(AP_Param_Test, DefaultsAllParams)
+{
+    // every parameter twice, in reverse order of the table, so the
+    // sort has to put them back in object order and keep the second
+    std::string contents;
+    char line[40];
+    for (int8_t i=TEST_GROUPS-1; i>=0; i--) {
+        for (int8_t j=TEST_GAINS-1; j>=0; j--) {
+            snprintf(line, sizeof(line), "T%d_G%d %d\n", i, j, -1);
+            contents += line;
+            snprintf(line, sizeof(line), "T%d_G%d %d\n", i, j, i*TEST_GAINS + j);
+            contents += line;
+        }
+    }
+    contents += "TINT32 5\nTINT8 1\nTINT32 6\n";
+    const std::string f = defaults_file(contents);
+    ASSERT_FALSE(f.empty());
+    ASSERT_TRUE(load_defaults(f));
+
+    EXPECT_EQ(num_param_overrides(), TEST_NUM_PARAMS);
+    for (uint8_t i=0; i<TEST_GROUPS; i++) {
+        for (uint8_t j=0; j<TEST_GAINS; j++) {
+            EXPECT_FLOAT_EQ(groups[i].gain[j], i*TEST_GAINS + j);
+            EXPECT_FLOAT_EQ(gain_default(groups[i].gain[j]), i*TEST_GAINS + j);
+        }
+    }
+    EXPECT_EQ(test_int8, 1);
+    EXPECT_EQ(test_int32, 6);
+}
+
+AP_GTEST_MAIN()
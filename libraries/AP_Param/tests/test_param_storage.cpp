@@ -0,0 +1,528 @@
+#include <AP_gtest.h>
+
+#include <vector>
+
+// small enough that the test parameters don't all fit
+#define TEST_STORAGE_SIZE 1024
+#include "param_test.h"
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+const struct AP_Param::Info var_info[] = {
+    TEST_VAR_INFO,
+    AP_VAREND
+};
+
+static AP_Param param_loader{var_info};
+
+// gains saved by fill_storage(), every other one back at its default
+#define TEST_FILL_GAINS 100
+
+// a stored parameter that isn't in the table, as one waiting for
+// conversion would be
+#define TEST_UNKNOWN_KEY 200
+#define TEST_UNKNOWN_VALUE 1234.5f
+#define TEST_STALE_KEY 201
+
+/*
+  each test starts from empty storage that has reached the device,
+  with every parameter at its table default
+ */
+class AP_Param_Test : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        StorageManager::erase();
+        reboot();
+        flush_all();
+    }
+
+    // a stored record, as found by walking storage
+    struct record {
+        AP_Param::Param_header phdr;
+        uint16_t ofs;
+    };
+
+    std::vector<record> walk_storage()
+    {
+        std::vector<record> records;
+        uint16_t ofs = sizeof(AP_Param::EEPROM_header);
+        while (ofs < TEST_STORAGE_SIZE) {
+            struct record r;
+            AP_Param::_storage.read_block(&r.phdr, ofs, sizeof(r.phdr));
+            if (AP_Param::is_sentinal(r.phdr)) {
+                break;
+            }
+            r.ofs = ofs;
+            records.push_back(r);
+            ofs += sizeof(r.phdr) + AP_Param::type_size((enum ap_var_type)r.phdr.type);
+        }
+        return records;
+    }
+
+    bool record_equal(const AP_Param::Param_header &h1, const AP_Param::Param_header &h2)
+    {
+        return memcmp(&h1, &h2, sizeof(h1)) == 0;
+    }
+
+    // send one dirty line, chosen at random, to the device
+    void flush_line()
+    {
+        std::vector<uint16_t> dirty;
+        for (uint8_t a=0; a<TEST_NUM_AREAS; a++) {
+            for (uint16_t i=0; i<TEST_NUM_LINES; i++) {
+                if (storage_dirty[a][i]) {
+                    dirty.push_back(a * TEST_NUM_LINES + i);
+                }
+            }
+        }
+        if (dirty.empty()) {
+            return;
+        }
+        seed = seed * 1664525U + 1013904223U;
+        const uint16_t n = dirty[(seed >> 8) % dirty.size()];
+        const uint8_t a = n / TEST_NUM_LINES;
+        const uint16_t ofs = (n % TEST_NUM_LINES) * TEST_LINE_SIZE;
+        memcpy(&storage_device[a][ofs], &storage_ram[a][ofs], TEST_LINE_SIZE);
+        storage_dirty[a][n % TEST_NUM_LINES] = false;
+    }
+
+    void flush_all()
+    {
+        while (!StorageManager::flushed()) {
+            flush_line();
+        }
+    }
+
+    /*
+      lose power, then boot with what reached the device
+     */
+    void reboot()
+    {
+        memcpy(storage_ram, storage_device, sizeof(storage_ram));
+        memset(storage_dirty, 0, sizeof(storage_dirty));
+        AP_Param::compact_state = AP_Param::CompactState::IDLE;
+        AP_Param::save_deferred.param = nullptr;
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+        AP_Param::bulk_depth = 0;
+        AP_Param::bulk_pending = false;
+        AP_Param::bulk_sentinal_written = false;
+#endif
+        AP_Param::param_save p;
+        while (AP_Param::save_queue.pop(p)) {
+        }
+        for (auto &g : groups) {
+            for (auto &gain : g.gain) {
+                gain.set(-1);
+            }
+            AP_Param::setup_object_defaults(&g, TestGroup::var_info);
+        }
+        ASSERT_TRUE(AP_Param::setup());
+        ASSERT_TRUE(AP_Param::load_all());
+    }
+
+    // one run of the IO thread parameter saving
+    void io_tick()
+    {
+        param_loader.save_io_handler();
+    }
+
+    bool compacting() const
+    {
+        return AP_Param::compact_state != AP_Param::CompactState::IDLE;
+    }
+
+    bool saves_waiting() const
+    {
+        return AP_Param::save_queue.available() > 0 || AP_Param::save_deferred.param != nullptr;
+    }
+
+    bool bulk_waiting() const
+    {
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+        return AP_Param::bulk_pending;
+#else
+        return false;
+#endif
+    }
+
+    /*
+      run the IO thread and the storage device until compaction,
+      saves and bulk commits are done, cutting power after cut_after
+      lines have been written. Returns true if the power was cut
+     */
+    bool run_storage(uint16_t cut_after=UINT16_MAX)
+    {
+        uint16_t written = 0;
+        while (compacting() || saves_waiting() || bulk_waiting() || !StorageManager::flushed()) {
+            io_tick();
+            if (!StorageManager::flushed()) {
+                if (written == cut_after) {
+                    reboot();
+                    return true;
+                }
+                flush_line();
+                written++;
+            }
+        }
+        return false;
+    }
+
+    // append a float record as save_sync() does
+    void add_record(const AP_Param::Param_header &phdr, float value)
+    {
+        const uint16_t ofs = AP_Param::sentinal_offset;
+        AP_Param::write_sentinal(ofs + record_size);
+        AP_Param::eeprom_write_check(&value, ofs + sizeof(phdr), sizeof(value));
+        AP_Param::eeprom_write_check(&phdr, ofs, sizeof(phdr));
+        ASSERT_TRUE(AP_Param::load_all());
+    }
+
+    /*
+      a record for a key that isn't in the parameter table
+     */
+    void add_unknown_record()
+    {
+        AP_Param::Param_header phdr {};
+        phdr.type = AP_PARAM_FLOAT;
+        AP_Param::set_key(phdr, TEST_UNKNOWN_KEY);
+        add_record(phdr, TEST_UNKNOWN_VALUE);
+    }
+
+    /*
+      a record past the sentinal, on the device
+     */
+    void add_stale_record(uint16_t ofs)
+    {
+        AP_Param::Param_header phdr {};
+        phdr.type = AP_PARAM_FLOAT;
+        AP_Param::set_key(phdr, TEST_STALE_KEY);
+        const float value = TEST_UNKNOWN_VALUE;
+        AP_Param::_storage.write_block(ofs, &phdr, sizeof(phdr));
+        AP_Param::_storage.write_block(ofs + sizeof(phdr), &value, sizeof(value));
+        flush_all();
+    }
+
+    bool stale_record_found()
+    {
+        for (const auto &r : walk_storage()) {
+            if (AP_Param::get_key(r.phdr) == TEST_STALE_KEY) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool unknown_record_kept()
+    {
+        for (const auto &r : walk_storage()) {
+            if (AP_Param::get_key(r.phdr) == TEST_UNKNOWN_KEY) {
+                float value;
+                AP_Param::_storage.read_block(&value, r.ofs + sizeof(r.phdr), sizeof(value));
+                return is_equal(value, TEST_UNKNOWN_VALUE);
+            }
+        }
+        return false;
+    }
+
+    /*
+      save TEST_FILL_GAINS gains, putting every other one back to its
+      default so compaction can remove it
+     */
+    void fill_storage()
+    {
+        add_unknown_record();
+        for (uint16_t i=0; i<TEST_FILL_GAINS; i++) {
+            AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+            gain.set(i + 1);
+            gain.save_sync(false, false);
+            if (i % 2 == 0) {
+                gain.set(TEST_GAIN_DEFAULT);
+                gain.save_sync(false, false);
+            }
+        }
+        flush_all();
+    }
+
+    void expect_filled_values()
+    {
+        for (uint16_t i=0; i<TEST_GROUPS*TEST_GAINS; i++) {
+            const float expected = (i < TEST_FILL_GAINS && i % 2 != 0) ? i + 1 : TEST_GAIN_DEFAULT;
+            ASSERT_FLOAT_EQ(groups[i / TEST_GAINS].gain[i % TEST_GAINS], expected) << "gain " << i;
+        }
+    }
+
+    static bool compact_storage()
+    {
+        return AP_Param::compact_storage();
+    }
+
+    static uint16_t storage_used()
+    {
+        return AP_Param::storage_used();
+    }
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    // a second copy of a stored record, after the first
+    void add_duplicate_record(const record &r)
+    {
+        add_record(r.phdr, 7);
+    }
+
+    // load every parameter, walking storage if use_index is false
+    void load_gains(bool use_index)
+    {
+        AP_Param::storage_index_valid = use_index;
+        for (auto &g : groups) {
+            AP_Param::setup_object_defaults(&g, TestGroup::var_info);
+            for (auto &gain : g.gain) {
+                gain.load();
+            }
+        }
+        AP_Param::storage_index_valid = true;
+    }
+
+    // check the index has the first copy of each stored record
+    void check_index()
+    {
+        ASSERT_TRUE(AP_Param::storage_index_valid);
+        uint16_t n = 0;
+        const std::vector<record> records = walk_storage();
+        for (uint16_t i=0; i<records.size(); i++) {
+            bool first = true;
+            for (uint16_t j=0; j<i; j++) {
+                if (record_equal(records[j].phdr, records[i].phdr)) {
+                    first = false;
+                }
+            }
+            const AP_Param::storage_index_entry *e = AP_Param::storage_index_find(records[i].phdr);
+            ASSERT_NE(e, nullptr) << "offset " << records[i].ofs;
+            if (first) {
+                EXPECT_EQ(e->ofs, records[i].ofs);
+                n++;
+            }
+        }
+        EXPECT_EQ(AP_Param::storage_index_count, n);
+    }
+#endif
+
+    // size of a stored float
+    static constexpr uint16_t record_size = sizeof(AP_Param::Param_header) + sizeof(float);
+
+    uint32_t seed = 1;
+};
+
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+TEST_F(AP_Param_Test, StorageIndexLookups)
+{
+    fill_storage();
+    check_index();
+
+    // loads through the index match loads walking storage
+    reboot();
+    check_index();
+    expect_filled_values();
+    load_gains(false);
+    expect_filled_values();
+    load_gains(true);
+    expect_filled_values();
+
+    // a record stored twice is found at its first copy, as a walk
+    // of storage finds it
+    const std::vector<record> records = walk_storage();
+    ASSERT_GT(records.size(), 2U);
+    add_duplicate_record(records[2]);
+    check_index();
+    load_gains(true);
+    expect_filled_values();
+}
+
+TEST_F(AP_Param_Test, BulkCommit)
+{
+    fill_storage();
+    const uint16_t used = storage_used();
+    const size_t stored = walk_storage().size();
+
+    AP_Param::save_bulk_begin();
+    for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+        AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+        gain.set(i);
+        gain.save_sync(false, false);
+        EXPECT_TRUE(gain.configured_in_storage());
+    }
+
+    // before the commit, even with every write on the device, storage
+    // ends where it did
+    flush_all();
+    EXPECT_EQ(walk_storage().size(), stored);
+    reboot();
+    EXPECT_EQ(storage_used(), used);
+    expect_filled_values();
+
+    AP_Param::save_bulk_begin();
+    for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+        AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+        gain.set(i);
+        gain.save_sync(false, false);
+    }
+    AP_Param::save_bulk_end();
+
+    // the header joining the records waits for the sentinal to reach
+    // the device, and until then the records are still found
+    EXPECT_TRUE(bulk_waiting());
+    io_tick();
+    EXPECT_TRUE(bulk_waiting());
+    EXPECT_EQ(walk_storage().size(), stored);
+    for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+        AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+        EXPECT_TRUE(gain.configured_in_storage());
+        gain.set(0);
+        gain.load();
+        EXPECT_FLOAT_EQ(gain, i);
+    }
+    load_gains(false);
+    EXPECT_FLOAT_EQ(groups[TEST_FILL_GAINS / TEST_GAINS].gain[TEST_FILL_GAINS % TEST_GAINS], TEST_FILL_GAINS);
+
+    EXPECT_FALSE(run_storage());
+    EXPECT_EQ(walk_storage().size(), stored + 20U);
+    check_index();
+    reboot();
+    EXPECT_EQ(storage_used(), used + 20U * record_size);
+    for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+        EXPECT_FLOAT_EQ(groups[i / TEST_GAINS].gain[i % TEST_GAINS], i);
+    }
+}
+
+TEST_F(AP_Param_Test, BulkCommitPowerCut)
+{
+    // cut the power after each line the device writes
+    for (uint16_t cut=0; ; cut++) {
+        SetUp();
+        fill_storage();
+        const uint16_t used = storage_used();
+
+        // stale bytes after the new end of storage, as left by an
+        // earlier compaction, that must never be read as a record
+        add_stale_record(used + 20U * record_size);
+
+        AP_Param::save_bulk_begin();
+        for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+            AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+            gain.set(i);
+            gain.save_sync(false, false);
+        }
+        AP_Param::save_bulk_end();
+        const bool was_cut = run_storage(cut);
+        if (!was_cut) {
+            reboot();
+        }
+
+        // storage ends either before or after all of the records
+        ASSERT_FALSE(stale_record_found()) << "cut after " << cut;
+        const bool committed = storage_used() != used;
+        if (committed) {
+            EXPECT_EQ(storage_used(), used + 20U * record_size) << "cut after " << cut;
+        }
+        for (uint16_t i=TEST_FILL_GAINS; i<TEST_FILL_GAINS+20; i++) {
+            AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+            EXPECT_FLOAT_EQ(gain, committed ? i : TEST_GAIN_DEFAULT) << "cut after " << cut;
+            gain.set(TEST_GAIN_DEFAULT);
+        }
+        expect_filled_values();
+        check_index();
+        if (!was_cut) {
+            EXPECT_TRUE(committed);
+            break;
+        }
+    }
+}
+#endif // AP_PARAM_STORAGE_INDEX_ENABLED
+
+TEST_F(AP_Param_Test, CompactNotAutomatic)
+{
+    fill_storage();
+
+    // save until storage is full
+    uint16_t i;
+    for (i=TEST_FILL_GAINS; i<TEST_GROUPS*TEST_GAINS; i++) {
+        AP_Float &gain = groups[i / TEST_GAINS].gain[i % TEST_GAINS];
+        gain.set(i + 1);
+        gain.save_sync(false, false);
+        if (!gain.configured_in_storage()) {
+            break;
+        }
+    }
+    ASSERT_LT(i, TEST_GROUPS*TEST_GAINS);
+
+    // without the board option the records at their default stay
+    EXPECT_FALSE(compacting());
+    EXPECT_FALSE(saves_waiting());
+    EXPECT_TRUE(groups[0].gain[0].configured_in_storage());
+    EXPECT_FLOAT_EQ(groups[0].gain[0], TEST_GAIN_DEFAULT);
+}
+
+TEST_F(AP_Param_Test, CompactKeepsValues)
+{
+    fill_storage();
+    const uint16_t used = storage_used();
+
+    ASSERT_TRUE(compact_storage());
+    EXPECT_TRUE(compacting());
+
+    // a save while compacting waits for it
+    AP_Float &gain = groups[9].gain[49];
+    gain.set(42);
+    gain.save_sync(false, false);
+    EXPECT_TRUE(saves_waiting());
+    EXPECT_FALSE(gain.configured_in_storage());
+
+    EXPECT_FALSE(run_storage());
+    EXPECT_TRUE(gain.configured_in_storage());
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+    check_index();
+#endif
+
+    // half the filled gains removed, and the new one added
+    EXPECT_EQ(storage_used(), used - TEST_FILL_GAINS / 2 * record_size + record_size);
+    EXPECT_FALSE(groups[0].gain[0].configured_in_storage());
+    EXPECT_TRUE(groups[0].gain[1].configured_in_storage());
+    EXPECT_TRUE(unknown_record_kept());
+
+    reboot();
+    EXPECT_FLOAT_EQ(gain, 42);
+    gain.set(TEST_GAIN_DEFAULT);
+    expect_filled_values();
+
+    // nothing more to remove
+    EXPECT_FALSE(compact_storage());
+}
+
+TEST_F(AP_Param_Test, CompactPowerCut)
+{
+    // cut the power after each line the device writes
+    for (uint16_t cut=0; ; cut++) {
+        SetUp();
+        fill_storage();
+        const uint16_t used = storage_used();
+        ASSERT_TRUE(compact_storage());
+        const bool was_cut = run_storage(cut);
+        if (!was_cut) {
+            reboot();
+        }
+
+        // either copy of the parameters is complete
+        expect_filled_values();
+        EXPECT_TRUE(unknown_record_kept()) << "cut after " << cut;
+        EXPECT_LE(storage_used(), used) << "cut after " << cut;
+#if AP_PARAM_STORAGE_INDEX_ENABLED
+        check_index();
+#endif
+        if (!was_cut) {
+            EXPECT_LT(storage_used(), used);
+            EXPECT_GT(cut, 3U);
+            break;
+        }
+    }
+}
+
+AP_GTEST_MAIN()
@@ -370,7 +370,7 @@ bool AP_Proximity::get_active_layer_distances(uint8_t layer, AP_Proximity::Proxi
 }
 
 // get total number of obstacles, used in GPS based Simple Avoidance
-uint8_t AP_Proximity::get_obstacle_count() const
+uint16_t AP_Proximity::get_obstacle_count() const
 {   
     if (!valid_instance(primary_instance)) {
         return 0;
@@ -388,7 +388,7 @@ uint8_t AP_Proximity::get_num_layers() const
 }
 
 // get vector to obstacle based on obstacle_num passed, used in GPS based Simple Avoidance
-bool AP_Proximity::get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_obstacle) const
+bool AP_Proximity::get_obstacle(uint16_t obstacle_num, Vector3f& vec_to_obstacle) const
 {
     if (!valid_instance(primary_instance)) {
         return false;
@@ -398,7 +398,7 @@ bool AP_Proximity::get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_obstacle)
 
 // returns shortest distance to "obstacle_num" obstacle, from a line segment formed between "seg_start" and "seg_end"
 // used in GPS based Simple Avoidance
-float AP_Proximity::distance_to_obstacle(uint8_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const
+float AP_Proximity::distance_to_obstacle(uint16_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const
 {
     if (!valid_instance(primary_instance)) {
         return FLT_MAX;
@@ -107,14 +107,14 @@ public:
     bool get_active_layer_distances(uint8_t layer, AP_Proximity::Proximity_Distance_Array &prx_dist_array, AP_Proximity::Proximity_Distance_Array &prx_filt_dist_array) const;
 
     // get total number of obstacles, used in GPS based Simple Avoidance
-    uint8_t get_obstacle_count() const;
+    uint16_t get_obstacle_count() const;
     
     // get vector to obstacle based on obstacle_num passed, used in GPS based Simple Avoidance
-    bool get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_obstacle) const;
+    bool get_obstacle(uint16_t obstacle_num, Vector3f& vec_to_obstacle) const;
     
     // returns shortest distance to "obstacle_num" obstacle, from a line segment formed between "seg_start" and "seg_end"
     // returns FLT_MAX if it's an invalid instance.
-    float distance_to_obstacle(uint8_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const;
+    float distance_to_obstacle(uint16_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const;
 
     // get distance and angle to closest object (used for pre-arm check)
     //   returns true on success, false if no valid readings
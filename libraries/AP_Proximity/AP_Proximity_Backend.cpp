@@ -41,7 +41,7 @@ static_assert(PROXIMITY_MAX_DIRECTION <= 8,
 bool AP_Proximity_Backend::get_horizontal_distances(AP_Proximity::Proximity_Distance_Array &prx_dist_array) const
 {
     AP_Proximity::Proximity_Distance_Array prx_filt_dist_array; // unused
-    return boundary.get_layer_distances(PROXIMITY_MIDDLE_LAYER, distance_max(), prx_dist_array, prx_filt_dist_array);
+    return boundary.get_layer_distances(boundary.middle_layer(), distance_max(), prx_dist_array, prx_filt_dist_array);
 }
 // get distances in PROXIMITY_MAX_DIRECTION directions at a layer. used for logging
 bool AP_Proximity_Backend::get_active_layer_distances(uint8_t layer, AP_Proximity::Proximity_Distance_Array &prx_dist_array, AP_Proximity::Proximity_Distance_Array &prx_filt_dist_array) const
@@ -53,14 +53,14 @@ public:
     virtual void handle_msg(const mavlink_message_t &msg) {}
 
     // get total number of obstacles, used in GPS based Simple Avoidance
-    uint8_t get_obstacle_count() { return boundary.get_obstacle_count(); }
+    uint16_t get_obstacle_count() const { return boundary.get_obstacle_count(); }
     
     // get vector to obstacle based on obstacle_num passed, used in GPS based Simple Avoidance
-    bool get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_obstacle) const { return boundary.get_obstacle(obstacle_num, vec_to_obstacle); }
+    bool get_obstacle(uint16_t obstacle_num, Vector3f& vec_to_obstacle) const { return boundary.get_obstacle(obstacle_num, vec_to_obstacle); }
     
     // returns shortest distance to "obstacle_num" obstacle, from a line segment formed between "seg_start" and "seg_end"
     // used in GPS based Simple Avoidance
-    float distance_to_obstacle(const uint8_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const { return boundary.distance_to_obstacle(obstacle_num , seg_start, seg_end, closest_point); } 
+    float distance_to_obstacle(const uint16_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const { return boundary.distance_to_obstacle(obstacle_num , seg_start, seg_end, closest_point); } 
 
     // get distance and angle to closest object (used for pre-arm check)
     //   returns true on success, false if no valid readings
@@ -16,46 +16,57 @@
 #include "AP_Proximity_Boundary_3D.h"
 
 #if HAL_PROXIMITY_ENABLED
-#include "AP_Proximity_Backend.h"
 
 /*
   Constructor. 
   This incorporates initialisation as well.
 */
-AP_Proximity_Boundary_3D::AP_Proximity_Boundary_3D() 
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::AP_Proximity_Boundary_3D_T()
 {
     // initialise sector edge vector used for building the boundary fence
     init();
 }
 
 // initialise the boundary and sector_edge_vector array used for object avoidance
-//   should be called if the sector_middle_deg or _sector_width_deg arrays are changed
-void AP_Proximity_Boundary_3D::init()
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::init()
 {
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        const float pitch = ((float)_pitch_middle_deg[layer]);
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
-            const float angle_rad = ((float)_sector_middle_deg[sector]+(PROXIMITY_SECTOR_WIDTH_DEG/2.0f));
-            _sector_edge_vector[layer][sector].offset_bearing(angle_rad, pitch, 100.0f);
-            _boundary_points[layer][sector] = _sector_edge_vector[layer][sector] * PROXIMITY_BOUNDARY_DIST_DEFAULT;
-        }
+    // the edge vector of a face is the unit vector along the clockwise edge of the sector,
+    // at the pitch of the middle of the layer, scaled to cm
+    for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
+        const float edge_rad = radians(sector_middle_deg(sector) + sector_width_deg() * 0.5f);
+        _edge_cos_yaw[sector] = cosf(edge_rad);
+        _edge_sin_yaw[sector] = sinf(edge_rad);
+    }
+    for (uint8_t layer=0; layer < NUM_LAYERS; layer++) {
+        const float pitch_rad = radians(layer_middle_deg(layer));
+        _layer_cos_pitch[layer] = cosf(pitch_rad) * 100.0f;
+        _layer_sin_pitch[layer] = sinf(pitch_rad) * 100.0f;
+        update_layer(layer);
     }
 }
 
 // returns face corresponding to the provided yaw and (optionally) pitch
 // pitch is the vertical body-frame angle (in degrees) to the obstacle (0=directly ahead, 90 is above the vehicle)
 // yaw is the horizontal body-frame angle (in degrees) to the obstacle (0=directly ahead of the vehicle, 90 is to the right of the vehicle)
-AP_Proximity_Boundary_3D::Face AP_Proximity_Boundary_3D::get_face(float pitch, float yaw) const
-{   
-    const uint8_t sector = wrap_360(yaw + (PROXIMITY_SECTOR_WIDTH_DEG * 0.5f)) / 45.0f;
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+typename AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::Face AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_face(float pitch, float yaw) const
+{
+    uint8_t sector = wrap_360(yaw + (sector_width_deg() * 0.5f)) / sector_width_deg();
+    if (sector >= NUM_SECTORS) {
+        // rounding just below 360 degrees
+        sector = 0;
+    }
     const float pitch_limited = constrain_float(pitch, -75.0f, 74.9f);
-    const uint8_t layer = (pitch_limited + 75.0f)/PROXIMITY_PITCH_WIDTH_DEG;
+    const uint8_t layer = MIN((pitch_limited + 75.0f) / layer_width_deg(), NUM_LAYERS - 1);
     return Face{layer, sector};
 }
 
 // Set the actual body-frame angle(yaw), pitch, and distance of the detected object.
 // This method will also mark the sector and layer to be "valid", so this distance can be used for Obstacle Avoidance
-void AP_Proximity_Boundary_3D::set_face_attributes(const Face &face, float pitch, float angle, float distance)
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::set_face_attributes(const Face &face, float pitch, float angle, float distance)
 {
     if (!face.valid()) {
         return;
@@ -73,34 +84,22 @@ void AP_Proximity_Boundary_3D::set_face_attributes(const Face &face, float pitch
     update_boundary(face);
 }
 
-// apply a new cutoff_freq to low-pass filter
-void AP_Proximity_Boundary_3D::apply_filter_freq(float cutoff_freq)
-{
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
-            _filtered_distance[layer][sector].set_cutoff_frequency(cutoff_freq);
-        }
-    }
-}
-
 // Apply low pass filter on the raw distance
-void AP_Proximity_Boundary_3D::set_filtered_distance(const Face &face, float distance)
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::set_filtered_distance(const Face &face, float distance)
 {
     if (!face.valid()) {
         return;
     }
-    if (!is_equal(_filtered_distance[face.layer][face.sector].get_cutoff_freq(), _filter_freq)) {
-        // cutoff freq has changed
-        apply_filter_freq(_filter_freq);
-    }
 
     const uint32_t now_ms = AP_HAL::millis();
     const uint32_t dt = now_ms - _last_update_ms[face.layer][face.sector];
+    float &filtered_distance = _filtered_distance[face.layer][face.sector];
     if (dt < PROXIMITY_FILT_RESET_TIME) {
-        _filtered_distance[face.layer][face.sector].apply(distance, dt* 0.001f);
+        filtered_distance += (distance - filtered_distance) * calc_lowpass_alpha_dt(dt * 0.001f, _filter_freq);
     } else {
         // reset filter since last distance was passed a long time back
-        _filtered_distance[face.layer][face.sector].reset(distance);
+        filtered_distance = distance;
     }
     _last_update_ms[face.layer][face.sector] = now_ms;
 }
@@ -108,70 +107,108 @@ void AP_Proximity_Boundary_3D::set_filtered_distance(const Face &face, float dis
 // update boundary points used for object avoidance based on a single sector and pitch distance changing
 //   the boundary points lie on the line between sectors meaning two boundary points may be updated based on a single sector's distance changing
 //   the boundary point is set to the shortest distance found in the two adjacent sectors, this is a conservative boundary around the vehicle
-void AP_Proximity_Boundary_3D::update_boundary(const Face &face)
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::update_boundary(const Face &face)
 {
     // sanity check
     if (!face.valid()) {
         return;
     }
 
-    const uint8_t layer = face.layer;
-    const uint8_t sector = face.sector;
+    // a sector's distance is used by the edges from two sectors counter-clockwise to one sector clockwise
+    uint8_t sector = get_prev_sector(get_prev_sector(face.sector));
+    for (uint8_t i=0; i < 4; i++) {
+        update_edge(face.layer, sector);
+        sector = get_next_sector(sector);
+    }
+
+    // and an obstacle uses the edges on either side of it
+    sector = get_prev_sector(get_prev_sector(get_prev_sector(face.sector)));
+    for (uint8_t i=0; i < 5; i++) {
+        update_obstacle(face.layer, sector);
+        sector = get_next_sector(sector);
+    }
+}
 
-    // find adjacent sector (clockwise)
+// recalculate the boundary point on the edge clockwise of a sector.  The point is placed at the
+// shorter distance found in the two sectors either side of the edge.  If neither is valid the
+// distance of the next valid sector beyond them is used to create a cup like boundary
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::update_edge(uint8_t layer, uint8_t sector)
+{
     const uint8_t next_sector = get_next_sector(sector);
+    const bool *valid = _distance_valid[layer];
+    const float *filtered = _filtered_distance[layer];
 
-    // boundary point lies on the line between the two sectors at the shorter distance found in the two sectors
     float shortest_distance = PROXIMITY_BOUNDARY_DIST_DEFAULT;
-    if (_distance_valid[layer][sector] && _distance_valid[layer][next_sector]) {
-        shortest_distance = MIN(_filtered_distance[layer][sector].get(), _filtered_distance[layer][next_sector].get());
-    } else if (_distance_valid[layer][sector]) {
-        shortest_distance = _filtered_distance[layer][sector].get();
-    } else if (_distance_valid[layer][next_sector]) {
-        shortest_distance = _filtered_distance[layer][next_sector].get();
+    if (valid[sector] || valid[next_sector]) {
+        if (valid[sector]) {
+            shortest_distance = filtered[sector];
+        }
+        if (valid[next_sector]) {
+            shortest_distance = MIN(shortest_distance, filtered[next_sector]);
+        }
+    } else {
+        const uint8_t next_sector_cw = get_next_sector(next_sector);
+        const uint8_t prev_sector = get_prev_sector(sector);
+        if (valid[next_sector_cw]) {
+            shortest_distance = filtered[next_sector_cw];
+        }
+        if (valid[prev_sector]) {
+            shortest_distance = MIN(shortest_distance, filtered[prev_sector]);
+        }
     }
     if (shortest_distance < PROXIMITY_BOUNDARY_DIST_MIN) {
         shortest_distance = PROXIMITY_BOUNDARY_DIST_MIN;
     }
-    _boundary_points[layer][sector] = _sector_edge_vector[layer][sector] * shortest_distance;
 
-    // if the next sector (clockwise) has an invalid distance, set boundary to create a cup like boundary
-    if (!_distance_valid[layer][next_sector]) {
-        _boundary_points[layer][next_sector] = _sector_edge_vector[layer][next_sector] * shortest_distance;
-    }
+    const float horizontal = _layer_cos_pitch[layer] * shortest_distance;
+    _boundary_points[layer][sector] = Vector3f{horizontal * _edge_cos_yaw[sector],
+                                               horizontal * _edge_sin_yaw[sector],
+                                               _layer_sin_pitch[layer] * shortest_distance};
+}
 
-    // repeat for edge between sector and previous sector
-    const uint8_t prev_sector = get_prev_sector(sector);
-    shortest_distance = PROXIMITY_BOUNDARY_DIST_DEFAULT;
-    if (_distance_valid[layer][prev_sector] && _distance_valid[layer][sector]) {
-        shortest_distance = MIN(_filtered_distance[layer][prev_sector].get(), _filtered_distance[layer][sector].get());
-    } else if (_distance_valid[layer][prev_sector]) {
-        shortest_distance = _filtered_distance[layer][prev_sector].get();
-    } else if (_distance_valid[layer][sector]) {
-        shortest_distance = _filtered_distance[layer][sector].get();
+// recalculate the obstacle between the boundary points either side of a sector
+// Any obstacle not near a sector with a valid distance is stale and marked invalid
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::update_obstacle(uint8_t layer, uint8_t sector)
+{
+    const uint8_t next_sector = get_next_sector(sector);
+    const bool *valid = _distance_valid[layer];
+    _obstacle_valid[layer][sector] = valid[sector] || valid[next_sector] || valid[get_next_sector(next_sector)];
+    if (_obstacle_valid[layer][sector]) {
+        _obstacle_vector[layer][sector] = Vector3f::point_on_line_closest_to_other_point(_boundary_points[layer][next_sector], _boundary_points[layer][sector], Vector3f{});
     }
-    _boundary_points[layer][prev_sector] = _sector_edge_vector[layer][prev_sector] * shortest_distance;
+}
 
-    // if the sector counter-clockwise from the previous sector has an invalid distance, set boundary to create a cup-like boundary
-    const uint8_t prev_sector_ccw = get_prev_sector(prev_sector);
-    if (!_distance_valid[layer][prev_sector_ccw]) {
-        _boundary_points[layer][prev_sector_ccw] = _sector_edge_vector[layer][prev_sector_ccw] * shortest_distance;
+// recalculate every boundary point and obstacle in a layer
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::update_layer(uint8_t layer)
+{
+    for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
+        update_edge(layer, sector);
+    }
+    for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
+        update_obstacle(layer, sector);
     }
 }
 
 // reset boundary.  marks all distances as invalid
-void AP_Proximity_Boundary_3D::reset()
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::reset()
 {
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
+    for (uint8_t layer=0; layer < NUM_LAYERS; layer++) {
+        for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
             _distance_valid[layer][sector] = false;
         }
+        update_layer(layer);
     }
 }
 
 // Reset this location, specified by Face object, back to default
 // i.e Distance is marked as not-valid, and set to a large number.
-void AP_Proximity_Boundary_3D::reset_face(const Face &face)
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::reset_face(const Face &face)
 {
     if (!face.valid()) {
         return;
@@ -183,23 +220,30 @@ void AP_Proximity_Boundary_3D::reset_face(const Face &face)
 }
 
 // check if a face has valid distance even if it was updated a long time back
-void AP_Proximity_Boundary_3D::check_face_timeout()
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::check_face_timeout()
 {
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint8_t layer=0; layer < NUM_LAYERS; layer++) {
+        bool layer_changed = false;
+        for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
             if (_distance_valid[layer][sector]) {
-                if ((AP_HAL::millis() - _last_update_ms[layer][sector]) > PROXIMITY_FACE_RESET_MS) {
+                if ((now_ms - _last_update_ms[layer][sector]) > PROXIMITY_FACE_RESET_MS) {
                     // this face has a valid distance but wasn't updated for a long time, reset it
-                    AP_Proximity_Boundary_3D::Face face{layer, sector};
-                    reset_face(face);
+                    _distance_valid[layer][sector] = false;
+                    layer_changed = true;
                 }
             }
         }
+        if (layer_changed) {
+            update_layer(layer);
+        }
     }
 }
 
 // get distance for a face.  returns true on success and fills in distance argument with distance in meters
-bool AP_Proximity_Boundary_3D::get_distance(const Face &face, float &distance) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_distance(const Face &face, float &distance) const
 {
     if (!face.valid()) {
         return false;
@@ -213,57 +257,24 @@ bool AP_Proximity_Boundary_3D::get_distance(const Face &face, float &distance) c
     return false;
 }
 
-// get the total number of obstacles 
-uint8_t AP_Proximity_Boundary_3D::get_obstacle_count() const
-{
-    return PROXIMITY_NUM_LAYERS * PROXIMITY_NUM_SECTORS;
-}
-
-// Converts obstacle_num passed from avoidance library into appropriate face of the boundary
-// Returns false if the face is invalid
-// "update_boundary" method manipulates two sectors ccw and one sector cw from any valid face.
-// Any boundary that does not fall into these manipulated faces are useless, and will be marked as false
-// The resultant is packed into a Boundary Location object and returned by reference as "face"
-bool AP_Proximity_Boundary_3D::convert_obstacle_num_to_face(uint8_t obstacle_num, Face& face) const
-{
-    // obstacle num is just "flattened layers, and sectors"
-    const uint8_t layer = obstacle_num / PROXIMITY_NUM_SECTORS;
-    const uint8_t sector = obstacle_num % PROXIMITY_NUM_SECTORS;
-    face.sector = sector;
-    face.layer = layer;
-
-    uint8_t valid_sector = sector;
-    // check for 3 adjacent sectors
-    for (uint8_t i=0; i < 3; i++) {
-        if (_distance_valid[layer][valid_sector]) {
-            // update boundary has manipulated this face
-            return true;
-        }
-        valid_sector = get_next_sector(valid_sector);
-    }
-
-    // this face was not manipulated by "update_boundary" and is stale. Don't use it
-    return false;
-}
-
 // Appropriate layer and sector are found from the passed obstacle_num
-// This function then draws a line between this sector, and sector + 1 at the given layer
-// Then returns the closest point on this line from vehicle, in body-frame. 
+// The obstacle is the line between this sector, and sector + 1 at the given layer
+// Returns the closest point on this line from vehicle, in body-frame.
 // Used by GPS based Simple Avoidance  
 // False is returned if the obstacle_num provided does not produce a valid obstacle 
-bool AP_Proximity_Boundary_3D::get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_obstacle) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_obstacle(uint16_t obstacle_num, Vector3f& vec_to_obstacle) const
 {
-    Face face;
-    if (!convert_obstacle_num_to_face(obstacle_num, face)) {
-        // not a valid face
+    // obstacle num is just "flattened layers, and sectors"
+    if (obstacle_num >= get_obstacle_count()) {
+        return false;
+    }
+    const uint8_t layer = obstacle_num / NUM_SECTORS;
+    const uint8_t sector = obstacle_num % NUM_SECTORS;
+    if (!_obstacle_valid[layer][sector]) {
         return false;
     }
-    const uint8_t sector_end = face.sector;
-    const uint8_t sector_start = get_next_sector(face.sector);
-    
-    const Vector3f start = _boundary_points[face.layer][sector_start];
-    const Vector3f end = _boundary_points[face.layer][sector_end];
-    vec_to_obstacle = Vector3f::point_on_line_closest_to_other_point(start, end, Vector3f{});
+    vec_to_obstacle = _obstacle_vector[layer][sector];
     return true;
 }
 
@@ -272,24 +283,28 @@ bool AP_Proximity_Boundary_3D::get_obstacle(uint8_t obstacle_num, Vector3f& vec_
 // Then returns the closest point on this line from the segment that was passed, in body-frame.
 // Used by GPS based Simple Avoidance  - for "brake mode" 
 // FLT_MAX is returned if the obstacle_num provided does not produce a valid obstacle
-float AP_Proximity_Boundary_3D::distance_to_obstacle(uint8_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+float AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::distance_to_obstacle(uint16_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const
 {   
-    Face face; 
-    if (!convert_obstacle_num_to_face(obstacle_num, face)) {
+    if (obstacle_num >= get_obstacle_count()) {
+        return FLT_MAX;
+    }
+    const uint8_t layer = obstacle_num / NUM_SECTORS;
+    const uint8_t sector = obstacle_num % NUM_SECTORS;
+    if (!_obstacle_valid[layer][sector]) {
         // not a valid a face
         return FLT_MAX;
     }
 
-    const uint8_t sector_end = face.sector;
-    const uint8_t sector_start = get_next_sector(face.sector);
-    const Vector3f start = _boundary_points[face.layer][sector_start];
-    const Vector3f end = _boundary_points[face.layer][sector_end];
+    const Vector3f &start = _boundary_points[layer][get_next_sector(sector)];
+    const Vector3f &end = _boundary_points[layer][sector];
     return Vector3f::segment_to_segment_dist(seg_start, seg_end, start, end, closest_point);
 }
 
 // get distance and angle to closest object (used for pre-arm check)
 //   returns true on success, false if no valid readings
-bool AP_Proximity_Boundary_3D::get_closest_object(float& angle_deg, float &distance) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_closest_object(float& angle_deg, float &distance) const
 {
     bool closest_found = false;
     uint8_t closest_sector = 0;
@@ -298,8 +313,8 @@ bool AP_Proximity_Boundary_3D::get_closest_object(float& angle_deg, float &dista
     // check boundary for shortest distance
     // only check for middle layers and higher
     // lower layers might contain ground, which will give false pre-arm failure
-    for (uint8_t layer=PROXIMITY_MIDDLE_LAYER; layer<PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector<PROXIMITY_NUM_SECTORS; sector++) {
+    for (uint8_t layer=middle_layer(); layer<NUM_LAYERS; layer++) {
+        for (uint8_t sector=0; sector<NUM_SECTORS; sector++) {
             if (_distance_valid[layer][sector]) {
                 if (!closest_found || (_distance[layer][sector] < _distance[closest_layer][closest_sector])) {
                     closest_layer = layer;
@@ -317,26 +332,22 @@ bool AP_Proximity_Boundary_3D::get_closest_object(float& angle_deg, float &dista
     return closest_found;
 }
 
-// get number of objects, used for non-GPS avoidance
-uint8_t AP_Proximity_Boundary_3D::get_horizontal_object_count() const
-{
-    return PROXIMITY_NUM_SECTORS;
-}
-
 // get an object's angle and distance, used for non-GPS avoidance
 // returns false if no angle or distance could be returned for some reason
-bool AP_Proximity_Boundary_3D::get_horizontal_object_angle_and_distance(uint8_t object_number, float &angle_deg, float &distance) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_horizontal_object_angle_and_distance(uint8_t object_number, float &angle_deg, float &distance) const
 {
-    if ((object_number < PROXIMITY_NUM_SECTORS) && _distance_valid[PROXIMITY_MIDDLE_LAYER][object_number]) {
-        angle_deg = _angle[PROXIMITY_MIDDLE_LAYER][object_number];
-        distance = _filtered_distance[PROXIMITY_MIDDLE_LAYER][object_number].get();
+    if ((object_number < NUM_SECTORS) && _distance_valid[middle_layer()][object_number]) {
+        angle_deg = _angle[middle_layer()][object_number];
+        distance = _filtered_distance[middle_layer()][object_number];
         return true;
     }
     return false;
 }
 
 // Return filtered distance for the passed in face
-bool AP_Proximity_Boundary_3D::get_filtered_distance(const Face &face, float &distance) const
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_filtered_distance(const Face &face, float &distance) const
 {
     if (!face.valid()) {
         return false;
@@ -347,31 +358,45 @@ bool AP_Proximity_Boundary_3D::get_filtered_distance(const Face &face, float &di
         return false;
     }
 
-    distance = _filtered_distance[face.layer][face.sector].get();
+    distance = _filtered_distance[face.layer][face.sector];
     return true;
 }
 
 // Get raw and filtered distances in 8 directions per layer
-bool AP_Proximity_Boundary_3D::get_layer_distances(uint8_t layer_number, float dist_max, AP_Proximity::Proximity_Distance_Array &prx_dist_array, AP_Proximity::Proximity_Distance_Array &prx_filt_dist_array) const
+// When there are more than 8 sectors the shortest distance of the sectors in each direction is used
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+bool AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS>::get_layer_distances(uint8_t layer_number, float dist_max, AP_Proximity::Proximity_Distance_Array &prx_dist_array, AP_Proximity::Proximity_Distance_Array &prx_filt_dist_array) const
 {
-    // cycle through all sectors filling in distances and orientations
+    if (layer_number >= NUM_LAYERS) {
+        return false;
+    }
+
+    // cycle through all directions filling in distances and orientations
     // see MAV_SENSOR_ORIENTATION for orientations (0 = forward, 1 = 45 degree clockwise from north, etc)
+    const uint8_t sectors_per_direction = NUM_SECTORS / PROXIMITY_MAX_DIRECTION;
     bool valid_distances = false;
     prx_dist_array.offset_valid = 0;
     prx_filt_dist_array.offset_valid = 0;
     for (uint8_t i=0; i<PROXIMITY_MAX_DIRECTION; i++) {
         prx_dist_array.orientation[i] = i;
-        const AP_Proximity_Boundary_3D::Face face(layer_number, i);
-        if (!face.valid()) {
-            return false;
-        }
-        if (get_distance(face, prx_dist_array.distance[i]) && get_filtered_distance(face, prx_filt_dist_array.distance[i])) {
-            valid_distances = true;
-            prx_dist_array.offset_valid |= (1U << i);
-            prx_filt_dist_array.offset_valid |= (1U << i);
-        } else {
-            prx_dist_array.distance[i] = dist_max;
-            prx_filt_dist_array.distance[i] = dist_max;
+        prx_dist_array.distance[i] = dist_max;
+        prx_filt_dist_array.distance[i] = dist_max;
+        // sectors centred on this direction, starting half a direction counter-clockwise of it
+        uint8_t sector = (i * sectors_per_direction + NUM_SECTORS - sectors_per_direction / 2) % NUM_SECTORS;
+        for (uint8_t j=0; j<sectors_per_direction; j++) {
+            if (_distance_valid[layer_number][sector]) {
+                if (!(prx_dist_array.offset_valid & (1U << i))) {
+                    prx_dist_array.distance[i] = _distance[layer_number][sector];
+                    prx_filt_dist_array.distance[i] = _filtered_distance[layer_number][sector];
+                } else {
+                    prx_dist_array.distance[i] = MIN(prx_dist_array.distance[i], _distance[layer_number][sector]);
+                    prx_filt_dist_array.distance[i] = MIN(prx_filt_dist_array.distance[i], _filtered_distance[layer_number][sector]);
+                }
+                valid_distances = true;
+                prx_dist_array.offset_valid |= (1U << i);
+                prx_filt_dist_array.offset_valid |= (1U << i);
+            }
+            sector = get_next_sector(sector);
         }
     }
 
@@ -379,10 +404,11 @@ bool AP_Proximity_Boundary_3D::get_layer_distances(uint8_t layer_number, float d
 }
 
 // reset the temporary boundary. This fills in distances with FLT_MAX
-void AP_Proximity_Temp_Boundary::reset()
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Temp_Boundary_T<NUM_SECTORS, NUM_LAYERS>::reset()
 {
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
+    for (uint8_t layer=0; layer < NUM_LAYERS; layer++) {
+        for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
             _distances[layer][sector] = FLT_MAX;
         }
     }
@@ -390,7 +416,8 @@ void AP_Proximity_Temp_Boundary::reset()
 
 // add a distance to the temp boundary if it is shorter than any other provided distance since the last time the boundary was reset
 // pitch and yaw are in degrees, distance is in meters
-void AP_Proximity_Temp_Boundary::add_distance(const AP_Proximity_Boundary_3D::Face &face, float pitch, float yaw, float distance)
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Temp_Boundary_T<NUM_SECTORS, NUM_LAYERS>::add_distance(const typename Boundary::Face &face, float pitch, float yaw, float distance)
 {
     if (face.valid() && distance < _distances[face.layer][face.sector]) {
         _distances[face.layer][face.sector] = distance;
@@ -400,16 +427,51 @@ void AP_Proximity_Temp_Boundary::add_distance(const AP_Proximity_Boundary_3D::Fa
 }
 
 // fill the original 3D boundary with the contents of this temporary boundary
-void AP_Proximity_Temp_Boundary::update_3D_boundary(AP_Proximity_Boundary_3D &boundary)
+// The faces of a layer are all filtered before its boundary points are recalculated once,
+// rather than recalculating the neighbouring boundary points for every face
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+void AP_Proximity_Temp_Boundary_T<NUM_SECTORS, NUM_LAYERS>::update_3D_boundary(Boundary &boundary)
 {
-    for (uint8_t layer=0; layer < PROXIMITY_NUM_LAYERS; layer++) {
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
-            if (_distances[layer][sector] < FLT_MAX) {
-                AP_Proximity_Boundary_3D::Face face{layer, sector};
-                boundary.set_face_attributes(face, _pitch[layer][sector], _angle[layer][sector], _distances[layer][sector]);
+    const uint32_t now_ms = AP_HAL::millis();
+    for (uint8_t layer=0; layer < NUM_LAYERS; layer++) {
+        bool layer_changed = false;
+        for (uint8_t sector=0; sector < NUM_SECTORS; sector++) {
+            const float distance = _distances[layer][sector];
+            if (distance >= FLT_MAX) {
+                continue;
             }
+            boundary._angle[layer][sector] = _angle[layer][sector];
+            boundary._pitch[layer][sector] = _pitch[layer][sector];
+            boundary._distance[layer][sector] = distance;
+            boundary._distance_valid[layer][sector] = true;
+
+            const uint32_t dt = now_ms - boundary._last_update_ms[layer][sector];
+            float &filtered_distance = boundary._filtered_distance[layer][sector];
+            if (dt < PROXIMITY_FILT_RESET_TIME) {
+                filtered_distance += (distance - filtered_distance) * calc_lowpass_alpha_dt(dt * 0.001f, boundary._filter_freq);
+            } else {
+                // reset filter since last distance was passed a long time back
+                filtered_distance = distance;
+            }
+            boundary._last_update_ms[layer][sector] = now_ms;
+            layer_changed = true;
+        }
+        if (layer_changed) {
+            boundary.update_layer(layer);
         }
     }
 }
 
+// instantiate the default layout, and the fine layout for dense lidars
+template class AP_Proximity_Boundary_3D_T<PROXIMITY_NUM_SECTORS, PROXIMITY_NUM_LAYERS>;
+template class AP_Proximity_Temp_Boundary_T<PROXIMITY_NUM_SECTORS, PROXIMITY_NUM_LAYERS>;
+#if PROXIMITY_NUM_SECTORS != 8 || PROXIMITY_NUM_LAYERS != 5
+template class AP_Proximity_Boundary_3D_T<8, 5>;
+template class AP_Proximity_Temp_Boundary_T<8, 5>;
+#endif
+#if PROXIMITY_NUM_SECTORS != 72 || PROXIMITY_NUM_LAYERS != 9
+template class AP_Proximity_Boundary_3D_T<72, 9>;
+template class AP_Proximity_Temp_Boundary_T<72, 9>;
+#endif
+
 #endif // HAL_PROXIMITY_ENABLED
\ No newline at end of file
@@ -19,23 +19,39 @@
 
 #if HAL_PROXIMITY_ENABLED
 
-#include <Filter/LowPassFilter.h>
-
+// the default layout of the boundary, boards with RAM to spare may use
+// a finer layout for dense 360 degree lidars, e.g. 72 sectors of 9 layers
+#ifndef PROXIMITY_NUM_SECTORS
 #define PROXIMITY_NUM_SECTORS         8       // number of sectors
+#endif
+#ifndef PROXIMITY_NUM_LAYERS
 #define PROXIMITY_NUM_LAYERS          5       // num of layers in a sector
-#define PROXIMITY_MIDDLE_LAYER        2       // middle layer
-#define PROXIMITY_PITCH_WIDTH_DEG     30      // width between each layer in degrees
-#define PROXIMITY_SECTOR_WIDTH_DEG    (360.0f/PROXIMITY_NUM_SECTORS)   // width of sectors in degrees
+#endif
+#define PROXIMITY_PITCH_RANGE_DEG     150.0f  // layers cover pitch angles from -75 to +75 degrees
 #define PROXIMITY_BOUNDARY_DIST_MIN   0.6f    // minimum distance for a boundary point.  This ensures the object avoidance code doesn't think we are outside the boundary.
 #define PROXIMITY_BOUNDARY_DIST_DEFAULT 100   // if we have no data for a sector, boundary is placed 100m out
 #define PROXIMITY_FILT_RESET_TIME     1000    // reset filter if last distance was pushed more than this many ms away
 #define PROXIMITY_FACE_RESET_MS       1000    // face will be reset if not updated within this many ms
 
-class AP_Proximity_Boundary_3D
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+class AP_Proximity_Temp_Boundary_T;
+
+/*
+  3D boundary around the vehicle made of NUM_LAYERS layers stacked
+  vertically, each split into NUM_SECTORS sectors horizontally.  Each
+  layer and sector (a face) holds the distance to the closest object
+  in that direction
+ */
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+class AP_Proximity_Boundary_3D_T
 {
+    // sectors are grouped into the 8 directions sent to the ground station
+    static_assert(NUM_SECTORS >= PROXIMITY_MAX_DIRECTION && NUM_SECTORS % PROXIMITY_MAX_DIRECTION == 0, "NUM_SECTORS must be a multiple of 8");
+    static_assert(NUM_LAYERS % 2 == 1, "NUM_LAYERS must be odd to have a middle layer");
+
 public:
     // constructor. This incorporates initialisation as well.
-	AP_Proximity_Boundary_3D();
+	AP_Proximity_Boundary_3D_T();
 
     // stores the layer and sector as a single object to access and modify the 3-D boundary
     // Objects of this class are used temporarily to modify the boundary, i,e they are not persistant or stored anywhere  
@@ -48,14 +64,14 @@ public:
 	    Face(uint8_t _layer, uint8_t _sector) { layer = _layer; sector = _sector; }
 
 	    // return true if face has valid layer and sector values
-	    bool valid() const { return ((layer < PROXIMITY_NUM_LAYERS) && (sector < PROXIMITY_NUM_SECTORS)); }
+	    bool valid() const { return ((layer < NUM_LAYERS) && (sector < NUM_SECTORS)); }
 
 	    // comparison operator
 	    bool operator ==(const Face &other) const { return ((layer == other.layer) && (sector == other.sector)); }
 	    bool operator !=(const Face &other) const { return ((layer != other.layer) || (sector != other.sector)); }
 
-        uint8_t layer;  // vertical "steps" on the 3D Boundary. 0th layer is the bottom most layer, 1st layer is 30 degrees above (in body frame) and so on
-        uint8_t sector; // horizontal "steps" on the 3D Boundary. 0th sector is directly in front of the vehicle. Each sector is 45 degrees wide.
+        uint8_t layer;  // vertical "steps" on the 3D Boundary. 0th layer is the bottom most layer, 1st layer is one layer width above (in body frame) and so on
+        uint8_t sector; // horizontal "steps" on the 3D Boundary. 0th sector is directly in front of the vehicle. Each sector is 360/NUM_SECTORS degrees wide.
     };
 
     // returns face corresponding to the provided yaw and (optionally) pitch
@@ -90,26 +106,26 @@ public:
     bool get_distance(const Face &face, float &distance) const;
 
     // Get the total number of obstacles 
-    uint8_t get_obstacle_count() const;
+    uint16_t get_obstacle_count() const { return NUM_LAYERS * NUM_SECTORS; }
 
     // Returns a body frame vector (in cm) to an obstacle
     // False is returned if the obstacle_num provided does not produce a valid obstacle
-    bool get_obstacle(uint8_t obstacle_num, Vector3f& vec_to_boundary) const;
+    bool get_obstacle(uint16_t obstacle_num, Vector3f& vec_to_boundary) const;
 
     // Returns a body frame vector (in cm) nearest to obstacle, in betwen seg_start and seg_end
     // FLT_MAX is returned if the obstacle_num provided does not produce a valid obstacle
-    float distance_to_obstacle(uint8_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const;
+    float distance_to_obstacle(uint16_t obstacle_num, const Vector3f& seg_start, const Vector3f& seg_end, Vector3f& closest_point) const;
 
     // get distance and angle to closest object (used for pre-arm check)
     //   returns true on success, false if no valid readings
     bool get_closest_object(float& angle_deg, float &distance) const;
 
     // get number of objects, angle and distance - used for non-GPS avoidance
-    uint8_t get_horizontal_object_count() const;
+    uint8_t get_horizontal_object_count() const { return NUM_SECTORS; }
     bool get_horizontal_object_angle_and_distance(uint8_t object_number, float& angle_deg, float &distance) const;
 
     // get number of layers
-    uint8_t get_num_layers() const { return PROXIMITY_NUM_LAYERS; }
+    uint8_t get_num_layers() const { return NUM_LAYERS; }
 
     // get raw and filtered distances in 8 directions per layer.
     bool get_layer_distances(uint8_t layer_number, float dist_max, AP_Proximity::Proximity_Distance_Array &prx_dist_array, AP_Proximity::Proximity_Distance_Array &prx_filt_dist_array) const;
@@ -117,33 +133,24 @@ public:
     // pass down filter cut-off freq from params
     void set_filter_freq(float filt_freq) { _filter_freq = filt_freq; }
 
-    // sectors
-    static_assert(PROXIMITY_NUM_SECTORS == 8, "PROXIMITY_NUM_SECTOR must be 8");
-    const uint16_t _sector_middle_deg[PROXIMITY_NUM_SECTORS] {0, 45, 90, 135, 180, 225, 270, 315};    // middle angle of each sector
-    // layers
-    static_assert(PROXIMITY_NUM_LAYERS == 5, "PROXIMITY_NUM_LAYERS must be 5");
-    const int16_t _pitch_middle_deg[PROXIMITY_NUM_LAYERS] {-60, -30, 0, 30, 60};
+    // width in degrees and middle angle in degrees of sectors and layers
+    static float sector_width_deg() { return 360.0f / NUM_SECTORS; }
+    static float sector_middle_deg(uint8_t sector) { return sector * sector_width_deg(); }
+    static float layer_width_deg() { return PROXIMITY_PITCH_RANGE_DEG / NUM_LAYERS; }
+    static float layer_middle_deg(uint8_t layer) { return (layer + 0.5f) * layer_width_deg() - PROXIMITY_PITCH_RANGE_DEG * 0.5f; }
+    static uint8_t middle_layer() { return NUM_LAYERS / 2; }
 
 private:
+    friend class AP_Proximity_Temp_Boundary_T<NUM_SECTORS, NUM_LAYERS>;
 
     // initialise the boundary and sector_edge_vector array used for object avoidance
     void init();
 
     // get the next sector which is CW to the passed sector
-    uint8_t get_next_sector(uint8_t sector) const {return ((sector >= PROXIMITY_NUM_SECTORS-1) ? 0 : sector+1); }
+    uint8_t get_next_sector(uint8_t sector) const {return ((sector >= NUM_SECTORS-1) ? 0 : sector+1); }
     
     // get the prev sector which is CCW to the passed sector 
-    uint8_t get_prev_sector(uint8_t sector) const {return ((sector <= 0) ? PROXIMITY_NUM_SECTORS-1 : sector-1); }
-
-    // Converts obstacle_num passed from avoidance library into appropriate face of the boundary
-    // Returns false if the face is invalid
-    // "update_boundary" method manipulates two sectors ccw and one sector cw from any valid face.
-    // Any boundary that does not fall into these manipulated faces are useless, and will be marked as false
-    // The resultant is packed into a Boundary Location object and returned by reference as "face"
-    bool convert_obstacle_num_to_face(uint8_t obstacle_num, Face& face) const WARN_IF_UNUSED;
-
-    // Apply a new cutoff_freq to low-pass filter
-    void apply_filter_freq(float cutoff_freq);
+    uint8_t get_prev_sector(uint8_t sector) const {return ((sector <= 0) ? NUM_SECTORS-1 : sector-1); }
 
     // Apply low pass filter on the raw distance
     void set_filtered_distance(const Face &face, float distance);
@@ -151,43 +158,67 @@ private:
     // Return filtered distance for the passed in face
     bool get_filtered_distance(const Face &face, float &distance) const;
 
-    Vector3f _sector_edge_vector[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];
-    Vector3f _boundary_points[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];
-
-    float _angle[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];          // yaw angle in degrees to closest object within each sector and layer
-    float _pitch[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];          // pitch angle in degrees to the closest object within each sector and layer
-    float _distance[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];       // distance to closest object within each sector and layer
-    bool _distance_valid[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];  // true if a valid distance received for each sector and layer
-    uint32_t _last_update_ms[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS]; // time when distance was last updated
-    LowPassFilterFloat _filtered_distance[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS]; // low pass filter
+    // recalculate the boundary point on the edge clockwise of a sector, and the
+    // obstacles that use it, from the distances of the nearby sectors
+    void update_edge(uint8_t layer, uint8_t sector);
+    void update_obstacle(uint8_t layer, uint8_t sector);
+
+    // recalculate every boundary point and obstacle in a layer
+    void update_layer(uint8_t layer);
+
+    // unit vectors (scaled to cm) along the edge clockwise of each sector, split into the
+    // horizontal and vertical parts so they are not stored for every face
+    float _edge_cos_yaw[NUM_SECTORS];
+    float _edge_sin_yaw[NUM_SECTORS];
+    float _layer_cos_pitch[NUM_LAYERS];
+    float _layer_sin_pitch[NUM_LAYERS];
+
+    Vector3f _boundary_points[NUM_LAYERS][NUM_SECTORS];                 // point on the edge clockwise of each sector
+    Vector3f _obstacle_vector[NUM_LAYERS][NUM_SECTORS];                 // point closest to the vehicle on the boundary line from each edge to the edge before it
+    bool _obstacle_valid[NUM_LAYERS][NUM_SECTORS];                      // true if the boundary line is near a sector with a valid distance
+
+    float _angle[NUM_LAYERS][NUM_SECTORS];          // yaw angle in degrees to closest object within each sector and layer
+    float _pitch[NUM_LAYERS][NUM_SECTORS];          // pitch angle in degrees to the closest object within each sector and layer
+    float _distance[NUM_LAYERS][NUM_SECTORS];       // distance to closest object within each sector and layer
+    float _filtered_distance[NUM_LAYERS][NUM_SECTORS];  // low pass filtered distance to closest object within each sector and layer
+    bool _distance_valid[NUM_LAYERS][NUM_SECTORS];  // true if a valid distance received for each sector and layer
+    uint32_t _last_update_ms[NUM_LAYERS][NUM_SECTORS]; // time when distance was last updated
     float _filter_freq;                                                 // cutoff freq of low pass filter
 };
 
 // This class gives an easy way of making a temporary boundary, used for "sorting" distances.
 // When unkown number of distances at various orientations are sent we store the least distance in the temporary boundary.
 // After all the messages are received, we copy the contents of the temporary boundary and put it in the main 3-D boundary.
-class AP_Proximity_Temp_Boundary
+template <uint8_t NUM_SECTORS, uint8_t NUM_LAYERS>
+class AP_Proximity_Temp_Boundary_T
 {
 public:
+    typedef AP_Proximity_Boundary_3D_T<NUM_SECTORS, NUM_LAYERS> Boundary;
+
     // constructor. This incorporates initialisation as well.
-	AP_Proximity_Temp_Boundary() { reset(); }
+	AP_Proximity_Temp_Boundary_T() { reset(); }
 
     // reset the temporary boundary. This fills in distances with FLT_MAX
     void reset();
 
     // add a distance to the temp boundary if it is shorter than any other provided distance since the last time the boundary was reset
     // pitch and yaw are in degrees, distance is in meters
-    void add_distance(const AP_Proximity_Boundary_3D::Face &face, float pitch, float yaw, float distance);
-    void add_distance(const AP_Proximity_Boundary_3D::Face &face, float yaw, float distance) { add_distance(face, 0.0f, PID_TUNING_YAW, distance); }
+    void add_distance(const typename Boundary::Face &face, float pitch, float yaw, float distance);
+    void add_distance(const typename Boundary::Face &face, float yaw, float distance) { add_distance(face, 0.0f, yaw, distance); }
 
-    // fill the original 3D boundary with the contents of this temporary boundary
-    void update_3D_boundary(AP_Proximity_Boundary_3D &boundary);
+    // fill the original 3D boundary with the contents of this temporary boundary.
+    // All the faces are filtered and then the boundary rebuilt once per layer
+    void update_3D_boundary(Boundary &boundary);
 
 private:
 
-    float _distances[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];      // distance to closest object within each sector and layer. Will start with FLT_MAX, and then be changed to a valid distance if needed
-    float _angle[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];          // yaw angle in degrees to closest object within each sector and layer
-    float _pitch[PROXIMITY_NUM_LAYERS][PROXIMITY_NUM_SECTORS];          // pitch angle in degrees to the closest object within each sector and layer
+    float _distances[NUM_LAYERS][NUM_SECTORS];      // distance to closest object within each sector and layer. Will start with FLT_MAX, and then be changed to a valid distance if needed
+    float _angle[NUM_LAYERS][NUM_SECTORS];          // yaw angle in degrees to closest object within each sector and layer
+    float _pitch[NUM_LAYERS][NUM_SECTORS];          // pitch angle in degrees to the closest object within each sector and layer
 };
 
+// the boundary used by the proximity backends
+typedef AP_Proximity_Boundary_3D_T<PROXIMITY_NUM_SECTORS, PROXIMITY_NUM_LAYERS> AP_Proximity_Boundary_3D;
+typedef AP_Proximity_Temp_Boundary_T<PROXIMITY_NUM_SECTORS, PROXIMITY_NUM_LAYERS> AP_Proximity_Temp_Boundary;
+
 #endif // HAL_PROXIMITY_ENABLED
\ No newline at end of file
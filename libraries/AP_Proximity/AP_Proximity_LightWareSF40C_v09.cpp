@@ -196,15 +196,15 @@ bool AP_Proximity_LightWareSF40C_v09::send_request_for_distance()
 
     // increment sector
     _last_sector++;
-    if (_last_sector >= PROXIMITY_NUM_SECTORS) {
+    if (_last_sector >= PROXIMITY_SF40C_V09_NUM_SECTORS) {
         _last_sector = 0;
     }
 
     // prepare request
     char request_str[16];
     snprintf(request_str, sizeof(request_str), "?TS,%u,%u\r\n",
-             (unsigned int)PROXIMITY_SECTOR_WIDTH_DEG,
-             boundary._sector_middle_deg[_last_sector]);
+             (unsigned int)PROXIMITY_SF40C_V09_SECTOR_WIDTH_DEG,
+             (unsigned int)(_last_sector * PROXIMITY_SF40C_V09_SECTOR_WIDTH_DEG));
     _uart->write(request_str);
 
 
@@ -4,6 +4,8 @@
 
 #if HAL_PROXIMITY_ENABLED
 #define PROXIMITY_SF40C_TIMEOUT_MS            200                               // requests timeout after 0.2 seconds
+#define PROXIMITY_SF40C_V09_NUM_SECTORS       8                                 // the sensor reports distances in 8 sectors
+#define PROXIMITY_SF40C_V09_SECTOR_WIDTH_DEG  45                                // width of each sector in degrees
 
 class AP_Proximity_LightWareSF40C_v09 : public AP_Proximity_Backend_Serial
 {
@@ -28,6 +28,7 @@ extern const AP_HAL::HAL& hal;
 
 #define PROXIMITY_MAX_RANGE 200.0f
 #define PROXIMITY_ACCURACY 0.1f
+#define PROXIMITY_SCAN_HZ 10        // revolutions per second of the simulated scanning lidar
 
 /* 
    The constructor also initialises the proximity sensor. 
@@ -57,8 +58,8 @@ void AP_Proximity_SITL::update(void)
     if (AP::fence()->polyfence().inclusion_boundary_available()) {
         set_status(AP_Proximity::Status::Good);
         // update distance in each sector
-        for (uint8_t sector=0; sector < PROXIMITY_NUM_SECTORS; sector++) {
-            const float yaw_angle_deg = sector * 45.0f;
+        for (uint8_t sector=0; sector < boundary.get_horizontal_object_count(); sector++) {
+            const float yaw_angle_deg = boundary.sector_middle_deg(sector);
             AP_Proximity_Boundary_3D::Face face = boundary.get_face(yaw_angle_deg);
             float fence_distance;
             if (get_distance_to_fence(yaw_angle_deg, fence_distance)) {
@@ -69,6 +70,9 @@ void AP_Proximity_SITL::update(void)
                 boundary.reset_face(face);
             }
         }
+        if (sitl->prx_scan_rate > 0) {
+            push_scan();
+        }
     } else {
         set_status(AP_Proximity::Status::NoData);
     }
@@ -108,6 +112,36 @@ bool AP_Proximity_SITL::get_distance_to_fence(float angle_deg, float &distance)
     return true;
 }
 
+// push the points a scanning lidar would have seen since the last
+// update into the object database.  This is a stress test of the
+// database rather than a realistic lidar model
+void AP_Proximity_SITL::push_scan()
+{
+    const uint32_t now_ms = AP_HAL::millis();
+    const float points_per_rev = sitl->prx_scan_rate / PROXIMITY_SCAN_HZ;
+    if (last_scan_ms != 0) {
+        // never more than one revolution after a long gap
+        scan_points_due = MIN(scan_points_due + (now_ms - last_scan_ms) * 0.001f * sitl->prx_scan_rate, MAX(points_per_rev, 1.0f));
+    }
+    last_scan_ms = now_ms;
+
+    Vector3f current_pos;
+    Matrix3f body_to_ned;
+    if (!database_prepare_for_push(current_pos, body_to_ned)) {
+        return;
+    }
+
+    const float angle_step_deg = 360.0f / points_per_rev;
+    while (scan_points_due >= 1.0f) {
+        scan_points_due -= 1.0f;
+        scan_angle_deg = wrap_360(scan_angle_deg + angle_step_deg);
+        float fence_distance;
+        if (get_distance_to_fence(scan_angle_deg, fence_distance)) {
+            database_push(scan_angle_deg, fence_distance, now_ms, current_pos, body_to_ned);
+        }
+    }
+}
+
 // get maximum and minimum distances (in meters) of primary sensor
 float AP_Proximity_SITL::distance_max() const
 {
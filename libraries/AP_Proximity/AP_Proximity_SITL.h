@@ -37,6 +37,12 @@ private:
     // get distance in meters to fence in a particular direction in degrees (0 is forward, angles increase in the clockwise direction)
     bool get_distance_to_fence(float angle_deg, float &distance) const;
 
+    // push the points a scanning lidar would have seen since the last update into the object database
+    void push_scan();
+    float scan_angle_deg;       // angle of the next scan point
+    float scan_points_due;      // points due to be pushed, carried between updates
+    uint32_t last_scan_ms;      // system time of the last scan update
+
 };
 #endif // CONFIG_HAL_BOARD
 
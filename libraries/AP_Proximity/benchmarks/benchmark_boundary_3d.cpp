@@ -0,0 +1,127 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Proximity/AP_Proximity_Boundary_3D.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+// distance to a room 10m by 6m centred on the vehicle
+static float room_distance(float yaw_deg)
+{
+    const float c = fabsf(cosf(radians(yaw_deg)));
+    const float s = fabsf(sinf(radians(yaw_deg)));
+    return MIN(5.0f / MAX(c, 0.001f), 3.0f / MAX(s, 0.001f));
+}
+
+// a 360 degree scan of the room with a point every half degree
+#define SCAN_POINTS 720
+static float scan[SCAN_POINTS];
+
+static void init_scan()
+{
+    for (uint16_t i=0; i<SCAN_POINTS; i++) {
+        scan[i] = room_distance(i * 0.5f);
+    }
+}
+
+/*
+  time adding one scan through the temporary boundary, as the MAV and
+  AirSim backends do
+ */
+template <uint8_t S, uint8_t L>
+static void BM_BoundaryScanBatched(benchmark::State& state)
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    Boundary *boundary = new Boundary();
+    AP_Proximity_Temp_Boundary_T<S, L> *temp = new AP_Proximity_Temp_Boundary_T<S, L>();
+    boundary->set_filter_freq(0.25f);
+    init_scan();
+
+    while (state.KeepRunning()) {
+        temp->reset();
+        for (uint16_t i=0; i<SCAN_POINTS; i++) {
+            const float yaw = i * 0.5f;
+            temp->add_distance(boundary->get_face(yaw), yaw, scan[i]);
+        }
+        temp->update_3D_boundary(*boundary);
+        gbenchmark_escape(boundary);
+    }
+
+    delete temp;
+    delete boundary;
+}
+
+/*
+  the same scan with each face set as soon as its shortest distance is
+  known, as the serial lidar backends do
+ */
+template <uint8_t S, uint8_t L>
+static void BM_BoundaryScanSingleFace(benchmark::State& state)
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    Boundary *boundary = new Boundary();
+    boundary->set_filter_freq(0.25f);
+    init_scan();
+
+    while (state.KeepRunning()) {
+        typename Boundary::Face last_face;
+        float shortest = FLT_MAX;
+        float shortest_yaw = 0.0f;
+        for (uint16_t i=0; i<SCAN_POINTS; i++) {
+            const float yaw = i * 0.5f;
+            const typename Boundary::Face face = boundary->get_face(yaw);
+            if (face != last_face && last_face.valid()) {
+                boundary->set_face_attributes(last_face, shortest_yaw, shortest);
+                shortest = FLT_MAX;
+            }
+            last_face = face;
+            if (scan[i] < shortest) {
+                shortest = scan[i];
+                shortest_yaw = yaw;
+            }
+        }
+        boundary->set_face_attributes(last_face, shortest_yaw, shortest);
+        gbenchmark_escape(boundary);
+    }
+
+    delete boundary;
+}
+
+/*
+  time reading every obstacle as AC_Avoid does each loop
+ */
+template <uint8_t S, uint8_t L>
+static void BM_BoundaryObstacleQuery(benchmark::State& state)
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    Boundary *boundary = new Boundary();
+    for (uint8_t layer=0; layer<L; layer++) {
+        for (uint8_t sector=0; sector<S; sector++) {
+            const float yaw = Boundary::sector_middle_deg(sector);
+            boundary->set_face_attributes(typename Boundary::Face{layer, sector}, Boundary::layer_middle_deg(layer), yaw, room_distance(yaw));
+        }
+    }
+
+    while (state.KeepRunning()) {
+        float closest = FLT_MAX;
+        for (uint16_t i=0; i<boundary->get_obstacle_count(); i++) {
+            Vector3f vec;
+            if (boundary->get_obstacle(i, vec)) {
+                closest = MIN(closest, vec.length_squared());
+            }
+        }
+        gbenchmark_escape(&closest);
+    }
+    state.SetItemsProcessed(state.iterations() * boundary->get_obstacle_count());
+
+    delete boundary;
+}
+
+BENCHMARK_TEMPLATE2(BM_BoundaryScanBatched, 8, 5);
+BENCHMARK_TEMPLATE2(BM_BoundaryScanBatched, 72, 9);
+BENCHMARK_TEMPLATE2(BM_BoundaryScanSingleFace, 8, 5);
+BENCHMARK_TEMPLATE2(BM_BoundaryScanSingleFace, 72, 9);
+BENCHMARK_TEMPLATE2(BM_BoundaryObstacleQuery, 8, 5);
+BENCHMARK_TEMPLATE2(BM_BoundaryObstacleQuery, 72, 9);
+
+BENCHMARK_MAIN();
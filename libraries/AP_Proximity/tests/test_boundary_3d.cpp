@@ -0,0 +1,194 @@
+#include <AP_gtest.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Proximity/AP_Proximity_Boundary_3D.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+static float rand_float(float low, float high)
+{
+    return low + (high - low) * (float)random() / (float)RAND_MAX;
+}
+
+/*
+  the middle of every face maps back to that face, including angles
+  just below a full turn and pitches beyond the top and bottom layers
+ */
+template <uint8_t S, uint8_t L>
+static void check_face_mapping()
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    Boundary *boundary = new Boundary();
+
+    for (uint8_t layer=0; layer<L; layer++) {
+        for (uint8_t sector=0; sector<S; sector++) {
+            const typename Boundary::Face face = boundary->get_face(Boundary::layer_middle_deg(layer), Boundary::sector_middle_deg(sector));
+            EXPECT_EQ(face.layer, layer);
+            EXPECT_EQ(face.sector, sector);
+        }
+    }
+    EXPECT_EQ(boundary->get_face(359.99f).sector, 0);
+    EXPECT_EQ(boundary->get_face(-0.01f).sector, 0);
+    EXPECT_EQ(boundary->get_face(Boundary::sector_width_deg() * 0.51f).sector, 1);
+    EXPECT_EQ(boundary->get_face(-90.0f, 0.0f).layer, 0);
+    EXPECT_EQ(boundary->get_face(90.0f, 0.0f).layer, L - 1);
+    EXPECT_EQ(boundary->get_face(0.0f).layer, Boundary::middle_layer());
+
+    delete boundary;
+}
+
+TEST(ProximityBoundary, FaceMapping)
+{
+    check_face_mapping<8, 5>();
+    check_face_mapping<72, 9>();
+}
+
+/*
+  a scan added through the temporary boundary, which filters whole
+  layers before rebuilding them, gives the same obstacles as adding
+  each face on its own.  The filter is disabled as the two boundaries
+  may be updated a millisecond apart
+ */
+template <uint8_t S, uint8_t L>
+static void check_batched_update()
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    typedef AP_Proximity_Temp_Boundary_T<S, L> TempBoundary;
+    Boundary *single = new Boundary();
+    Boundary *batched = new Boundary();
+    TempBoundary *temp = new TempBoundary();
+
+    for (uint8_t scan=0; scan<20; scan++) {
+        // a lidar spinning past some posts, missing some faces
+        float shortest[L][S];
+        for (uint8_t layer=0; layer<L; layer++) {
+            for (uint8_t sector=0; sector<S; sector++) {
+                shortest[layer][sector] = FLT_MAX;
+            }
+        }
+        temp->reset();
+        for (uint16_t n=0; n<S*L/2; n++) {
+            const float yaw = rand_float(0.0f, 360.0f);
+            const float pitch = rand_float(-80.0f, 80.0f);
+            const float distance = rand_float(0.1f, 20.0f);
+            const typename Boundary::Face face = batched->get_face(pitch, yaw);
+            temp->add_distance(face, pitch, yaw, distance);
+            shortest[face.layer][face.sector] = MIN(shortest[face.layer][face.sector], distance);
+        }
+        temp->update_3D_boundary(*batched);
+
+        // the same shortest distances, one face at a time
+        for (uint8_t layer=0; layer<L; layer++) {
+            for (uint8_t sector=0; sector<S; sector++) {
+                if (shortest[layer][sector] < FLT_MAX) {
+                    single->set_face_attributes(typename Boundary::Face{layer, sector}, 0.0f, 0.0f, shortest[layer][sector]);
+                }
+            }
+        }
+
+        // some faces time out between scans
+        if (scan % 5 == 4) {
+            const typename Boundary::Face face{uint8_t(random() % L), uint8_t(random() % S)};
+            single->reset_face(face);
+            batched->reset_face(face);
+        }
+
+        for (uint16_t i=0; i<batched->get_obstacle_count(); i++) {
+            Vector3f vec_single, vec_batched;
+            const bool valid = batched->get_obstacle(i, vec_batched);
+            ASSERT_EQ(single->get_obstacle(i, vec_single), valid);
+            if (valid) {
+                EXPECT_LT((vec_single - vec_batched).length(), 0.01f);
+                Vector3f closest;
+                EXPECT_NEAR(single->distance_to_obstacle(i, Vector3f{}, vec_single * 2.0f, closest),
+                            batched->distance_to_obstacle(i, Vector3f{}, vec_batched * 2.0f, closest), 0.01f);
+            }
+        }
+    }
+
+    delete temp;
+    delete batched;
+    delete single;
+}
+
+TEST(ProximityBoundary, BatchedUpdateMatchesSingleFace)
+{
+    srandom(0x42443344);
+    check_batched_update<8, 5>();
+    check_batched_update<72, 9>();
+}
+
+/*
+  a single object makes the three obstacles using its sector valid, and
+  the closest of them is no further away than the object
+ */
+template <uint8_t S, uint8_t L>
+static void check_single_object()
+{
+    typedef AP_Proximity_Boundary_3D_T<S, L> Boundary;
+    Boundary *boundary = new Boundary();
+
+    const float yaw = Boundary::sector_middle_deg(S / 4);
+    const typename Boundary::Face face = boundary->get_face(yaw);
+    boundary->set_face_attributes(face, yaw, 10.0f);
+
+    uint16_t valid_count = 0;
+    float closest = FLT_MAX;
+    for (uint16_t i=0; i<boundary->get_obstacle_count(); i++) {
+        Vector3f vec;
+        if (boundary->get_obstacle(i, vec)) {
+            valid_count++;
+            EXPECT_EQ(i / S, face.layer);
+            closest = MIN(closest, vec.length());
+        }
+    }
+    EXPECT_EQ(valid_count, 3);
+    EXPECT_LE(closest, 1000.0f);
+    EXPECT_GT(closest, 900.0f);
+
+    float angle_deg, distance;
+    ASSERT_TRUE(boundary->get_closest_object(angle_deg, distance));
+    EXPECT_FLOAT_EQ(angle_deg, yaw);
+    EXPECT_FLOAT_EQ(distance, 10.0f);
+
+    boundary->reset_face(face);
+    for (uint16_t i=0; i<boundary->get_obstacle_count(); i++) {
+        Vector3f vec;
+        EXPECT_FALSE(boundary->get_obstacle(i, vec));
+    }
+
+    delete boundary;
+}
+
+TEST(ProximityBoundary, SingleObject)
+{
+    check_single_object<8, 5>();
+    check_single_object<72, 9>();
+}
+
+/*
+  the ground station sees the shortest distance of the sectors around
+  each of the 8 directions
+ */
+TEST(ProximityBoundary, LayerDistancesFineSectors)
+{
+    typedef AP_Proximity_Boundary_3D_T<72, 9> Boundary;
+    Boundary *boundary = new Boundary();
+
+    boundary->set_face_attributes(boundary->get_face(355.0f), 355.0f, 8.0f);
+    boundary->set_face_attributes(boundary->get_face(20.0f), 20.0f, 6.0f);
+    boundary->set_face_attributes(boundary->get_face(25.0f), 25.0f, 4.0f);
+
+    AP_Proximity::Proximity_Distance_Array dist, filt_dist;
+    ASSERT_TRUE(boundary->get_layer_distances(Boundary::middle_layer(), 50.0f, dist, filt_dist));
+    EXPECT_EQ(dist.offset_valid, 0x03);
+    EXPECT_FLOAT_EQ(dist.distance[0], 6.0f);
+    EXPECT_FLOAT_EQ(dist.distance[1], 4.0f);
+    EXPECT_FLOAT_EQ(dist.distance[2], 50.0f);
+    EXPECT_FALSE(boundary->get_layer_distances(0, 50.0f, dist, filt_dist));
+
+    delete boundary;
+}
+
+AP_GTEST_MAIN()
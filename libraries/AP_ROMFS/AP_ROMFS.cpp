@@ -18,6 +18,7 @@
 
 #include "AP_ROMFS.h"
 #include "tinf.h"
+#include <AP_Math/AP_Math.h>
 #include <AP_Math/crc.h>
 
 #ifdef HAL_HAVE_AP_ROMFS_EMBEDDED_H
@@ -26,21 +27,74 @@
 const AP_ROMFS::embedded_file AP_ROMFS::files[] = {};
 #endif
 
+/*
+  state of a streamed file
+ */
+class AP_ROMFS::Stream {
+public:
+    const struct embedded_file *file;
+    uint32_t size;
+#ifndef HAL_ROMFS_UNCOMPRESSED
+    // number of decompressed bytes produced so far
+    uint32_t out_ofs;
+    // running crc of the decompressed data
+    uint32_t crc;
+    TINF_DATA d;
+    uint8_t window[AP_ROMFS_STREAM_WINDOW_SIZE];
+#endif
+};
+
+#if !defined(HAL_ROMFS_UNCOMPRESSED) && AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+AP_ROMFS::cached_page *AP_ROMFS::page_cache;
+uint32_t AP_ROMFS::page_cache_counter;
+uint16_t AP_ROMFS::page_cache_streams;
+HAL_Semaphore AP_ROMFS::page_cache_sem;
+#endif
+
 /*
   find an embedded file
 */
-const uint8_t *AP_ROMFS::find_file(const char *name, uint32_t &size, uint32_t &crc)
+const AP_ROMFS::embedded_file *AP_ROMFS::find_file(const char *name)
 {
     for (uint16_t i=0; i<ARRAY_SIZE(files); i++) {
         if (strcmp(name, files[i].filename) == 0) {
-            size = files[i].size;
-            crc = files[i].crc;
-            return files[i].contents;
+            return &files[i];
         }
     }
     return nullptr;
 }
 
+/*
+  find the decompressed size of a file without decompressing it
+*/
+bool AP_ROMFS::find_size(const char *name, uint32_t &size)
+{
+    const embedded_file *f = find_file(name);
+    if (f == nullptr) {
+        return false;
+    }
+    return file_size(*f, size);
+}
+
+/*
+  the decompressed size of a file. The last 4 bytes of a gzip file
+  are the length of the decompressed data, so no decompression is
+  needed
+*/
+bool AP_ROMFS::file_size(const embedded_file &f, uint32_t &size)
+{
+#ifdef HAL_ROMFS_UNCOMPRESSED
+    size = f.size;
+#else
+    if (f.size < 4) {
+        return false;
+    }
+    const uint8_t *p = &f.contents[f.size-4];
+    size = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
+#endif
+    return true;
+}
+
 /*
   find a compressed file and uncompress it. Space for decompressed
   data comes from malloc. Caller must be careful to free the resulting
@@ -49,21 +103,27 @@ const uint8_t *AP_ROMFS::find_file(const char *name, uint32_t &size, uint32_t &c
 */
 const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
 {
-    uint32_t compressed_size = 0;
-    uint32_t crc;
-    const uint8_t *compressed_data = find_file(name, compressed_size, crc);
-    if (!compressed_data) {
+    const embedded_file *f = find_file(name);
+    if (f == nullptr) {
         return nullptr;
     }
+    return decompress(*f, size);
+}
 
+/*
+  uncompress a whole file into memory from malloc
+*/
+const uint8_t *AP_ROMFS::decompress(const embedded_file &f, uint32_t &size)
+{
 #ifdef HAL_ROMFS_UNCOMPRESSED
-    size = compressed_size;
-    return compressed_data;
+    size = f.size;
+    return f.contents;
 #else
-    // last 4 bytes of gzip file are length of decompressed data
-    const uint8_t *p = &compressed_data[compressed_size-4];
-    uint32_t decompressed_size = p[0] | p[1] << 8 | p[2] << 16 | p[3] << 24;
-    
+    uint32_t decompressed_size;
+    if (!file_size(f, decompressed_size)) {
+        return nullptr;
+    }
+
     uint8_t *decompressed_data = (uint8_t *)malloc(decompressed_size + 1);
     if (!decompressed_data) {
         return nullptr;
@@ -79,8 +139,8 @@ const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
     }
     uzlib_uncompress_init(d, NULL, 0);
 
-    d->source = compressed_data;
-    d->source_limit = compressed_data + compressed_size - 4;
+    d->source = f.contents;
+    d->source_limit = f.contents + f.size - 4;
 
     // assume gzip format
     int res = uzlib_gzip_parse_header(d);
@@ -104,7 +164,7 @@ const uint8_t *AP_ROMFS::find_decompress(const char *name, uint32_t &size)
         return nullptr;
     }
 
-    if (crc32_small(0, decompressed_data, decompressed_size) != crc) {
+    if (crc32_small(0, decompressed_data, decompressed_size) != f.crc) {
         ::free(decompressed_data);
         return nullptr;
     }
@@ -122,6 +182,283 @@ void AP_ROMFS::free(const uint8_t *data)
 #endif
 }
 
+/*
+  open a file for streaming. Only the stream state and a small inflate
+  window are allocated, independent of the size of the file
+*/
+AP_ROMFS::Stream *AP_ROMFS::stream_open(const char *name, uint32_t &size)
+{
+    const embedded_file *f = find_file(name);
+    if (f == nullptr) {
+        return nullptr;
+    }
+    return stream_open(*f, size);
+}
+
+AP_ROMFS::Stream *AP_ROMFS::stream_open(const embedded_file &f, uint32_t &size)
+{
+    uint32_t decompressed_size;
+    if (!file_size(f, decompressed_size)) {
+        return nullptr;
+    }
+    Stream *s = (Stream *)malloc(sizeof(Stream));
+    if (s == nullptr) {
+        return nullptr;
+    }
+    s->file = &f;
+    s->size = decompressed_size;
+#ifndef HAL_ROMFS_UNCOMPRESSED
+    if (!stream_restart(s)) {
+        ::free(s);
+        return nullptr;
+    }
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    {
+        WITH_SEMAPHORE(page_cache_sem);
+        page_cache_streams++;
+    }
+#endif
+#endif
+    size = decompressed_size;
+    return s;
+}
+
+/*
+  close a stream. The page cache goes with the last stream, so boards
+  that only read ROMFS at startup get the memory back
+*/
+void AP_ROMFS::stream_close(Stream *s)
+{
+    if (s == nullptr) {
+        return;
+    }
+    ::free(s);
+#if !defined(HAL_ROMFS_UNCOMPRESSED) && AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    WITH_SEMAPHORE(page_cache_sem);
+    if (page_cache_streams > 0 && --page_cache_streams == 0) {
+        ::free(page_cache);
+        page_cache = nullptr;
+    }
+#endif
+}
+
+/*
+  read from a stream at the given offset. Sequential reads inflate
+  straight into the caller's buffer. Backward seeks are served from
+  the inflate window or the page cache where possible, otherwise the
+  stream is restarted from the beginning of the file
+*/
+int32_t AP_ROMFS::stream_read(Stream *s, uint32_t ofs, uint8_t *buf, uint32_t count)
+{
+    if (s == nullptr) {
+        return -1;
+    }
+    if (ofs >= s->size) {
+        return 0;
+    }
+    count = MIN(count, s->size - ofs);
+
+#ifdef HAL_ROMFS_UNCOMPRESSED
+    memcpy(buf, &s->file->contents[ofs], count);
+    return count;
+#else
+    uint32_t total = 0;
+    while (total < count) {
+        if (ofs < s->out_ofs) {
+            // already decompressed, try the window then the page cache
+            uint32_t n = stream_copy_window(s, ofs, buf, count - total);
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+            if (n == 0) {
+                n = page_cache_lookup(s->file, ofs, buf, count - total);
+            }
+#endif
+            if (n == 0) {
+                if (!stream_restart(s)) {
+                    return -1;
+                }
+                continue;
+            }
+            ofs += n;
+            buf += n;
+            total += n;
+            continue;
+        }
+        if (ofs > s->out_ofs) {
+            // skip forward, using the stack as a scratch buffer
+            uint8_t scratch[64];
+            const int32_t n = stream_inflate(s, scratch, MIN(ofs - s->out_ofs, sizeof(scratch)));
+            if (n <= 0) {
+                return -1;
+            }
+            continue;
+        }
+        const int32_t n = stream_inflate(s, buf, count - total);
+        if (n <= 0) {
+            return -1;
+        }
+        ofs += n;
+        buf += n;
+        total += n;
+    }
+    return total;
+#endif
+}
+
+#ifndef HAL_ROMFS_UNCOMPRESSED
+/*
+  restart inflating a stream from the start of the compressed data
+*/
+bool AP_ROMFS::stream_restart(Stream *s)
+{
+    const embedded_file &f = *s->file;
+    if (f.size < 4) {
+        return false;
+    }
+    uzlib_uncompress_init(&s->d, s->window, sizeof(s->window));
+    s->d.source = f.contents;
+    s->d.source_limit = f.contents + f.size - 4;
+    if (uzlib_gzip_parse_header(&s->d) != TINF_OK) {
+        return false;
+    }
+    s->out_ofs = 0;
+    s->crc = 0;
+    return true;
+}
+
+/*
+  inflate up to count bytes into buf. The inflater keeps the most
+  recent output in its window for back references, so buf does not
+  need to hold any previous data
+*/
+int32_t AP_ROMFS::stream_inflate(Stream *s, uint8_t *buf, uint32_t count)
+{
+    count = MIN(count, s->size - s->out_ofs);
+    if (count == 0) {
+        return 0;
+    }
+    s->d.dest = buf;
+    s->d.destSize = count;
+    const int res = uzlib_uncompress(&s->d);
+    if (res != TINF_OK && res != TINF_DONE) {
+        return -1;
+    }
+    const uint32_t n = s->d.dest - buf;
+    const uint32_t old_ofs = s->out_ofs;
+    s->crc = crc32_small(s->crc, buf, n);
+    s->out_ofs += n;
+    if (s->out_ofs == s->size && s->crc != s->file->crc) {
+        // we check the CRC once the whole file has been produced
+        return -1;
+    }
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    page_cache_store(s, old_ofs);
+#else
+    (void)old_ofs;
+#endif
+    return n;
+}
+
+/*
+  copy already decompressed data from the stream window. Returns the
+  number of bytes copied, which is zero if ofs is no longer held in
+  the window
+*/
+uint32_t AP_ROMFS::stream_copy_window(const Stream *s, uint32_t ofs, uint8_t *buf, uint32_t count)
+{
+    const uint32_t back = s->out_ofs - ofs;
+    if (back > MIN(s->out_ofs, AP_ROMFS_STREAM_WINDOW_SIZE)) {
+        return 0;
+    }
+    count = MIN(count, back);
+    // dict_idx is the position in the ring of the next byte to be produced
+    uint32_t idx = (s->d.dict_idx + AP_ROMFS_STREAM_WINDOW_SIZE - back) % AP_ROMFS_STREAM_WINDOW_SIZE;
+    const uint32_t n1 = MIN(count, AP_ROMFS_STREAM_WINDOW_SIZE - idx);
+    memcpy(buf, &s->window[idx], n1);
+    if (n1 < count) {
+        memcpy(&buf[n1], &s->window[0], count - n1);
+    }
+    return count;
+}
+
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+/*
+  store any pages completed by the last inflate into the page
+  cache. Completed pages are always still held in the window
+*/
+void AP_ROMFS::page_cache_store(const Stream *s, uint32_t old_ofs)
+{
+    static_assert(AP_ROMFS_PAGE_SIZE <= AP_ROMFS_STREAM_WINDOW_SIZE, "page must fit in window");
+    uint32_t page = old_ofs / AP_ROMFS_PAGE_SIZE;
+    // pages before last_page are complete, including a partial last
+    // page at the end of the file
+    uint32_t last_page = s->out_ofs / AP_ROMFS_PAGE_SIZE;
+    if (s->out_ofs == s->size) {
+        last_page = (s->size + AP_ROMFS_PAGE_SIZE - 1) / AP_ROMFS_PAGE_SIZE;
+    }
+    if (page == last_page || page > UINT16_MAX) {
+        return;
+    }
+
+    WITH_SEMAPHORE(page_cache_sem);
+    if (page_cache == nullptr) {
+        page_cache = (cached_page *)calloc(AP_ROMFS_PAGE_CACHE_NUM_PAGES, sizeof(cached_page));
+        if (page_cache == nullptr) {
+            return;
+        }
+    }
+    for ( ; page < last_page; page++) {
+        const uint32_t page_ofs = page * AP_ROMFS_PAGE_SIZE;
+        if (s->out_ofs - page_ofs > AP_ROMFS_STREAM_WINDOW_SIZE) {
+            // already dropped out of the window
+            continue;
+        }
+        // pick an existing copy or the least recently used page
+        uint8_t best = 0;
+        for (uint8_t i=0; i<AP_ROMFS_PAGE_CACHE_NUM_PAGES; i++) {
+            const cached_page &p = page_cache[i];
+            if (p.file == s->file && p.page == page) {
+                best = i;
+                break;
+            }
+            if (p.last_use < page_cache[best].last_use) {
+                best = i;
+            }
+        }
+        cached_page &p = page_cache[best];
+        p.file = s->file;
+        p.page = page;
+        p.last_use = ++page_cache_counter;
+        const uint32_t len = MIN(AP_ROMFS_PAGE_SIZE, s->size - page_ofs);
+        stream_copy_window(s, page_ofs, p.data, len);
+    }
+}
+
+/*
+  lookup data from the page cache. Returns number of bytes copied
+*/
+uint32_t AP_ROMFS::page_cache_lookup(const embedded_file *file, uint32_t ofs, uint8_t *buf, uint32_t count)
+{
+    WITH_SEMAPHORE(page_cache_sem);
+    if (page_cache == nullptr) {
+        return 0;
+    }
+    const uint32_t page = ofs / AP_ROMFS_PAGE_SIZE;
+    for (uint8_t i=0; i<AP_ROMFS_PAGE_CACHE_NUM_PAGES; i++) {
+        cached_page &p = page_cache[i];
+        if (p.file != file || p.page != page) {
+            continue;
+        }
+        p.last_use = ++page_cache_counter;
+        const uint32_t page_ofs = ofs % AP_ROMFS_PAGE_SIZE;
+        count = MIN(count, AP_ROMFS_PAGE_SIZE - page_ofs);
+        memcpy(buf, &p.data[page_ofs], count);
+        return count;
+    }
+    return 0;
+}
+#endif // AP_ROMFS_PAGE_CACHE_NUM_PAGES
+#endif // HAL_ROMFS_UNCOMPRESSED
+
 /*
   directory listing interface. Start with ofs=0. Returns pathnames
   that match dirname prefix. Ends with nullptr return when no more
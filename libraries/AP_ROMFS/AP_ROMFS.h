@@ -5,7 +5,26 @@
 
 #include <AP_HAL/AP_HAL.h>
 
+/*
+  size of the inflate window used by the streaming interface. This
+  must match the window bits used when compressing files in
+  Tools/ardupilotwaf/embed.py
+ */
+#define AP_ROMFS_STREAM_WINDOW_BITS 12
+#define AP_ROMFS_STREAM_WINDOW_SIZE (1U<<AP_ROMFS_STREAM_WINDOW_BITS)
+
+/*
+  number of decompressed pages kept in the shared page cache for
+  streamed files. Set to zero to disable the cache
+ */
+#ifndef AP_ROMFS_PAGE_CACHE_NUM_PAGES
+#define AP_ROMFS_PAGE_CACHE_NUM_PAGES 8
+#endif
+#define AP_ROMFS_PAGE_SIZE 512U
+
 class AP_ROMFS {
+    friend class AP_ROMFS_Test;
+
 public:
     // find a file and de-compress, assumning gzip format. The
     // decompressed data will be allocated with malloc(). You must
@@ -23,10 +42,28 @@ public:
     */
     static const char *dir_list(const char *dirname, uint16_t &ofs);
 
-private:
-    // find an embedded file
-    static const uint8_t *find_file(const char *name, uint32_t &size, uint32_t &crc);
+    // find the decompressed size of a file without decompressing it
+    static bool find_size(const char *name, uint32_t &size);
+
+    /*
+      streaming interface. Files are decompressed on demand through a
+      small fixed window instead of allocating the full decompressed
+      size. Recently decompressed pages are kept in a shared cache so
+      re-reading hot files does not need to inflate again
+     */
+    class Stream;
+
+    // open a file for streaming, returns nullptr if not found
+    static Stream *stream_open(const char *name, uint32_t &size);
+
+    // read count bytes at offset ofs into buf. Returns number of
+    // bytes read, 0 at end of file and -1 on error
+    static int32_t stream_read(Stream *s, uint32_t ofs, uint8_t *buf, uint32_t count);
 
+    // close a stream
+    static void stream_close(Stream *s);
+
+private:
     struct embedded_file {
         const char *filename;
         uint32_t size;
@@ -34,4 +71,42 @@ private:
         const uint8_t *contents;
     };
     static const struct embedded_file files[];
+
+    // find an embedded file
+    static const struct embedded_file *find_file(const char *name);
+
+    // the decompressed size and contents of an embedded file
+    static bool file_size(const struct embedded_file &f, uint32_t &size);
+    static const uint8_t *decompress(const struct embedded_file &f, uint32_t &size);
+
+    // open an embedded file for streaming
+    static Stream *stream_open(const struct embedded_file &f, uint32_t &size);
+
+#ifndef HAL_ROMFS_UNCOMPRESSED
+    // restart inflating a stream from the start of the file
+    static bool stream_restart(Stream *s);
+
+    // inflate up to count bytes into buf, returns bytes produced or -1
+    static int32_t stream_inflate(Stream *s, uint8_t *buf, uint32_t count);
+
+    // copy already decompressed data from the stream window or page cache
+    static uint32_t stream_copy_window(const Stream *s, uint32_t ofs, uint8_t *buf, uint32_t count);
+
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    static void page_cache_store(const Stream *s, uint32_t old_ofs);
+    static uint32_t page_cache_lookup(const struct embedded_file *file, uint32_t ofs, uint8_t *buf, uint32_t count);
+
+    struct cached_page {
+        const struct embedded_file *file;
+        uint16_t page;
+        uint32_t last_use;
+        uint8_t data[AP_ROMFS_PAGE_SIZE];
+    };
+    static cached_page *page_cache;
+    static uint32_t page_cache_counter;
+    // the cache is freed when the last stream is closed
+    static uint16_t page_cache_streams;
+    static HAL_Semaphore page_cache_sem;
+#endif
+#endif // HAL_ROMFS_UNCOMPRESSED
 };
@@ -0,0 +1,129 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_ROMFS/AP_ROMFS.h>
+
+#include <malloc.h>
+#include <stdio.h>
+#include <string.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define READ_SIZE 512
+
+/*
+  bytes of heap in use
+ */
+static size_t heap_in_use()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return mallinfo().uordblks;
+#endif
+}
+
+/*
+  the largest embedded file. The SITL build embeds the frame models
+  and locations.txt, plus the OSD fonts with --osd
+ */
+static const char *largest_file(uint32_t &size)
+{
+    static const char *names[] = { "locations.txt", "font0.bin" };
+    static const char *dirs[] = { "models", "scripts" };
+    const char *ret = nullptr;
+    size = 0;
+    uint32_t fsize;
+    for (const char *name : names) {
+        if (AP_ROMFS::find_size(name, fsize) && fsize > size) {
+            ret = name;
+            size = fsize;
+        }
+    }
+    for (const char *dir : dirs) {
+        uint16_t ofs = 0;
+        const char *name;
+        while ((name = AP_ROMFS::dir_list(dir, ofs)) != nullptr) {
+            if (AP_ROMFS::find_size(name, fsize) && fsize > size) {
+                ret = name;
+                size = fsize;
+            }
+        }
+    }
+    return ret;
+}
+
+/*
+  load a whole file with find_decompress(), as everything did before
+  streaming. The label has the heap held while the file is in use
+ */
+static void BM_ROMFSLoadDecompress(benchmark::State& state)
+{
+    uint32_t size;
+    const char *name = largest_file(size);
+    if (name == nullptr) {
+        state.SkipWithError("no embedded files");
+        return;
+    }
+
+    const size_t heap_before = heap_in_use();
+    const uint8_t *data = AP_ROMFS::find_decompress(name, size);
+    const size_t heap_held = heap_in_use() - heap_before;
+    AP_ROMFS::free(data);
+
+    while (state.KeepRunning()) {
+        data = AP_ROMFS::find_decompress(name, size);
+        gbenchmark_escape((void *)data);
+        AP_ROMFS::free(data);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+
+    char label[100];
+    snprintf(label, sizeof(label), "%s %u bytes, heap %u", name, unsigned(size), unsigned(heap_held));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_ROMFSLoadDecompress);
+
+/*
+  read the same file through a stream a block at a time. The heap
+  held includes the shared page cache the first time it is used
+ */
+static void BM_ROMFSLoadStream(benchmark::State& state)
+{
+    uint32_t size;
+    const char *name = largest_file(size);
+    if (name == nullptr) {
+        state.SkipWithError("no embedded files");
+        return;
+    }
+    uint8_t buf[READ_SIZE];
+
+    const size_t heap_before = heap_in_use();
+    AP_ROMFS::Stream *s = AP_ROMFS::stream_open(name, size);
+    for (uint32_t ofs = 0; ofs < size; ofs += sizeof(buf)) {
+        AP_ROMFS::stream_read(s, ofs, buf, sizeof(buf));
+    }
+    const size_t heap_held = heap_in_use() - heap_before;
+    AP_ROMFS::stream_close(s);
+
+    while (state.KeepRunning()) {
+        s = AP_ROMFS::stream_open(name, size);
+        for (uint32_t ofs = 0; ofs < size; ofs += sizeof(buf)) {
+            if (AP_ROMFS::stream_read(s, ofs, buf, sizeof(buf)) <= 0) {
+                state.SkipWithError("read failed");
+                break;
+            }
+            gbenchmark_escape(buf);
+        }
+        AP_ROMFS::stream_close(s);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+
+    char label[100];
+    snprintf(label, sizeof(label), "%s %u bytes, heap %u", name, unsigned(size), unsigned(heap_held));
+    state.SetLabel(label);
+}
+
+BENCHMARK(BM_ROMFSLoadStream);
+
+BENCHMARK_MAIN();
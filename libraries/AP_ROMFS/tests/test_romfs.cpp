@@ -0,0 +1,365 @@
+#include <AP_gtest.h>
+
+#include <AP_ROMFS/AP_ROMFS.h>
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/crc.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#ifndef HAL_ROMFS_UNCOMPRESSED
+
+/*
+  the linux board does not embed any ROMFS files, so the tests build
+  their own gzip file. This is a minimal deflate encoder using the
+  fixed huffman codes, with back references up to the same distance
+  as zlib produces for the 4k window used by embed.py
+ */
+class GzipWriter {
+public:
+    std::vector<uint8_t> out;
+
+    void compress(const std::vector<uint8_t> &data) {
+        static const uint8_t header[] = { 0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff };
+        out.assign(header, header+sizeof(header));
+        bitbuf = 0;
+        bitcount = 0;
+
+        // single final block with fixed codes
+        put_bits(1, 1);
+        put_bits(1, 2);
+
+        std::vector<int32_t> head(1U<<12, -1);
+        std::vector<int32_t> prev(data.size(), -1);
+        uint32_t i = 0;
+        while (i < data.size()) {
+            uint32_t best_len = 0;
+            uint32_t best_dist = 0;
+            if (i + 3 <= data.size()) {
+                const uint32_t h = hash(&data[i]);
+                for (int32_t p = head[h], tries = 0; p >= 0 && tries < 64; p = prev[p], tries++) {
+                    const uint32_t dist = i - p;
+                    if (dist > max_dist) {
+                        break;
+                    }
+                    uint32_t len = 0;
+                    while (len < 258 && i + len < data.size() && data[p+len] == data[i+len]) {
+                        len++;
+                    }
+                    if (len > best_len) {
+                        best_len = len;
+                        best_dist = dist;
+                    }
+                }
+            }
+            const uint32_t n = best_len >= 3 ? best_len : 1;
+            if (n == 1) {
+                put_literal(data[i]);
+            } else {
+                put_match(best_len, best_dist);
+            }
+            for (uint32_t j=0; j<n; j++, i++) {
+                if (i + 3 <= data.size()) {
+                    const uint32_t h = hash(&data[i]);
+                    prev[i] = head[h];
+                    head[h] = i;
+                }
+            }
+        }
+        put_code(0, 7);
+        if (bitcount > 0) {
+            out.push_back(bitbuf);
+        }
+
+        const uint32_t crc = crc32_small(0, data.data(), data.size());
+        const uint32_t size = data.size();
+        for (uint8_t b=0; b<4; b++) {
+            out.push_back(crc >> (8*b));
+        }
+        for (uint8_t b=0; b<4; b++) {
+            out.push_back(size >> (8*b));
+        }
+    }
+
+    // zlib never references further back than this with a 4k window
+    static const uint32_t max_dist = 4096 - 262;
+
+private:
+    uint32_t bitbuf;
+    uint8_t bitcount;
+
+    static uint32_t hash(const uint8_t *p) {
+        return ((p[0] << 8) ^ (p[1] << 4) ^ p[2]) & ((1U<<12) - 1);
+    }
+
+    // extra bits are packed lsb first
+    void put_bits(uint32_t v, uint8_t n) {
+        for (uint8_t b=0; b<n; b++) {
+            bitbuf |= ((v >> b) & 1) << bitcount;
+            if (++bitcount == 8) {
+                out.push_back(bitbuf);
+                bitbuf = 0;
+                bitcount = 0;
+            }
+        }
+    }
+
+    // huffman codes are packed msb first
+    void put_code(uint32_t code, uint8_t n) {
+        for (int8_t b=n-1; b>=0; b--) {
+            put_bits((code >> b) & 1, 1);
+        }
+    }
+
+    void put_symbol(uint16_t sym) {
+        if (sym < 144) {
+            put_code(0x30 + sym, 8);
+        } else if (sym < 256) {
+            put_code(0x190 + sym - 144, 9);
+        } else if (sym < 280) {
+            put_code(sym - 256, 7);
+        } else {
+            put_code(0xc0 + sym - 280, 8);
+        }
+    }
+
+    void put_literal(uint8_t c) {
+        put_symbol(c);
+    }
+
+    void put_match(uint32_t len, uint32_t dist) {
+        static const uint16_t len_base[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                             35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t len_extra[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                             3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t dist_base[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                              257, 385, 513, 769, 1025, 1537, 2049, 3073 };
+        static const uint8_t dist_extra[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                              7, 7, 8, 8, 9, 9, 10, 10 };
+        uint8_t l = ARRAY_SIZE(len_base) - 1;
+        while (len_base[l] > len) {
+            l--;
+        }
+        put_symbol(257 + l);
+        put_bits(len - len_base[l], len_extra[l]);
+        uint8_t d = ARRAY_SIZE(dist_base) - 1;
+        while (dist_base[d] > dist) {
+            d--;
+        }
+        put_code(d, 5);
+        put_bits(dist - dist_base[d], dist_extra[d]);
+    }
+};
+
+class AP_ROMFS_Test : public ::testing::Test {
+protected:
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> compressed;
+    AP_ROMFS::embedded_file file;
+
+    void SetUp() override {
+        make_data(20000);
+    }
+
+    /*
+      text-like data with repeats at short and long distances, so
+      back references reach right up to the edge of the window, with
+      some incompressible runs mixed in
+     */
+    void make_data(uint32_t size) {
+        static const char *words[] = { "GPS", "BATT", "ATT", "RATE", "PARM", "MODE", "CTUN",
+                                       "0.125", "-17.5", "1500", ",", "\n" };
+        uint32_t seed = 1;
+        data.clear();
+        while (data.size() < size) {
+            seed = seed * 1103515245 + 12345;
+            const uint32_t r = seed >> 8;
+            if (r % 16 == 0 && data.size() > GzipWriter::max_dist) {
+                // copy a block from close to the window edge
+                const uint32_t back = GzipWriter::max_dist - (r >> 4) % 64;
+                const uint32_t start = data.size() - back;
+                for (uint32_t i=0; i<100; i++) {
+                    data.push_back(data[start+i]);
+                }
+            } else if (r % 16 == 1) {
+                for (uint32_t i=0; i<40; i++) {
+                    seed = seed * 1103515245 + 12345;
+                    data.push_back(seed >> 16);
+                }
+            } else {
+                const char *w = words[(r >> 4) % ARRAY_SIZE(words)];
+                data.insert(data.end(), w, w + strlen(w));
+            }
+        }
+        data.resize(size);
+
+        GzipWriter gz;
+        gz.compress(data);
+        compressed = gz.out;
+        file.filename = "test.txt";
+        file.size = compressed.size();
+        file.crc = crc32_small(0, data.data(), data.size());
+        file.contents = compressed.data();
+    }
+
+    const uint8_t *decompress(uint32_t &size) {
+        return AP_ROMFS::decompress(file, size);
+    }
+
+    AP_ROMFS::Stream *stream_open(uint32_t &size) {
+        return AP_ROMFS::stream_open(file, size);
+    }
+
+    bool page_cache_allocated() const {
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+        return AP_ROMFS::page_cache != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    void corrupt_crc() {
+        file.crc ^= 1;
+    }
+
+    // read from a stream and compare against the reference data
+    void check_read(AP_ROMFS::Stream *s, uint32_t ofs, uint32_t count) {
+        std::vector<uint8_t> buf(count+1);
+        const int32_t n = AP_ROMFS::stream_read(s, ofs, buf.data(), count);
+        const uint32_t expected = ofs >= data.size() ? 0 : MIN(count, data.size() - ofs);
+        ASSERT_EQ(int32_t(expected), n) << "ofs=" << ofs << " count=" << count;
+        EXPECT_EQ(0, memcmp(buf.data(), &data[ofs], expected)) << "ofs=" << ofs << " count=" << count;
+    }
+};
+
+TEST_F(AP_ROMFS_Test, Decompress)
+{
+    uint32_t size = 0;
+    const uint8_t *d = decompress(size);
+    ASSERT_NE(nullptr, d);
+    ASSERT_EQ(data.size(), size);
+    EXPECT_EQ(0, memcmp(d, data.data(), size));
+    EXPECT_EQ(0, d[size]);
+    AP_ROMFS::free(d);
+}
+
+TEST_F(AP_ROMFS_Test, StreamSequential)
+{
+    uint32_t size = 0;
+    const uint8_t *d = decompress(size);
+    ASSERT_NE(nullptr, d);
+    ASSERT_EQ(0, memcmp(d, data.data(), size));
+    AP_ROMFS::free(d);
+
+    // odd read sizes so reads straddle the page and window boundaries
+    for (uint32_t count : { 1U, 7U, 333U, 512U, 4095U, 4097U }) {
+        AP_ROMFS::Stream *s = stream_open(size);
+        ASSERT_NE(nullptr, s);
+        ASSERT_EQ(data.size(), size);
+        for (uint32_t ofs=0; ofs<size; ofs += count) {
+            check_read(s, ofs, count);
+        }
+        check_read(s, size, 10);
+        AP_ROMFS::stream_close(s);
+    }
+}
+
+TEST_F(AP_ROMFS_Test, StreamSeek)
+{
+    uint32_t size = 0;
+    AP_ROMFS::Stream *s = stream_open(size);
+    ASSERT_NE(nullptr, s);
+
+    // backward reads around the edge of the 4k inflate window,
+    // which come from the window, the page cache or a restart. Each
+    // read leaves the stream with 3*W+110 bytes inflated
+    const uint32_t W = AP_ROMFS_STREAM_WINDOW_SIZE;
+    check_read(s, 3*W, 100);
+    for (uint32_t back : { 1U, 511U, 512U, W-100, W-1, W, W+1, W+511, 2*W }) {
+        check_read(s, 3*W + 100, 10);
+        check_read(s, 3*W + 110 - back, MIN(back, 200U));
+    }
+    // reads that straddle the window edge
+    check_read(s, W - 50, 100);
+    check_read(s, 2*W - 50, 100);
+    check_read(s, W - 50, 2*W);
+
+    // random offsets and lengths, mostly backwards from the end
+    uint32_t seed = 42;
+    for (uint16_t i=0; i<2000; i++) {
+        seed = seed * 1103515245 + 12345;
+        const uint32_t ofs = (seed >> 8) % (size + 100);
+        seed = seed * 1103515245 + 12345;
+        const uint32_t count = 1 + (seed >> 8) % 1500;
+        check_read(s, ofs, count);
+    }
+    AP_ROMFS::stream_close(s);
+}
+
+TEST_F(AP_ROMFS_Test, TwoStreams)
+{
+    uint32_t size = 0;
+    AP_ROMFS::Stream *s1 = stream_open(size);
+    AP_ROMFS::Stream *s2 = stream_open(size);
+    ASSERT_NE(nullptr, s1);
+    ASSERT_NE(nullptr, s2);
+
+    // interleaved streams share the page cache
+    for (uint32_t ofs=0; ofs<size; ofs += 1000) {
+        check_read(s1, ofs, 1000);
+        check_read(s2, size - ofs - 1, 1);
+        check_read(s1, ofs / 2, 300);
+    }
+    AP_ROMFS::stream_close(s1);
+    AP_ROMFS::stream_close(s2);
+}
+
+TEST_F(AP_ROMFS_Test, PageCacheFreed)
+{
+    uint32_t size = 0;
+    EXPECT_FALSE(page_cache_allocated());
+    AP_ROMFS::Stream *s1 = stream_open(size);
+    AP_ROMFS::Stream *s2 = stream_open(size);
+    ASSERT_NE(nullptr, s1);
+    ASSERT_NE(nullptr, s2);
+    check_read(s1, 0, size);
+    check_read(s2, 5000, 1000);
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    EXPECT_TRUE(page_cache_allocated());
+#endif
+
+    // the cache stays while any stream is open
+    AP_ROMFS::stream_close(s1);
+#if AP_ROMFS_PAGE_CACHE_NUM_PAGES > 0
+    EXPECT_TRUE(page_cache_allocated());
+#endif
+    check_read(s2, 100, 1000);
+    AP_ROMFS::stream_close(s2);
+    EXPECT_FALSE(page_cache_allocated());
+
+    // and comes back for the next stream
+    AP_ROMFS::Stream *s3 = stream_open(size);
+    ASSERT_NE(nullptr, s3);
+    check_read(s3, 10000, 1000);
+    check_read(s3, 100, 1000);
+    AP_ROMFS::stream_close(s3);
+    EXPECT_FALSE(page_cache_allocated());
+}
+
+TEST_F(AP_ROMFS_Test, BadCrc)
+{
+    corrupt_crc();
+    uint32_t size = 0;
+    EXPECT_EQ(nullptr, decompress(size));
+
+    // the crc is only known once the whole file has been inflated
+    AP_ROMFS::Stream *s = stream_open(size);
+    ASSERT_NE(nullptr, s);
+    std::vector<uint8_t> buf(size);
+    EXPECT_EQ(int32_t(size - 100), AP_ROMFS::stream_read(s, 0, buf.data(), size - 100));
+    EXPECT_EQ(-1, AP_ROMFS::stream_read(s, size - 100, buf.data(), 100));
+    AP_ROMFS::stream_close(s);
+}
+
+#endif // HAL_ROMFS_UNCOMPRESSED
+
+AP_GTEST_MAIN()
@@ -0,0 +1,152 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AP_StateExport.h"
+
+#if HAL_STATE_EXPORT_ENABLED
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <AP_AHRS/AP_AHRS.h>
+#include <AP_InertialSensor/AP_InertialSensor.h>
+#include <AP_Scheduler/AP_Scheduler.h>
+#include <GCS_MAVLink/GCS.h>
+#include <SRV_Channel/SRV_Channel.h>
+
+extern const AP_HAL::HAL& hal;
+
+const AP_Param::GroupInfo AP_StateExport::var_info[] = {
+
+    // @Param: ENABLE
+    // @DisplayName: Enable shared memory state export
+    // @Description: Publish attitude, EKF, IMU and servo output state at the main loop rate in a POSIX shared memory segment named /ardupilot_state.<SYSID_THISMAV>, for processes running on the same board
+    // @Values: 0:Disabled,1:Enabled
+    // @RebootRequired: True
+    // @User: Advanced
+    AP_GROUPINFO_FLAGS("ENABLE", 1, AP_StateExport, _enable, 0, AP_PARAM_FLAG_ENABLE),
+
+    AP_GROUPEND
+};
+
+AP_StateExport::AP_StateExport()
+{
+    AP_Param::setup_object_defaults(this, var_info);
+}
+
+void AP_StateExport::init()
+{
+    if (_enable == 0) {
+        return;
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), AP_STATE_EXPORT_NAME_PREFIX "%u", (unsigned)mavlink_system.sysid);
+
+    // start from a fresh segment so readers still mapping the one
+    // from a previous boot see it stop rather than go backwards
+    shm_unlink(name);
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "SHM: failed to create %s", name);
+        return;
+    }
+    if (ftruncate(fd, AP_STATE_EXPORT_SEGMENT_SIZE) != 0) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "SHM: failed to size %s", name);
+        close(fd);
+        shm_unlink(name);
+        return;
+    }
+    void *p = mmap(nullptr, AP_STATE_EXPORT_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        gcs().send_text(MAV_SEVERITY_WARNING, "SHM: failed to map %s", name);
+        shm_unlink(name);
+        return;
+    }
+
+    ap_state_header *hdr = (ap_state_header *)p;
+    hdr->version = AP_STATE_EXPORT_VERSION;
+    hdr->record_size = sizeof(ap_state_record);
+    hdr->ring_length = AP_STATE_EXPORT_RING_LENGTH;
+    hdr->loop_rate_hz = AP::scheduler().get_loop_rate_hz();
+    // readers check the magic, so it goes in last
+    __atomic_store_n(&hdr->magic, AP_STATE_EXPORT_MAGIC, __ATOMIC_RELEASE);
+    _hdr = hdr;
+}
+
+void AP_StateExport::update()
+{
+    if (_hdr == nullptr) {
+        return;
+    }
+
+    ap_state_record rec {};
+    rec.time_us = AP_HAL::micros64();
+
+    const AP_AHRS &ahrs = AP::ahrs();
+    Quaternion quat;
+    ahrs.get_quat_body_to_ned(quat);
+    rec.quat[0] = quat.q1;
+    rec.quat[1] = quat.q2;
+    rec.quat[2] = quat.q3;
+    rec.quat[3] = quat.q4;
+    const Vector3f &gyro = ahrs.get_gyro();
+    memcpy(rec.gyro, &gyro, sizeof(rec.gyro));
+
+    const AP_InertialSensor &ins = AP::ins();
+    memcpy(rec.accel_raw, &ins.get_accel(), sizeof(rec.accel_raw));
+    memcpy(rec.gyro_raw, &ins.get_gyro(), sizeof(rec.gyro_raw));
+
+    Vector3f v;
+    if (ahrs.get_relative_position_NED_origin(v)) {
+        memcpy(rec.pos_ned, &v, sizeof(rec.pos_ned));
+        rec.flags |= AP_STATE_EXPORT_REL_POSITION_VALID;
+    }
+    if (ahrs.get_velocity_NED(v)) {
+        memcpy(rec.vel_ned, &v, sizeof(rec.vel_ned));
+        rec.flags |= AP_STATE_EXPORT_VELOCITY_VALID;
+    }
+    Location loc;
+    if (ahrs.get_position(loc)) {
+        rec.lat = loc.lat;
+        rec.lng = loc.lng;
+        rec.alt_cm = loc.alt;
+        rec.flags |= AP_STATE_EXPORT_POSITION_VALID;
+    }
+#if AP_AHRS_NAVEKF_AVAILABLE
+    nav_filter_status status;
+    if (AP::ahrs_navekf().get_filter_status(status)) {
+        rec.ekf_status = status.value;
+        rec.flags |= AP_STATE_EXPORT_EKF_STATUS_VALID;
+    }
+#endif
+    if (hal.util->get_soft_armed()) {
+        rec.flags |= AP_STATE_EXPORT_ARMED;
+    }
+
+    for (uint8_t i = 0; i < MIN(NUM_SERVO_CHANNELS, ARRAY_SIZE(rec.servo_pwm)); i++) {
+        const SRV_Channel *c = SRV_Channels::srv_channel(i);
+        if (c != nullptr && c->get_function() != SRV_Channel::k_none) {
+            rec.servo_pwm[i] = c->get_output_pwm();
+        }
+    }
+
+    ap_state_publish(_hdr, &rec);
+}
+
+#endif // HAL_STATE_EXPORT_ENABLED
@@ -0,0 +1,56 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  export of attitude, EKF, IMU and servo output state through POSIX
+  shared memory, so companion processes on the same board can read it
+  at the full loop rate without going through MAVLink. See
+  AP_StateExport_Layout.h for the segment layout and
+  AP_StateExport_Reader.h for a reader.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_Param/AP_Param.h>
+
+#ifndef HAL_STATE_EXPORT_ENABLED
+#define HAL_STATE_EXPORT_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL) && !defined(HAL_BUILD_AP_PERIPH)
+#endif
+
+#if HAL_STATE_EXPORT_ENABLED
+
+#include "AP_StateExport_Layout.h"
+
+class AP_StateExport {
+public:
+    AP_StateExport();
+
+    /* Do not allow copies */
+    CLASS_NO_COPY(AP_StateExport);
+
+    static const struct AP_Param::GroupInfo var_info[];
+
+    // create the shared memory segment if enabled
+    void init();
+
+    // publish a record, called at the main loop rate
+    void update();
+
+private:
+    AP_Int8 _enable;
+
+    ap_state_header *_hdr;
+};
+
+#endif // HAL_STATE_EXPORT_ENABLED
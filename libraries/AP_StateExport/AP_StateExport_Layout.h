@@ -0,0 +1,156 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  layout of the shared memory segment used to export vehicle state to
+  processes on the same board.
+
+  This header is included by both the vehicle and by readers built
+  outside of ArduPilot, so it only depends on the C library. The
+  segment is a header followed by a ring of fixed size records. Each
+  record is protected by its own sequence counter (a seqlock): the
+  writer makes the counter odd while it fills the record, and a reader
+  copies the record and accepts it only if the counter was even and
+  unchanged across the copy. Readers never block the writer.
+
+  Any change to the records must bump AP_STATE_EXPORT_VERSION.
+ */
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#define AP_STATE_EXPORT_MAGIC   0x45535041U // "APSE"
+#define AP_STATE_EXPORT_VERSION 1
+
+// records in the ring, 160ms of history at 400Hz
+#define AP_STATE_EXPORT_RING_LENGTH 64
+
+// segment name is this prefix followed by the MAVLink system ID
+#define AP_STATE_EXPORT_NAME_PREFIX "/ardupilot_state."
+
+// bits in ap_state_record::flags
+#define AP_STATE_EXPORT_POSITION_VALID     (1U<<0) // lat/lng/alt_cm
+#define AP_STATE_EXPORT_REL_POSITION_VALID (1U<<1) // pos_ned
+#define AP_STATE_EXPORT_VELOCITY_VALID     (1U<<2) // vel_ned
+#define AP_STATE_EXPORT_EKF_STATUS_VALID   (1U<<3) // ekf_status
+#define AP_STATE_EXPORT_ARMED              (1U<<4)
+
+struct ap_state_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t record_size;
+    uint16_t ring_length;
+    uint16_t loop_rate_hz;
+    uint32_t reserved;
+    // number of records published. The newest is number count-1,
+    // held in slot (count-1) % ring_length
+    uint64_t count;
+    uint8_t pad[40];
+};
+
+struct ap_state_record {
+    // 2n+1 while record n is being written, 2n+2 once it is complete
+    uint32_t seq;
+    // nav_filter_status bits of the active EKF
+    uint32_t ekf_status;
+    // time of the main loop iteration that produced the record
+    uint64_t time_us;
+
+    // AHRS attitude, body to NED, and corrected body rates in rad/s
+    float quat[4];
+    float gyro[3];
+
+    // primary IMU, m/s/s and rad/s, with no bias correction
+    float accel_raw[3];
+    float gyro_raw[3];
+
+    // EKF position relative to its origin and velocity, NED in m and m/s
+    float pos_ned[3];
+    float vel_ned[3];
+
+    // EKF position, degrees*1e7 and cm above mean sea level
+    int32_t lat;
+    int32_t lng;
+    int32_t alt_cm;
+
+    uint32_t flags;
+
+    // servo output PWM values in microseconds, 0 for unused channels
+    uint16_t servo_pwm[16];
+
+    uint32_t reserved;
+};
+
+static_assert(sizeof(struct ap_state_header) == 64, "ap_state_header must be 64 bytes");
+static_assert(sizeof(struct ap_state_record) == 144, "ap_state_record size changed, bump version");
+
+// total size of the shared memory segment
+#define AP_STATE_EXPORT_SEGMENT_SIZE \
+    (sizeof(struct ap_state_header) + AP_STATE_EXPORT_RING_LENGTH * sizeof(struct ap_state_record))
+
+static inline struct ap_state_record *ap_state_ring(struct ap_state_header *hdr)
+{
+    return (struct ap_state_record *)(hdr + 1);
+}
+
+static inline const struct ap_state_record *ap_state_ring_const(const struct ap_state_header *hdr)
+{
+    return (const struct ap_state_record *)(hdr + 1);
+}
+
+/*
+  publish a record. Only one writer may call this at a time. The seq
+  field of rec is ignored
+ */
+static inline void ap_state_publish(struct ap_state_header *hdr, const struct ap_state_record *rec)
+{
+    const uint64_t n = hdr->count;
+    struct ap_state_record *slot = &ap_state_ring(hdr)[n % AP_STATE_EXPORT_RING_LENGTH];
+
+    __atomic_store_n(&slot->seq, (uint32_t)(2*n+1), __ATOMIC_RELAXED);
+    // the odd sequence must be visible before any of the new data
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((uint8_t *)slot + sizeof(slot->seq), (const uint8_t *)rec + sizeof(rec->seq),
+           sizeof(*rec) - sizeof(rec->seq));
+    __atomic_store_n(&slot->seq, (uint32_t)(2*n+2), __ATOMIC_RELEASE);
+    __atomic_store_n(&hdr->count, n+1, __ATOMIC_RELEASE);
+}
+
+/*
+  copy record number n. Returns false if it has been overwritten or
+  was being written during the copy; the caller decides whether to
+  retry or move on to a newer record
+ */
+static inline bool ap_state_read(const struct ap_state_header *hdr, uint64_t n, struct ap_state_record *rec)
+{
+    const struct ap_state_record *slot = &ap_state_ring_const(hdr)[n % AP_STATE_EXPORT_RING_LENGTH];
+    const uint32_t expected = (uint32_t)(2*n+2);
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != expected) {
+        return false;
+    }
+    memcpy(rec, slot, sizeof(*rec));
+    // the data must be read before the sequence is checked again
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == expected;
+}
+
+// number of records published so far
+static inline uint64_t ap_state_count(const struct ap_state_header *hdr)
+{
+    return __atomic_load_n(&hdr->count, __ATOMIC_ACQUIRE);
+}
@@ -0,0 +1,150 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  reader for the shared memory state export, for use by companion
+  processes. It is header only and needs nothing from ArduPilot
+  beyond AP_StateExport_Layout.h, so it can be copied into other
+  projects. Link with -lrt on older glibc.
+
+  Example:
+
+    AP_StateExport_Reader reader;
+    if (!reader.open(1)) {
+        // vehicle not running or SHM_ENABLE not set
+    }
+    ap_state_record rec;
+    while (true) {
+        if (reader.read_next(rec)) {
+            // every record in order, see lost() for overruns
+        }
+    }
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "AP_StateExport_Layout.h"
+
+class AP_StateExport_Reader {
+public:
+    ~AP_StateExport_Reader() { close(); }
+
+    // map the segment of the vehicle with the given MAVLink system ID
+    bool open(uint8_t sysid) {
+        char name[32];
+        snprintf(name, sizeof(name), AP_STATE_EXPORT_NAME_PREFIX "%u", (unsigned)sysid);
+        return open_name(name);
+    }
+
+    bool open_name(const char *name) {
+        close();
+        const int fd = shm_open(name, O_RDONLY, 0);
+        if (fd == -1) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)AP_STATE_EXPORT_SEGMENT_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, AP_STATE_EXPORT_SEGMENT_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        hdr = (const ap_state_header *)p;
+        if (hdr->magic != AP_STATE_EXPORT_MAGIC ||
+            hdr->version != AP_STATE_EXPORT_VERSION ||
+            hdr->record_size != sizeof(ap_state_record) ||
+            hdr->ring_length != AP_STATE_EXPORT_RING_LENGTH) {
+            close();
+            return false;
+        }
+        next = ap_state_count(hdr);
+        lost_count = 0;
+        return true;
+    }
+
+    void close() {
+        if (hdr != nullptr) {
+            munmap((void *)hdr, AP_STATE_EXPORT_SEGMENT_SIZE);
+            hdr = nullptr;
+        }
+    }
+
+    bool is_open() const { return hdr != nullptr; }
+
+    // main loop rate of the vehicle, which is the publish rate
+    uint16_t loop_rate_hz() const { return hdr->loop_rate_hz; }
+
+    // records published since the vehicle started
+    uint64_t count() const { return ap_state_count(hdr); }
+
+    /*
+      copy the newest record. Returns false if nothing has been
+      published yet
+     */
+    bool read_latest(ap_state_record &rec) const {
+        for (uint8_t tries = 0; tries < 4; tries++) {
+            const uint64_t c = ap_state_count(hdr);
+            if (c == 0) {
+                return false;
+            }
+            if (ap_state_read(hdr, c-1, &rec)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /*
+      copy the oldest record not yet returned by read_next(). Returns
+      false when there is nothing new. Records the writer overwrote
+      before they were read are skipped and counted in lost()
+     */
+    bool read_next(ap_state_record &rec) {
+        while (true) {
+            const uint64_t c = ap_state_count(hdr);
+            if (next >= c) {
+                return false;
+            }
+            // the slot after the newest is the next to be overwritten
+            if (c - next >= AP_STATE_EXPORT_RING_LENGTH) {
+                const uint64_t oldest = c - (AP_STATE_EXPORT_RING_LENGTH - 1);
+                lost_count += oldest - next;
+                next = oldest;
+            }
+            if (ap_state_read(hdr, next, &rec)) {
+                next++;
+                return true;
+            }
+            // overwritten during the copy, catch up and try again
+            lost_count++;
+            next++;
+        }
+    }
+
+    // records skipped by read_next() because the reader fell behind
+    uint64_t lost() const { return lost_count; }
+
+private:
+    const ap_state_header *hdr = nullptr;
+    uint64_t next = 0;
+    uint64_t lost_count = 0;
+};
@@ -0,0 +1,186 @@
+#include <AP_gtest.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <AP_HAL/AP_HAL.h>
+#include <AP_StateExport/AP_StateExport_Reader.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#define TEST_SEGMENT_NAME "/ap_state_export_test"
+
+// fill every field from the record number so a torn copy shows up
+static void make_record(uint64_t n, ap_state_record &rec)
+{
+    memset(&rec, 0, sizeof(rec));
+    rec.time_us = n;
+    for (uint8_t i = 0; i < 3; i++) {
+        rec.gyro[i] = rec.accel_raw[i] = rec.gyro_raw[i] = rec.pos_ned[i] = rec.vel_ned[i] = n;
+    }
+    for (uint8_t i = 0; i < 4; i++) {
+        rec.quat[i] = n;
+    }
+    rec.lat = rec.lng = rec.alt_cm = n;
+    rec.ekf_status = rec.flags = n;
+    for (uint8_t i = 0; i < 16; i++) {
+        rec.servo_pwm[i] = n;
+    }
+}
+
+static bool record_consistent(uint64_t n, const ap_state_record &rec)
+{
+    ap_state_record expected;
+    make_record(n, expected);
+    expected.seq = 2*n+2;
+    return memcmp(&expected, &rec, sizeof(rec)) == 0;
+}
+
+static ap_state_header *create_segment(const char *name)
+{
+    shm_unlink(name);
+    const int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd == -1 || ftruncate(fd, AP_STATE_EXPORT_SEGMENT_SIZE) != 0) {
+        return nullptr;
+    }
+    void *p = mmap(nullptr, AP_STATE_EXPORT_SEGMENT_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        return nullptr;
+    }
+    ap_state_header *hdr = (ap_state_header *)p;
+    hdr->magic = AP_STATE_EXPORT_MAGIC;
+    hdr->version = AP_STATE_EXPORT_VERSION;
+    hdr->record_size = sizeof(ap_state_record);
+    hdr->ring_length = AP_STATE_EXPORT_RING_LENGTH;
+    hdr->loop_rate_hz = 400;
+    return hdr;
+}
+
+static void destroy_segment(const char *name, ap_state_header *hdr)
+{
+    munmap(hdr, AP_STATE_EXPORT_SEGMENT_SIZE);
+    shm_unlink(name);
+}
+
+TEST(StateExport, ReadNextInOrder)
+{
+    ap_state_header *hdr = create_segment(TEST_SEGMENT_NAME);
+    ASSERT_NE(hdr, nullptr);
+
+    AP_StateExport_Reader reader;
+    ASSERT_TRUE(reader.open_name(TEST_SEGMENT_NAME));
+    EXPECT_EQ(reader.loop_rate_hz(), 400);
+
+    ap_state_record rec;
+    EXPECT_FALSE(reader.read_latest(rec));
+    EXPECT_FALSE(reader.read_next(rec));
+
+    uint64_t n = 0;
+    for (; n < 10; n++) {
+        make_record(n, rec);
+        ap_state_publish(hdr, &rec);
+    }
+    for (uint64_t i = 0; i < 10; i++) {
+        ASSERT_TRUE(reader.read_next(rec));
+        EXPECT_TRUE(record_consistent(i, rec));
+    }
+    EXPECT_FALSE(reader.read_next(rec));
+    EXPECT_EQ(reader.lost(), 0U);
+
+    // fall behind by more than the ring holds
+    for (; n < 10 + 3*AP_STATE_EXPORT_RING_LENGTH; n++) {
+        make_record(n, rec);
+        ap_state_publish(hdr, &rec);
+    }
+    ASSERT_TRUE(reader.read_latest(rec));
+    EXPECT_TRUE(record_consistent(n-1, rec));
+
+    uint64_t expect = n - (AP_STATE_EXPORT_RING_LENGTH - 1);
+    while (reader.read_next(rec)) {
+        EXPECT_TRUE(record_consistent(expect, rec));
+        expect++;
+    }
+    EXPECT_EQ(expect, n);
+    EXPECT_EQ(reader.lost(), n - 10 - (AP_STATE_EXPORT_RING_LENGTH - 1));
+
+    destroy_segment(TEST_SEGMENT_NAME, hdr);
+}
+
+TEST(StateExport, RejectsOtherLayouts)
+{
+    ap_state_header *hdr = create_segment(TEST_SEGMENT_NAME);
+    ASSERT_NE(hdr, nullptr);
+
+    AP_StateExport_Reader reader;
+    hdr->version = AP_STATE_EXPORT_VERSION + 1;
+    EXPECT_FALSE(reader.open_name(TEST_SEGMENT_NAME));
+    hdr->version = AP_STATE_EXPORT_VERSION;
+    hdr->record_size++;
+    EXPECT_FALSE(reader.open_name(TEST_SEGMENT_NAME));
+    hdr->record_size--;
+    EXPECT_TRUE(reader.open_name(TEST_SEGMENT_NAME));
+    EXPECT_FALSE(reader.open_name("/ap_state_export_missing"));
+    EXPECT_FALSE(reader.is_open());
+
+    destroy_segment(TEST_SEGMENT_NAME, hdr);
+}
+
+#define CONCURRENT_RECORDS 500000
+
+static void *writer_thread(void *arg)
+{
+    ap_state_header *hdr = (ap_state_header *)arg;
+    ap_state_record rec;
+    for (uint64_t n = 0; n < CONCURRENT_RECORDS; n++) {
+        make_record(n, rec);
+        ap_state_publish(hdr, &rec);
+    }
+    return nullptr;
+}
+
+/*
+  a reader racing the writer must never accept a torn record, and
+  records it gets through read_next() must be in order
+ */
+TEST(StateExport, ConcurrentReadsAreConsistent)
+{
+    ap_state_header *hdr = create_segment(TEST_SEGMENT_NAME);
+    ASSERT_NE(hdr, nullptr);
+
+    AP_StateExport_Reader reader;
+    ASSERT_TRUE(reader.open_name(TEST_SEGMENT_NAME));
+
+    pthread_t writer;
+    ASSERT_EQ(pthread_create(&writer, nullptr, writer_thread, hdr), 0);
+
+    uint32_t received = 0;
+    uint32_t bad = 0;
+    int64_t last = -1;
+    ap_state_record rec;
+    while (reader.count() < CONCURRENT_RECORDS) {
+        if (reader.read_next(rec)) {
+            const uint64_t n = (rec.seq - 2) / 2;
+            if (!record_consistent(n, rec) || int64_t(n) <= last) {
+                bad++;
+            }
+            last = n;
+            received++;
+        }
+        if (reader.read_latest(rec) && !record_consistent((rec.seq - 2) / 2, rec)) {
+            bad++;
+        }
+    }
+    pthread_join(writer, nullptr);
+    while (reader.read_next(rec)) {
+        received++;
+    }
+
+    EXPECT_EQ(bad, 0U);
+    EXPECT_EQ(received + reader.lost(), uint64_t(CONCURRENT_RECORDS));
+
+    destroy_segment(TEST_SEGMENT_NAME, hdr);
+}
+
+AP_GTEST_MAIN()
@@ -49,8 +49,8 @@ const AP_Param::GroupInfo AP_Terrain::var_info[] = {
 
     // @Param: OPTIONS
     // @DisplayName: Terrain options
-    // @Description: Options to change behaviour of terrain system
-    // @Bitmask: 0:Disable Download
+    // @Description: Options to change behaviour of terrain system. Import Tiles converts the terrain DAT files on the SD card into memory mapped tile files at boot, which speeds up terrain lookups on Linux and SITL boards. It has no effect on other boards
+    // @Bitmask: 0:Disable Download, 1:Import Tiles
     // @User: Advanced
     AP_GROUPINFO("OPTIONS",   2, AP_Terrain, options, 0),
     
@@ -105,9 +105,38 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
 
     calculate_grid_info(loc, info);
 
-    // find the grid
-    const struct grid_block &grid = find_grid_cache(info).grid;
+#if AP_TERRAIN_TILE_ENABLED
+    // a mapped tile answers without needing the grid block in the cache
+    if (!tile_height(find_tile(info.lat_degrees, info.lon_degrees), info, height) &&
+        !grid_height(find_grid_cache(info).grid, info, height)) {
+        return false;
+    }
+#else
+    if (!grid_height(find_grid_cache(info).grid, info, height)) {
+        return false;
+    }
+#endif
+
+    if (loc.lat == ahrs.get_home().lat &&
+        loc.lng == ahrs.get_home().lng) {
+        // remember home altitude as a special case
+        home_height = height;
+        home_loc = loc;
+    }
+
+    // apply correction which assumes home altitude is at terrain altitude
+    if (corrected) {
+        height += (ahrs.get_home().alt * 0.01f) - home_height;
+    }
+
+    return true;
+}
 
+/*
+  height at a grid_info from its grid block
+ */
+bool AP_Terrain::grid_height(const struct grid_block &grid, const struct grid_info &info, float &height)
+{
     /*
       note that we rely on the one square overlap to ensure these
       calculations don't go past the end of the arrays
@@ -141,19 +170,138 @@ bool AP_Terrain::height_amsl(const Location &loc, float &height, bool corrected)
 
     height = avg;
 
-    if (loc.lat == ahrs.get_home().lat &&
-        loc.lng == ahrs.get_home().lng) {
-        // remember home altitude as a special case
-        home_height = height;
-        home_loc = loc;
+    return true;
+}
+
+/*
+  height at a location for a batch of lookups. The offset into the
+  degree is linear in lat/lon so it is found with the scale cached in
+  the cursor, and the grid block is only searched for when the
+  location moves out of the last one
+ */
+bool AP_Terrain::batch_height(const Location &loc, struct batch_cursor &cursor, float &height)
+{
+    struct grid_info info;
+    info.lat_degrees = (loc.lat<0?(loc.lat-9999999L):loc.lat) / (10*1000*1000L);
+    info.lon_degrees = (loc.lng<0?(loc.lng-9999999L):loc.lng) / (10*1000*1000L);
+
+    if (!cursor.valid ||
+        cursor.lat_degrees != info.lat_degrees ||
+        cursor.lon_degrees != info.lon_degrees) {
+        // new degree
+        Location ref, corner;
+        ref.lat = info.lat_degrees*10*1000*1000L;
+        ref.lng = info.lon_degrees*10*1000*1000L;
+        corner.lat = ref.lat + 10*1000*1000L;
+        corner.lng = ref.lng + 10*1000*1000L;
+        cursor.scale = ref.get_distance_NE(corner) * 1.0e-7f;
+        cursor.lat_degrees = info.lat_degrees;
+        cursor.lon_degrees = info.lon_degrees;
+        cursor.gcache = nullptr;
+#if AP_TERRAIN_TILE_ENABLED
+        cursor.tile = find_tile(info.lat_degrees, info.lon_degrees);
+#endif
+        cursor.valid = true;
     }
 
-    // apply correction which assumes home altitude is at terrain altitude
-    if (corrected) {
-        height += (ahrs.get_home().alt * 0.01f) - home_height;
+    const Vector2f offset((loc.lat - info.lat_degrees*10*1000*1000L) * cursor.scale.x,
+                          (loc.lng - info.lon_degrees*10*1000*1000L) * cursor.scale.y);
+    calculate_grid_index(offset, info);
+
+#if AP_TERRAIN_TILE_ENABLED
+    if (tile_height(cursor.tile, info, height)) {
+        return true;
     }
+#endif
 
-    return true;
+    if (cursor.gcache == nullptr ||
+        cursor.grid_idx_x != info.grid_idx_x ||
+        cursor.grid_idx_y != info.grid_idx_y) {
+        calculate_grid_corner(info);
+        cursor.gcache = &find_grid_cache(info);
+        cursor.grid_idx_x = info.grid_idx_x;
+        cursor.grid_idx_y = info.grid_idx_y;
+    }
+    return grid_height(cursor.gcache->grid, info, height);
+}
+
+/*
+  return terrain heights in meters above average sea level (WGS84)
+  for an array of locations
+ */
+bool AP_Terrain::height_amsl(const Location *locs, uint16_t count, float *heights, bool corrected)
+{
+    if (!allocate()) {
+        return false;
+    }
+
+    // the correction height_amsl() applies, which assumes home
+    // altitude is at terrain altitude
+    const float correction = corrected ? (AP::ahrs().get_home().alt * 0.01f) - home_height : 0;
+
+    struct batch_cursor cursor {};
+    bool ret = true;
+    for (uint16_t i=0; i<count; i++) {
+        float height;
+        if (batch_height(locs[i], cursor, height)) {
+            heights[i] = height + correction;
+        } else {
+            ret = false;
+        }
+    }
+    return ret;
+}
+
+/*
+  the location a fraction i/steps of the way from start to end
+ */
+static Location path_location(const Location &start, const Location &end, uint32_t i, uint32_t steps)
+{
+    Location loc = start;
+    if (steps > 0) {
+        loc.lat += int32_t((int64_t(end.lat) - start.lat) * i / steps);
+        loc.lng += int32_t((int64_t(end.lng) - start.lng) * i / steps);
+    }
+    return loc;
+}
+
+/*
+  find the highest terrain in meters above average sea level (WGS84)
+  along a path
+ */
+bool AP_Terrain::height_amsl_max(const Location &start, const Location &end, float spacing,
+                                 float &max_height, bool corrected,
+                                 float *heights, uint16_t max_heights)
+{
+    if (!allocate() || grid_spacing <= 0) {
+        return false;
+    }
+    if (spacing <= 0) {
+        spacing = grid_spacing;
+    }
+
+    const float correction = corrected ? (AP::ahrs().get_home().alt * 0.01f) - home_height : 0;
+    const uint16_t steps = MIN(ceilf(start.get_distance(end) / spacing), float(UINT16_MAX-1));
+
+    struct batch_cursor cursor {};
+    bool ret = true;
+    bool have_height = false;
+    for (uint16_t i=0; i<=steps; i++) {
+        float height;
+        if (!batch_height(path_location(start, end, i, steps), cursor, height)) {
+            ret = false;
+            continue;
+        }
+        height += correction;
+        if (heights != nullptr && i < max_heights) {
+            heights[i] = height;
+        }
+        if (!have_height || height > max_height) {
+            max_height = height;
+            have_height = true;
+        }
+    }
+    return ret;
 }
 
 
@@ -275,16 +423,17 @@ float AP_Terrain::lookahead(float bearing, float distance, float climb_ratio)
         return 0;
     }
 
-    float climb = 0;
     float lookahead_estimate = 0;
 
     // check for terrain at grid spacing intervals
-    while (distance > 0) {
-        loc.offset_bearing(bearing, grid_spacing);
-        climb += climb_ratio * grid_spacing;
-        distance -= grid_spacing;
+    const uint16_t steps = MIN(ceilf(MAX(distance, 0) / grid_spacing), float(UINT16_MAX));
+    Location end = loc;
+    end.offset_bearing(bearing, steps * (float)grid_spacing);
+    struct batch_cursor cursor {};
+    for (uint32_t i=1; i<=steps; i++) {
+        const float climb = climb_ratio * grid_spacing * i;
         float height;
-        if (height_amsl(loc, height, false)) {
+        if (batch_height(path_location(loc, end, i, steps), cursor, height)) {
             float rise = (height - base_height) - climb;
             if (rise > lookahead_estimate) {
                 lookahead_estimate = rise;
@@ -29,6 +29,7 @@
 
 #include <AP_Param/AP_Param.h>
 #include <AP_Mission/AP_Mission.h>
+#include "TerrainTile.h"
 
 #define TERRAIN_DEBUG 0
 
@@ -62,6 +63,23 @@
 // different programming languages
 #define TERRAIN_LATLON_EQUAL(v1, v2) (labs((v1)-(v2)) <= 2)
 
+#if AP_TERRAIN_TILE_ENABLED
+// number of degree tiles kept mapped, LRU
+#ifndef TERRAIN_TILE_SLOTS
+#define TERRAIN_TILE_SLOTS 4
+#endif
+
+// grid blocks read from a DAT file per IO timer call while importing
+#ifndef TERRAIN_TILE_IMPORT_BLOCKS
+#define TERRAIN_TILE_IMPORT_BLOCKS 16
+#endif
+
+// DAT files imported per boot, any left over are imported on the next
+#ifndef TERRAIN_TILE_IMPORT_MAX
+#define TERRAIN_TILE_IMPORT_MAX 32
+#endif
+#endif
+
 #if TERRAIN_DEBUG
 #include <assert.h>
 #define ASSERT_RANGE(v,minv,maxv) assert((v)<=(maxv)&&(v)>=(minv))
@@ -80,6 +98,8 @@
  */
 
 class AP_Terrain {
+    friend class AP_Terrain_Test;
+
 public:
     AP_Terrain(const AP_Mission &_mission);
 
@@ -126,6 +146,30 @@ public:
      */
     bool height_amsl(const Location &loc, float &height, bool corrected);
 
+    /*
+      find the terrain heights in meters above sea level for an array
+      of locations. Consecutive locations in the same grid block share
+      one cache search, so order them along the path being checked.
+
+      return false if any location has no data, leaving its height
+      unchanged
+     */
+    bool height_amsl(const Location *locs, uint16_t count, float *heights, bool corrected);
+
+    /*
+      sample the terrain every spacing meters along the straight line
+      from start to end, including both ends, and find the highest
+      terrain in meters above sea level. A spacing of zero uses the
+      grid spacing. The samples are also written to heights if it is
+      given, up to max_heights of them.
+
+      return false if any sample has no data, with max_height from the
+      samples that do
+     */
+    bool height_amsl_max(const Location &start, const Location &end, float spacing,
+                         float &max_height, bool corrected,
+                         float *heights = nullptr, uint16_t max_heights = 0);
+
     /* 
        find difference between home terrain height and the terrain
        height at the current location in meters. A positive result
@@ -289,6 +333,39 @@ private:
     // given a location, fill a grid_info structure
     void calculate_grid_info(const Location &loc, struct grid_info &info) const;
 
+    // fill the grid and square indexes of a grid_info from the offset
+    // in meters from the SW corner of its degree
+    void calculate_grid_index(const Vector2f &offset, struct grid_info &info) const;
+
+    // fill the SW corner of the grid block of a grid_info
+    void calculate_grid_corner(struct grid_info &info) const;
+
+    /*
+      height at a grid_info from its grid block, false if the block
+      isn't loaded or is missing one of the four points
+     */
+    bool grid_height(const struct grid_block &grid, const struct grid_info &info, float &height);
+
+    /*
+      state kept across a batch of lookups, so points in the same
+      degree and grid block as the one before skip the trig and the
+      cache search
+     */
+    struct batch_cursor {
+        bool valid;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+        // meters per 1e-7 degree north and east in this degree
+        Vector2f scale;
+        const struct grid_cache *gcache;
+        uint16_t grid_idx_x;
+        uint16_t grid_idx_y;
+#if AP_TERRAIN_TILE_ENABLED
+        const AP_Terrain_Tile *tile;
+#endif
+    };
+    bool batch_height(const Location &loc, struct batch_cursor &cursor, float &height);
+
     /*
       find a grid structure given a grid_info
     */
@@ -336,6 +413,22 @@ private:
     void write_block(void);
     void read_block(void);
 
+#if AP_TERRAIN_TILE_ENABLED
+    /*
+      tile functions. find_tile() and the tile_*() lookups run in the
+      main thread, check_tile_io() and the import in the IO thread
+     */
+    const AP_Terrain_Tile *find_tile(int8_t lat_degrees, int16_t lon_degrees);
+    bool tile_height(const AP_Terrain_Tile *tile, const struct grid_info &info, float &height) const;
+    bool tile_has_block(const struct grid_info &info);
+    void check_tile_io(void);
+    void import_tiles(void);
+    void import_scan(void);
+    bool import_next_file(void);
+    void import_blocks(void);
+    char *degree_file_path(int8_t lat_degrees, int16_t lon_degrees, const char *ext) const;
+#endif
+
     /*
       check for missing mission terrain data
      */
@@ -354,6 +447,7 @@ private:
 
     enum class Options {
         DisableDownload = (1U<<0),
+        ImportTiles     = (1U<<1),
     };
 
     // reference to AP_Mission, so we can ask preload terrain data for 
@@ -410,9 +504,6 @@ private:
     // next mission command to check
     uint16_t next_mission_index;
 
-    // next mission position to check
-    uint8_t next_mission_pos;
-
     // last time the mission changed
     uint32_t last_mission_change_ms;
 
@@ -430,6 +521,47 @@ private:
 
     char *file_path = nullptr;
 
+#if AP_TERRAIN_TILE_ENABLED
+    /*
+      degree tiles mapped by the IO thread. The IO thread owns a slot
+      while it is TILE_WANTED, the main thread in the other states
+     */
+    enum TileState {
+        TILE_EMPTY   = 0, // slot unused
+        TILE_WANTED  = 1, // waiting for check_tile_io()
+        TILE_MAPPED  = 2, // tile usable
+        TILE_MISSING = 3  // no usable tile file for this degree
+    };
+    struct tile_slot {
+        AP_Terrain_Tile tile;
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+        uint16_t spacing;
+        uint8_t state; // TileState, accessed atomically
+        uint32_t last_access_ms;
+    } tiles[TERRAIN_TILE_SLOTS];
+
+    // import of DAT files into tiles, owned by the IO thread
+    bool import_done;
+    bool import_scanned;
+    struct {
+        int8_t lat_degrees;
+        int16_t lon_degrees;
+    } import_list[TERRAIN_TILE_IMPORT_MAX];
+    uint8_t import_list_len;
+    uint8_t import_list_next;
+    int import_fd = -1;
+    AP_Terrain_Tile import_tile;
+    char *import_path;
+    int8_t import_lat_degrees;
+    int16_t import_lon_degrees;
+    uint16_t import_spacing;
+    uint16_t import_count;
+
+    // set by the IO thread after an import so MISSING tiles are retried
+    volatile bool tiles_imported;
+#endif
+
     // status
     enum TerrainStatus system_status = TerrainStatusDisabled;
 
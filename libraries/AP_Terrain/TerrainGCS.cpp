@@ -79,6 +79,13 @@ bool AP_Terrain::request_missing(mavlink_channel_t chan, struct grid_cache &gcac
  */
 bool AP_Terrain::request_missing(mavlink_channel_t chan, const struct grid_info &info)
 {
+#if AP_TERRAIN_TILE_ENABLED
+    if (tile_has_block(info)) {
+        // the tile already has every point of the block
+        return false;
+    }
+#endif
+
     // find the grid
     struct grid_cache &gcache = find_grid_cache(info);
     return request_missing(chan, gcache);
@@ -336,11 +336,215 @@ void AP_Terrain::read_block(void)
     disk_io_state = DiskIoDoneRead;
 }
 
+#if AP_TERRAIN_TILE_ENABLED
+/*
+  path of the file for a degree square in the terrain directory with
+  the given extension. The caller frees it
+ */
+char *AP_Terrain::degree_file_path(int8_t lat_degrees, int16_t lon_degrees, const char *ext) const
+{
+    const char* terrain_dir = hal.util->get_custom_terrain_directory();
+    if (terrain_dir == nullptr) {
+        terrain_dir = HAL_BOARD_TERRAIN_DIRECTORY;
+    }
+    char *path = nullptr;
+    if (asprintf(&path, "%s/%c%02u%c%03u.%s", terrain_dir,
+                 lat_degrees<0?'S':'N',
+                 (unsigned)abs((int32_t)lat_degrees),
+                 lon_degrees<0?'W':'E',
+                 (unsigned)abs((int32_t)lon_degrees),
+                 ext) <= 0) {
+        return nullptr;
+    }
+    return path;
+}
+
+/*
+  map the tiles the main thread has asked for
+ */
+void AP_Terrain::check_tile_io(void)
+{
+    for (uint8_t i=0; i<TERRAIN_TILE_SLOTS; i++) {
+        struct tile_slot &slot = tiles[i];
+        if (__atomic_load_n(&slot.state, __ATOMIC_ACQUIRE) != TILE_WANTED) {
+            continue;
+        }
+        char *path = degree_file_path(slot.lat_degrees, slot.lon_degrees, "TIL");
+        const bool mapped = path != nullptr &&
+            slot.tile.map(path, slot.lat_degrees, slot.lon_degrees, slot.spacing);
+        free(path);
+        __atomic_store_n(&slot.state, mapped ? TILE_MAPPED : TILE_MISSING, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+  convert the DAT files in the terrain directory into tiles, once per
+  boot. A DAT file is read a few blocks per call so the IO timer keeps
+  servicing grid cache reads and writes while importing
+ */
+void AP_Terrain::import_tiles(void)
+{
+    if (import_done || !(options.get() & uint16_t(Options::ImportTiles))) {
+        return;
+    }
+    if (import_fd == -1 && !import_next_file()) {
+        import_done = true;
+        if (import_count > 0) {
+            GCS_SEND_TEXT(MAV_SEVERITY_INFO, "Terrain: imported %u tiles", (unsigned)import_count);
+            tiles_imported = true;
+        }
+        return;
+    }
+    import_blocks();
+}
+
+/*
+  list the DAT files in the terrain directory that have no up to date
+  tile at the current grid spacing
+ */
+void AP_Terrain::import_scan(void)
+{
+    const char* terrain_dir = hal.util->get_custom_terrain_directory();
+    if (terrain_dir == nullptr) {
+        terrain_dir = HAL_BOARD_TERRAIN_DIRECTORY;
+    }
+    auto *d = AP::FS().opendir(terrain_dir);
+    if (d == nullptr) {
+        return;
+    }
+
+    struct dirent *de;
+    while (import_list_len < ARRAY_SIZE(import_list) &&
+           (de = AP::FS().readdir(d)) != nullptr) {
+        // names are like S35E149.DAT
+        char ns, ew;
+        unsigned lat, lon;
+        if (strlen(de->d_name) != 11 ||
+            strcmp(&de->d_name[7], ".DAT") != 0 ||
+            sscanf(de->d_name, "%c%2u%c%3u", &ns, &lat, &ew, &lon) != 4 ||
+            (ns != 'N' && ns != 'S') ||
+            (ew != 'E' && ew != 'W') ||
+            lat > 90 || lon > 180) {
+            continue;
+        }
+        const int8_t lat_degrees = ns == 'S' ? -int8_t(lat) : int8_t(lat);
+        const int16_t lon_degrees = ew == 'W' ? -int16_t(lon) : int16_t(lon);
+
+        char *dat_path = degree_file_path(lat_degrees, lon_degrees, "DAT");
+        char *til_path = degree_file_path(lat_degrees, lon_degrees, "TIL");
+        struct stat dat_st, til_st;
+        bool wanted = dat_path != nullptr && til_path != nullptr &&
+            AP::FS().stat(dat_path, &dat_st) == 0;
+        if (wanted &&
+            AP::FS().stat(til_path, &til_st) == 0 &&
+            til_st.st_mtime >= dat_st.st_mtime &&
+            import_tile.map(til_path, lat_degrees, lon_degrees, grid_spacing)) {
+            // already imported at this spacing
+            wanted = false;
+        }
+        import_tile.release();
+        free(dat_path);
+        free(til_path);
+        if (wanted) {
+            import_list[import_list_len].lat_degrees = lat_degrees;
+            import_list[import_list_len].lon_degrees = lon_degrees;
+            import_list_len++;
+        }
+    }
+    AP::FS().closedir(d);
+}
+
+/*
+  open the next DAT file to import, returning false when there are
+  none left
+ */
+bool AP_Terrain::import_next_file(void)
+{
+    if (!import_scanned) {
+        import_scanned = true;
+        import_scan();
+    }
+
+    while (import_list_next < import_list_len) {
+        const int8_t lat_degrees = import_list[import_list_next].lat_degrees;
+        const int16_t lon_degrees = import_list[import_list_next].lon_degrees;
+        import_list_next++;
+
+        char *dat_path = degree_file_path(lat_degrees, lon_degrees, "DAT");
+        char *til_path = degree_file_path(lat_degrees, lon_degrees, "TIL");
+        if (dat_path != nullptr && til_path != nullptr &&
+            import_tile.create(lat_degrees, lon_degrees, grid_spacing)) {
+            import_fd = AP::FS().open(dat_path, O_RDONLY);
+        }
+        free(dat_path);
+        if (import_fd == -1) {
+            import_tile.release();
+            free(til_path);
+            continue;
+        }
+        import_path = til_path;
+        import_lat_degrees = lat_degrees;
+        import_lon_degrees = lon_degrees;
+        import_spacing = grid_spacing;
+        return true;
+    }
+    return false;
+}
+
+/*
+  copy the next few blocks of the DAT file being imported into the
+  tile, saving the tile at the end of the file
+ */
+void AP_Terrain::import_blocks(void)
+{
+    union grid_io_block io;
+    struct grid_block &block = io.block;
+
+    for (uint8_t n=0; n<TERRAIN_TILE_IMPORT_BLOCKS; n++) {
+        if (AP::FS().read(import_fd, &io, sizeof(io)) != sizeof(io)) {
+            // end of the file
+            AP::FS().close(import_fd);
+            import_fd = -1;
+            if (import_tile.points() > 0 && import_tile.save(import_path)) {
+                import_count++;
+            }
+            import_tile.release();
+            free(import_path);
+            import_path = nullptr;
+            return;
+        }
+        // skip the holes and any blocks a different spacing left
+        if (block.bitmap == 0 ||
+            block.spacing != import_spacing ||
+            block.version != TERRAIN_GRID_FORMAT_VERSION ||
+            block.lat_degrees != import_lat_degrees ||
+            block.lon_degrees != import_lon_degrees ||
+            block.crc != get_block_crc(block)) {
+            continue;
+        }
+        const uint32_t base_x = block.grid_idx_x * TERRAIN_GRID_BLOCK_SPACING_X;
+        const uint32_t base_y = block.grid_idx_y * TERRAIN_GRID_BLOCK_SPACING_Y;
+        for (uint8_t x=0; x<TERRAIN_GRID_BLOCK_SIZE_X; x++) {
+            for (uint8_t y=0; y<TERRAIN_GRID_BLOCK_SIZE_Y; y++) {
+                if (check_bitmap(block, x, y)) {
+                    import_tile.set(base_x + x, base_y + y, block.height[x][y]);
+                }
+            }
+        }
+    }
+}
+#endif // AP_TERRAIN_TILE_ENABLED
+
 /*
   timer called to do disk IO
  */
 void AP_Terrain::io_timer(void)
 {
+#if AP_TERRAIN_TILE_ENABLED
+    // mapping tiles doesn't wait on the DAT file state machine
+    check_tile_io();
+#endif
+
     if (io_failure) {
         // retry the IO every 5s to allow for remount of sdcard
         uint32_t now = AP_HAL::millis();
@@ -376,6 +580,10 @@ void AP_Terrain::io_timer(void)
         read_block();
         break;
     }
+
+#if AP_TERRAIN_TILE_ENABLED
+    import_tiles();
+#endif
 }
 
 #endif // AP_TERRAIN_AVAILABLE
@@ -38,7 +38,6 @@ void AP_Terrain::update_mission_data(void)
         last_mission_spacing != grid_spacing) {
         // the mission has changed - start again
         next_mission_index = 1;
-        next_mission_pos = 0;
         last_mission_change_ms = mission.last_change_time_ms();
         last_mission_spacing = grid_spacing;
     }
@@ -54,9 +53,9 @@ void AP_Terrain::update_mission_data(void)
         return;
     }
 
-    // don't do more than 20 waypoints at a time, to prevent too much
-    // CPU usage
-    for (uint8_t i=0; i<20; i++) {
+    // don't do more than 4 waypoints (20 points) at a time, to
+    // prevent too much CPU usage
+    for (uint8_t i=0; i<4; i++) {
         // get next mission command
         AP_Mission::Mission_Command cmd;
         if (!mission.read_cmd_from_storage(next_mission_index, cmd)) {
@@ -74,36 +73,35 @@ void AP_Terrain::update_mission_data(void)
             if (!mission.read_cmd_from_storage(next_mission_index, cmd)) {
                 // nothing more to do
                 next_mission_index = 0;
-                next_mission_pos = 0;
                 return;
             }
         }
 
         // we will fetch 5 points around the waypoint. Four at 10 grid
         // spacings away at 45, 135, 225 and 315 degrees, and the
-        // point itself
-        if (next_mission_pos != 4) {
-            cmd.content.location.offset_bearing(45+90*next_mission_pos, grid_spacing.get() * 10);
+        // point itself. They are looked up together so points in the
+        // same grid block share one cache search
+        Location locs[5];
+        for (uint8_t pos=0; pos<4; pos++) {
+            locs[pos] = cmd.content.location;
+            locs[pos].offset_bearing(45+90*pos, grid_spacing.get() * 10);
         }
+        locs[4] = cmd.content.location;
 
         // we have a mission command to check
-        float height;
-        if (!height_amsl(cmd.content.location, height, false)) {
+        float heights[ARRAY_SIZE(locs)];
+        if (!height_amsl(locs, ARRAY_SIZE(locs), heights, false)) {
             // if we can't get data for a mission item then return and
             // check again next time
             return;
         }
 
-        next_mission_pos++;
-        if (next_mission_pos == 5) {
 #if TERRAIN_DEBUG
-            hal.console->printf("checked waypoint %u\n", (unsigned)next_mission_index);
+        hal.console->printf("checked waypoint %u\n", (unsigned)next_mission_index);
 #endif
 
-            // move to next waypoint
-            next_mission_index++;
-            next_mission_pos = 0;
-        }
+        // move to next waypoint
+        next_mission_index++;
     }
 }
 
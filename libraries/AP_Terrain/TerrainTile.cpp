@@ -0,0 +1,270 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  memory mapped terrain tiles
+ */
+
+#include "TerrainTile.h"
+
+#if AP_TERRAIN_TILE_ENABLED
+
+#include <AP_Common/Location.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(sizeof(AP_Terrain_Tile::header) == 64, "terrain tile header must be 64 bytes");
+
+/*
+  number of grid points north and east in the tile for a degree square
+ */
+void AP_Terrain_Tile::dimensions(int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing, uint16_t &rows, uint16_t &cols)
+{
+    Location ref;
+    ref.lat = lat_degrees*10*1000*1000L;
+    ref.lng = lon_degrees*10*1000*1000L;
+    Location north = ref;
+    north.lat += 10*1000*1000L;
+    Location east = ref;
+    east.lng += 10*1000*1000L;
+
+    // measured from the south west corner the same way as
+    // AP_Terrain::calculate_grid_info() so the indexes agree
+    rows = MIN(ref.get_distance_NE(north).x / spacing + 2, float(UINT16_MAX));
+    cols = MIN(ref.get_distance_NE(east).y / spacing + 2, float(UINT16_MAX));
+}
+
+/*
+  map a tile file read only
+ */
+bool AP_Terrain_Tile::map(const char *path, int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing)
+{
+    release();
+
+    if (spacing == 0) {
+        return false;
+    }
+
+    const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(header)) {
+        ::close(fd);
+        return false;
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    const header &hdr = *(const header *)p;
+    uint16_t rows, cols;
+    dimensions(lat_degrees, lon_degrees, spacing, rows, cols);
+    if (hdr.magic != TERRAIN_TILE_MAGIC ||
+        hdr.version != TERRAIN_TILE_VERSION ||
+        hdr.header_size < sizeof(header) ||
+        (hdr.header_size & 1) != 0 ||
+        hdr.spacing != spacing ||
+        hdr.lat_degrees != lat_degrees ||
+        hdr.lon_degrees != lon_degrees ||
+        hdr.rows != rows ||
+        hdr.cols != cols ||
+        st.st_size != (off_t)(hdr.header_size + uint32_t(rows) * cols * sizeof(int16_t))) {
+        munmap(p, st.st_size);
+        return false;
+    }
+
+    // lookups follow the vehicle, not the file order
+    madvise(p, st.st_size, MADV_RANDOM);
+
+    _base = (uint8_t *)p;
+    _size = st.st_size;
+    _mapped = true;
+    _heights = (int16_t *)(_base + hdr.header_size);
+    _rows = rows;
+    _cols = cols;
+    return true;
+}
+
+/*
+  allocate a tile in memory with no data
+ */
+bool AP_Terrain_Tile::create(int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing)
+{
+    release();
+
+    if (spacing == 0) {
+        return false;
+    }
+
+    uint16_t rows, cols;
+    dimensions(lat_degrees, lon_degrees, spacing, rows, cols);
+    const size_t size = sizeof(header) + size_t(rows) * cols * sizeof(int16_t);
+    if (size > TERRAIN_TILE_MAX_BYTES) {
+        return false;
+    }
+    _base = (uint8_t *)malloc(size);
+    if (_base == nullptr) {
+        return false;
+    }
+    _size = size;
+    _mapped = false;
+    _heights = (int16_t *)(_base + sizeof(header));
+    _rows = rows;
+    _cols = cols;
+
+    header &hdr = *(header *)_base;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = TERRAIN_TILE_MAGIC;
+    hdr.version = TERRAIN_TILE_VERSION;
+    hdr.header_size = sizeof(header);
+    hdr.spacing = spacing;
+    hdr.lat_degrees = lat_degrees;
+    hdr.lon_degrees = lon_degrees;
+    hdr.rows = rows;
+    hdr.cols = cols;
+
+    for (uint32_t i=0; i<uint32_t(rows)*cols; i++) {
+        _heights[i] = TERRAIN_TILE_NO_DATA;
+    }
+    return true;
+}
+
+/*
+  unmap or free the tile
+ */
+void AP_Terrain_Tile::release(void)
+{
+    if (_base != nullptr) {
+        if (_mapped) {
+            munmap(_base, _size);
+        } else {
+            free(_base);
+        }
+    }
+    _base = nullptr;
+    _size = 0;
+    _mapped = false;
+    _heights = nullptr;
+    _rows = 0;
+    _cols = 0;
+}
+
+/*
+  set the height of one grid point
+ */
+void AP_Terrain_Tile::set(uint32_t idx_x, uint32_t idx_y, int16_t height)
+{
+    if (_mapped || _heights == nullptr || idx_x >= _rows || idx_y >= _cols) {
+        return;
+    }
+    int16_t &h = _heights[idx_x*_cols + idx_y];
+    header &hdr = *(header *)_base;
+    if (h == TERRAIN_TILE_NO_DATA && height != TERRAIN_TILE_NO_DATA) {
+        hdr.points++;
+    } else if (h != TERRAIN_TILE_NO_DATA && height == TERRAIN_TILE_NO_DATA) {
+        hdr.points--;
+    }
+    h = height;
+}
+
+/*
+  write the tile to a temporary file then rename it over path
+ */
+bool AP_Terrain_Tile::save(const char *path)
+{
+    if (_mapped || _base == nullptr) {
+        return false;
+    }
+    char *tmp_path = nullptr;
+    if (asprintf(&tmp_path, "%s.tmp", path) <= 0) {
+        return false;
+    }
+    const int fd = ::open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        free(tmp_path);
+        return false;
+    }
+    size_t ofs = 0;
+    while (ofs < _size) {
+        const ssize_t ret = ::write(fd, &_base[ofs], _size - ofs);
+        if (ret <= 0) {
+            break;
+        }
+        ofs += ret;
+    }
+    const bool ok = ofs == _size && fsync(fd) == 0;
+    ::close(fd);
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return false;
+    }
+    free(tmp_path);
+    return true;
+}
+
+/*
+  interpolated height within the square north east of grid point
+  (idx_x,idx_y)
+ */
+bool AP_Terrain_Tile::height(uint32_t idx_x, uint32_t idx_y, float frac_x, float frac_y, float &height) const
+{
+    if (_heights == nullptr || idx_x+1 >= _rows || idx_y+1 >= _cols) {
+        return false;
+    }
+    const int16_t *h0 = &_heights[idx_x*_cols + idx_y];
+    const int16_t *h1 = h0 + _cols;
+    if (h0[0] == TERRAIN_TILE_NO_DATA ||
+        h0[1] == TERRAIN_TILE_NO_DATA ||
+        h1[0] == TERRAIN_TILE_NO_DATA ||
+        h1[1] == TERRAIN_TILE_NO_DATA) {
+        return false;
+    }
+
+    // the same dual linear interpolation as AP_Terrain::grid_height()
+    const float avg1 = (1.0f-frac_x) * h0[0] + frac_x * h1[0];
+    const float avg2 = (1.0f-frac_x) * h0[1] + frac_x * h1[1];
+    height = (1.0f-frac_y) * avg1 + frac_y * avg2;
+    return true;
+}
+
+/*
+  check a patch of grid points all have data
+ */
+bool AP_Terrain_Tile::has_data(uint32_t idx_x, uint32_t idx_y, uint16_t size_x, uint16_t size_y) const
+{
+    if (_heights == nullptr || idx_x+size_x > _rows || idx_y+size_y > _cols) {
+        return false;
+    }
+    for (uint16_t x=0; x<size_x; x++) {
+        const int16_t *row = &_heights[(idx_x+x)*_cols + idx_y];
+        for (uint16_t y=0; y<size_y; y++) {
+            if (row[y] == TERRAIN_TILE_NO_DATA) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+#endif // AP_TERRAIN_TILE_ENABLED
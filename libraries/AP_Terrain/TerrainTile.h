@@ -0,0 +1,122 @@
+/*
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/*
+  fixed layout terrain tiles, one per degree square, that are memory
+  mapped rather than read a block at a time.
+
+  A tile file NxxExxx.TIL is a header followed by the heights of every
+  grid point in the degree as int16_t, north rows of east points. Grid
+  point (x,y) is x*spacing north and y*spacing east of the south west
+  corner of the degree, the same indexing AP_Terrain uses for its grid
+  blocks, so the height at any location is found with one multiply.
+  Points without data hold TERRAIN_TILE_NO_DATA.
+ */
+#pragma once
+
+#include <AP_HAL/AP_HAL_Boards.h>
+#include <AP_Common/AP_Common.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef AP_TERRAIN_TILE_ENABLED
+#define AP_TERRAIN_TILE_ENABLED (CONFIG_HAL_BOARD == HAL_BOARD_LINUX || CONFIG_HAL_BOARD == HAL_BOARD_SITL)
+#endif
+
+#if AP_TERRAIN_TILE_ENABLED
+
+#define TERRAIN_TILE_MAGIC      0x4c495441 // "ATIL"
+#define TERRAIN_TILE_VERSION    1
+#define TERRAIN_TILE_NO_DATA    INT16_MIN
+
+// largest tile built in memory, 64MB is a 14m grid spacing at the equator
+#ifndef TERRAIN_TILE_MAX_BYTES
+#define TERRAIN_TILE_MAX_BYTES (64*1024*1024UL)
+#endif
+
+class AP_Terrain_Tile {
+public:
+    AP_Terrain_Tile() {}
+    ~AP_Terrain_Tile() { release(); }
+
+    /* Do not allow copies */
+    CLASS_NO_COPY(AP_Terrain_Tile);
+
+    struct PACKED header {
+        uint32_t magic;
+        uint16_t version;
+        // offset of the heights from the start of the file
+        uint16_t header_size;
+        // grid spacing in meters
+        uint16_t spacing;
+        // south west corner in degrees
+        int16_t lon_degrees;
+        int8_t lat_degrees;
+        uint8_t reserved1;
+        // number of grid points north and east
+        uint16_t rows;
+        uint16_t cols;
+        // number of grid points holding data
+        uint32_t points;
+        uint8_t reserved2[42];
+    };
+
+    // number of grid points north and east in the tile for a degree
+    // square. One point past the far edges is included so every
+    // location in the degree has all four neighbours
+    static void dimensions(int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing, uint16_t &rows, uint16_t &cols);
+
+    // map a tile file read only, returning false if it is missing or
+    // doesn't match the degree square and spacing
+    bool map(const char *path, int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing);
+
+    // allocate a tile in memory with no data, to be filled and saved
+    bool create(int8_t lat_degrees, int16_t lon_degrees, uint16_t spacing);
+
+    // unmap or free the tile
+    void release(void);
+
+    bool valid(void) const { return _heights != nullptr; }
+    uint16_t rows(void) const { return _rows; }
+    uint16_t cols(void) const { return _cols; }
+
+    // number of grid points holding data
+    uint32_t points(void) const { return _base != nullptr ? ((const header *)_base)->points : 0; }
+
+    // set the height of one grid point of a tile from create()
+    void set(uint32_t idx_x, uint32_t idx_y, int16_t height);
+
+    // write a tile from create() to path, replacing any existing file
+    // in one step so a mapped copy never sees a partial tile
+    bool save(const char *path);
+
+    // interpolated height at a fraction of the way from grid point
+    // (idx_x,idx_y) to the next point north and east. False if any of
+    // the four points has no data
+    bool height(uint32_t idx_x, uint32_t idx_y, float frac_x, float frac_y, float &height) const;
+
+    // true if every point of the size_x by size_y patch starting at
+    // (idx_x,idx_y) has data
+    bool has_data(uint32_t idx_x, uint32_t idx_y, uint16_t size_x, uint16_t size_y) const;
+
+private:
+    uint8_t *_base = nullptr;
+    size_t _size;
+    bool _mapped;
+    int16_t *_heights = nullptr;
+    uint16_t _rows;
+    uint16_t _cols;
+};
+
+#endif // AP_TERRAIN_TILE_ENABLED
@@ -73,6 +73,16 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
     // find offset from reference
     const Vector2f offset = ref.get_distance_NE(loc);
 
+    calculate_grid_index(offset, info);
+    calculate_grid_corner(info);
+}
+
+/*
+  given the offset from the SW corner of the degree, calculate the
+  32x28 grid indices
+*/
+void AP_Terrain::calculate_grid_index(const Vector2f &offset, struct grid_info &info) const
+{
     // get indices in terms of grid_spacing elements
     uint32_t idx_x = offset.x / grid_spacing;
     uint32_t idx_y = offset.y / grid_spacing;
@@ -91,18 +101,26 @@ void AP_Terrain::calculate_grid_info(const Location &loc, struct grid_info &info
     info.frac_x = (offset.x - idx_x * grid_spacing) / grid_spacing;
     info.frac_y = (offset.y - idx_y * grid_spacing) / grid_spacing;
 
-    // calculate lat/lon of SW corner of 32*28 grid_block
-    ref.offset(info.grid_idx_x * TERRAIN_GRID_BLOCK_SPACING_X * (float)grid_spacing,
-               info.grid_idx_y * TERRAIN_GRID_BLOCK_SPACING_Y * (float)grid_spacing);
-    info.grid_lat = ref.lat;
-    info.grid_lon = ref.lng;
-
     ASSERT_RANGE(info.idx_x,0,TERRAIN_GRID_BLOCK_SPACING_X-1);
     ASSERT_RANGE(info.idx_y,0,TERRAIN_GRID_BLOCK_SPACING_Y-1);
     ASSERT_RANGE(info.frac_x,0,1);
     ASSERT_RANGE(info.frac_y,0,1);
 }
 
+/*
+  calculate lat/lon of SW corner of the 32*28 grid_block of a grid_info
+*/
+void AP_Terrain::calculate_grid_corner(struct grid_info &info) const
+{
+    Location ref;
+    ref.lat = info.lat_degrees*10*1000*1000L;
+    ref.lng = info.lon_degrees*10*1000*1000L;
+    ref.offset(info.grid_idx_x * TERRAIN_GRID_BLOCK_SPACING_X * (float)grid_spacing,
+               info.grid_idx_y * TERRAIN_GRID_BLOCK_SPACING_Y * (float)grid_spacing);
+    info.grid_lat = ref.lat;
+    info.grid_lon = ref.lng;
+}
+
 
 /*
   find a grid structure given a grid_info
@@ -145,6 +163,84 @@ AP_Terrain::grid_cache &AP_Terrain::find_grid_cache(const struct grid_info &info
     return grid;
 }
 
+#if AP_TERRAIN_TILE_ENABLED
+/*
+  find the mapped tile for a degree square, asking the IO thread to
+  map it if it isn't in a slot. Returns nullptr until it is mapped
+ */
+const AP_Terrain_Tile *AP_Terrain::find_tile(int8_t lat_degrees, int16_t lon_degrees)
+{
+    if (tiles_imported) {
+        // new tile files may cover degrees that had none
+        tiles_imported = false;
+        for (uint8_t i=0; i<TERRAIN_TILE_SLOTS; i++) {
+            if (__atomic_load_n(&tiles[i].state, __ATOMIC_ACQUIRE) == TILE_MISSING) {
+                __atomic_store_n(&tiles[i].state, TILE_EMPTY, __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    const uint32_t now = AP_HAL::millis();
+    int8_t oldest_i = -1;
+    for (uint8_t i=0; i<TERRAIN_TILE_SLOTS; i++) {
+        struct tile_slot &slot = tiles[i];
+        const uint8_t state = __atomic_load_n(&slot.state, __ATOMIC_ACQUIRE);
+        if (state != TILE_EMPTY &&
+            slot.lat_degrees == lat_degrees &&
+            slot.lon_degrees == lon_degrees &&
+            slot.spacing == grid_spacing) {
+            slot.last_access_ms = now;
+            return state == TILE_MAPPED ? &slot.tile : nullptr;
+        }
+        if (state != TILE_WANTED &&
+            (oldest_i == -1 || slot.last_access_ms < tiles[oldest_i].last_access_ms)) {
+            oldest_i = i;
+        }
+    }
+    if (oldest_i == -1) {
+        // every slot is waiting on the IO thread
+        return nullptr;
+    }
+
+    // replace the least recently used tile
+    struct tile_slot &slot = tiles[oldest_i];
+    slot.lat_degrees = lat_degrees;
+    slot.lon_degrees = lon_degrees;
+    slot.spacing = grid_spacing;
+    slot.last_access_ms = now;
+    __atomic_store_n(&slot.state, TILE_WANTED, __ATOMIC_RELEASE);
+    return nullptr;
+}
+
+/*
+  height at a grid_info from a mapped tile
+ */
+bool AP_Terrain::tile_height(const AP_Terrain_Tile *tile, const struct grid_info &info, float &height) const
+{
+    if (tile == nullptr) {
+        return false;
+    }
+    return tile->height(info.grid_idx_x*TERRAIN_GRID_BLOCK_SPACING_X + info.idx_x,
+                        info.grid_idx_y*TERRAIN_GRID_BLOCK_SPACING_Y + info.idx_y,
+                        info.frac_x, info.frac_y, height);
+}
+
+/*
+  check if a mapped tile has every point of the grid block for a
+  grid_info
+ */
+bool AP_Terrain::tile_has_block(const struct grid_info &info)
+{
+    const AP_Terrain_Tile *tile = find_tile(info.lat_degrees, info.lon_degrees);
+    if (tile == nullptr) {
+        return false;
+    }
+    return tile->has_data(info.grid_idx_x*TERRAIN_GRID_BLOCK_SPACING_X,
+                          info.grid_idx_y*TERRAIN_GRID_BLOCK_SPACING_Y,
+                          TERRAIN_GRID_BLOCK_SIZE_X, TERRAIN_GRID_BLOCK_SIZE_Y);
+}
+#endif // AP_TERRAIN_TILE_ENABLED
+
 /*
   find cache index of disk_block
  */
@@ -0,0 +1,197 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Terrain/AP_Terrain.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if AP_TERRAIN_AVAILABLE
+
+static AP_Mission mission{nullptr, nullptr, nullptr};
+static AP_Terrain terrain{mission};
+
+#define BENCH_SPACING 100
+#define BENCH_POINTS  1000
+
+/*
+  sets up terrain data without a GCS or SD card, and looks up single
+  points the way height_amsl() does less the home altitude check,
+  which needs the AHRS
+ */
+class AP_Terrain_Test {
+public:
+    static bool setup()
+    {
+        terrain.grid_spacing.set(BENCH_SPACING);
+        if (!terrain.allocate()) {
+            return false;
+        }
+        memset(terrain.cache, 0, terrain.cache_size * sizeof(terrain.cache[0]));
+#if AP_TERRAIN_TILE_ENABLED
+        for (auto &slot : terrain.tiles) {
+            slot.tile.release();
+            slot.state = AP_Terrain::TILE_EMPTY;
+        }
+#endif
+        return true;
+    }
+
+    static void load_block(const Location &loc)
+    {
+        AP_Terrain::grid_info info;
+        terrain.calculate_grid_info(loc, info);
+        AP_Terrain::grid_cache &gcache = terrain.find_grid_cache(info);
+        gcache.last_access_ms = AP_HAL::millis() + 1;
+        if (gcache.state == AP_Terrain::GRID_CACHE_VALID) {
+            return;
+        }
+        for (uint8_t x=0; x<TERRAIN_GRID_BLOCK_SIZE_X; x++) {
+            for (uint8_t y=0; y<TERRAIN_GRID_BLOCK_SIZE_Y; y++) {
+                gcache.grid.height[x][y] = 500 + x + y;
+            }
+        }
+        gcache.grid.bitmap = AP_Terrain::bitmap_mask;
+        gcache.state = AP_Terrain::GRID_CACHE_VALID;
+    }
+
+#if AP_TERRAIN_TILE_ENABLED
+    static bool load_tile(uint8_t i, int8_t lat_degrees, int16_t lon_degrees)
+    {
+        AP_Terrain::tile_slot &slot = terrain.tiles[i];
+        if (!slot.tile.create(lat_degrees, lon_degrees, BENCH_SPACING)) {
+            return false;
+        }
+        for (uint32_t x=0; x<slot.tile.rows(); x++) {
+            for (uint32_t y=0; y<slot.tile.cols(); y++) {
+                slot.tile.set(x, y, 500 + (x + y) % 64);
+            }
+        }
+        slot.lat_degrees = lat_degrees;
+        slot.lon_degrees = lon_degrees;
+        slot.spacing = BENCH_SPACING;
+        slot.state = AP_Terrain::TILE_MAPPED;
+        return true;
+    }
+#endif
+
+    static bool height_single(const Location &loc, float &height)
+    {
+        AP_Terrain::grid_info info;
+        terrain.calculate_grid_info(loc, info);
+#if AP_TERRAIN_TILE_ENABLED
+        if (terrain.tile_height(terrain.find_tile(info.lat_degrees, info.lon_degrees), info, height)) {
+            return true;
+        }
+#endif
+        return terrain.grid_height(terrain.find_grid_cache(info).grid, info, height);
+    }
+};
+
+static Location locs[BENCH_POINTS];
+static float heights[BENCH_POINTS];
+
+/*
+  a path 5.6km NE across the east edge of a degree, sampled every 5.6m.
+  With range(0) of 1 the data comes from mapped tiles, otherwise from
+  the grid block cache
+ */
+static bool setup_path(benchmark::State& state)
+{
+    if (!AP_Terrain_Test::setup()) {
+        state.SkipWithError("terrain allocate failed");
+        return false;
+    }
+    const Location start(-355000000, 1499800000, 0, Location::AltFrame::ABSOLUTE);
+    const Location end(-354700000, 1500300000, 0, Location::AltFrame::ABSOLUTE);
+    for (uint16_t i=0; i<BENCH_POINTS; i++) {
+        locs[i] = start;
+        locs[i].lat += (end.lat - start.lat) * i / (BENCH_POINTS-1);
+        locs[i].lng += (end.lng - start.lng) * i / (BENCH_POINTS-1);
+    }
+#if AP_TERRAIN_TILE_ENABLED
+    if (state.range(0) == 1) {
+        if (!AP_Terrain_Test::load_tile(0, -36, 149) ||
+            !AP_Terrain_Test::load_tile(1, -36, 150)) {
+            state.SkipWithError("tile setup failed");
+            return false;
+        }
+        state.SetLabel("tile");
+        return true;
+    }
+#endif
+    for (uint16_t i=0; i<BENCH_POINTS; i++) {
+        AP_Terrain_Test::load_block(locs[i]);
+    }
+    state.SetLabel("grid cache");
+    return true;
+}
+
+/*
+  the path looked up a point at a time
+ */
+static void BM_TerrainPathSingle(benchmark::State& state)
+{
+    if (!setup_path(state)) {
+        return;
+    }
+    while (state.KeepRunning()) {
+        for (uint16_t i=0; i<BENCH_POINTS; i++) {
+            if (!AP_Terrain_Test::height_single(locs[i], heights[i])) {
+                state.SkipWithError("lookup failed");
+                break;
+            }
+        }
+        gbenchmark_escape(heights);
+    }
+    state.SetItemsProcessed(state.iterations() * BENCH_POINTS);
+}
+
+/*
+  the path looked up as one batch
+ */
+static void BM_TerrainPathBatch(benchmark::State& state)
+{
+    if (!setup_path(state)) {
+        return;
+    }
+    while (state.KeepRunning()) {
+        if (!terrain.height_amsl(locs, BENCH_POINTS, heights, false)) {
+            state.SkipWithError("lookup failed");
+            break;
+        }
+        gbenchmark_escape(heights);
+    }
+    state.SetItemsProcessed(state.iterations() * BENCH_POINTS);
+}
+
+/*
+  highest terrain along the same path at the grid spacing
+ */
+static void BM_TerrainPathMax(benchmark::State& state)
+{
+    if (!setup_path(state)) {
+        return;
+    }
+    float max_height;
+    while (state.KeepRunning()) {
+        if (!terrain.height_amsl_max(locs[0], locs[BENCH_POINTS-1], 0, max_height, false)) {
+            state.SkipWithError("lookup failed");
+            break;
+        }
+        gbenchmark_escape(&max_height);
+    }
+    state.SetItemsProcessed(state.iterations() * (uint32_t(locs[0].get_distance(locs[BENCH_POINTS-1]) / BENCH_SPACING) + 1));
+}
+
+#if AP_TERRAIN_TILE_ENABLED
+BENCHMARK(BM_TerrainPathSingle)->Arg(0)->Arg(1);
+BENCHMARK(BM_TerrainPathBatch)->Arg(0)->Arg(1);
+BENCHMARK(BM_TerrainPathMax)->Arg(0)->Arg(1);
+#else
+BENCHMARK(BM_TerrainPathSingle)->Arg(0);
+BENCHMARK(BM_TerrainPathBatch)->Arg(0);
+BENCHMARK(BM_TerrainPathMax)->Arg(0);
+#endif
+
+#endif // AP_TERRAIN_AVAILABLE
+
+BENCHMARK_MAIN();
@@ -0,0 +1,269 @@
+#include <AP_gbenchmark.h>
+
+#include <AP_Terrain/TerrainTile.h>
+
+const AP_HAL::HAL &hal = AP_HAL::get_HAL();
+
+#if AP_TERRAIN_TILE_ENABLED
+
+#include <AP_Math/AP_Math.h>
+#include <AP_Math/crc.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TILE_LAT     -35
+#define TILE_LON     149
+#define TILE_SPACING 100
+
+// layout of AP_Terrain::grid_block, 32x28 points overlapping by one
+// with each neighbour and padded to 2048 bytes on disk
+#define BLOCK_SIZE_X    28
+#define BLOCK_SIZE_Y    32
+#define BLOCK_SPACING_X 24
+#define BLOCK_SPACING_Y 28
+
+union dat_block {
+    struct PACKED {
+        uint64_t bitmap;
+        int32_t lat;
+        int32_t lon;
+        uint16_t crc;
+        uint16_t version;
+        uint16_t spacing;
+        int16_t height[BLOCK_SIZE_X][BLOCK_SIZE_Y];
+        uint16_t grid_idx_x;
+        uint16_t grid_idx_y;
+        int16_t lon_degrees;
+        int8_t lat_degrees;
+    } block;
+    uint8_t buffer[2048];
+};
+
+static const char *dat_path = "benchmark_terrain.DAT";
+static const char *tile_path = "benchmark_terrain.TIL";
+
+static uint16_t rows, cols;
+static uint16_t blocks_x, blocks_y;
+
+static int16_t terrain_height(uint32_t x, uint32_t y)
+{
+    return 500 + (x * 7 + y * 13) % 300;
+}
+
+static uint16_t block_crc(dat_block &b)
+{
+    const uint16_t saved_crc = b.block.crc;
+    b.block.crc = 0;
+    const uint16_t ret = crc16_ccitt((const uint8_t *)&b.block, sizeof(b.block), 0);
+    b.block.crc = saved_crc;
+    return ret;
+}
+
+/*
+  write a fully populated degree as a DAT file and as a tile
+ */
+static bool setup_files()
+{
+    if (rows != 0) {
+        return true;
+    }
+    AP_Terrain_Tile::dimensions(TILE_LAT, TILE_LON, TILE_SPACING, rows, cols);
+    blocks_x = (rows + BLOCK_SPACING_X - 1) / BLOCK_SPACING_X;
+    blocks_y = (cols + BLOCK_SPACING_Y - 1) / BLOCK_SPACING_Y;
+
+    const int fd = open(dat_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return false;
+    }
+    dat_block b {};
+    for (uint16_t gx=0; gx<blocks_x; gx++) {
+        for (uint16_t gy=0; gy<blocks_y; gy++) {
+            b.block.bitmap = (1ULL << 56) - 1;
+            b.block.version = 1;
+            b.block.spacing = TILE_SPACING;
+            b.block.grid_idx_x = gx;
+            b.block.grid_idx_y = gy;
+            b.block.lat_degrees = TILE_LAT;
+            b.block.lon_degrees = TILE_LON;
+            for (uint8_t x=0; x<BLOCK_SIZE_X; x++) {
+                for (uint8_t y=0; y<BLOCK_SIZE_Y; y++) {
+                    b.block.height[x][y] = terrain_height(gx*BLOCK_SPACING_X + x, gy*BLOCK_SPACING_Y + y);
+                }
+            }
+            b.block.crc = block_crc(b);
+            if (write(fd, &b, sizeof(b)) != sizeof(b)) {
+                close(fd);
+                return false;
+            }
+        }
+    }
+    close(fd);
+
+    AP_Terrain_Tile tile;
+    if (!tile.create(TILE_LAT, TILE_LON, TILE_SPACING)) {
+        return false;
+    }
+    for (uint32_t x=0; x<rows; x++) {
+        for (uint32_t y=0; y<cols; y++) {
+            tile.set(x, y, terrain_height(x, y));
+        }
+    }
+    return tile.save(tile_path);
+}
+
+/*
+  interpolated lookups at random points of a mapped tile
+ */
+static void BM_TerrainTileLookup(benchmark::State& state)
+{
+    AP_Terrain_Tile tile;
+    if (!setup_files() || !tile.map(tile_path, TILE_LAT, TILE_LON, TILE_SPACING)) {
+        state.SkipWithError("tile setup failed");
+        return;
+    }
+    uint32_t n = 0;
+    float height = 0;
+    while (state.KeepRunning()) {
+        n = n * 1664525U + 1013904223U;
+        tile.height((n >> 8) % (rows-1), (n >> 4) % (cols-1), 0.3f, 0.6f, height);
+        gbenchmark_escape(&height);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TerrainTileLookup);
+
+/*
+  what a grid cache miss costs on the DAT path before the lookup can
+  be made: seek, read and crc of one 2k block
+ */
+static void BM_TerrainDATBlockRead(benchmark::State& state)
+{
+    if (!setup_files()) {
+        state.SkipWithError("DAT setup failed");
+        return;
+    }
+    const int fd = open(dat_path, O_RDONLY);
+    dat_block b;
+    uint32_t n = 0;
+    while (state.KeepRunning()) {
+        n = n * 1664525U + 1013904223U;
+        const uint32_t blocknum = (n >> 8) % (uint32_t(blocks_x) * blocks_y);
+        lseek(fd, blocknum * sizeof(b), SEEK_SET);
+        if (read(fd, &b, sizeof(b)) != sizeof(b) || block_crc(b) != b.block.crc) {
+            state.SkipWithError("bad block");
+            break;
+        }
+        gbenchmark_escape(&b);
+    }
+    close(fd);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TerrainDATBlockRead);
+
+/*
+  make a square region of blocks around the middle of the degree
+  available, from the DAT file block by block. The argument is the
+  number of blocks along each side
+ */
+static void BM_TerrainRegionLoadDAT(benchmark::State& state)
+{
+    if (!setup_files()) {
+        state.SkipWithError("DAT setup failed");
+        return;
+    }
+    const uint16_t side = state.range(0);
+    dat_block b;
+    while (state.KeepRunning()) {
+        const int fd = open(dat_path, O_RDONLY);
+        for (uint16_t gx=blocks_x/2; gx<blocks_x/2+side; gx++) {
+            for (uint16_t gy=blocks_y/2; gy<blocks_y/2+side; gy++) {
+                lseek(fd, (uint32_t(gx) * blocks_y + gy) * sizeof(b), SEEK_SET);
+                if (read(fd, &b, sizeof(b)) != sizeof(b) || block_crc(b) != b.block.crc) {
+                    state.SkipWithError("bad block");
+                }
+                gbenchmark_escape(&b);
+            }
+        }
+        close(fd);
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+
+BENCHMARK(BM_TerrainRegionLoadDAT)->Arg(3)->Arg(10);
+
+/*
+  the same region from a tile, mapping it and touching every block
+ */
+static void BM_TerrainRegionLoadTile(benchmark::State& state)
+{
+    if (!setup_files()) {
+        state.SkipWithError("tile setup failed");
+        return;
+    }
+    const uint16_t side = state.range(0);
+    AP_Terrain_Tile tile;
+    while (state.KeepRunning()) {
+        if (!tile.map(tile_path, TILE_LAT, TILE_LON, TILE_SPACING)) {
+            state.SkipWithError("map failed");
+            break;
+        }
+        for (uint16_t gx=blocks_x/2; gx<blocks_x/2+side; gx++) {
+            for (uint16_t gy=blocks_y/2; gy<blocks_y/2+side; gy++) {
+                bool ok = tile.has_data(gx*BLOCK_SPACING_X, gy*BLOCK_SPACING_Y, BLOCK_SIZE_X, BLOCK_SIZE_Y);
+                gbenchmark_escape(&ok);
+            }
+        }
+        tile.release();
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+
+BENCHMARK(BM_TerrainRegionLoadTile)->Arg(3)->Arg(10);
+
+/*
+  import a whole degree from the DAT file into a tile, as the IO
+  thread does at boot
+ */
+static void BM_TerrainTileImport(benchmark::State& state)
+{
+    if (!setup_files()) {
+        state.SkipWithError("DAT setup failed");
+        return;
+    }
+    AP_Terrain_Tile tile;
+    dat_block b;
+    while (state.KeepRunning()) {
+        if (!tile.create(TILE_LAT, TILE_LON, TILE_SPACING)) {
+            state.SkipWithError("create failed");
+            break;
+        }
+        const int fd = open(dat_path, O_RDONLY);
+        while (read(fd, &b, sizeof(b)) == sizeof(b)) {
+            if (block_crc(b) != b.block.crc) {
+                continue;
+            }
+            for (uint8_t x=0; x<BLOCK_SIZE_X; x++) {
+                for (uint8_t y=0; y<BLOCK_SIZE_Y; y++) {
+                    tile.set(b.block.grid_idx_x*BLOCK_SPACING_X + x,
+                             b.block.grid_idx_y*BLOCK_SPACING_Y + y,
+                             b.block.height[x][y]);
+                }
+            }
+        }
+        close(fd);
+        tile.save("benchmark_import.TIL");
+        tile.release();
+    }
+    unlink("benchmark_import.TIL");
+    state.SetItemsProcessed(state.iterations() * blocks_x * blocks_y);
+}
+
+BENCHMARK(BM_TerrainTileImport);
+
+#endif // AP_TERRAIN_TILE_ENABLED
+
+BENCHMARK_MAIN();
@@ -0,0 +1,230 @@
+#include <AP_gtest.h>
+
+#include <AP_Terrain/AP_Terrain.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_TERRAIN_AVAILABLE
+
+static AP_Mission mission{nullptr, nullptr, nullptr};
+static AP_Terrain terrain{mission};
+
+#define TEST_SPACING 100
+
+/*
+  the batch lookups must give the same heights as looking each
+  location up on its own. The single lookup is done as height_amsl()
+  does it, without the home altitude special case as that needs the
+  AHRS
+ */
+class AP_Terrain_Test : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        terrain.grid_spacing.set(TEST_SPACING);
+        ASSERT_TRUE(terrain.allocate());
+        memset(terrain.cache, 0, terrain.cache_size * sizeof(terrain.cache[0]));
+#if AP_TERRAIN_TILE_ENABLED
+        for (auto &slot : terrain.tiles) {
+            slot.tile.release();
+            slot.state = AP_Terrain::TILE_EMPTY;
+        }
+#endif
+    }
+
+    /*
+      terrain at grid point (x,y) of a degree. It isn't a plane, so a
+      lookup in the wrong square is seen, and the slope is kept under
+      0.4m per meter so the 1cm the batch offset may differ by is
+      under 1cm of height
+     */
+    static int16_t field(int8_t lat_degrees, int16_t lon_degrees, uint32_t x, uint32_t y)
+    {
+        return 500 + lat_degrees + lon_degrees + 3*x + 2*y + 10*((x + y) % 4);
+    }
+
+    // load the grid block holding a location into the cache
+    void load_block(const Location &loc)
+    {
+        AP_Terrain::grid_info info;
+        terrain.calculate_grid_info(loc, info);
+        AP_Terrain::grid_cache &gcache = terrain.find_grid_cache(info);
+        // newer than the empty entries even at boot, so the next
+        // block doesn't replace this one
+        gcache.last_access_ms = AP_HAL::millis() + 1;
+        if (gcache.state == AP_Terrain::GRID_CACHE_VALID) {
+            return;
+        }
+        for (uint8_t x=0; x<TERRAIN_GRID_BLOCK_SIZE_X; x++) {
+            for (uint8_t y=0; y<TERRAIN_GRID_BLOCK_SIZE_Y; y++) {
+                gcache.grid.height[x][y] = field(info.lat_degrees, info.lon_degrees,
+                                                 info.grid_idx_x*TERRAIN_GRID_BLOCK_SPACING_X + x,
+                                                 info.grid_idx_y*TERRAIN_GRID_BLOCK_SPACING_Y + y);
+            }
+        }
+        gcache.grid.bitmap = AP_Terrain::bitmap_mask;
+        gcache.state = AP_Terrain::GRID_CACHE_VALID;
+    }
+
+#if AP_TERRAIN_TILE_ENABLED
+    // fill a tile for a degree and put it in a slot as if mapped
+    void load_tile(uint8_t i, int8_t lat_degrees, int16_t lon_degrees)
+    {
+        AP_Terrain::tile_slot &slot = terrain.tiles[i];
+        ASSERT_TRUE(slot.tile.create(lat_degrees, lon_degrees, TEST_SPACING));
+        for (uint32_t x=0; x<slot.tile.rows(); x++) {
+            for (uint32_t y=0; y<slot.tile.cols(); y++) {
+                slot.tile.set(x, y, field(lat_degrees, lon_degrees, x, y));
+            }
+        }
+        slot.lat_degrees = lat_degrees;
+        slot.lon_degrees = lon_degrees;
+        slot.spacing = TEST_SPACING;
+        slot.state = AP_Terrain::TILE_MAPPED;
+    }
+#endif
+
+    bool height_single(const Location &loc, float &height)
+    {
+        AP_Terrain::grid_info info;
+        terrain.calculate_grid_info(loc, info);
+#if AP_TERRAIN_TILE_ENABLED
+        if (terrain.tile_height(terrain.find_tile(info.lat_degrees, info.lon_degrees), info, height)) {
+            return true;
+        }
+#endif
+        return terrain.grid_height(terrain.find_grid_cache(info).grid, info, height);
+    }
+
+    // locations every step along a line, which is not a multiple of
+    // the grid spacing so the fractions within the squares vary
+    static uint16_t make_path(const Location &start, const Location &end, float step, Location *locs, uint16_t max_locs)
+    {
+        const uint16_t n = MIN(uint16_t(start.get_distance(end) / step) + 1, max_locs);
+        for (uint16_t i=0; i<n; i++) {
+            locs[i] = start;
+            locs[i].lat += int32_t((int64_t(end.lat) - start.lat) * i / (n-1));
+            locs[i].lng += int32_t((int64_t(end.lng) - start.lng) * i / (n-1));
+        }
+        return n;
+    }
+
+    void check_path(const Location &start, const Location &end, bool tiles)
+    {
+        Location locs[400];
+        float heights[ARRAY_SIZE(locs)];
+        const uint16_t n = make_path(start, end, 37, locs, ARRAY_SIZE(locs));
+        if (!tiles) {
+            for (uint16_t i=0; i<n; i++) {
+                load_block(locs[i]);
+            }
+        }
+
+        ASSERT_TRUE(terrain.height_amsl(locs, n, heights, false));
+        for (uint16_t i=0; i<n; i++) {
+            float height;
+            ASSERT_TRUE(height_single(locs[i], height));
+            // the cursor offset into the degree is within 1cm of the
+            // single lookup
+            EXPECT_NEAR(heights[i], height, 0.01f) << "point " << i;
+        }
+    }
+
+    // paths a few km long over a degree edge, which also cross grid
+    // block edges in both degrees
+    static const Location east_start;
+    static const Location east_end;
+    static const Location north_start;
+    static const Location north_end;
+};
+
+const Location AP_Terrain_Test::east_start = Location(-355000000, 1499800000, 0, Location::AltFrame::ABSOLUTE);
+const Location AP_Terrain_Test::east_end = Location(-354700000, 1500300000, 0, Location::AltFrame::ABSOLUTE);
+const Location AP_Terrain_Test::north_start = Location(-350200000, 1495000000, 0, Location::AltFrame::ABSOLUTE);
+const Location AP_Terrain_Test::north_end = Location(-349800000, 1495300000, 0, Location::AltFrame::ABSOLUTE);
+
+TEST_F(AP_Terrain_Test, BatchGridEastEdge)
+{
+    check_path(east_start, east_end, false);
+}
+
+TEST_F(AP_Terrain_Test, BatchGridNorthEdge)
+{
+    check_path(north_start, north_end, false);
+}
+
+#if AP_TERRAIN_TILE_ENABLED
+TEST_F(AP_Terrain_Test, BatchTileEastEdge)
+{
+    load_tile(0, -36, 149);
+    load_tile(1, -36, 150);
+    check_path(east_start, east_end, true);
+}
+
+TEST_F(AP_Terrain_Test, BatchTileNorthEdge)
+{
+    load_tile(0, -36, 149);
+    load_tile(1, -35, 149);
+    check_path(north_start, north_end, true);
+}
+#endif
+
+TEST_F(AP_Terrain_Test, BatchMissing)
+{
+    Location locs[3] { east_start, east_start, east_end };
+    locs[1].lat += 500000;
+    load_block(locs[0]);
+    load_block(locs[2]);
+
+    float h0, h2;
+    ASSERT_TRUE(height_single(locs[0], h0));
+    ASSERT_TRUE(height_single(locs[2], h2));
+
+    // the middle location's block is not loaded, its height is left
+    // alone and the others are still filled in
+    float heights[3] { -1, -1, -1 };
+    EXPECT_FALSE(terrain.height_amsl(locs, 3, heights, false));
+    EXPECT_NEAR(heights[0], h0, 0.01f);
+    EXPECT_FLOAT_EQ(heights[1], -1);
+    EXPECT_NEAR(heights[2], h2, 0.01f);
+}
+
+TEST_F(AP_Terrain_Test, HeightMax)
+{
+    Location locs[400];
+    const uint16_t n = make_path(east_start, east_end, 37, locs, ARRAY_SIZE(locs));
+    for (uint16_t i=0; i<n; i++) {
+        load_block(locs[i]);
+    }
+
+    // samples at the grid spacing including both ends
+    const uint16_t steps = ceilf(east_start.get_distance(east_end) / TEST_SPACING);
+    float heights[ARRAY_SIZE(locs)];
+    float max_height;
+    ASSERT_TRUE(terrain.height_amsl_max(east_start, east_end, 0, max_height, false, heights, ARRAY_SIZE(heights)));
+
+    float expected_max = -1000;
+    for (uint16_t i=0; i<=steps; i++) {
+        Location loc = east_start;
+        loc.lat += int32_t((int64_t(east_end.lat) - east_start.lat) * i / steps);
+        loc.lng += int32_t((int64_t(east_end.lng) - east_start.lng) * i / steps);
+        float height;
+        ASSERT_TRUE(height_single(loc, height));
+        EXPECT_NEAR(heights[i], height, 0.01f) << "sample " << i;
+        expected_max = MAX(expected_max, height);
+    }
+    EXPECT_NEAR(max_height, expected_max, 0.01f);
+
+    // a spacing longer than the path samples just the two ends
+    ASSERT_TRUE(terrain.height_amsl_max(east_start, east_end, 10000, max_height, false, heights, 2));
+    float h0, h1;
+    ASSERT_TRUE(height_single(east_start, h0));
+    ASSERT_TRUE(height_single(east_end, h1));
+    EXPECT_NEAR(heights[0], h0, 0.01f);
+    EXPECT_NEAR(heights[1], h1, 0.01f);
+    EXPECT_NEAR(max_height, MAX(h0, h1), 0.01f);
+}
+
+#endif // AP_TERRAIN_AVAILABLE
+
+AP_GTEST_MAIN()
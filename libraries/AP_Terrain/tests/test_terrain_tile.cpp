@@ -0,0 +1,84 @@
+#include <AP_gtest.h>
+
+#include <AP_Terrain/TerrainTile.h>
+
+const AP_HAL::HAL& hal = AP_HAL::get_HAL();
+
+#if AP_TERRAIN_TILE_ENABLED
+
+#include <AP_Common/Location.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define TILE_LAT     -35
+#define TILE_LON     149
+#define TILE_SPACING 100
+
+static const char *tile_path = "test_terrain_tile.TIL";
+
+TEST(TerrainTileTest, Dimensions)
+{
+    uint16_t rows, cols;
+    AP_Terrain_Tile::dimensions(TILE_LAT, TILE_LON, TILE_SPACING, rows, cols);
+
+    // a degree of latitude is about 111km, a degree of longitude
+    // shrinks with the cosine of the latitude. Both have a point past
+    // the far edge and one for the rounding down
+    EXPECT_EQ(rows, 1113 + 2);
+    EXPECT_NEAR(cols, 111319 * cosf(radians(-35.0f)) / TILE_SPACING + 2, 1);
+}
+
+TEST(TerrainTileTest, SaveAndMap)
+{
+    AP_Terrain_Tile *tile = new AP_Terrain_Tile();
+    ASSERT_TRUE(tile->create(TILE_LAT, TILE_LON, TILE_SPACING));
+    EXPECT_EQ(tile->points(), 0U);
+
+    // a plane rising 1m per point north and 2m per point east, with
+    // one point left empty
+    for (uint32_t x=0; x<100; x++) {
+        for (uint32_t y=0; y<100; y++) {
+            tile->set(x, y, x + 2*y);
+        }
+    }
+    tile->set(50, 50, TERRAIN_TILE_NO_DATA);
+    EXPECT_EQ(tile->points(), 100U*100U - 1);
+    ASSERT_TRUE(tile->save(tile_path));
+    tile->release();
+    EXPECT_FALSE(tile->valid());
+
+    // the header has to match the degree and spacing asked for
+    EXPECT_FALSE(tile->map(tile_path, TILE_LAT, TILE_LON, TILE_SPACING/2));
+    EXPECT_FALSE(tile->map(tile_path, TILE_LAT+1, TILE_LON, TILE_SPACING));
+    EXPECT_FALSE(tile->map("missing.TIL", TILE_LAT, TILE_LON, TILE_SPACING));
+    ASSERT_TRUE(tile->map(tile_path, TILE_LAT, TILE_LON, TILE_SPACING));
+
+    float height;
+    ASSERT_TRUE(tile->height(10, 20, 0, 0, height));
+    EXPECT_FLOAT_EQ(height, 50);
+    ASSERT_TRUE(tile->height(10, 20, 0.5f, 0.25f, height));
+    EXPECT_FLOAT_EQ(height, 10.5f + 2*20.25f);
+
+    // any of the four corners missing fails the lookup
+    EXPECT_FALSE(tile->height(49, 49, 0.5f, 0.5f, height));
+    EXPECT_FALSE(tile->height(50, 50, 0.5f, 0.5f, height));
+    EXPECT_FALSE(tile->height(99, 10, 0.5f, 0.5f, height));
+    EXPECT_FALSE(tile->height(tile->rows(), 0, 0, 0, height));
+
+    EXPECT_TRUE(tile->has_data(0, 0, 28, 32));
+    EXPECT_FALSE(tile->has_data(40, 40, 28, 32));
+    EXPECT_FALSE(tile->has_data(tile->rows()-10, 0, 28, 32));
+
+    // a mapped tile is read only
+    tile->set(0, 0, 1000);
+    ASSERT_TRUE(tile->height(0, 0, 0, 0, height));
+    EXPECT_FLOAT_EQ(height, 0);
+    EXPECT_FALSE(tile->save(tile_path));
+
+    delete tile;
+    unlink(tile_path);
+}
+
+#endif // AP_TERRAIN_TILE_ENABLED
+
+AP_GTEST_MAIN()
@@ -143,11 +143,6 @@ AP_UAVCAN::AP_UAVCAN() :
 {
     AP_Param::setup_object_defaults(this, var_info);
 
-    for (uint8_t i = 0; i < UAVCAN_SRV_NUMBER; i++) {
-        _SRV_conf[i].esc_pending = false;
-        _SRV_conf[i].servo_pending = false;
-    }
-
     debug_uavcan(AP_CANManager::LOG_INFO, "AP_UAVCAN constructed\n\r");
 }
 
@@ -354,15 +349,31 @@ void AP_UAVCAN::loop(void)
             continue;
         }
 
-        const int error = _node->spin(uavcan::MonotonicDuration::fromMSec(1));
+        // block until a frame arrives or SRV_push_servos() wakes us,
+        // for at most 1ms so the periodic sends below keep their rates
+        _iface_mgr->wait(_node->getMonotonicTime() + uavcan::MonotonicDuration::fromMSec(1));
+
+        const int error = _node->spinOnce();
 
         if (error < 0) {
             hal.scheduler->delay_microseconds(100);
             continue;
         }
 
-        if (_SRV_armed) {
-            bool sent_servos = false;
+        if (_SRV_out.update()) {
+            const uint32_t active_mask = _SRV_out.front().active_mask;
+            _SRV_esc_pending = active_mask;
+            _SRV_servo_pending |= active_mask;
+            _SRV_latency.pending = true;
+        }
+
+        if (_SRV_out.front().armed) {
+            // ESCs go first as they are what the rate controllers are
+            // waiting on
+            if (_esc_bm > 0) {
+                SRV_send_esc();
+            }
+            _SRV_esc_pending = 0;
 
             if (_servo_bm > 0) {
                 // if we have any Servos in bitmask
@@ -371,23 +382,12 @@ void AP_UAVCAN::loop(void)
                 if (now - _SRV_last_send_us >= servo_period_us) {
                     _SRV_last_send_us = now;
                     SRV_send_actuator();
-                    sent_servos = true;
-                    for (uint8_t i = 0; i < UAVCAN_SRV_NUMBER; i++) {
-                        _SRV_conf[i].servo_pending = false;
-                    }
+                    _SRV_servo_pending = 0;
                 }
             }
-
-            // if we have any ESC's in bitmask
-            if (_esc_bm > 0 && !sent_servos) {
-                SRV_send_esc();
-            }
-
-            for (uint8_t i = 0; i < UAVCAN_SRV_NUMBER; i++) {
-                _SRV_conf[i].esc_pending = false;
-            }
         }
 
+        SRV_log_latency();
         led_out_send();
         buzzer_send();
         rtcm_stream_send();
@@ -401,11 +401,10 @@ void AP_UAVCAN::loop(void)
 
 void AP_UAVCAN::SRV_send_actuator(void)
 {
+    const SRV_output &out = _SRV_out.front();
     uint8_t starting_servo = 0;
     bool repeat_send;
 
-    WITH_SEMAPHORE(SRV_sem);
-
     do {
         repeat_send = false;
         uavcan::equipment::actuator::ArrayCommand msg;
@@ -424,14 +423,15 @@ void AP_UAVCAN::SRV_send_actuator(void)
              * physically possible throws at [-1:1] limits.
              */
 
-            if (_SRV_conf[starting_servo].servo_pending && ((((uint32_t) 1) << starting_servo) & _servo_bm)) {
+            const uint32_t mask = ((uint32_t) 1) << starting_servo;
+            if ((_SRV_servo_pending & mask) && (mask & _servo_bm)) {
                 cmd.actuator_id = starting_servo + 1;
 
                 // TODO: other types
                 cmd.command_type = uavcan::equipment::actuator::Command::COMMAND_TYPE_UNITLESS;
 
                 // TODO: failsafe, safety
-                cmd.command_value = constrain_float(((float) _SRV_conf[starting_servo].pulse - 1000.0) / 500.0 - 1.0, -1.0, 1.0);
+                cmd.command_value = constrain_float(((float) out.pulse[starting_servo] - 1000.0) / 500.0 - 1.0, -1.0, 1.0);
 
                 msg.commands.push_back(cmd);
 
@@ -441,6 +441,7 @@ void AP_UAVCAN::SRV_send_actuator(void)
 
         if (i > 0) {
             act_out_array[_driver_index]->broadcast(msg);
+            SRV_sent(out.push_us);
 
             if (i == 15) {
                 repeat_send = true;
@@ -452,18 +453,17 @@ void AP_UAVCAN::SRV_send_actuator(void)
 void AP_UAVCAN::SRV_send_esc(void)
 {
     static const int cmd_max = uavcan::equipment::esc::RawCommand::FieldTypes::cmd::RawValueType::max();
+    const SRV_output &out = _SRV_out.front();
     uavcan::equipment::esc::RawCommand esc_msg;
 
     uint8_t active_esc_num = 0, max_esc_num = 0;
     uint8_t k = 0;
 
-    WITH_SEMAPHORE(SRV_sem);
-
     // find out how many esc we have enabled and if they are active at all
     for (uint8_t i = 0; i < UAVCAN_SRV_NUMBER; i++) {
         if ((((uint32_t) 1) << i) & _esc_bm) {
             max_esc_num = i + 1;
-            if (_SRV_conf[i].esc_pending) {
+            if (_SRV_esc_pending & (((uint32_t) 1) << i)) {
                 active_esc_num++;
             }
         }
@@ -476,7 +476,7 @@ void AP_UAVCAN::SRV_send_esc(void)
         for (uint8_t i = 0; i < max_esc_num && k < 20; i++) {
             if ((((uint32_t) 1) << i) & _esc_bm) {
                 // TODO: ESC negative scaling for reverse thrust and reverse rotation
-                float scaled = cmd_max * (hal.rcout->scale_esc_to_unity(_SRV_conf[i].pulse) + 1.0) / 2.0;
+                float scaled = cmd_max * (hal.rcout->scale_esc_to_unity(out.pulse[i]) + 1.0) / 2.0;
 
                 scaled = constrain_float(scaled, 0, cmd_max);
 
@@ -489,23 +489,78 @@ void AP_UAVCAN::SRV_send_esc(void)
         }
 
         esc_raw[_driver_index]->broadcast(esc_msg);
+        SRV_sent(out.push_us);
     }
 }
 
+/*
+  called from the main thread with new outputs. Hands them to the
+  UAVCAN thread without waiting on it, and wakes it to send them
+ */
 void AP_UAVCAN::SRV_push_servos()
 {
-    WITH_SEMAPHORE(SRV_sem);
+    SRV_output &out = _SRV_out.back();
+    out.active_mask = 0;
 
-    for (uint8_t i = 0; i < NUM_SERVO_CHANNELS; i++) {
+    for (uint8_t i = 0; i < MIN(NUM_SERVO_CHANNELS, UAVCAN_SRV_NUMBER); i++) {
         // Check if this channels has any function assigned
         if (SRV_Channels::channel_function(i)) {
-            _SRV_conf[i].pulse = SRV_Channels::srv_channel(i)->get_output_pwm();
-            _SRV_conf[i].esc_pending = true;
-            _SRV_conf[i].servo_pending = true;
+            out.pulse[i] = SRV_Channels::srv_channel(i)->get_output_pwm();
+            out.active_mask |= ((uint32_t) 1) << i;
+        } else {
+            out.pulse[i] = 0;
         }
     }
 
-    _SRV_armed = hal.util->safety_switch_state() != AP_HAL::Util::SAFETY_DISARMED;
+    out.armed = hal.util->safety_switch_state() != AP_HAL::Util::SAFETY_DISARMED;
+    out.push_us = AP_HAL::native_micros64();
+    _SRV_out.publish();
+
+    _iface_mgr->wake();
+}
+
+// record the latency of the first broadcast of each set of outputs
+void AP_UAVCAN::SRV_sent(uint64_t push_us)
+{
+    if (!_SRV_latency.pending) {
+        return;
+    }
+    _SRV_latency.pending = false;
+    const uint32_t latency_us = AP_HAL::native_micros64() - push_us;
+    _SRV_latency.count++;
+    _SRV_latency.sum_us += latency_us;
+    _SRV_latency.max_us = MAX(_SRV_latency.max_us, latency_us);
+}
+
+void AP_UAVCAN::SRV_log_latency()
+{
+    const uint32_t now_ms = AP_HAL::native_millis();
+    if (now_ms - _SRV_latency.last_log_ms < 1000) {
+        return;
+    }
+    _SRV_latency.last_log_ms = now_ms;
+    if (_SRV_latency.count == 0) {
+        return;
+    }
+
+    // @LoggerMessage: CSRL
+    // @Description: Latency of UAVCAN servo and ESC outputs
+    // @Field: TimeUS: Time since system startup
+    // @Field: Drv: UAVCAN driver index
+    // @Field: N: number of output updates broadcast since the last message
+    // @Field: Lat: average time from the outputs being pushed to being broadcast
+    // @Field: MaxLat: longest time from the outputs being pushed to being broadcast
+    AP::logger().Write("CSRL", "TimeUS,Drv,N,Lat,MaxLat",
+                       "s#-ss", "F--FF", "QBHII",
+                       AP_HAL::micros64(),
+                       _driver_index,
+                       uint16_t(MIN(_SRV_latency.count, UINT16_MAX)),
+                       uint32_t(_SRV_latency.sum_us / _SRV_latency.count),
+                       _SRV_latency.max_us);
+
+    _SRV_latency.count = 0;
+    _SRV_latency.sum_us = 0;
+    _SRV_latency.max_us = 0;
 }
 
 
@@ -26,6 +26,7 @@
 #include "AP_UAVCAN_Clock.h"
 #include <AP_CANManager/AP_CANDriver.h>
 #include <AP_HAL/Semaphores.h>
+#include <AP_HAL/utility/TripleBuffer.h>
 #include <AP_Param/AP_Param.h>
 #include <AP_ESC_Telem/AP_ESC_Telem_Backend.h>
 
@@ -150,6 +151,8 @@ private:
     ///// SRV output /////
     void SRV_send_actuator();
     void SRV_send_esc();
+    void SRV_sent(uint64_t push_us);
+    void SRV_log_latency();
 
     ///// LED /////
     void led_out_send();
@@ -179,15 +182,28 @@ private:
     char _thread_name[13];
     bool _initialized;
     ///// SRV output /////
-    struct {
-        uint16_t pulse;
-        bool esc_pending;
-        bool servo_pending;
-    } _SRV_conf[UAVCAN_SRV_NUMBER];
+    // outputs handed from SRV_push_servos() to the UAVCAN thread
+    struct SRV_output {
+        uint16_t pulse[UAVCAN_SRV_NUMBER];
+        uint32_t active_mask;   // channels with a function assigned
+        uint64_t push_us;       // when they were pushed
+        bool armed;
+    };
+    ObjectTripleBuffer<SRV_output> _SRV_out;
 
-    uint8_t _SRV_armed;
+    // channels with outputs not yet sent, only used by the UAVCAN thread
+    uint32_t _SRV_esc_pending;
+    uint32_t _SRV_servo_pending;
     uint32_t _SRV_last_send_us;
-    HAL_Semaphore SRV_sem;
+
+    // time from the outputs being pushed to them being broadcast
+    struct {
+        bool pending;
+        uint32_t count;
+        uint64_t sum_us;
+        uint32_t max_us;
+        uint32_t last_log_ms;
+    } _SRV_latency;
 
     ///// LED /////
     struct led_device {
@@ -256,4 +256,20 @@ int16_t CanIfaceMgr::select(CanSelectMasks& inout_masks,
     inout_masks = makeSelectMasks(in_masks, pending_tx);  // Return what we got even if none of the requested events are set
     return 1;                                   // Return value doesn't matter as long as it is non-negative
 }
+
+void CanIfaceMgr::wait(const MonotonicTime blocking_deadline)
+{
+    CanSelectMasks masks;
+    masks.read = (1U << num_ifaces) - 1;
+    const CanFrame* pending_tx[MaxCanIfaces] {};
+    select(masks, pending_tx, blocking_deadline);
+}
+
+void CanIfaceMgr::wake()
+{
+    AP_HAL::EventSource *evt_src = _event_handle.get_source();
+    if (evt_src != nullptr) {
+        evt_src->signal(_event_handle.get_evt_mask());
+    }
+}
 #endif //HAL_ENABLE_LIBUAVCAN_DRIVERSs
@@ -67,6 +67,12 @@ public:
     int16_t select(CanSelectMasks& inout_masks,
                    const CanFrame* (& pending_tx)[MaxCanIfaces],
                    const MonotonicTime blocking_deadline) override;
+
+    // block until a frame can be read, wake() is called or the deadline passes
+    void wait(const MonotonicTime blocking_deadline);
+
+    // wake a thread blocked in wait() or select()
+    void wake();
 };
 
 }
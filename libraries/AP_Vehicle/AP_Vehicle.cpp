@@ -61,6 +61,12 @@ const AP_Param::GroupInfo AP_Vehicle::var_info[] = {
     AP_SUBGROUPINFO(externalAHRS, "EAHRS", 8, AP_Vehicle, AP_ExternalAHRS),
 #endif
 
+#if HAL_STATE_EXPORT_ENABLED
+    // @Group: SHM_
+    // @Path: ../AP_StateExport/AP_StateExport.cpp
+    AP_SUBGROUPINFO(state_export, "SHM_", 9, AP_Vehicle, AP_StateExport),
+#endif
+
     AP_GROUPEND
 };
 
@@ -176,6 +182,9 @@ void AP_Vehicle::setup()
     generator.init();
 #endif
 
+#if HAL_STATE_EXPORT_ENABLED
+    state_export.init();
+#endif
 }
 
 void AP_Vehicle::loop()
@@ -231,6 +240,9 @@ const AP_Scheduler::Task AP_Vehicle::scheduler_tasks[] = {
 #if OSD_ENABLED
     SCHED_TASK(publish_osd_info, 1, 10),
 #endif
+#if HAL_STATE_EXPORT_ENABLED
+    SCHED_TASK_CLASS(AP_StateExport, &vehicle.state_export,   update,            LOOP_RATE,  20),
+#endif
 };
 
 void AP_Vehicle::get_common_scheduler_tasks(const AP_Scheduler::Task*& tasks, uint8_t& num_tasks)
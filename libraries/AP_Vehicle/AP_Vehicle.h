@@ -46,6 +46,7 @@
 #include <AP_Frsky_Telem/AP_Frsky_Parameters.h>
 #include <AP_ExternalAHRS/AP_ExternalAHRS.h>
 #include <AP_VideoTX/AP_SmartAudio.h>
+#include <AP_StateExport/AP_StateExport.h>
 
 class AP_Vehicle : public AP_HAL::HAL::Callbacks {
 
@@ -327,6 +328,10 @@ protected:
     AP_SmartAudio smartaudio;
 #endif
 
+#if HAL_STATE_EXPORT_ENABLED
+    AP_StateExport state_export;
+#endif
+
     static const struct AP_Param::GroupInfo var_info[];
     static const struct AP_Scheduler::Task scheduler_tasks[];
 
@@ -27,6 +27,30 @@
 
 #define GCS_DEBUG_SEND_MESSAGE_TIMINGS 0
 
+// number of MAVFTP files that may be open at once across all links
+#ifndef GCS_FTP_MAX_SESSIONS
+#if HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define GCS_FTP_MAX_SESSIONS 4
+#else
+#define GCS_FTP_MAX_SESSIONS 1
+#endif
+#endif
+
+// schedule streamed messages on each link from a token bucket sized
+// to what the link is seen to carry, holding back low priority
+// messages first when it is congested
+#ifndef GCS_STREAM_SCHEDULER_ENABLED
+#define GCS_STREAM_SCHEDULER_ENABLED 0
+#endif
+
+// count the messages the stream scheduler sends and holds back, for
+// @SYS/streams.txt
+#ifndef GCS_STREAM_SCHEDULER_DEBUG
+#define GCS_STREAM_SCHEDULER_DEBUG 0
+#endif
+
+class ExpandingString;
+
 #ifndef HAL_NO_GCS
 
 // macros used to determine if a message will fit in the space available.
@@ -338,6 +362,10 @@ public:
     uint16_t get_stream_slowdown_ms() const { return stream_slowdown_ms; }
     uint8_t get_last_txbuf() const { return last_txbuf; }
 
+    // fill in stream scheduler state and the rate each message is
+    // actually being sent at, for @SYS/streams.txt
+    void stream_info(ExpandingString &str) const;
+
     MAV_RESULT set_message_interval(uint32_t msg_id, int32_t interval_us);
 
 protected:
@@ -580,6 +608,58 @@ private:
     // last reported radio buffer percent available
     uint8_t          last_txbuf = 100;
 
+    // returns false if a streamed message should be held back on this
+    // pass of its bucket to leave room on a congested link
+    bool stream_sched_admit(const ap_message id);
+    // returns true if every message left in the bucket is held back,
+    // counting them as skipped
+    bool stream_sched_bucket_held(void);
+
+#if GCS_STREAM_SCHEDULER_ENABLED
+    /*
+      token bucket shared by everything sent on this link. The rate
+      is only limited once the link shows it is congested, either by
+      the port not draining or by the radio reporting a full buffer.
+      Streamed messages are then admitted against the tokens by
+      priority, so low priority messages are held back first
+     */
+    enum class StreamPriority : uint8_t {
+        HIGH,
+        NORMAL,
+        LOW,
+    };
+    static StreamPriority stream_priority(const ap_message id);
+    struct {
+        float rate;              // bytes/s allowed, zero when not limited
+        float tokens;            // bytes available
+        float tx_rate;           // bytes/s written, filtered
+        float drain_rate;        // bytes/s sent by the port, filtered
+        uint32_t last_update_us;
+        uint32_t last_tx_bytes;
+        uint16_t last_txspace;
+        uint16_t max_txspace;
+        uint32_t last_congested_ms;
+        uint32_t last_throttle_ms;
+        // messages held back on this pass of update_send()
+        Bitmask<MSG_LAST> held;
+        // messages skipped because they were still held back when
+        // their bucket was rescheduled
+        uint32_t skipped;
+#if GCS_STREAM_SCHEDULER_DEBUG
+        // per message counts for the current and last window
+        uint32_t window_start_ms;
+        uint16_t window_ms;
+        uint16_t sent[MSG_LAST];
+        uint16_t throttled[MSG_LAST];
+        uint16_t last_sent[MSG_LAST];
+        uint16_t last_throttled[MSG_LAST];
+#endif
+    } stream_sched;
+    void stream_sched_update(void);
+    void stream_sched_radio_status(const uint8_t txbuf);
+    float stream_sched_burst(void) const;
+#endif
+
     // outbound ("deferred message") queue.
 
     // "special" messages such as heartbeat, next_param etc are stored
@@ -754,16 +834,55 @@ private:
         Write,
     };
 
+    // an open file, identified by the client chosen session number
+    // and the system it came from
+    struct ftp_session {
+        int fd = -1;
+        FTP_FILE_MODE mode; // work around AP_Filesystem not supporting file modes
+        int16_t id = -1;
+        uint8_t sysid;
+        uint8_t compid;
+        uint32_t last_use_ms;
+
+        // read-ahead buffer, filled from the file in large blocks
+        uint8_t *read_buf;
+        uint32_t read_buf_offset;
+        uint32_t read_buf_len;
+
+        // burst read still being queued, carried on by the worker
+        // as the link's reply queue drains
+        uint16_t burst_remaining;
+        uint16_t burst_seq;
+        uint8_t burst_max_read;
+        uint32_t burst_offset;
+        mavlink_channel_t burst_chan;
+    };
+
+    // the last reply to a client session, kept so it can be resent if
+    // the client re-requests it and retried if its link's queue was
+    // full when it was made
+    struct ftp_cached_reply {
+        pending_ftp reply;
+        uint32_t last_use_ms;
+        bool valid;
+        bool unsent;
+    };
+
     struct ftp_state {
         ObjectBuffer<pending_ftp> *requests;
-        ObjectBuffer<pending_ftp> *replies;
 
-        // session specific info, currently only support a single session over all links
-        int fd = -1;
-        FTP_FILE_MODE mode; // work around AP_Filesystem not supporting file modes
-        int16_t current_session;
+        // replies are queued per link so a slow link does not hold
+        // up replies on another
+        ObjectBuffer<pending_ftp> *replies[MAVLINK_COMM_NUM_BUFFERS];
+
+        ftp_session sessions[GCS_FTP_MAX_SESSIONS];
+        ftp_cached_reply reply_cache[GCS_FTP_MAX_SESSIONS];
+
         uint32_t last_send_ms;
         uint8_t need_banner_send_mask;
+
+        // free transmit space last seen on each link, used to size bursts
+        uint16_t chan_txspace[MAVLINK_COMM_NUM_BUFFERS];
     };
     static struct ftp_state ftp;
 
@@ -771,11 +890,21 @@ private:
     static int gen_dir_entry(char *dest, size_t space, const char * path, const struct dirent * entry); // FTP helper for emitting a dir response
     static void ftp_list_dir(struct pending_ftp &request, struct pending_ftp &response);
 
+    // session helpers
+    static ftp_session *ftp_find_session(const pending_ftp &request);
+    static ftp_session *ftp_alloc_session(uint32_t now);
+    static void ftp_close_session(ftp_session &session);
+    static ssize_t ftp_read(ftp_session &session, uint32_t offset, uint8_t *buf, uint16_t len);
+    static uint16_t ftp_burst_packets(mavlink_channel_t chan);
+    static bool ftp_burst_send(ftp_session &session);
+
     bool ftp_init(void);
     void handle_file_transfer_protocol(const mavlink_message_t &msg);
     void send_ftp_replies(void);
     void ftp_worker(void);
-    void ftp_push_replies(pending_ftp &reply);
+    static bool ftp_push_replies(const pending_ftp &reply);
+    static ftp_cached_reply *ftp_find_reply(const pending_ftp &request);
+    static void ftp_send_reply(const pending_ftp &reply, uint32_t now);
 
     void send_distance_sensor(const class AP_RangeFinder_Backend *sensor, const uint8_t instance) const;
 
@@ -938,6 +1067,9 @@ public:
                               ap_var_type param_type,
                               float param_value);
 
+    // stream scheduler state of every link, for @SYS/streams.txt
+    void stream_info(ExpandingString &str) const;
+
     static MissionItemProtocol_Waypoints *_missionitemprotocol_waypoints;
     static MissionItemProtocol_Rally *_missionitemprotocol_rally;
     static MissionItemProtocol_Fence *_missionitemprotocol_fence;
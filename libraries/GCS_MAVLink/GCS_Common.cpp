@@ -702,6 +702,10 @@ void GCS_MAVLINK::handle_radio_status(const mavlink_message_t &msg, bool log_rad
     }
 #endif
 
+#if GCS_STREAM_SCHEDULER_ENABLED
+    stream_sched_radio_status(packet.txbuf);
+#endif
+
     //log rssi, noise, etc if logging Performance monitoring data
     if (log_radio) {
         AP::logger().Write_Radio(packet);
@@ -903,7 +907,15 @@ uint16_t GCS_MAVLINK::get_reschedule_interval_ms(const deferred_message_bucket_t
 {
     uint32_t interval_ms = deferred.interval_ms;
 
+#if GCS_STREAM_SCHEDULER_ENABLED
+    // while the stream scheduler is limiting the link it slows
+    // messages by priority instead
+    if (is_zero(stream_sched.rate)) {
+        interval_ms += stream_slowdown_ms;
+    }
+#else
     interval_ms += stream_slowdown_ms;
+#endif
 
     // slow most messages down if we're transfering parameters or
     // waypoints:
@@ -915,7 +927,7 @@ uint16_t GCS_MAVLINK::get_reschedule_interval_ms(const deferred_message_bucket_t
         // we are sending requests for waypoints, penalize streams:
         interval_ms *= 4;
     }
-    if (ftp.replies && AP_HAL::millis() - ftp.last_send_ms < 500) {
+    if (ftp.replies[chan] != nullptr && AP_HAL::millis() - ftp.last_send_ms < 500) {
         // we are sending ftp replies
         interval_ms *= 4;
     }
@@ -994,7 +1006,18 @@ ap_message GCS_MAVLINK::next_deferred_bucket_message_to_send(uint16_t now16_ms)
         find_next_bucket_to_send(now16_ms);
         return no_message_to_send;
     }
+#if GCS_STREAM_SCHEDULER_ENABLED
+    // messages held back for a congested link go after the rest of
+    // the bucket
+    for (uint16_t i=next; i<MSG_LAST; i++) {
+        if (bucket_message_ids_to_send.get(i) && !stream_sched.held.get(i)) {
+            return (ap_message)i;
+        }
+    }
+    return no_message_to_send;
+#else
     return (ap_message)next;
+#endif
 }
 
 // call try_send_message if appropriate.  Incorporates debug code to
@@ -1028,6 +1051,9 @@ bool GCS_MAVLINK::do_try_send_message(const ap_message id)
         try_send_message_stats.longest_time_us = delta_us;
         try_send_message_stats.longest_id = id;
     }
+#endif
+#if GCS_STREAM_SCHEDULER_ENABLED && GCS_STREAM_SCHEDULER_DEBUG
+    stream_sched.sent[id]++;
 #endif
     return true;
 }
@@ -1097,6 +1123,10 @@ void GCS_MAVLINK::update_send()
         deferred_messages_initialised = true;
     }
 
+#if GCS_STREAM_SCHEDULER_ENABLED
+    stream_sched_update();
+#endif
+
 #if GCS_DEBUG_SEND_MESSAGE_TIMINGS
     uint32_t retry_deferred_body_start = AP_HAL::micros();
 #endif
@@ -1165,12 +1195,18 @@ void GCS_MAVLINK::update_send()
 
         ap_message next = next_deferred_bucket_message_to_send(start16);
         if (next != no_message_to_send) {
-            if (!do_try_send_message(next)) {
-                break;
+            // a message the link has no room for is held back while
+            // the rest of the bucket is sent, and tried again on the
+            // next pass if the bucket hasn't finished by then
+            if (stream_sched_admit(next)) {
+                if (!do_try_send_message(next)) {
+                    break;
+                }
+                bucket_message_ids_to_send.clear(next);
             }
-            bucket_message_ids_to_send.clear(next);
-            if (bucket_message_ids_to_send.count() == 0) {
-                // we sent everything in the bucket.  Reschedule it.
+            if (bucket_message_ids_to_send.count() == 0 || stream_sched_bucket_held()) {
+                // we sent everything in the bucket, or all that is
+                // left is being held back.  Reschedule it.
                 // we try to keep output on a regular clock to avoid
                 // user support questions:
                 const uint16_t interval_ms = get_reschedule_interval_ms(deferred_message_bucket[sending_bucket_id]);
@@ -29,6 +29,28 @@ struct GCS_MAVLINK::ftp_state GCS_MAVLINK::ftp;
 // timeout for session inactivity
 #define FTP_SESSION_TIMEOUT 3000
 
+// limits on the number of packets sent in response to a single burst
+// read request. The burst length between these is scaled by the
+// transmit space of the link
+#define FTP_BURST_MIN_PACKETS 100
+#define FTP_BURST_MAX_PACKETS 1000
+
+// replies kept free in each link's queue while a burst is queued, so
+// requests on other sessions can still be answered
+#define FTP_REPLY_RESERVE (GCS_FTP_MAX_SESSIONS + 2)
+
+// size of the per-session read-ahead buffer. Reads from the filesystem
+// are done in blocks of this size and then split into packets
+#ifndef FTP_READ_AHEAD_SIZE
+#if CONFIG_HAL_BOARD == HAL_BOARD_SITL || CONFIG_HAL_BOARD == HAL_BOARD_LINUX
+#define FTP_READ_AHEAD_SIZE 32768
+#elif HAL_MEM_CLASS >= HAL_MEM_CLASS_500
+#define FTP_READ_AHEAD_SIZE 4096
+#else
+#define FTP_READ_AHEAD_SIZE 0
+#endif
+#endif
+
 bool GCS_MAVLINK::ftp_init(void) {
 
     // check if ftp is disabled for memory savings
@@ -38,31 +60,32 @@ bool GCS_MAVLINK::ftp_init(void) {
 
     // we can simply check if we allocated everything we need
 
-    if (ftp.requests != nullptr) {
+    if (ftp.requests != nullptr && ftp.replies[chan] != nullptr) {
         return true;
     }
 
-    ftp.requests = new ObjectBuffer<pending_ftp>(5);
     if (ftp.requests == nullptr) {
-        goto failed;
-    }
-    ftp.replies = new ObjectBuffer<pending_ftp>(30);
-    if (ftp.replies == nullptr) {
-        goto failed;
+        ftp.requests = new ObjectBuffer<pending_ftp>(GCS_FTP_MAX_SESSIONS + 4);
+        if (ftp.requests == nullptr) {
+            goto failed;
+        }
+        if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&GCS_MAVLINK::ftp_worker, void),
+                                          "FTP", 2560, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+            delete ftp.requests;
+            ftp.requests = nullptr;
+            goto failed;
+        }
     }
 
-    if (!hal.scheduler->thread_create(FUNCTOR_BIND_MEMBER(&GCS_MAVLINK::ftp_worker, void),
-                                      "FTP", 2560, AP_HAL::Scheduler::PRIORITY_IO, 0)) {
+    // replies are allocated per link the first time it uses FTP
+    ftp.replies[chan] = new ObjectBuffer<pending_ftp>(30);
+    if (ftp.replies[chan] == nullptr) {
         goto failed;
     }
 
     return true;
 
 failed:
-    delete ftp.requests;
-    ftp.requests = nullptr;
-    delete ftp.replies;
-    ftp.replies = nullptr;
     gcs().send_text(MAV_SEVERITY_WARNING, "failed to initialize MAVFTP");
 
     return false;
@@ -104,12 +127,22 @@ void GCS_MAVLINK::send_ftp_replies(void)
         ftp.need_banner_send_mask &= ~(1U<<chan);
         send_banner();
     }
-    
-    if (ftp.replies == nullptr || ftp.replies->is_empty()) {
+
+    ObjectBuffer<pending_ftp> *replies = ftp.replies[chan];
+    if (replies == nullptr) {
+        return;
+    }
+
+    if (replies->is_empty()) {
+        // note how much space the link has when we are not filling
+        // it, this is used to size burst reads
+        ftp.chan_txspace[chan] = comm_get_txspace(chan);
         return;
     }
 
-    for (uint8_t i = 0; i < 20; i++) {
+    // send as many replies as the link has space for
+    const uint32_t queued = replies->available();
+    for (uint32_t i = 0; i < queued; i++) {
         if (!HAVE_PAYLOAD_SPACE(chan, FILE_TRANSFER_PROTOCOL)) {
             return;
         }
@@ -120,7 +153,7 @@ void GCS_MAVLINK::send_ftp_replies(void)
 
         struct pending_ftp reply;
         uint8_t payload[251] = {};
-        if (ftp.replies->peek(reply) && (reply.chan == chan)) {
+        if (replies->peek(reply)) {
             put_le16_ptr(payload, reply.seq_number);
             payload[2] = reply.session;
             payload[3] = static_cast<uint8_t>(reply.opcode);
@@ -133,7 +166,7 @@ void GCS_MAVLINK::send_ftp_replies(void)
                 reply.chan,
                 0, reply.sysid, reply.compid,
                 payload);
-            ftp.replies->pop();
+            replies->pop();
             ftp.last_send_ms = AP_HAL::millis();
         } else {
             return;
@@ -164,31 +197,242 @@ void GCS_MAVLINK::ftp_error(struct pending_ftp &response, FTP_ERROR error) {
     }
 }
 
-// send our response back out to the system
-void GCS_MAVLINK::ftp_push_replies(pending_ftp &reply)
+// send our response back out to the system. Returns false if the
+// link's queue is full
+bool GCS_MAVLINK::ftp_push_replies(const pending_ftp &reply)
+{
+    return ftp.replies[reply.chan]->push(reply);
+}
+
+// find the last reply to the client session a request came from
+GCS_MAVLINK::ftp_cached_reply *GCS_MAVLINK::ftp_find_reply(const pending_ftp &request)
+{
+    for (ftp_cached_reply &c : ftp.reply_cache) {
+        if (c.valid &&
+            c.reply.session == request.session &&
+            c.reply.sysid == request.sysid &&
+            c.reply.compid == request.compid &&
+            c.reply.chan == request.chan) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+/*
+  queue a reply and keep it as the last reply to its client
+  session. The worker can't wait for a link with a full queue as that
+  would hold up every other session, so a reply that doesn't fit is
+  pushed again on later passes of the worker
+ */
+void GCS_MAVLINK::ftp_send_reply(const pending_ftp &reply, uint32_t now)
 {
-    while (!ftp.replies->push(reply)) { // we must fit the response, keep shoving it in
-        hal.scheduler->delay(2);
+    ftp_cached_reply *c = ftp_find_reply(reply);
+    if (c == nullptr) {
+        // take a free slot, else the least recently used, preferring
+        // replies that have already gone out
+        for (ftp_cached_reply &r : ftp.reply_cache) {
+            if (!r.valid) {
+                c = &r;
+                break;
+            }
+            if (c == nullptr ||
+                (c->unsent && !r.unsent) ||
+                (c->unsent == r.unsent && now - r.last_use_ms > now - c->last_use_ms)) {
+                c = &r;
+            }
+        }
     }
+    c->reply = reply;
+    c->valid = true;
+    c->last_use_ms = now;
+    c->unsent = !ftp_push_replies(reply);
+}
+
+// find the open session a request refers to
+GCS_MAVLINK::ftp_session *GCS_MAVLINK::ftp_find_session(const pending_ftp &request)
+{
+    for (ftp_session &session : ftp.sessions) {
+        if (session.fd != -1 &&
+            session.id == request.session &&
+            session.sysid == request.sysid &&
+            session.compid == request.compid) {
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+// find a free session slot, reclaiming one that has been idle for
+// longer than the session timeout if needed
+GCS_MAVLINK::ftp_session *GCS_MAVLINK::ftp_alloc_session(uint32_t now)
+{
+    for (ftp_session &session : ftp.sessions) {
+        if (session.fd == -1) {
+            return &session;
+        }
+    }
+    for (ftp_session &session : ftp.sessions) {
+        if (now - session.last_use_ms >= FTP_SESSION_TIMEOUT) {
+            ftp_close_session(session);
+            return &session;
+        }
+    }
+    return nullptr;
+}
+
+void GCS_MAVLINK::ftp_close_session(ftp_session &session)
+{
+    if (session.fd != -1) {
+        AP::FS().close(session.fd);
+        session.fd = -1;
+    }
+    delete[] session.read_buf;
+    session.read_buf = nullptr;
+    session.read_buf_len = 0;
+    session.burst_remaining = 0;
+    session.id = -1;
+}
+
+/*
+  read from a session's file at the given offset. Data is read from
+  the filesystem in large blocks into the session's read-ahead buffer
+  and then served from there
+ */
+ssize_t GCS_MAVLINK::ftp_read(ftp_session &session, uint32_t offset, uint8_t *buf, uint16_t len)
+{
+    if (session.read_buf == nullptr) {
+        // no read-ahead buffer, read directly
+        if (AP::FS().lseek(session.fd, offset, SEEK_SET) == -1) {
+            return -1;
+        }
+        return AP::FS().read(session.fd, buf, len);
+    }
+
+    if (offset < session.read_buf_offset ||
+        offset + len > session.read_buf_offset + session.read_buf_len) {
+        // refill starting at the requested offset
+        session.read_buf_len = 0;
+        if (AP::FS().lseek(session.fd, offset, SEEK_SET) == -1) {
+            return -1;
+        }
+        const ssize_t read_bytes = AP::FS().read(session.fd, session.read_buf, FTP_READ_AHEAD_SIZE);
+        if (read_bytes == -1) {
+            return -1;
+        }
+        session.read_buf_offset = offset;
+        session.read_buf_len = read_bytes;
+    }
+
+    const uint32_t n = MIN(len, session.read_buf_offset + session.read_buf_len - offset);
+    memcpy(buf, &session.read_buf[offset - session.read_buf_offset], n);
+    return n;
+}
+
+/*
+  number of packets to send for a burst read. Links with a large
+  transmit buffer, such as network links on Linux boards, get longer
+  bursts so fewer request round trips are needed
+ */
+uint16_t GCS_MAVLINK::ftp_burst_packets(mavlink_channel_t chan)
+{
+    const uint16_t packet_len = MAVLINK_NUM_NON_PAYLOAD_BYTES + MAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL_LEN;
+    const uint32_t packets = 4U * (ftp.chan_txspace[chan] / packet_len);
+    return constrain_int32(packets, FTP_BURST_MIN_PACKETS, FTP_BURST_MAX_PACKETS);
+}
+
+/*
+  queue as much of a session's burst read as its link has room for,
+  leaving space for replies on other sessions. Returns true if there
+  is more of the burst to send
+ */
+bool GCS_MAVLINK::ftp_burst_send(ftp_session &session)
+{
+    ObjectBuffer<pending_ftp> *replies = ftp.replies[session.burst_chan];
+    pending_ftp reply {};
+    reply.chan = session.burst_chan;
+    reply.session = session.id;
+    reply.sysid = session.sysid;
+    reply.compid = session.compid;
+    reply.req_opcode = FTP_OP::BurstReadFile;
+
+    while (session.burst_remaining > 0 && replies->space() > FTP_REPLY_RESERVE) {
+        reply.seq_number = session.burst_seq;
+
+        // fill the buffer
+        const ssize_t read_bytes = ftp_read(session, session.burst_offset, reply.data, session.burst_max_read);
+        if (read_bytes <= 0) {
+            // ensure the NACK is at the right offset
+            reply.offset = session.burst_offset;
+            ftp_error(reply, read_bytes == 0 ? FTP_ERROR::EndOfFile : FTP_ERROR::FailErrno);
+            replies->push(reply);
+            session.burst_remaining = 0;
+            break;
+        }
+
+        if (read_bytes != sizeof(reply.data)) {
+            // don't send any old data
+            memset(reply.data + read_bytes, 0, sizeof(reply.data) - read_bytes);
+        }
+
+        session.burst_remaining--;
+        reply.opcode = FTP_OP::Ack;
+        reply.offset = session.burst_offset;
+        reply.burst_complete = (session.burst_remaining == 0);
+        reply.size = (uint8_t)read_bytes;
+        replies->push(reply);
+
+        session.burst_offset += read_bytes;
+        session.burst_seq++;
+    }
+
+    // a session is busy while its burst is going out
+    session.last_use_ms = AP_HAL::millis();
+
+    return session.burst_remaining > 0;
 }
 
 void GCS_MAVLINK::ftp_worker(void) {
     pending_ftp request;
-    pending_ftp reply = {};
-    reply.session = -1; // flag the reply as invalid for any reuse
+    pending_ftp reply;
 
     while (true) {
         bool skip_push_reply = false;
 
-        while (!ftp.requests->pop(request)) {
+        // retry replies that found their link's queue full, giving up
+        // once the client will have timed out
+        for (ftp_cached_reply &c : ftp.reply_cache) {
+            if (c.valid && c.unsent) {
+                c.unsent = !ftp_push_replies(c.reply) &&
+                    AP_HAL::millis() - c.last_use_ms < FTP_SESSION_TIMEOUT;
+            }
+        }
+
+        // carry on with bursts that were waiting for space in their
+        // link's reply queue
+        for (ftp_session &s : ftp.sessions) {
+            if (s.fd != -1 && s.burst_remaining > 0) {
+                ftp_burst_send(s);
+            }
+        }
+
+        if (!ftp.requests->pop(request)) {
             // nothing to handle, delay ourselves a bit then check again. Ideally we'd use conditional waits here
             hal.scheduler->delay(2);
+            continue;
         }
 
-        // if it's a rerequest and we still have the last response then send it
-        if ((request.sysid == reply.sysid) && (request.compid = reply.compid) &&
-            (request.session == reply.session) && (request.seq_number + 1 == reply.seq_number)) {
-            ftp_push_replies(reply);
+        const uint32_t now = AP_HAL::millis();
+
+        // if it's a rerequest and we still have the last response to
+        // that session then send it, unless it is still waiting to go
+        // out
+        ftp_cached_reply *cached = ftp_find_reply(request);
+        if (cached != nullptr && request.seq_number + 1 == cached->reply.seq_number) {
+            if (!cached->unsent) {
+                cached->unsent = !ftp_push_replies(cached->reply);
+            }
+            cached->last_use_ms = now;
             continue;
         }
 
@@ -204,360 +448,337 @@ void GCS_MAVLINK::ftp_worker(void) {
         // sanity check the request size
         if (request.size > sizeof(request.data)) {
             ftp_error(reply, FTP_ERROR::InvalidDataSize);
-            ftp_push_replies(reply);
+            ftp_send_reply(reply, now);
             continue;
         }
 
-        uint32_t now = AP_HAL::millis();
-
-        // check for session termination
-        if (request.session != ftp.current_session &&
-            (request.opcode == FTP_OP::TerminateSession || request.opcode == FTP_OP::ResetSessions)) {
-            // terminating a different session, just ack
-            reply.opcode = FTP_OP::Ack;
-        } else if (ftp.fd != -1 && request.session != ftp.current_session &&
-                   now - ftp.last_send_ms < FTP_SESSION_TIMEOUT) {
-            // if we have an open file and the session isn't right
-            // then reject. This prevents IO on the wrong file
-            ftp_error(reply, FTP_ERROR::InvalidSession);
-        } else {
-            if (ftp.fd != -1 &&
-                request.session != ftp.current_session &&
-                now - ftp.last_send_ms >= FTP_SESSION_TIMEOUT) {
-                // if a new session appears and the old session has
-                // been idle for more than the timeout then force
-                // close the old session
-                AP::FS().close(ftp.fd);
-                ftp.fd = -1;
-                ftp.current_session = -1;
-            }
-            // dispatch the command as needed
-            switch (request.opcode) {
-                case FTP_OP::None:
-                    reply.opcode = FTP_OP::Ack;
-                    break;
-                case FTP_OP::TerminateSession:
-                case FTP_OP::ResetSessions:
-                    // we already handled this, just listed for completeness
-                    if (ftp.fd != -1) {
-                        AP::FS().close(ftp.fd);
-                        ftp.fd = -1;
+        // find the session this request is for, if it has one open
+        ftp_session *session = ftp_find_session(request);
+        uint32_t session_idle_ms = 0;
+        if (session != nullptr) {
+            session_idle_ms = now - session->last_use_ms;
+            session->last_use_ms = now;
+            // the client has moved on from any burst still going out
+            session->burst_remaining = 0;
+        }
+
+        // dispatch the command as needed
+        switch (request.opcode) {
+            case FTP_OP::None:
+                reply.opcode = FTP_OP::Ack;
+                break;
+            case FTP_OP::TerminateSession:
+                if (session != nullptr) {
+                    ftp_close_session(*session);
+                }
+                reply.opcode = FTP_OP::Ack;
+                break;
+            case FTP_OP::ResetSessions:
+                // the protocol has this terminate all sessions, not
+                // just those of the client that asked
+                for (ftp_session &s : ftp.sessions) {
+                    ftp_close_session(s);
+                }
+                reply.opcode = FTP_OP::Ack;
+                break;
+            case FTP_OP::ListDirectory:
+                ftp_list_dir(request, reply);
+                break;
+            case FTP_OP::OpenFileRO:
+                {
+                    // only allow one file to be open per session
+                    if (session != nullptr && session_idle_ms > FTP_SESSION_TIMEOUT) {
+                        // no activity for 3s, assume client has
+                        // timed out receiving open reply, close
+                        // the file
+                        ftp_close_session(*session);
+                        session = nullptr;
+                    }
+                    if (session != nullptr) {
+                        ftp_error(reply, FTP_ERROR::Fail);
+                        break;
                     }
-                    ftp.current_session = -1;
-                    reply.opcode = FTP_OP::Ack;
-                    break;
-                case FTP_OP::ListDirectory:
-                    ftp_list_dir(request, reply);
-                    break;
-                case FTP_OP::OpenFileRO:
-                    {
-                        // only allow one file to be open per session
-                        if (ftp.fd != -1 && now - ftp.last_send_ms > FTP_SESSION_TIMEOUT) {
-                            // no activity for 3s, assume client has
-                            // timed out receiving open reply, close
-                            // the file
-                            AP::FS().close(ftp.fd);
-                            ftp.fd = -1;
-                            ftp.current_session = -1;
-                        }
-                        if (ftp.fd != -1) {
-                            ftp_error(reply, FTP_ERROR::Fail);
-                            break;
-                        }
 
-                        // sanity check that our the request looks well formed
-                        const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
-                        if ((file_name_len != request.size) || (request.size == 0)) {
-                            ftp_error(reply, FTP_ERROR::InvalidDataSize);
-                            break;
-                        }
+                    // sanity check that our the request looks well formed
+                    const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
+                    if ((file_name_len != request.size) || (request.size == 0)) {
+                        ftp_error(reply, FTP_ERROR::InvalidDataSize);
+                        break;
+                    }
 
-                        request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
+                    request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
 
-                        // get the file size
-                        struct stat st;
-                        if (AP::FS().stat((char *)request.data, &st)) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-                        const size_t file_size = st.st_size;
-
-                        // actually open the file
-                        ftp.fd = AP::FS().open((char *)request.data, 0);
-                        if (ftp.fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-                        ftp.mode = FTP_FILE_MODE::Read;
-                        ftp.current_session = request.session;
+                    session = ftp_alloc_session(now);
+                    if (session == nullptr) {
+                        ftp_error(reply, FTP_ERROR::NoSessionsAvailable);
+                        break;
+                    }
 
-                        reply.opcode = FTP_OP::Ack;
-                        reply.size = sizeof(uint32_t);
-                        put_le32_ptr(reply.data, (uint32_t)file_size);
+                    // get the file size
+                    struct stat st;
+                    if (AP::FS().stat((char *)request.data, &st)) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
+                        break;
+                    }
+                    const size_t file_size = st.st_size;
 
-                        // provide compatibility with old protocol banner download
-                        if (strncmp((const char *)request.data, "@PARAM/param.pck", 16) == 0) {
-                            ftp.need_banner_send_mask |= 1U<<reply.chan;
-                        }
+                    // actually open the file
+                    session->fd = AP::FS().open((char *)request.data, 0);
+                    if (session->fd == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::ReadFile:
-                    {
-                        // must actually be working on a file
-                        if (ftp.fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FileNotFound);
-                            break;
-                        }
+                    session->mode = FTP_FILE_MODE::Read;
+                    session->id = request.session;
+                    session->sysid = request.sysid;
+                    session->compid = request.compid;
+                    session->last_use_ms = now;
+#if FTP_READ_AHEAD_SIZE > 0
+                    // if this fails we fall back to reading directly
+                    session->read_buf = new uint8_t[FTP_READ_AHEAD_SIZE];
+                    session->read_buf_offset = 0;
+                    session->read_buf_len = 0;
+#endif
 
-                        // must have the file in read mode
-                        if ((ftp.mode != FTP_FILE_MODE::Read)) {
-                            ftp_error(reply, FTP_ERROR::Fail);
-                            break;
-                        }
+                    reply.opcode = FTP_OP::Ack;
+                    reply.size = sizeof(uint32_t);
+                    put_le32_ptr(reply.data, (uint32_t)file_size);
 
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    // provide compatibility with old protocol banner download
+                    if (strncmp((const char *)request.data, "@PARAM/param.pck", 16) == 0) {
+                        ftp.need_banner_send_mask |= 1U<<reply.chan;
+                    }
+                    break;
+                }
+            case FTP_OP::ReadFile:
+                {
+                    // must actually be working on a file
+                    if (session == nullptr) {
+                        ftp_error(reply, FTP_ERROR::FileNotFound);
+                        break;
+                    }
 
-                        // fill the buffer
-                        const ssize_t read_bytes = AP::FS().read(ftp.fd, reply.data, request.size);
-                        if (read_bytes == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-                        if (read_bytes == 0) {
-                            ftp_error(reply, FTP_ERROR::EndOfFile);
-                            break;
-                        }
+                    // must have the file in read mode
+                    if ((session->mode != FTP_FILE_MODE::Read)) {
+                        ftp_error(reply, FTP_ERROR::Fail);
+                        break;
+                    }
 
-                        reply.opcode = FTP_OP::Ack;
-                        reply.offset = request.offset;
-                        reply.size = (uint8_t)read_bytes;
+                    // fill the buffer
+                    const ssize_t read_bytes = ftp_read(*session, request.offset, reply.data, request.size);
+                    if (read_bytes == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
+                        break;
+                    }
+                    if (read_bytes == 0) {
+                        ftp_error(reply, FTP_ERROR::EndOfFile);
                         break;
                     }
-                case FTP_OP::Ack:
-                case FTP_OP::Nack:
-                    // eat these, we just didn't expect them
-                    continue;
+
+                    reply.opcode = FTP_OP::Ack;
+                    reply.offset = request.offset;
+                    reply.size = (uint8_t)read_bytes;
                     break;
-                case FTP_OP::OpenFileWO:
-                case FTP_OP::CreateFile:
-                    {
-                        // only allow one file to be open per session
-                        if (ftp.fd != -1) {
-                            ftp_error(reply, FTP_ERROR::Fail);
-                            break;
-                        }
+                }
+            case FTP_OP::Ack:
+            case FTP_OP::Nack:
+                // eat these, we just didn't expect them
+                continue;
+                break;
+            case FTP_OP::OpenFileWO:
+            case FTP_OP::CreateFile:
+                {
+                    // only allow one file to be open per session
+                    if (session != nullptr) {
+                        ftp_error(reply, FTP_ERROR::Fail);
+                        break;
+                    }
 
-                        // sanity check that our the request looks well formed
-                        const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
-                        if ((file_name_len != request.size) || (request.size == 0)) {
-                            ftp_error(reply, FTP_ERROR::InvalidDataSize);
-                            break;
-                        }
+                    // sanity check that our the request looks well formed
+                    const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
+                    if ((file_name_len != request.size) || (request.size == 0)) {
+                        ftp_error(reply, FTP_ERROR::InvalidDataSize);
+                        break;
+                    }
 
-                        request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
+                    request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
 
-                        // actually open the file
-                        ftp.fd = AP::FS().open((char *)request.data,
-                                               (request.opcode == FTP_OP::CreateFile) ? O_WRONLY|O_CREAT|O_TRUNC : O_WRONLY);
-                        if (ftp.fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
-                        ftp.mode = FTP_FILE_MODE::Write;
-                        ftp.current_session = request.session;
+                    session = ftp_alloc_session(now);
+                    if (session == nullptr) {
+                        ftp_error(reply, FTP_ERROR::NoSessionsAvailable);
+                        break;
+                    }
 
-                        reply.opcode = FTP_OP::Ack;
+                    // actually open the file
+                    session->fd = AP::FS().open((char *)request.data,
+                                                (request.opcode == FTP_OP::CreateFile) ? O_WRONLY|O_CREAT|O_TRUNC : O_WRONLY);
+                    if (session->fd == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::WriteFile:
-                    {
-                        // must actually be working on a file
-                        if (ftp.fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FileNotFound);
-                            break;
-                        }
+                    session->mode = FTP_FILE_MODE::Write;
+                    session->id = request.session;
+                    session->sysid = request.sysid;
+                    session->compid = request.compid;
+                    session->last_use_ms = now;
 
-                        // must have the file in write mode
-                        if ((ftp.mode != FTP_FILE_MODE::Write)) {
-                            ftp_error(reply, FTP_ERROR::Fail);
-                            break;
-                        }
+                    reply.opcode = FTP_OP::Ack;
+                    break;
+                }
+            case FTP_OP::WriteFile:
+                {
+                    // must actually be working on a file
+                    if (session == nullptr) {
+                        ftp_error(reply, FTP_ERROR::FileNotFound);
+                        break;
+                    }
 
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    // must have the file in write mode
+                    if ((session->mode != FTP_FILE_MODE::Write)) {
+                        ftp_error(reply, FTP_ERROR::Fail);
+                        break;
+                    }
 
-                        // fill the buffer
-                        const ssize_t write_bytes = AP::FS().write(ftp.fd, request.data, request.size);
-                        if (write_bytes == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    // seek to requested offset
+                    if (AP::FS().lseek(session->fd, request.offset, SEEK_SET) == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
+                        break;
+                    }
 
-                        reply.opcode = FTP_OP::Ack;
-                        reply.offset = request.offset;
+                    // fill the buffer
+                    const ssize_t write_bytes = AP::FS().write(session->fd, request.data, request.size);
+                    if (write_bytes == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::CreateDirectory:
-                    {
-                        // sanity check that our the request looks well formed
-                        const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
-                        if ((file_name_len != request.size) || (request.size == 0)) {
-                            ftp_error(reply, FTP_ERROR::InvalidDataSize);
-                            break;
-                        }
 
-                        request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
+                    reply.opcode = FTP_OP::Ack;
+                    reply.offset = request.offset;
+                    break;
+                }
+            case FTP_OP::CreateDirectory:
+                {
+                    // sanity check that our the request looks well formed
+                    const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
+                    if ((file_name_len != request.size) || (request.size == 0)) {
+                        ftp_error(reply, FTP_ERROR::InvalidDataSize);
+                        break;
+                    }
 
-                        // actually make the directory
-                        if (AP::FS().mkdir((char *)request.data) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
 
-                        reply.opcode = FTP_OP::Ack;
+                    // actually make the directory
+                    if (AP::FS().mkdir((char *)request.data) == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::RemoveDirectory:
-                case FTP_OP::RemoveFile:
-                    {
-                        // sanity check that our the request looks well formed
-                        const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
-                        if ((file_name_len != request.size) || (request.size == 0)) {
-                            ftp_error(reply, FTP_ERROR::InvalidDataSize);
-                            break;
-                        }
 
-                        request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
+                    reply.opcode = FTP_OP::Ack;
+                    break;
+                }
+            case FTP_OP::RemoveDirectory:
+            case FTP_OP::RemoveFile:
+                {
+                    // sanity check that our the request looks well formed
+                    const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
+                    if ((file_name_len != request.size) || (request.size == 0)) {
+                        ftp_error(reply, FTP_ERROR::InvalidDataSize);
+                        break;
+                    }
 
-                        // remove the file/dir
-                        if (AP::FS().unlink((char *)request.data) == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
 
-                        reply.opcode = FTP_OP::Ack;
+                    // remove the file/dir
+                    if (AP::FS().unlink((char *)request.data) == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::CalcFileCRC32:
-                    {
-                        // sanity check that our the request looks well formed
-                        const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
-                        if ((file_name_len != request.size) || (request.size == 0)) {
-                            ftp_error(reply, FTP_ERROR::InvalidDataSize);
-                            break;
-                        }
 
-                        request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
+                    reply.opcode = FTP_OP::Ack;
+                    break;
+                }
+            case FTP_OP::CalcFileCRC32:
+                {
+                    // sanity check that our the request looks well formed
+                    const size_t file_name_len = strnlen((char *)request.data, sizeof(request.data));
+                    if ((file_name_len != request.size) || (request.size == 0)) {
+                        ftp_error(reply, FTP_ERROR::InvalidDataSize);
+                        break;
+                    }
 
-                        // actually open the file
-                        int fd = AP::FS().open((char *)request.data, O_RDONLY);
-                        if (fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FailErrno);
-                            break;
-                        }
+                    request.data[sizeof(request.data) - 1] = 0; // ensure the path is null terminated
 
-                        uint32_t checksum = 0;
-                        ssize_t read_size;
-                        do {
-                            read_size = AP::FS().read(fd, reply.data, sizeof(reply.data));
-                            if (read_size == -1) {
-                                ftp_error(reply, FTP_ERROR::FailErrno);
-                                break;
-                            }
-                            checksum = crc_crc32(checksum, reply.data, MIN((size_t)read_size, sizeof(reply.data)));
-                        } while (read_size > 0);
-
-                        AP::FS().close(fd);
-
-                        // reset our scratch area so we don't leak data, and can leverage trimming
-                        memset(reply.data, 0, sizeof(reply.data));
-                        reply.size = sizeof(uint32_t);
-                        put_le32_ptr(reply.data, checksum);
-                        reply.opcode = FTP_OP::Ack;
+                    // actually open the file
+                    int fd = AP::FS().open((char *)request.data, O_RDONLY);
+                    if (fd == -1) {
+                        ftp_error(reply, FTP_ERROR::FailErrno);
                         break;
                     }
-                case FTP_OP::BurstReadFile:
-                    {
-                        const uint16_t max_read = (request.size == 0?sizeof(reply.data):request.size);
-                        // must actually be working on a file
-                        if (ftp.fd == -1) {
-                            ftp_error(reply, FTP_ERROR::FileNotFound);
-                            break;
-                        }
 
-                        // must have the file in read mode
-                        if ((ftp.mode != FTP_FILE_MODE::Read)) {
-                            ftp_error(reply, FTP_ERROR::Fail);
-                            break;
-                        }
-
-                        // seek to requested offset
-                        if (AP::FS().lseek(ftp.fd, request.offset, SEEK_SET) == -1) {
+                    uint32_t checksum = 0;
+                    ssize_t read_size;
+                    do {
+                        read_size = AP::FS().read(fd, reply.data, sizeof(reply.data));
+                        if (read_size == -1) {
                             ftp_error(reply, FTP_ERROR::FailErrno);
                             break;
                         }
+                        checksum = crc_crc32(checksum, reply.data, MIN((size_t)read_size, sizeof(reply.data)));
+                    } while (read_size > 0);
 
-                        const uint32_t transfer_size = 100;
-                        for (uint32_t i = 0; (i < transfer_size); i++) {
-                            // fill the buffer
-                            const ssize_t read_bytes = AP::FS().read(ftp.fd, reply.data, max_read);
-                            if (read_bytes == -1) {
-                                ftp_error(reply, FTP_ERROR::FailErrno);
-                                break;
-                            }
-
-                            if (read_bytes != sizeof(reply.data)) {
-                                // don't send any old data
-                                memset(reply.data + read_bytes, 0, sizeof(reply.data) - read_bytes);
-                            }
-
-                            if (read_bytes == 0) {
-                                ftp_error(reply, FTP_ERROR::EndOfFile);
-                                break;
-                            }
-
-                            reply.opcode = FTP_OP::Ack;
-                            reply.offset = request.offset + i * max_read;
-                            reply.burst_complete = (i == (transfer_size - 1));
-                            reply.size = (uint8_t)read_bytes;
-
-                            ftp_push_replies(reply);
-
-                            if (read_bytes < max_read) {
-                                // ensure the NACK which we send next is at the right offset
-                                reply.offset += read_bytes;
-                            }
-
-                            // prep the reply to be used again
-                            reply.seq_number++;
-                        }
+                    AP::FS().close(fd);
 
-                        if (reply.opcode != FTP_OP::Nack) {
-                            // prevent a duplicate packet send for
-                            // normal replies of burst reads
-                            skip_push_reply = true;
-                        }
+                    // reset our scratch area so we don't leak data, and can leverage trimming
+                    memset(reply.data, 0, sizeof(reply.data));
+                    reply.size = sizeof(uint32_t);
+                    put_le32_ptr(reply.data, checksum);
+                    reply.opcode = FTP_OP::Ack;
+                    break;
+                }
+            case FTP_OP::BurstReadFile:
+                {
+                    const uint16_t max_read = (request.size == 0?sizeof(reply.data):request.size);
+                    // must actually be working on a file
+                    if (session == nullptr) {
+                        ftp_error(reply, FTP_ERROR::FileNotFound);
                         break;
                     }
-                case FTP_OP::TruncateFile:
-                case FTP_OP::Rename:
-                default:
-                    // this was bad data, just nack it
-                    gcs().send_text(MAV_SEVERITY_DEBUG, "Unsupported FTP: %d", static_cast<int>(request.opcode));
-                    ftp_error(reply, FTP_ERROR::Fail);
+
+                    // must have the file in read mode
+                    if ((session->mode != FTP_FILE_MODE::Read)) {
+                        ftp_error(reply, FTP_ERROR::Fail);
+                        break;
+                    }
+
+                    // queue what the link has room for now, the
+                    // worker sends the rest as the queue drains
+                    session->burst_chan = request.chan;
+                    session->burst_remaining = ftp_burst_packets(request.chan);
+                    session->burst_seq = reply.seq_number;
+                    session->burst_offset = request.offset;
+                    session->burst_max_read = max_read;
+                    ftp_burst_send(*session);
+
+                    // the burst sends its own replies, and a resent
+                    // request starts it again rather than repeating
+                    // the last reply
+                    skip_push_reply = true;
+                    if (cached != nullptr) {
+                        cached->valid = false;
+                    }
                     break;
-            }
+                }
+            case FTP_OP::TruncateFile:
+            case FTP_OP::Rename:
+            default:
+                // this was bad data, just nack it
+                gcs().send_text(MAV_SEVERITY_DEBUG, "Unsupported FTP: %d", static_cast<int>(request.opcode));
+                ftp_error(reply, FTP_ERROR::Fail);
+                break;
         }
 
         if (!skip_push_reply) {
-            ftp_push_replies(reply);
+            ftp_send_reply(reply, now);
         }
 
         continue;
@@ -0,0 +1,346 @@
+/*
+   GCS MAVLink per link scheduling of streamed messages
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <AP_HAL/AP_HAL.h>
+
+#include "GCS.h"
+
+#include <AP_Common/ExpandingString.h>
+
+extern const AP_HAL::HAL& hal;
+
+#if GCS_STREAM_SCHEDULER_ENABLED
+
+// time constant of the throughput filters in seconds
+#define STREAM_SCHED_FILTER_TC   1.0f
+// lowest rate a congested link is limited to, bytes/s
+#define STREAM_SCHED_MIN_RATE    100.0f
+// smallest bucket, enough for a few of the largest messages
+#define STREAM_SCHED_MIN_BURST   300.0f
+// how long the link must be clear before the rate is raised again
+#define STREAM_SCHED_HOLD_MS     1000U
+// how long the limit must go unused before it is removed
+#define STREAM_SCHED_RELEASE_MS  2000U
+#if GCS_STREAM_SCHEDULER_DEBUG
+// window the per message rates are counted over
+#define STREAM_SCHED_WINDOW_MS   5000U
+#endif
+
+/*
+  how important a streamed message is to someone flying the
+  vehicle. High priority messages are the last to be slowed on a
+  congested link, low priority ones the first
+ */
+GCS_MAVLINK::StreamPriority GCS_MAVLINK::stream_priority(const ap_message id)
+{
+    switch (id) {
+    case MSG_HEARTBEAT:
+    case MSG_ATTITUDE:
+    case MSG_LOCATION:
+    case MSG_SYS_STATUS:
+    case MSG_VFR_HUD:
+    case MSG_GPS_RAW:
+    case MSG_CURRENT_WAYPOINT:
+    case MSG_MISSION_ITEM_REACHED:
+    case MSG_FENCE_STATUS:
+    case MSG_BATTERY_STATUS:
+    case MSG_EXTENDED_SYS_STATE:
+    case MSG_HOME:
+    case MSG_ORIGIN:
+    case MSG_ADSB_VEHICLE:
+    case MSG_MAG_CAL_PROGRESS:
+    case MSG_MAG_CAL_REPORT:
+        return StreamPriority::HIGH;
+
+    case MSG_ATTITUDE_QUATERNION:
+    case MSG_POWER_STATUS:
+    case MSG_MEMINFO:
+    case MSG_RAW_IMU:
+    case MSG_SCALED_IMU:
+    case MSG_SCALED_IMU2:
+    case MSG_SCALED_IMU3:
+    case MSG_SCALED_PRESSURE:
+    case MSG_SCALED_PRESSURE2:
+    case MSG_SCALED_PRESSURE3:
+    case MSG_SENSOR_OFFSETS:
+    case MSG_GPS_RTK:
+    case MSG_GPS2_RTK:
+    case MSG_AHRS:
+    case MSG_SIMSTATE:
+    case MSG_SIM_STATE:
+    case MSG_AHRS2:
+    case MSG_HWSTATUS:
+    case MSG_WIND:
+    case MSG_OPTICAL_FLOW:
+    case MSG_GIMBAL_REPORT:
+    case MSG_EKF_STATUS_REPORT:
+    case MSG_PID_TUNING:
+    case MSG_VIBRATION:
+    case MSG_RPM:
+    case MSG_WHEEL_DISTANCE:
+    case MSG_AOA_SSA:
+    case MSG_ESC_TELEMETRY:
+    case MSG_NAMED_FLOAT:
+        return StreamPriority::LOW;
+
+    default:
+        return StreamPriority::NORMAL;
+    }
+}
+
+/*
+  bucket size for the current rate
+ */
+float GCS_MAVLINK::stream_sched_burst(void) const
+{
+    return MAX(stream_sched.rate * 0.25f, STREAM_SCHED_MIN_BURST);
+}
+
+/*
+  measure what the link is carrying and refill the tokens. Called at
+  the start of each update_send()
+ */
+void GCS_MAVLINK::stream_sched_update(void)
+{
+    // held back messages are tried again on each pass
+    stream_sched.held.clearall();
+
+    if (_locked) {
+        return;
+    }
+    const uint32_t now_us = AP_HAL::micros();
+    const uint32_t now_ms = AP_HAL::millis();
+    const uint32_t tx_bytes = mavlink_tx_bytes[chan];
+    const uint16_t space = txspace();
+
+    if (stream_sched.last_update_us == 0) {
+        stream_sched.last_update_us = now_us;
+        stream_sched.last_tx_bytes = tx_bytes;
+        stream_sched.last_txspace = space;
+        stream_sched.max_txspace = space;
+#if GCS_STREAM_SCHEDULER_DEBUG
+        stream_sched.window_start_ms = now_ms;
+#endif
+        return;
+    }
+    const float dt = (now_us - stream_sched.last_update_us) * 1.0e-6f;
+    if (dt < 0.01f) {
+        // too short an interval to measure rates over
+        return;
+    }
+
+    // whatever was written and is no longer queued has been sent
+    const uint32_t written = tx_bytes - stream_sched.last_tx_bytes;
+    const int32_t drained = int32_t(written) + int32_t(space) - int32_t(stream_sched.last_txspace);
+    stream_sched.max_txspace = MAX(stream_sched.max_txspace, space);
+    const float alpha = constrain_float(dt / STREAM_SCHED_FILTER_TC, 0, 1);
+    stream_sched.tx_rate += (written / dt - stream_sched.tx_rate) * alpha;
+    stream_sched.drain_rate += (MAX(drained, 0) / dt - stream_sched.drain_rate) * alpha;
+
+    if (space < stream_sched.max_txspace / 4) {
+        // the port is backed up, so it is sending as fast as it can
+        stream_sched.last_congested_ms = now_ms;
+        const float limit = MAX(stream_sched.drain_rate * 0.9f, STREAM_SCHED_MIN_RATE);
+        if (is_zero(stream_sched.rate) || stream_sched.rate > limit) {
+            stream_sched.rate = limit;
+        }
+    } else if (!is_zero(stream_sched.rate) &&
+               now_ms - stream_sched.last_congested_ms > STREAM_SCHED_HOLD_MS) {
+        if (now_ms - stream_sched.last_throttle_ms > STREAM_SCHED_RELEASE_MS) {
+            // nothing has been held back, the limit isn't needed
+            stream_sched.rate = 0;
+        } else {
+            // probe for more bandwidth
+            stream_sched.rate *= 1 + 0.25f * dt;
+        }
+    }
+
+    if (is_zero(stream_sched.rate)) {
+        stream_sched.tokens = 0;
+    } else {
+        const float burst = stream_sched_burst();
+        stream_sched.tokens = constrain_float(stream_sched.tokens + stream_sched.rate * dt - written,
+                                              -burst, burst);
+    }
+
+    stream_sched.last_update_us = now_us;
+    stream_sched.last_tx_bytes = tx_bytes;
+    stream_sched.last_txspace = space;
+
+#if GCS_STREAM_SCHEDULER_DEBUG
+    if (now_ms - stream_sched.window_start_ms >= STREAM_SCHED_WINDOW_MS) {
+        memcpy(stream_sched.last_sent, stream_sched.sent, sizeof(stream_sched.sent));
+        memcpy(stream_sched.last_throttled, stream_sched.throttled, sizeof(stream_sched.throttled));
+        memset(stream_sched.sent, 0, sizeof(stream_sched.sent));
+        memset(stream_sched.throttled, 0, sizeof(stream_sched.throttled));
+        stream_sched.window_ms = now_ms - stream_sched.window_start_ms;
+        stream_sched.window_start_ms = now_ms;
+    }
+#endif
+}
+
+/*
+  the radio buffers at its air rate, which the port can't see, so
+  take its buffer level as a sign of congestion too
+ */
+void GCS_MAVLINK::stream_sched_radio_status(const uint8_t txbuf)
+{
+    if (txbuf > 90) {
+        return;
+    }
+    // hold the rate where it is until the radio has room again
+    stream_sched.last_congested_ms = AP_HAL::millis();
+    float scale;
+    if (txbuf < 20) {
+        scale = 0.7f;
+    } else if (txbuf < 50) {
+        scale = 0.9f;
+    } else {
+        return;
+    }
+    float rate = stream_sched.tx_rate;
+    if (!is_zero(stream_sched.rate)) {
+        rate = MIN(rate, stream_sched.rate);
+    }
+    stream_sched.rate = MAX(rate * scale, STREAM_SCHED_MIN_RATE);
+}
+
+/*
+  admit a streamed message if the tokens left, less everything
+  written since the last update, leave the headroom its priority
+  needs. High priority messages may borrow from the next refill. A
+  message held back stays in its bucket, and is only skipped if it
+  is still held back when everything else in the bucket has gone
+ */
+bool GCS_MAVLINK::stream_sched_admit(const ap_message id)
+{
+    if (is_zero(stream_sched.rate)) {
+        return true;
+    }
+    const float burst = stream_sched_burst();
+    float threshold;
+    switch (stream_priority(id)) {
+    case StreamPriority::HIGH:
+        threshold = -0.5f * burst;
+        break;
+    case StreamPriority::NORMAL:
+        threshold = 0.25f * burst;
+        break;
+    case StreamPriority::LOW:
+    default:
+        threshold = 0.5f * burst;
+        break;
+    }
+    const float tokens = stream_sched.tokens - (mavlink_tx_bytes[chan] - stream_sched.last_tx_bytes);
+    if (tokens >= threshold) {
+        return true;
+    }
+    stream_sched.held.set(id);
+#if GCS_STREAM_SCHEDULER_DEBUG
+    stream_sched.throttled[id]++;
+#endif
+    stream_sched.last_throttle_ms = AP_HAL::millis();
+    return false;
+}
+
+/*
+  once everything left in the bucket is held back, the bucket is
+  rescheduled without them. They are skipped until it comes round
+  again, as if their interval were longer
+ */
+bool GCS_MAVLINK::stream_sched_bucket_held(void)
+{
+    const int16_t first = bucket_message_ids_to_send.first_set();
+    if (first == -1) {
+        return false;
+    }
+    uint16_t count = 0;
+    for (uint16_t i=first; i<MSG_LAST; i++) {
+        if (!bucket_message_ids_to_send.get(i)) {
+            continue;
+        }
+        if (!stream_sched.held.get(i)) {
+            return false;
+        }
+        count++;
+    }
+    stream_sched.skipped += count;
+    return true;
+}
+
+#else
+
+bool GCS_MAVLINK::stream_sched_admit(const ap_message id)
+{
+    return true;
+}
+
+bool GCS_MAVLINK::stream_sched_bucket_held(void)
+{
+    return false;
+}
+
+#endif // GCS_STREAM_SCHEDULER_ENABLED
+
+/*
+  scheduler state and, with GCS_STREAM_SCHEDULER_DEBUG, the rate each
+  message was sent and held back at over the last window
+ */
+void GCS_MAVLINK::stream_info(ExpandingString &str) const
+{
+#if GCS_STREAM_SCHEDULER_ENABLED
+    str.printf("CHAN%u limit=%.0f tx=%.0f drain=%.0f tokens=%.0f skipped=%u\n",
+               unsigned(chan),
+               stream_sched.rate,
+               stream_sched.tx_rate,
+               stream_sched.drain_rate,
+               stream_sched.tokens,
+               unsigned(stream_sched.skipped));
+#if GCS_STREAM_SCHEDULER_DEBUG
+    if (stream_sched.window_ms == 0) {
+        return;
+    }
+    const float scale = 1000.0f / stream_sched.window_ms;
+    for (uint8_t i=0; i<MSG_LAST; i++) {
+        if (stream_sched.last_sent[i] == 0 && stream_sched.last_throttled[i] == 0) {
+            continue;
+        }
+        const ap_message id = (ap_message)i;
+        uint16_t interval_ms = 0;
+        get_ap_message_interval(id, interval_ms);
+        str.printf("  MSG%-3u %c int=%-5u rate=%5.1f held=%5.1f\n",
+                   unsigned(i),
+                   "HNL"[uint8_t(stream_priority(id))],
+                   unsigned(interval_ms),
+                   stream_sched.last_sent[i] * scale,
+                   stream_sched.last_throttled[i] * scale);
+    }
+#endif // GCS_STREAM_SCHEDULER_DEBUG
+#endif
+}
+
+/*
+  stream scheduler state of every link
+ */
+void GCS::stream_info(ExpandingString &str) const
+{
+    for (uint8_t i=0; i<num_gcs(); i++) {
+        const GCS_MAVLINK *c = chan(i);
+        if (c != nullptr) {
+            c->stream_info(str);
+        }
+    }
+}
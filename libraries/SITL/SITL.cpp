@@ -213,6 +213,9 @@ const AP_Param::GroupInfo SITL::var_info3[] = {
     // count of simulated IMUs
     AP_GROUPINFO("IMU_COUNT",    23, SITL,  imu_count,  2),
 
+    // proximity sensor scan rate in points per second, 0 for a reading every 45 degrees
+    AP_GROUPINFO("PRX_SCAN",     24, SITL,  prx_scan_rate,  0),
+
     // @Path: ./SIM_RichenPower.cpp
     AP_SUBGROUPINFO(richenpower_sim, "RICH_", 31, SITL, RichenPower),
 
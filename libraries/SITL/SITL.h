@@ -233,6 +233,8 @@ public:
     AP_Float buoyancy; // submarine buoyancy in Newtons
     AP_Int16 loop_rate_hz;
 
+    AP_Int16 prx_scan_rate; // simulated proximity sensor points per second pushed to the object database
+
 #ifdef SFML_JOYSTICK
     AP_Int8 sfml_joystick_id;
     AP_Int8 sfml_joystick_axis[8];
@@ -140,6 +140,14 @@ void StorageManager::erase(void)
     }
 }
 
+/*
+  check if all writes have been written out by the HAL
+ */
+bool StorageManager::flushed(void)
+{
+    return hal.storage->flushed();
+}
+
 /*
   constructor for StorageAccess
  */
@@ -64,6 +64,9 @@ public:
     // erase whole of storage
     static void erase(void);
 
+    // true when all writes so far have reached the storage device
+    static bool flushed(void);
+
 private:
     struct StorageArea {
         StorageType type;